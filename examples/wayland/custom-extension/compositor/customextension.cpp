@@ -69,7 +69,7 @@ void CustomExtension::initialize()
 void CustomExtension::setFontSize(QWaylandSurface *surface, uint pixelSize)
 {
     if (surface) {
-        Resource *target = resourceMap().value(surface->waylandClient());
+        Resource *target = clientResource(surface->waylandClient());
         if (target) {
             qDebug() << "Server-side extension sending setFontSize:" << pixelSize;
             send_set_font_size(target->handle,  surface->resource(), pixelSize);
@@ -80,7 +80,7 @@ void CustomExtension::setFontSize(QWaylandSurface *surface, uint pixelSize)
 void CustomExtension::showDecorations(QWaylandClient *client, bool shown)
 {
     if (client) {
-        Resource *target = resourceMap().value(client->client());
+        Resource *target = clientResource(client->client());
         if (target) {
             qDebug() << "Server-side extension sending showDecorations:" << shown;
             send_set_window_decoration(target->handle, shown);
@@ -92,7 +92,7 @@ void CustomExtension::showDecorations(QWaylandClient *client, bool shown)
 void CustomExtension::close(QWaylandSurface *surface)
 {
     if (surface) {
-        Resource *target = resourceMap().value(surface->waylandClient());
+        Resource *target = clientResource(surface->waylandClient());
         if (target) {
             qDebug() << "Server-side extension sending close for" << surface;
             send_close(target->handle,  surface->resource());
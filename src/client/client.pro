@@ -28,6 +28,10 @@ qtHaveModule(linuxaccessibility_support-private): \
 
 QMAKE_USE += wayland-client
 
+# Count the messages passing through the generated protocol code,
+# see QWaylandDisplay::protocolStatistics()
+qtConfig(wayland-client-protocol-statistics): DEFINES += QT_WAYLAND_PROTOCOL_STATISTICS
+
 INCLUDEPATH += $$PWD/../shared
 
 WAYLANDCLIENTSOURCES += \
@@ -65,6 +69,9 @@ SOURCES +=  qwaylandintegration.cpp \
             qwaylandinputcontext.cpp \
             qwaylandshm.cpp \
             qwaylandbuffer.cpp \
+            qwaylandprotocolstatistics.cpp \
+            qwaylandtrace.cpp \
+            ../shared/qwaylandtracewriter.cpp \
 
 HEADERS +=  qwaylandintegration_p.h \
             qwaylandnativeinterface_p.h \
@@ -88,11 +95,14 @@ HEADERS +=  qwaylandintegration_p.h \
             qwaylandwindowmanagerintegration_p.h \
             qwaylandinputcontext_p.h \
             qwaylandshm_p.h \
+            qwaylandprotocolstatistics_p.h \
+            qwaylandtrace_p.h \
             qtwaylandclientglobal.h \
             qtwaylandclientglobal_p.h \
             ../shared/qwaylandinputmethodeventbuilder_p.h \
             ../shared/qwaylandmimehelper_p.h \
             ../shared/qwaylandsharedmemoryformathelper_p.h \
+            ../shared/qwaylandtracewriter_p.h \
 
 qtConfig(clipboard) {
     HEADERS += qwaylandclipboard_p.h
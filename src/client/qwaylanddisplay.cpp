@@ -71,6 +71,8 @@
 #include "qwaylandtouch_p.h"
 #include "qwaylandtabletv2_p.h"
 #include "qwaylandqtkey_p.h"
+#include "qwaylandprotocolstatistics_p.h"
+#include "qwaylandtrace_p.h"
 
 #include <QtWaylandClient/private/qwayland-text-input-unstable-v2.h>
 #include <QtWaylandClient/private/qwayland-wp-primary-selection-unstable-v1.h>
@@ -142,6 +144,10 @@ QWaylandDisplay::QWaylandDisplay(QWaylandIntegration *waylandIntegration)
 {
     qRegisterMetaType<uint32_t>("uint32_t");
 
+    if (qEnvironmentVariableIntValue("QT_WAYLAND_PROTOCOL_STATISTICS"))
+        QWaylandProtocolStatistics::setEnabled(true);
+    QWaylandTrace::initialize();
+
     mDisplay = wl_display_connect(nullptr);
     if (!mDisplay) {
         qErrnoWarning(errno, "Failed to create wl_display");
@@ -169,6 +175,9 @@ QWaylandDisplay::QWaylandDisplay(QWaylandIntegration *waylandIntegration)
 
 QWaylandDisplay::~QWaylandDisplay(void)
 {
+    if (qEnvironmentVariableIntValue("QT_WAYLAND_PROTOCOL_STATISTICS"))
+        qCInfo(lcQpaWayland).noquote() << "Protocol statistics:\n" << QWaylandProtocolStatistics::dump();
+
     if (mSyncCallback)
         wl_callback_destroy(mSyncCallback);
 
@@ -296,6 +305,29 @@ void QWaylandDisplay::dispatchQueueWhile(wl_event_queue *queue, std::function<bo
     }
 }
 
+// The counters are shared by everything in the process that uses code generated by
+// qtwaylandscanner with QT_WAYLAND_PROTOCOL_STATISTICS defined, which the client does
+// when configured with -feature-wayland-client-protocol-statistics.
+bool QWaylandDisplay::protocolStatisticsEnabled() const
+{
+    return QWaylandProtocolStatistics::isEnabled();
+}
+
+void QWaylandDisplay::setProtocolStatisticsEnabled(bool enabled)
+{
+    QWaylandProtocolStatistics::setEnabled(enabled);
+}
+
+QString QWaylandDisplay::protocolStatistics() const
+{
+    return QWaylandProtocolStatistics::dump();
+}
+
+void QWaylandDisplay::resetProtocolStatistics()
+{
+    QWaylandProtocolStatistics::reset();
+}
+
 QWaylandScreen *QWaylandDisplay::screenForOutput(struct wl_output *output) const
 {
     for (auto screen : qAsConst(mScreens)) {
@@ -217,6 +217,11 @@ public:
     void destroyFrameQueue(const FrameQueue &q);
     void dispatchQueueWhile(wl_event_queue *queue, std::function<bool()> condition, int timeout = -1);
 
+    bool protocolStatisticsEnabled() const;
+    void setProtocolStatisticsEnabled(bool enabled);
+    QString protocolStatistics() const;
+    void resetProtocolStatistics();
+
 public slots:
     void blockingReadEvents();
     void flushRequests();
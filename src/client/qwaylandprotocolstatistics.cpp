@@ -0,0 +1,149 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwaylandprotocolstatistics_p.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include <wayland-util.h>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWaylandClient {
+
+namespace {
+
+struct Counter
+{
+    quint64 messages = 0;
+    quint64 bytes = 0;
+};
+
+struct InterfaceCounters
+{
+    QVector<Counter> requests;
+    QVector<Counter> events;
+};
+
+struct StatisticsData
+{
+    QMutex mutex;
+    QHash<const struct ::wl_interface *, InterfaceCounters> interfaces;
+};
+
+Q_GLOBAL_STATIC(StatisticsData, statisticsData)
+
+}
+
+QBasicAtomicInt QWaylandProtocolStatistics::s_enabled = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+void QWaylandProtocolStatistics::setEnabled(bool enabled)
+{
+    s_enabled.storeRelaxed(enabled ? 1 : 0);
+}
+
+void QWaylandProtocolStatistics::record(const struct ::wl_interface *interface, int opcode, bool request, uint32_t size)
+{
+    StatisticsData *data = statisticsData();
+    QMutexLocker locker(&data->mutex);
+
+    auto it = data->interfaces.find(interface);
+    if (it == data->interfaces.end()) {
+        it = data->interfaces.insert(interface, InterfaceCounters());
+        it->requests.resize(interface->method_count);
+        it->events.resize(interface->event_count);
+    }
+
+    QVector<Counter> &counters = request ? it->requests : it->events;
+    if (opcode < 0 || opcode >= counters.size())
+        return;
+
+    Counter &counter = counters[opcode];
+    ++counter.messages;
+    counter.bytes += size;
+}
+
+void QWaylandProtocolStatistics::reset()
+{
+    StatisticsData *data = statisticsData();
+    QMutexLocker locker(&data->mutex);
+    data->interfaces.clear();
+}
+
+QString QWaylandProtocolStatistics::dump()
+{
+    struct Line {
+        QString name;
+        Counter counter;
+    };
+    QVector<Line> lines;
+
+    {
+        StatisticsData *data = statisticsData();
+        QMutexLocker locker(&data->mutex);
+        for (auto it = data->interfaces.cbegin(), end = data->interfaces.cend(); it != end; ++it) {
+            const struct ::wl_interface *interface = it.key();
+            for (int i = 0; i < it->requests.size(); ++i) {
+                if (it->requests.at(i).messages)
+                    lines.append({ QString::asprintf("%s.%s (request)", interface->name, interface->methods[i].name), it->requests.at(i) });
+            }
+            for (int i = 0; i < it->events.size(); ++i) {
+                if (it->events.at(i).messages)
+                    lines.append({ QString::asprintf("%s.%s (event)", interface->name, interface->events[i].name), it->events.at(i) });
+            }
+        }
+    }
+
+    std::sort(lines.begin(), lines.end(), [](const Line &a, const Line &b) {
+        return a.counter.bytes > b.counter.bytes;
+    });
+
+    QString result;
+    for (const Line &line : qAsConst(lines))
+        result += QString::asprintf("%s: %llu messages, %llu bytes\n", qPrintable(line.name), line.counter.messages, line.counter.bytes);
+    return result;
+}
+
+}
+
+QT_END_NAMESPACE
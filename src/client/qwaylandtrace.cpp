@@ -0,0 +1,85 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwaylandtrace_p.h"
+#include "qwaylanddisplay_p.h"
+
+#include <qwaylandtracewriter_p.h>
+
+#include <QtCore/QCoreApplication>
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWaylandClient {
+
+Q_GLOBAL_STATIC(QWaylandTraceWriter, traceWriter)
+
+QBasicAtomicInt QWaylandTrace::s_enabled = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+void QWaylandTrace::initialize()
+{
+    if (isEnabled())
+        return;
+
+    const QString fileName = qEnvironmentVariable("QT_WAYLAND_CLIENT_TRACE");
+    if (fileName.isEmpty())
+        return;
+
+    const QByteArray processName = QCoreApplication::applicationName().toUtf8();
+    if (!traceWriter()->open(fileName, processName)) {
+        qCWarning(lcQpaWayland) << "Could not open trace file" << fileName;
+        return;
+    }
+    s_enabled.storeRelaxed(1);
+}
+
+qint64 QWaylandTrace::timestamp()
+{
+    return QWaylandTraceWriter::timestamp();
+}
+
+void QWaylandTrace::complete(const char *name, qint64 start, std::initializer_list<Arg> args)
+{
+    const qint64 end = QWaylandTraceWriter::timestamp();
+    traceWriter()->writeEvent(name, 'X', start, end - start, QWaylandTraceWriter::formatArgs(args));
+}
+
+}
+
+QT_END_NAMESPACE
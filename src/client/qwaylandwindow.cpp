@@ -52,6 +52,7 @@
 #include "qwaylanddecorationfactory_p.h"
 #include "qwaylandshmbackingstore_p.h"
 #include "qwaylandshellintegration_p.h"
+#include "qwaylandtrace_p.h"
 
 #include <QtCore/QFileInfo>
 #include <QtCore/QPointer>
@@ -601,25 +602,66 @@ void QWaylandWindow::commit(QWaylandBuffer *buffer, const QRegion &damage)
     if (!mSurface)
         return;
 
+    const qint64 traceStart = QWaylandTrace::isEnabled() ? QWaylandTrace::timestamp() : 0;
     attachOffset(buffer);
     for (const QRect &rect: damage)
         mSurface->damage(rect.x(), rect.y(), rect.width(), rect.height());
     Q_ASSERT(!buffer->committed());
     buffer->setCommitted();
     mSurface->commit();
+    if (traceStart)
+        traceCommit("commit", traceStart);
 }
 
 void QWaylandWindow::commit()
 {
+    const qint64 traceStart = QWaylandTrace::isEnabled() ? QWaylandTrace::timestamp() : 0;
     mSurface->commit();
+    if (traceStart)
+        traceCommit("commit", traceStart);
+}
+
+/*!
+ * Records a commit of the surface made since \a start, for instance by eglSwapBuffers(),
+ * under \a name. Does nothing unless tracing is enabled, see QWaylandTrace.
+ */
+void QWaylandWindow::traceCommit(const char *name, qint64 start)
+{
+    if (!QWaylandTrace::isEnabled())
+        return;
+
+    QWaylandTrace::complete(name, start, {
+        { "surface", surfaceId() },
+        { "seq", ++mCommitSequence },
+        { "frameCallback", frameCallbackId() }
+    });
+}
+
+uint QWaylandWindow::surfaceId() const
+{
+    return mSurface ? wl_proxy_get_id(reinterpret_cast<wl_proxy *>(mSurface->object())) : 0;
+}
+
+uint QWaylandWindow::frameCallbackId() const
+{
+    return mFrameCallback ? wl_proxy_get_id(reinterpret_cast<wl_proxy *>(mFrameCallback)) : 0;
 }
 
 const wl_callback_listener QWaylandWindow::callbackListener = {
     [](void *data, wl_callback *callback, uint32_t time) {
-        Q_UNUSED(callback);
         Q_UNUSED(time);
         auto *window = static_cast<QWaylandWindow*>(data);
+        if (!QWaylandTrace::isEnabled()) {
+            window->handleFrameCallback();
+            return;
+        }
+
+        const qint64 start = QWaylandTrace::timestamp();
         window->handleFrameCallback();
+        QWaylandTrace::complete("frameCallback", start, {
+            { "surface", window->surfaceId() },
+            { "frameCallback", wl_proxy_get_id(reinterpret_cast<wl_proxy *>(callback)) }
+        });
     }
 };
 
@@ -651,7 +693,16 @@ void QWaylandWindow::handleFrameCallback()
 bool QWaylandWindow::waitForFrameSync(int timeout)
 {
     QMutexLocker locker(mFrameQueue.mutex);
+    const qint64 traceStart = QWaylandTrace::isEnabled() ? QWaylandTrace::timestamp() : 0;
+    const uint traceFrameCallback = traceStart ? frameCallbackId() : 0;
     mDisplay->dispatchQueueWhile(mFrameQueue.queue, [&]() { return mWaitingForFrameCallback; }, timeout);
+    if (traceStart) {
+        QWaylandTrace::complete("waitForFrameSync", traceStart, {
+            { "surface", surfaceId() },
+            { "frameCallback", traceFrameCallback },
+            { "timedOut", mWaitingForFrameCallback }
+        });
+    }
 
     if (mWaitingForFrameCallback) {
         qCDebug(lcWaylandBackingstore) << "Didn't receive frame callback in time, window should now be inexposed";
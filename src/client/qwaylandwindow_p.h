@@ -125,6 +125,8 @@ public:
     void commit(QWaylandBuffer *buffer, const QRegion &damage);
 
     void commit();
+    // Records a commit of the surface, made since start, when tracing is enabled
+    void traceCommit(const char *name, qint64 start);
 
     bool waitForFrameSync(int timeout);
 
@@ -285,6 +287,10 @@ private:
     static const wl_callback_listener callbackListener;
     void handleFrameCallback();
 
+    uint surfaceId() const;
+    uint frameCallbackId() const;
+    qint64 mCommitSequence = 0; // Only counted when tracing
+
     static QWaylandWindow *mMouseGrab;
 
     QReadWriteLock mSurfaceLock;
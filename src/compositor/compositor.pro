@@ -16,14 +16,20 @@ QMAKE_DOCS = $$PWD/doc/qtwaylandcompositor.qdocconf
 
 QMAKE_USE += wayland-server
 
+# Count the messages passing through the generated protocol code,
+# see QWaylandCompositor::protocolStatistics()
+qtConfig(wayland-server-protocol-statistics): DEFINES += QT_WAYLAND_PROTOCOL_STATISTICS
+
 INCLUDEPATH += ../shared
 
 HEADERS += ../shared/qwaylandmimehelper_p.h \
            ../shared/qwaylandinputmethodeventbuilder_p.h \
-           ../shared/qwaylandsharedmemoryformathelper_p.h
+           ../shared/qwaylandsharedmemoryformathelper_p.h \
+           ../shared/qwaylandtracewriter_p.h
 
 SOURCES += ../shared/qwaylandmimehelper.cpp \
-           ../shared/qwaylandinputmethodeventbuilder.cpp
+           ../shared/qwaylandinputmethodeventbuilder.cpp \
+           ../shared/qwaylandtracewriter.cpp
 
 RESOURCES += compositor.qrc
 
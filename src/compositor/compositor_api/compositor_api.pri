@@ -4,6 +4,7 @@ HEADERS += \
     compositor_api/qwaylandcompositor.h \
     compositor_api/qwaylandcompositor_p.h \
     compositor_api/qwaylandclient.h \
+    compositor_api/qwaylandclient_p.h \
     compositor_api/qwaylandsurface.h \
     compositor_api/qwaylandsurface_p.h \
     compositor_api/qwaylandseat.h \
@@ -18,6 +19,10 @@ HEADERS += \
     compositor_api/qwaylandtouch_p.h \
     compositor_api/qwaylandoutput.h \
     compositor_api/qwaylandoutput_p.h \
+    compositor_api/qwaylandsoftwareoutput.h \
+    compositor_api/qwaylandsoftwareoutput_p.h \
+    compositor_api/qwaylandframestatistics.h \
+    compositor_api/qwaylandframestatistics_p.h \
     compositor_api/qwaylandoutputmode.h \
     compositor_api/qwaylandoutputmode_p.h \
     compositor_api/qwaylandbufferref.h \
@@ -27,6 +32,7 @@ HEADERS += \
     compositor_api/qwaylandview_p.h \
     compositor_api/qwaylandresource.h \
     compositor_api/qwaylandsurfacegrabber.h \
+    compositor_api/qwaylandsurfacegrabber_p.h \
     compositor_api/qwaylandoutputmode_p.h \
     compositor_api/qwaylandquickchildren.h
 
@@ -40,6 +46,8 @@ SOURCES += \
     compositor_api/qwaylandpointer.cpp \
     compositor_api/qwaylandtouch.cpp \
     compositor_api/qwaylandoutput.cpp \
+    compositor_api/qwaylandsoftwareoutput.cpp \
+    compositor_api/qwaylandframestatistics.cpp \
     compositor_api/qwaylandoutputmode.cpp \
     compositor_api/qwaylandbufferref.cpp \
     compositor_api/qwaylanddestroylistener.cpp \
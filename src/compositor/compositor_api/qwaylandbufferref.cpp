@@ -29,15 +29,64 @@
 
 #include <QDebug>
 #include <QAtomicInt>
+#include <QMutex>
 
 #include "qwaylandbufferref.h"
 #include "wayland_wrapper/qwlclientbuffer_p.h"
 
 QT_BEGIN_NAMESPACE
 
+// Buffer references are copied around on every commit, by the surface, its views and the
+// renderers, so their privates are recycled instead of allocated for each copy. References
+// are also created and dropped on the render thread, hence the lock.
+class BufferRefFreeList
+{
+public:
+    enum { MaxFree = 256 };
+
+    ~BufferRefFreeList()
+    {
+        for (int i = 0; i < m_count; ++i)
+            ::operator delete(m_free[i]);
+    }
+
+    void *take()
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_count ? m_free[--m_count] : nullptr;
+    }
+
+    bool put(void *ptr)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_count == MaxFree)
+            return false;
+        m_free[m_count++] = ptr;
+        return true;
+    }
+
+private:
+    QBasicMutex m_mutex;
+    void *m_free[MaxFree];
+    int m_count = 0;
+};
+
+Q_GLOBAL_STATIC(BufferRefFreeList, bufferRefFreeList)
+
 class QWaylandBufferRefPrivate
 {
 public:
+    static void *operator new(std::size_t size)
+    {
+        void *ptr = bufferRefFreeList.isDestroyed() ? nullptr : bufferRefFreeList()->take();
+        return ptr ? ptr : ::operator new(size);
+    }
+    static void operator delete(void *ptr)
+    {
+        if (bufferRefFreeList.isDestroyed() || !bufferRefFreeList()->put(ptr))
+            ::operator delete(ptr);
+    }
+
     QtWayland::ClientBuffer *buffer = nullptr;
 
     bool nullOrDestroyed() {
@@ -28,54 +28,206 @@
 ****************************************************************************/
 
 #include "qwaylandclient.h"
-#include <QtCore/private/qobject_p.h>
+#include "qwaylandclient_p.h"
 
 #include <QtWaylandCompositor/QWaylandCompositor>
 #include <QtWaylandCompositor/private/qwaylandcompositor_p.h>
 
+#include <QtCore/QPointer>
 
 #include <wayland-server-core.h>
 #include <wayland-util.h>
 
 QT_BEGIN_NAMESPACE
 
-class QWaylandClientPrivate : public QObjectPrivate
+namespace QtWayland {
+
+void ClientResourceUsage::addSharedMemory(qint64 bytes)
 {
-public:
-    QWaylandClientPrivate(QWaylandCompositor *compositor, wl_client *_client)
-        : compositor(compositor)
-        , client(_client)
-    {
-        // Save client credentials
-        wl_client_get_credentials(client, &pid, &uid, &gid);
+    sharedMemoryBytes.fetchAndAddRelaxed(bytes);
+    memoryChanged(bytes);
+}
+
+void ClientResourceUsage::addTextures(int count, qint64 bytes)
+{
+    textureCount.fetchAndAddRelaxed(count);
+    textureBytes.fetchAndAddRelaxed(bytes);
+    memoryChanged(bytes);
+}
+
+void ClientResourceUsage::setClient(QWaylandClient *client)
+{
+    QMutexLocker locker(&m_clientMutex);
+    m_client = client;
+}
+
+// Called from any thread. Only schedules a check when a limit has been crossed, and never
+// handles it right away: we might be in the middle of dispatching a request of the client.
+void ClientResourceUsage::memoryChanged(qint64 delta)
+{
+    const qint64 softLimit = memorySoftLimit.loadRelaxed();
+    const qint64 hardLimit = memoryHardLimit.loadRelaxed();
+    const qint64 usage = memoryUsage();
+
+    if (delta < 0) {
+        if (softLimit <= 0 || usage <= softLimit)
+            softLimitExceeded.storeRelaxed(0);
+        return;
     }
 
-    ~QWaylandClientPrivate() override
-    {
+    const bool softExceeded = softLimit > 0 && usage > softLimit && !softLimitExceeded.loadRelaxed();
+    const bool hardExceeded = hardLimit > 0 && usage > hardLimit;
+    if (softExceeded || hardExceeded)
+        scheduleMemoryLimitCheck();
+}
+
+void ClientResourceUsage::scheduleMemoryLimitCheck()
+{
+    if (!m_limitCheckPending.testAndSetRelaxed(0, 1))
+        return;
+
+    QMutexLocker locker(&m_clientMutex);
+    if (!m_client) {
+        m_limitCheckPending.storeRelaxed(0);
+        return;
     }
 
-    static void client_destroy_callback(wl_listener *listener, void *data)
+    // The compositor is the context rather than the client, as the client may be closed
+    QExplicitlySharedDataPointer<ClientResourceUsage> self(this);
+    QMetaObject::invokeMethod(m_client->compositor(), [self]() {
+        self->checkMemoryLimits();
+    }, Qt::QueuedConnection);
+}
+
+void ClientResourceUsage::checkMemoryLimits()
+{
+    m_limitCheckPending.storeRelaxed(0);
+
+    QWaylandClient *client = nullptr;
     {
-        Q_UNUSED(data);
+        QMutexLocker locker(&m_clientMutex);
+        client = m_client;
+    }
+    if (client)
+        QWaylandClientPrivate::get(client)->checkMemoryLimits();
+}
+
+}
+
+QWaylandClientPrivate::QWaylandClientPrivate(QWaylandCompositor *compositor, wl_client *_client)
+    : compositor(compositor)
+    , client(_client)
+    , usage(new QtWayland::ClientResourceUsage)
+{
+    // Save client credentials
+    wl_client_get_credentials(client, &pid, &uid, &gid);
+}
 
-        QWaylandClient *client = reinterpret_cast<Listener *>(listener)->parent;
-        Q_ASSERT(client != nullptr);
-        delete client;
+QWaylandClientPrivate::~QWaylandClientPrivate()
+{
+}
+
+void QWaylandClientPrivate::client_destroy_callback(wl_listener *listener, void *data)
+{
+    Q_UNUSED(data);
+
+    QWaylandClient *client = reinterpret_cast<Listener *>(listener)->parent;
+    Q_ASSERT(client != nullptr);
+    delete client;
+}
+
+/*!
+ * \internal
+ * Returns the resource usage of the QWaylandClient for \a client, if one has been created.
+ */
+QtWayland::ClientResourceUsage *QWaylandClientPrivate::resourceUsage(wl_client *client)
+{
+    if (!client)
+        return nullptr;
+
+    wl_listener *l = wl_client_get_destroy_listener(client, client_destroy_callback);
+    if (!l)
+        return nullptr;
+
+    QWaylandClient *parent = reinterpret_cast<Listener *>(
+            wl_container_of(l, (Listener *)nullptr, listener))->parent;
+    return get(parent)->usage.data();
+}
+
+#if WAYLAND_VERSION_MAJOR >= 1 && (WAYLAND_VERSION_MAJOR != 1 || WAYLAND_VERSION_MINOR >= 14)
+/*!
+ * \internal
+ * Protocol logger installed by QWaylandCompositor, counting the requests of each client.
+ */
+void QWaylandClientPrivate::countRequest(void *data, wl_protocol_logger_type type,
+                                         const wl_protocol_logger_message *message)
+{
+    Q_UNUSED(data);
+
+    if (type != WL_PROTOCOL_LOGGER_REQUEST || !message->resource)
+        return;
+
+    if (QtWayland::ClientResourceUsage *usage = resourceUsage(wl_resource_get_client(message->resource)))
+        usage->addRequest();
+}
+#endif
+
+template <typename T>
+static void updateReported(T *reported, T value, bool *changed)
+{
+    if (*reported != value) {
+        *reported = value;
+        *changed = true;
     }
+}
 
-    QWaylandCompositor *compositor = nullptr;
-    wl_client *client = nullptr;
+void QWaylandClientPrivate::updateResourceUsage()
+{
+    Q_Q(QWaylandClient);
+
+    const qint64 requests = usage->requestCount.loadRelaxed();
+    if (requestRateTimer.isValid()) {
+        const qint64 elapsed = requestRateTimer.restart();
+        if (elapsed > 0)
+            requestRate = (requests - lastRequestCount) * 1000.0 / elapsed;
+    } else {
+        requestRateTimer.start();
+    }
+    lastRequestCount = requests;
+
+    bool changed = false;
+    updateReported(&reported.sharedMemorySize, usage->sharedMemoryBytes.loadRelaxed(), &changed);
+    updateReported(&reported.textureCount, usage->textureCount.loadRelaxed(), &changed);
+    updateReported(&reported.textureMemorySize, usage->textureBytes.loadRelaxed(), &changed);
+    updateReported(&reported.eglImageCount, usage->eglImageCount.loadRelaxed(), &changed);
+    updateReported(&reported.surfaceCount, q->surfaceCount(), &changed);
+    updateReported(&reported.pendingFrameCallbackCount, usage->frameCallbackCount.loadRelaxed(), &changed);
+    updateReported(&reported.requestCount, requests, &changed);
+
+    if (changed)
+        emit q->resourceUsageChanged();
+}
 
-    uid_t uid;
-    gid_t gid;
-    pid_t pid;
+void QWaylandClientPrivate::checkMemoryLimits()
+{
+    Q_Q(QWaylandClient);
+
+    const qint64 memory = usage->memoryUsage();
+    const qint64 hardLimit = usage->memoryHardLimit.loadRelaxed();
+    if (hardLimit > 0 && memory > hardLimit) {
+        qCWarning(qLcWaylandCompositor) << "Closing client" << pid << "for using" << memory
+                                        << "bytes, above its hard limit of" << hardLimit;
+        QPointer<QWaylandClient> guard(q);
+        emit q->memoryHardLimitExceeded();
+        if (guard)
+            q->close();
+        return;
+    }
 
-    struct Listener {
-        wl_listener listener;
-        QWaylandClient *parent = nullptr;
-    };
-    Listener listener;
-};
+    const qint64 softLimit = usage->memorySoftLimit.loadRelaxed();
+    if (softLimit > 0 && memory > softLimit && usage->softLimitExceeded.testAndSetRelaxed(0, 1))
+        emit q->memorySoftLimitExceeded();
+}
 
 /*!
  * \qmltype WaylandClient
@@ -110,6 +262,9 @@ QWaylandClient::QWaylandClient(QWaylandCompositor *compositor, wl_client *client
     d->listener.listener.notify = QWaylandClientPrivate::client_destroy_callback;
     wl_client_add_destroy_listener(client, &d->listener.listener);
 
+    d->usage->setClient(this);
+    QObject::connect(&d->usageTimer, &QTimer::timeout, this, [d]() { d->updateResourceUsage(); });
+
     QWaylandCompositorPrivate::get(compositor)->addClient(this);
 }
 
@@ -123,6 +278,9 @@ QWaylandClient::~QWaylandClient()
     // Remove listener from signal
     wl_list_remove(&d->listener.listener.link);
 
+    // Buffers and callbacks may hold on to the usage for a little longer
+    d->usage->setClient(nullptr);
+
     QWaylandCompositorPrivate::get(d->compositor)->removeClient(this);
 }
 
@@ -272,4 +430,378 @@ void QWaylandClient::close()
     d->compositor->destroyClient(this);
 }
 
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::sharedMemorySize
+ * \readonly
+ * \since 5.15
+ *
+ * This property holds the number of bytes of shared memory buffers the compositor
+ * currently knows of for this WaylandClient.
+ */
+
+/*!
+ * \property QWaylandClient::sharedMemorySize
+ * \since 5.15
+ *
+ * This property holds the number of bytes of shared memory buffers the compositor
+ * currently knows of for this QWaylandClient. This is the size of the wl_buffers
+ * created from the client's pools, not of the pools themselves, which the compositor
+ * does not see.
+ *
+ * \sa memoryUsage, resourceUsageInterval
+ */
+qint64 QWaylandClient::sharedMemorySize() const
+{
+    Q_D(const QWaylandClient);
+    return d->usage->sharedMemoryBytes.loadRelaxed();
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::textureCount
+ * \readonly
+ * \since 5.15
+ *
+ * This property holds the number of OpenGL textures created for the buffers of this
+ * WaylandClient.
+ */
+
+/*!
+ * \property QWaylandClient::textureCount
+ * \since 5.15
+ *
+ * This property holds the number of OpenGL textures created for the buffers of this
+ * QWaylandClient.
+ *
+ * \sa textureMemorySize
+ */
+int QWaylandClient::textureCount() const
+{
+    Q_D(const QWaylandClient);
+    return d->usage->textureCount.loadRelaxed();
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::textureMemorySize
+ * \readonly
+ * \since 5.15
+ *
+ * This property holds the estimated size in bytes of the OpenGL textures created for the
+ * buffers of this WaylandClient.
+ */
+
+/*!
+ * \property QWaylandClient::textureMemorySize
+ * \since 5.15
+ *
+ * This property holds the estimated size in bytes of the OpenGL textures created for the
+ * buffers of this QWaylandClient, assuming four bytes per pixel.
+ *
+ * \sa textureCount, memoryUsage
+ */
+qint64 QWaylandClient::textureMemorySize() const
+{
+    Q_D(const QWaylandClient);
+    return d->usage->textureBytes.loadRelaxed();
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::eglImageCount
+ * \readonly
+ * \since 5.15
+ *
+ * This property holds the number of EGL images imported from the buffers of this
+ * WaylandClient.
+ */
+
+/*!
+ * \property QWaylandClient::eglImageCount
+ * \since 5.15
+ *
+ * This property holds the number of EGL images imported from the buffers of this
+ * QWaylandClient by the client buffer integration.
+ */
+int QWaylandClient::eglImageCount() const
+{
+    Q_D(const QWaylandClient);
+    return d->usage->eglImageCount.loadRelaxed();
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::memoryUsage
+ * \readonly
+ * \since 5.15
+ *
+ * This property holds the memory in bytes held by the compositor on behalf of this
+ * WaylandClient.
+ */
+
+/*!
+ * \property QWaylandClient::memoryUsage
+ * \since 5.15
+ *
+ * This property holds the memory in bytes held by the compositor on behalf of this
+ * QWaylandClient, that is the sum of sharedMemorySize and textureMemorySize. This
+ * is what memorySoftLimit and memoryHardLimit are compared to.
+ */
+qint64 QWaylandClient::memoryUsage() const
+{
+    Q_D(const QWaylandClient);
+    return d->usage->memoryUsage();
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::surfaceCount
+ * \readonly
+ * \since 5.15
+ *
+ * This property holds the number of surfaces of this WaylandClient.
+ */
+
+/*!
+ * \property QWaylandClient::surfaceCount
+ * \since 5.15
+ *
+ * This property holds the number of surfaces of this QWaylandClient.
+ *
+ * \sa QWaylandCompositor::surfacesForClient()
+ */
+int QWaylandClient::surfaceCount() const
+{
+    Q_D(const QWaylandClient);
+    auto *compositorPrivate = QWaylandCompositorPrivate::get(d->compositor);
+    const auto it = compositorPrivate->client_surfaces.constFind(const_cast<QWaylandClient *>(this));
+    return it != compositorPrivate->client_surfaces.constEnd() ? it->size() : 0;
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::pendingFrameCallbackCount
+ * \readonly
+ * \since 5.15
+ *
+ * This property holds the number of frame callbacks of this WaylandClient that have not
+ * been sent yet.
+ */
+
+/*!
+ * \property QWaylandClient::pendingFrameCallbackCount
+ * \since 5.15
+ *
+ * This property holds the number of frame callbacks of this QWaylandClient that have not
+ * been sent yet. A client whose surfaces are not shown keeps adding to it.
+ */
+int QWaylandClient::pendingFrameCallbackCount() const
+{
+    Q_D(const QWaylandClient);
+    return d->usage->frameCallbackCount.loadRelaxed();
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::requestCount
+ * \readonly
+ * \since 5.15
+ *
+ * This property holds the number of requests made by this WaylandClient.
+ */
+
+/*!
+ * \property QWaylandClient::requestCount
+ * \since 5.15
+ *
+ * This property holds the number of requests made by this QWaylandClient. Counting
+ * requests needs libwayland 1.14 or later; with older versions it stays \c 0.
+ *
+ * \sa requestRate
+ */
+qint64 QWaylandClient::requestCount() const
+{
+    Q_D(const QWaylandClient);
+    return d->usage->requestCount.loadRelaxed();
+}
+
+/*!
+ * \qmlproperty real QtWaylandCompositor::WaylandClient::requestRate
+ * \readonly
+ * \since 5.15
+ *
+ * This property holds the number of requests per second made by this WaylandClient.
+ */
+
+/*!
+ * \property QWaylandClient::requestRate
+ * \since 5.15
+ *
+ * This property holds the number of requests per second made by this QWaylandClient,
+ * measured over the last resourceUsageInterval. It stays \c 0 unless resourceUsageInterval
+ * is set.
+ *
+ * \sa requestCount
+ */
+qreal QWaylandClient::requestRate() const
+{
+    Q_D(const QWaylandClient);
+    return d->requestRate;
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::resourceUsageInterval
+ * \since 5.15
+ *
+ * This property holds the interval in milliseconds at which resourceUsageChanged is
+ * emitted if the resource usage of this WaylandClient changed. The default is \c 0,
+ * which means it is never emitted.
+ */
+
+/*!
+ * \property QWaylandClient::resourceUsageInterval
+ * \since 5.15
+ *
+ * This property holds the interval in milliseconds at which resourceUsageChanged() is
+ * emitted if the resource usage of this QWaylandClient changed. The default is \c 0,
+ * which means it is never emitted.
+ *
+ * The resource usage properties can be read at any time, they are just not notified of
+ * every change as many of them change every frame.
+ */
+int QWaylandClient::resourceUsageInterval() const
+{
+    Q_D(const QWaylandClient);
+    return d->usageTimer.isActive() ? d->usageTimer.interval() : 0;
+}
+
+void QWaylandClient::setResourceUsageInterval(int msecs)
+{
+    Q_D(QWaylandClient);
+    if (msecs < 0)
+        msecs = 0;
+    if (resourceUsageInterval() == msecs)
+        return;
+
+    if (msecs > 0) {
+        d->usageTimer.start(msecs);
+        d->requestRateTimer.invalidate();
+        d->updateResourceUsage();
+    } else {
+        d->usageTimer.stop();
+        d->requestRate = 0;
+    }
+    emit resourceUsageIntervalChanged();
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::memorySoftLimit
+ * \since 5.15
+ *
+ * This property holds the memory usage in bytes above which memorySoftLimitExceeded is
+ * emitted. The default is \c 0, which means no limit.
+ */
+
+/*!
+ * \property QWaylandClient::memorySoftLimit
+ * \since 5.15
+ *
+ * This property holds the memoryUsage in bytes above which memorySoftLimitExceeded() is
+ * emitted. The signal is emitted again only after the usage dropped below the limit in
+ * between. The default is \c 0, which means no limit.
+ *
+ * \sa memoryHardLimit
+ */
+qint64 QWaylandClient::memorySoftLimit() const
+{
+    Q_D(const QWaylandClient);
+    return d->usage->memorySoftLimit.loadRelaxed();
+}
+
+void QWaylandClient::setMemorySoftLimit(qint64 bytes)
+{
+    Q_D(QWaylandClient);
+    if (d->usage->memorySoftLimit.loadRelaxed() == bytes)
+        return;
+
+    d->usage->memorySoftLimit.storeRelaxed(bytes);
+    d->usage->softLimitExceeded.storeRelaxed(0);
+    emit memorySoftLimitChanged();
+    d->usage->scheduleMemoryLimitCheck();
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::memoryHardLimit
+ * \since 5.15
+ *
+ * This property holds the memory usage in bytes above which the WaylandClient is closed.
+ * The default is \c 0, which means no limit.
+ */
+
+/*!
+ * \property QWaylandClient::memoryHardLimit
+ * \since 5.15
+ *
+ * This property holds the memoryUsage in bytes above which the QWaylandClient is closed.
+ * memoryHardLimitExceeded() is emitted right before that, which is the place to kill()
+ * the client process as well. The default is \c 0, which means no limit.
+ *
+ * \sa memorySoftLimit, close()
+ */
+qint64 QWaylandClient::memoryHardLimit() const
+{
+    Q_D(const QWaylandClient);
+    return d->usage->memoryHardLimit.loadRelaxed();
+}
+
+void QWaylandClient::setMemoryHardLimit(qint64 bytes)
+{
+    Q_D(QWaylandClient);
+    if (d->usage->memoryHardLimit.loadRelaxed() == bytes)
+        return;
+
+    d->usage->memoryHardLimit.storeRelaxed(bytes);
+    emit memoryHardLimitChanged();
+    d->usage->scheduleMemoryLimitCheck();
+}
+
+/*!
+ * \qmlsignal QtWaylandCompositor::WaylandClient::resourceUsageChanged()
+ * \since 5.15
+ *
+ * This signal is emitted every resourceUsageInterval when the resource usage of the
+ * client changed.
+ */
+
+/*!
+ * \fn void QWaylandClient::resourceUsageChanged()
+ * \since 5.15
+ *
+ * This signal is emitted every resourceUsageInterval when the resource usage of the
+ * client changed.
+ */
+
+/*!
+ * \qmlsignal QtWaylandCompositor::WaylandClient::memorySoftLimitExceeded()
+ * \since 5.15
+ *
+ * This signal is emitted when the memory usage of the client grows above memorySoftLimit.
+ */
+
+/*!
+ * \fn void QWaylandClient::memorySoftLimitExceeded()
+ * \since 5.15
+ *
+ * This signal is emitted when memoryUsage grows above memorySoftLimit.
+ */
+
+/*!
+ * \qmlsignal QtWaylandCompositor::WaylandClient::memoryHardLimitExceeded()
+ * \since 5.15
+ *
+ * This signal is emitted when the memory usage of the client grows above memoryHardLimit,
+ * right before the client is closed.
+ */
+
+/*!
+ * \fn void QWaylandClient::memoryHardLimitExceeded()
+ * \since 5.15
+ *
+ * This signal is emitted when memoryUsage grows above memoryHardLimit, right before the
+ * client is closed.
+ */
+
 QT_END_NAMESPACE
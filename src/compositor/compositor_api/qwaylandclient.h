@@ -52,6 +52,18 @@ class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandClient : public QObject
     Q_PROPERTY(qint64 userId READ userId CONSTANT)
     Q_PROPERTY(qint64 groupId READ groupId CONSTANT)
     Q_PROPERTY(qint64 processId READ processId CONSTANT)
+    Q_PROPERTY(qint64 sharedMemorySize READ sharedMemorySize NOTIFY resourceUsageChanged REVISION 15)
+    Q_PROPERTY(int textureCount READ textureCount NOTIFY resourceUsageChanged REVISION 15)
+    Q_PROPERTY(qint64 textureMemorySize READ textureMemorySize NOTIFY resourceUsageChanged REVISION 15)
+    Q_PROPERTY(int eglImageCount READ eglImageCount NOTIFY resourceUsageChanged REVISION 15)
+    Q_PROPERTY(qint64 memoryUsage READ memoryUsage NOTIFY resourceUsageChanged REVISION 15)
+    Q_PROPERTY(int surfaceCount READ surfaceCount NOTIFY resourceUsageChanged REVISION 15)
+    Q_PROPERTY(int pendingFrameCallbackCount READ pendingFrameCallbackCount NOTIFY resourceUsageChanged REVISION 15)
+    Q_PROPERTY(qint64 requestCount READ requestCount NOTIFY resourceUsageChanged REVISION 15)
+    Q_PROPERTY(qreal requestRate READ requestRate NOTIFY resourceUsageChanged REVISION 15)
+    Q_PROPERTY(int resourceUsageInterval READ resourceUsageInterval WRITE setResourceUsageInterval NOTIFY resourceUsageIntervalChanged REVISION 15)
+    Q_PROPERTY(qint64 memorySoftLimit READ memorySoftLimit WRITE setMemorySoftLimit NOTIFY memorySoftLimitChanged REVISION 15)
+    Q_PROPERTY(qint64 memoryHardLimit READ memoryHardLimit WRITE setMemoryHardLimit NOTIFY memoryHardLimitChanged REVISION 15)
 public:
     ~QWaylandClient() override;
 
@@ -68,9 +80,35 @@ public:
 
     Q_INVOKABLE void kill(int signal = SIGTERM);
 
+    qint64 sharedMemorySize() const;
+    int textureCount() const;
+    qint64 textureMemorySize() const;
+    int eglImageCount() const;
+    qint64 memoryUsage() const;
+    int surfaceCount() const;
+    int pendingFrameCallbackCount() const;
+    qint64 requestCount() const;
+    qreal requestRate() const;
+
+    int resourceUsageInterval() const;
+    void setResourceUsageInterval(int msecs);
+
+    qint64 memorySoftLimit() const;
+    void setMemorySoftLimit(qint64 bytes);
+    qint64 memoryHardLimit() const;
+    void setMemoryHardLimit(qint64 bytes);
+
 public Q_SLOTS:
     void close();
 
+Q_SIGNALS:
+    Q_REVISION(15) void resourceUsageChanged();
+    Q_REVISION(15) void resourceUsageIntervalChanged();
+    Q_REVISION(15) void memorySoftLimitChanged();
+    Q_REVISION(15) void memoryHardLimitChanged();
+    Q_REVISION(15) void memorySoftLimitExceeded();
+    Q_REVISION(15) void memoryHardLimitExceeded();
+
 private:
     explicit QWaylandClient(QWaylandCompositor *compositor, wl_client *client);
 };
@@ -0,0 +1,154 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QWAYLANDCLIENT_P_H
+#define QWAYLANDCLIENT_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtWaylandCompositor/qtwaylandcompositorglobal.h>
+#include <QtWaylandCompositor/QWaylandClient>
+
+#include <QtCore/private/qobject_p.h>
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedData>
+#include <QtCore/QTimer>
+
+#include <wayland-server-core.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWayland {
+
+// What a client costs the compositor. It is shared with the buffers and frame callbacks
+// accounted to the client, since those can outlive the QWaylandClient, and textures are
+// accounted from the render thread, hence the atomics.
+class Q_WAYLAND_COMPOSITOR_EXPORT ClientResourceUsage : public QSharedData
+{
+public:
+    void addSharedMemory(qint64 bytes);
+    void addTextures(int count, qint64 bytes);
+    void addEglImages(int count) { eglImageCount.fetchAndAddRelaxed(count); }
+    void addFrameCallbacks(int count) { frameCallbackCount.fetchAndAddRelaxed(count); }
+    void addRequest() { requestCount.fetchAndAddRelaxed(1); }
+
+    qint64 memoryUsage() const { return sharedMemoryBytes.loadRelaxed() + textureBytes.loadRelaxed(); }
+
+    void setClient(QWaylandClient *client);
+    void scheduleMemoryLimitCheck();
+    void checkMemoryLimits();
+
+    QAtomicInteger<qint64> sharedMemoryBytes;
+    QAtomicInt textureCount;
+    QAtomicInteger<qint64> textureBytes;
+    QAtomicInt eglImageCount;
+    QAtomicInt frameCallbackCount;
+    QAtomicInteger<qint64> requestCount;
+
+    QAtomicInteger<qint64> memorySoftLimit;
+    QAtomicInteger<qint64> memoryHardLimit;
+    QAtomicInt softLimitExceeded; // Set once reported, until usage drops below the limit again
+
+private:
+    void memoryChanged(qint64 delta);
+
+    QAtomicInt m_limitCheckPending;
+
+    QMutex m_clientMutex;
+    QWaylandClient *m_client = nullptr; // Guarded by m_clientMutex
+};
+
+}
+
+class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandClientPrivate : public QObjectPrivate
+{
+    Q_DECLARE_PUBLIC(QWaylandClient)
+public:
+    QWaylandClientPrivate(QWaylandCompositor *compositor, wl_client *_client);
+    ~QWaylandClientPrivate() override;
+
+    static QWaylandClientPrivate *get(QWaylandClient *client) { return client ? client->d_func() : nullptr; }
+    static QtWayland::ClientResourceUsage *resourceUsage(wl_client *client);
+
+    static void client_destroy_callback(wl_listener *listener, void *data);
+#if WAYLAND_VERSION_MAJOR >= 1 && (WAYLAND_VERSION_MAJOR != 1 || WAYLAND_VERSION_MINOR >= 14)
+    static void countRequest(void *data, wl_protocol_logger_type type,
+                             const wl_protocol_logger_message *message);
+#endif
+
+    void updateResourceUsage();
+    void checkMemoryLimits();
+
+    QWaylandCompositor *compositor = nullptr;
+    wl_client *client = nullptr;
+
+    uid_t uid;
+    gid_t gid;
+    pid_t pid;
+
+    struct Listener {
+        wl_listener listener;
+        QWaylandClient *parent = nullptr;
+    };
+    Listener listener;
+
+    QExplicitlySharedDataPointer<QtWayland::ClientResourceUsage> usage;
+
+    QTimer usageTimer;
+    QElapsedTimer requestRateTimer;
+    qint64 lastRequestCount = 0;
+    qreal requestRate = 0;
+
+    // What was last reported through resourceUsageChanged()
+    struct {
+        qint64 sharedMemorySize = 0;
+        int textureCount = 0;
+        qint64 textureMemorySize = 0;
+        int eglImageCount = 0;
+        int surfaceCount = 0;
+        int pendingFrameCallbackCount = 0;
+        qint64 requestCount = 0;
+    } reported;
+};
+
+QT_END_NAMESPACE
+
+#endif // QWAYLANDCLIENT_P_H
@@ -42,14 +42,18 @@
 #include <QtWaylandCompositor/qwaylandtouch.h>
 #include <QtWaylandCompositor/qwaylandsurfacegrabber.h>
 
+#include <QtWaylandCompositor/private/qwaylandclient_p.h>
 #include <QtWaylandCompositor/private/qwaylandkeyboard_p.h>
 #include <QtWaylandCompositor/private/qwaylandsurface_p.h>
+#include <QtWaylandCompositor/private/qwaylandsurfacegrabber_p.h>
 
 #if QT_CONFIG(wayland_datadevice)
 #include "wayland_wrapper/qwldatadevice_p.h"
 #include "wayland_wrapper/qwldatadevicemanager_p.h"
 #endif
 #include "wayland_wrapper/qwlbuffermanager_p.h"
+#include "wayland_wrapper/qwlprotocolstatistics_p.h"
+#include "wayland_wrapper/qwltrace_p.h"
 
 #include "hardware_integration/qwlclientbufferintegration_p.h"
 #include "hardware_integration/qwlclientbufferintegrationfactory_p.h"
@@ -76,11 +80,7 @@
 #include <QtGui/private/qguiapplication_p.h>
 
 #if QT_CONFIG(opengl)
-#   include <QOpenGLTextureBlitter>
-#   include <QOpenGLTexture>
 #   include <QOpenGLContext>
-#   include <QOpenGLFramebufferObject>
-#   include <QMatrix4x4>
 #endif
 
 QT_BEGIN_NAMESPACE
@@ -190,6 +190,10 @@ void QWaylandCompositorPrivate::init()
         if (socketArg != -1 && socketArg + 1 < arguments.size())
             socket_name = arguments.at(socketArg + 1).toLocal8Bit();
     }
+    if (qEnvironmentVariableIntValue("QT_WAYLAND_PROTOCOL_STATISTICS"))
+        QtWayland::ProtocolStatistics::setEnabled(true);
+    QtWayland::Trace::initialize();
+
     wl_compositor::init(display, 3);
     wl_subcompositor::init(display, 1);
 
@@ -197,11 +201,20 @@ void QWaylandCompositorPrivate::init()
     data_device_manager =  new QtWayland::DataDeviceManager(q);
 #endif
     buffer_manager = new QtWayland::BufferManager(q);
+#if WAYLAND_VERSION_MAJOR >= 1 && (WAYLAND_VERSION_MAJOR != 1 || WAYLAND_VERSION_MINOR >= 14)
+    request_logger = wl_display_add_protocol_logger(display, QWaylandClientPrivate::countRequest, nullptr);
+#endif
 
     wl_display_init_shm(display);
     const QVector<wl_shm_format> formats = QWaylandSharedMemoryFormatHelper::supportedWaylandFormats();
     for (wl_shm_format format : formats)
         wl_display_add_shm_format(display, format);
+    // Not QImage formats, but SharedMemoryBuffer knows how to show them, as long as it can
+    // tell that their chroma planes fit in the pool
+    if (buffer_manager->tracksShmPools()) {
+        for (wl_shm_format format : { WL_SHM_FORMAT_NV12, WL_SHM_FORMAT_YUV420, WL_SHM_FORMAT_YUYV })
+            wl_display_add_shm_format(display, format);
+    }
 
     if (!socket_name.isEmpty()) {
         if (wl_display_add_socket(display, socket_name.constData()))
@@ -245,6 +258,9 @@ void QWaylandCompositorPrivate::init()
 
 QWaylandCompositorPrivate::~QWaylandCompositorPrivate()
 {
+    if (qEnvironmentVariableIntValue("QT_WAYLAND_PROTOCOL_STATISTICS"))
+        qCInfo(qLcWaylandCompositor).noquote() << "Protocol statistics:\n" << QtWayland::ProtocolStatistics::dump();
+
     // Take copies, since the lists will get modified as elements are deleted
     const auto clientsToDelete = clients;
     qDeleteAll(clientsToDelete);
@@ -261,6 +277,11 @@ QWaylandCompositorPrivate::~QWaylandCompositorPrivate()
     client_buffer_integration.reset();
 #endif
 
+#if WAYLAND_VERSION_MAJOR >= 1 && (WAYLAND_VERSION_MAJOR != 1 || WAYLAND_VERSION_MINOR >= 14)
+    if (request_logger)
+        wl_protocol_logger_destroy(request_logger);
+#endif
+
     if (ownsDisplay)
         wl_display_destroy(display);
 }
@@ -290,6 +311,13 @@ void QWaylandCompositorPrivate::unregisterSurface(QWaylandSurface *surface)
 {
     if (!all_surfaces.removeOne(surface))
         qWarning("%s Unexpected state. Cant find registered surface\n", Q_FUNC_INFO);
+
+    auto it = client_surfaces.find(QWaylandSurfacePrivate::get(surface)->client);
+    if (it != client_surfaces.end()) {
+        it->removeOne(surface);
+        if (it->isEmpty())
+            client_surfaces.erase(it);
+    }
 }
 
 void QWaylandCompositorPrivate::feedRetainedSelectionData(QMimeData *data)
@@ -339,6 +367,7 @@ void QWaylandCompositorPrivate::compositor_create_surface(wl_compositor::Resourc
     }
     Q_ASSERT(surface);
     all_surfaces.append(surface);
+    client_surfaces[QWaylandSurfacePrivate::get(surface)->client].append(surface);
     emit q->surfaceCreated(surface);
 }
 
@@ -722,7 +751,9 @@ QList<QWaylandSurface *> QWaylandCompositor::surfacesForClient(QWaylandClient* c
 {
     Q_D(const QWaylandCompositor);
     QList<QWaylandSurface *> surfs;
-    for (QWaylandSurface *surface : d->all_surfaces) {
+    if (!client)
+        return surfs;
+    for (QWaylandSurface *surface : d->client_surfaces.value(client)) {
         if (surface->client() == client)
             surfs.append(surface);
     }
@@ -815,10 +846,12 @@ uint QWaylandCompositor::currentTimeMsecs() const
 void QWaylandCompositor::processWaylandEvents()
 {
     Q_D(QWaylandCompositor);
+    const qint64 start = d->timer.nsecsElapsed();
     int ret = wl_event_loop_dispatch(d->loop, 0);
     if (ret)
         fprintf(stderr, "wl_event_loop_dispatch error: %d\n", ret);
     wl_display_flush_clients(d->display);
+    d->eventDispatchTime.fetchAndAddRelaxed(d->timer.nsecsElapsed() - start);
 }
 
 /*!
@@ -996,34 +1029,77 @@ void QWaylandCompositor::setUseHardwareIntegrationExtension(bool use)
  */
 void QWaylandCompositor::grabSurface(QWaylandSurfaceGrabber *grabber, const QWaylandBufferRef &buffer)
 {
+    QWaylandSurfaceGrabberPrivate *grabberPrivate = QWaylandSurfaceGrabberPrivate::get(grabber);
     if (buffer.isSharedMemory()) {
-        emit grabber->success(buffer.image());
+        grabberPrivate->grabSharedMemory(buffer);
     } else {
 #if QT_CONFIG(opengl)
         if (QOpenGLContext::currentContext()) {
-            QOpenGLFramebufferObject fbo(buffer.size());
-            fbo.bind();
-            QOpenGLTextureBlitter blitter;
-            blitter.create();
-
-
-            glViewport(0, 0, buffer.size().width(), buffer.size().height());
-
-            QOpenGLTextureBlitter::Origin surfaceOrigin =
-                buffer.origin() == QWaylandSurface::OriginTopLeft
-                ? QOpenGLTextureBlitter::OriginTopLeft
-                : QOpenGLTextureBlitter::OriginBottomLeft;
-
-            auto texture = buffer.toOpenGLTexture();
-            blitter.bind(texture->target());
-            blitter.blit(texture->textureId(), QMatrix4x4(), surfaceOrigin);
-            blitter.release();
-
-            emit grabber->success(fbo.toImage());
+            grabberPrivate->grabTexture(buffer, grabberPrivate->requestedRect);
+            // Asynchronous read backs are polled for as long as the context stays current,
+            // and otherwise delivered on the next grab
+            if (grabberPrivate->pollReadbacks(false))
+                grabberPrivate->pollTimer.start();
         } else
 #endif
         emit grabber->failed(QWaylandSurfaceGrabber::UnknownBufferType);
     }
 }
 
+/*!
+ * \since 5.15
+ *
+ * Returns \c true if the compositor counts the Wayland protocol messages it sends
+ * and receives; otherwise returns \c false.
+ *
+ * Messages are only counted if Qt Wayland Compositor was configured with
+ * \c -feature-wayland-server-protocol-statistics; otherwise the statistics stay empty.
+ *
+ * Counting can also be enabled by setting the \c QT_WAYLAND_PROTOCOL_STATISTICS
+ * environment variable to \c 1, in which case the statistics are also written to
+ * the \c qt.waylandcompositor logging category when the compositor is destroyed.
+ *
+ * \sa protocolStatistics()
+ */
+bool QWaylandCompositor::protocolStatisticsEnabled() const
+{
+    return QtWayland::ProtocolStatistics::isEnabled();
+}
+
+/*!
+ * \since 5.15
+ *
+ * Enables counting of Wayland protocol messages if \a enabled is \c true.
+ * The counters are shared by all compositors in the process.
+ */
+void QWaylandCompositor::setProtocolStatisticsEnabled(bool enabled)
+{
+    QtWayland::ProtocolStatistics::setEnabled(enabled);
+}
+
+/*!
+ * \since 5.15
+ *
+ * Returns the number of messages and bytes counted for each interface and
+ * opcode, followed by the totals for each client process, ordered by bytes.
+ * Only protocols implemented by code generated with \c qtwaylandscanner are
+ * counted.
+ *
+ * \sa setProtocolStatisticsEnabled(), resetProtocolStatistics()
+ */
+QString QWaylandCompositor::protocolStatistics() const
+{
+    return QtWayland::ProtocolStatistics::dump();
+}
+
+/*!
+ * \since 5.15
+ *
+ * Clears the protocol statistics counted so far.
+ */
+void QWaylandCompositor::resetProtocolStatistics()
+{
+    QtWayland::ProtocolStatistics::reset();
+}
+
 QT_END_NAMESPACE
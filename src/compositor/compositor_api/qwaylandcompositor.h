@@ -118,6 +118,11 @@ public:
 
     virtual void grabSurface(QWaylandSurfaceGrabber *grabber, const QWaylandBufferRef &buffer);
 
+    bool protocolStatisticsEnabled() const;
+    void setProtocolStatisticsEnabled(bool enabled);
+    Q_INVOKABLE QString protocolStatistics() const;
+    Q_INVOKABLE void resetProtocolStatistics();
+
 public Q_SLOTS:
     void processWaylandEvents();
 
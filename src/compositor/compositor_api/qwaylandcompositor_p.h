@@ -45,8 +45,10 @@
 #include <QtWaylandCompositor/private/qtwaylandcompositorglobal_p.h>
 #include <QtWaylandCompositor/QWaylandCompositor>
 #include <QtCore/private/qobject_p.h>
+#include <QtCore/QHash>
 #include <QtCore/QSet>
 #include <QtCore/QElapsedTimer>
+#include <QtCore/QAtomicInteger>
 
 #include <QtWaylandCompositor/private/qwayland-server-wayland.h>
 
@@ -138,11 +140,15 @@ protected:
 #endif
     struct wl_display *display = nullptr;
     bool ownsDisplay = false;
+#if WAYLAND_VERSION_MAJOR >= 1 && (WAYLAND_VERSION_MAJOR != 1 || WAYLAND_VERSION_MINOR >= 14)
+    struct wl_protocol_logger *request_logger = nullptr;
+#endif
 
     QList<QWaylandSeat *> seats;
     QList<QWaylandOutput *> outputs;
 
     QList<QWaylandSurface *> all_surfaces;
+    QHash<QWaylandClient *, QList<QWaylandSurface *>> client_surfaces;
 
 #if QT_CONFIG(wayland_datadevice)
     QtWayland::DataDeviceManager *data_device_manager = nullptr;
@@ -150,6 +156,7 @@ protected:
     QtWayland::BufferManager *buffer_manager = nullptr;
 
     QElapsedTimer timer;
+    QAtomicInteger<qint64> eventDispatchTime = 0; // Total nanoseconds spent in processWaylandEvents()
 
     wl_event_loop *loop = nullptr;
 
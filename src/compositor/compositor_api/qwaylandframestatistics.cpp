@@ -0,0 +1,499 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qwaylandframestatistics.h"
+#include "qwaylandframestatistics_p.h"
+
+#include <QtWaylandCompositor/QWaylandOutput>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+
+QT_BEGIN_NAMESPACE
+
+static qreal toMsecs(qint64 nsecs)
+{
+    return nsecs / 1000000.0;
+}
+
+void QWaylandFrameStatisticsPrivate::frameStarted(qint64 eventDispatchTotal)
+{
+    Q_Q(QWaylandFrameStatistics);
+    bool finished = false;
+    {
+        QMutexLocker locker(&mutex);
+        if (current.active)
+            finished = finishFrame();
+
+        current = CurrentFrame();
+        current.active = true;
+        current.startWallTime = QDateTime::currentMSecsSinceEpoch();
+        current.start = clock.nsecsElapsed();
+        if (lastEventDispatchTotal >= 0)
+            current.eventDispatchTime = eventDispatchTotal - lastEventDispatchTotal;
+        lastEventDispatchTotal = eventDispatchTotal;
+        current.earliestCommit = earliestPendingCommit;
+        current.surfacesUpdated = pendingSurfaceUpdates;
+        earliestPendingCommit = 0;
+        pendingSurfaceUpdates = 0;
+    }
+    // Frames of Qt Quick outputs start on the render thread
+    if (finished)
+        QMetaObject::invokeMethod(q, "frameFinished", Qt::QueuedConnection);
+}
+
+// Must be called with the mutex locked
+bool QWaylandFrameStatisticsPrivate::finishFrame()
+{
+    if (!current.active)
+        return false;
+    current.active = false;
+
+    QWaylandFrameStatistics::Frame frame;
+    frame.startTime = current.startWallTime;
+    frame.eventDispatchTime = toMsecs(current.eventDispatchTime);
+    frame.textureUploadTime = toMsecs(current.textureUploadTime);
+    frame.renderTime = toMsecs(current.renderTime);
+    frame.surfacesUpdated = current.surfacesUpdated;
+    if (current.frameCallbacksSent)
+        frame.frameCallbackLatency = toMsecs(current.frameCallbacksSent - current.start);
+
+    // Outputs that don't tell when the frame was swapped are taken to show it once they
+    // are done with it, i.e. when they send the frame callbacks
+    const qint64 displayed = current.swap ? current.swap : current.frameCallbacksSent;
+    if (current.earliestCommit && displayed)
+        frame.commitToDisplayTime = toMsecs(displayed - current.earliestCommit);
+
+    last = frame;
+    ++frameCount;
+    if (historySize > 0) {
+        if (history.size() < historySize)
+            history.append(frame);
+        else
+            history[historyNext] = frame;
+        historyNext = (historyNext + 1) % historySize;
+    }
+    return true;
+}
+
+// Must be called with the mutex locked
+QVector<QWaylandFrameStatistics::Frame> QWaylandFrameStatisticsPrivate::orderedHistory() const
+{
+    if (history.size() < historySize || historyNext == 0)
+        return history;
+
+    QVector<QWaylandFrameStatistics::Frame> frames;
+    frames.reserve(history.size());
+    for (int i = 0; i < history.size(); ++i)
+        frames.append(history.at((historyNext + i) % history.size()));
+    return frames;
+}
+
+void QWaylandFrameStatisticsPrivate::frameCallbacksSent()
+{
+    QMutexLocker locker(&mutex);
+    if (current.active && !current.frameCallbacksSent)
+        current.frameCallbacksSent = clock.nsecsElapsed();
+}
+
+void QWaylandFrameStatisticsPrivate::surfaceCommitted()
+{
+    QMutexLocker locker(&mutex);
+    if (!earliestPendingCommit)
+        earliestPendingCommit = clock.nsecsElapsed();
+    ++pendingSurfaceUpdates;
+}
+
+void QWaylandFrameStatisticsPrivate::renderStarted()
+{
+    QMutexLocker locker(&mutex);
+    current.renderStart = clock.nsecsElapsed();
+}
+
+void QWaylandFrameStatisticsPrivate::renderFinished()
+{
+    QMutexLocker locker(&mutex);
+    if (current.renderStart)
+        current.renderTime += clock.nsecsElapsed() - current.renderStart;
+    current.renderStart = 0;
+}
+
+void QWaylandFrameStatisticsPrivate::frameSwapped()
+{
+    QMutexLocker locker(&mutex);
+    if (current.active && !current.swap)
+        current.swap = clock.nsecsElapsed();
+}
+
+void QWaylandFrameStatisticsPrivate::addTextureUploadTime(qint64 nsecs)
+{
+    QMutexLocker locker(&mutex);
+    current.textureUploadTime += nsecs;
+}
+
+/*!
+ * \qmltype WaylandFrameStatistics
+ * \inqmlmodule QtWayland.Compositor
+ * \since 5.15
+ * \brief Measures where the frame time of a WaylandOutput goes.
+ *
+ * This type holds timings of the last frame rendered on a WaylandOutput, and optionally
+ * of a number of frames before it. It is available through the
+ * \l{WaylandOutput::frameStatistics}{frameStatistics} property of the output, and starts
+ * measuring when that property is first read.
+ */
+
+/*!
+ * \class QWaylandFrameStatistics
+ * \inmodule QtWaylandCompositor
+ * \since 5.15
+ * \brief The QWaylandFrameStatistics class measures where the frame time of an output goes.
+ *
+ * QWaylandFrameStatistics holds timings of the last frame rendered on a QWaylandOutput, and
+ * optionally of a number of frames before it. It is created by
+ * QWaylandOutput::frameStatistics(), and nothing is measured until then.
+ *
+ * A frame starts with QWaylandOutput::frameStarted() and is finished when the next frame
+ * starts, at which point frameFinished() is emitted.
+ *
+ * All times are in milliseconds.
+ */
+
+/*!
+ * \class QWaylandFrameStatistics::Frame
+ * \inmodule QtWaylandCompositor
+ * \since 5.15
+ * \brief The timings of one frame.
+ *
+ * \c startTime is the time the frame started, in milliseconds since the epoch. The other
+ * members correspond to the properties of QWaylandFrameStatistics with the same names.
+ */
+
+QWaylandFrameStatistics::QWaylandFrameStatistics(QWaylandOutput *output)
+    : QObject(*new QWaylandFrameStatisticsPrivate, output)
+{
+    Q_D(QWaylandFrameStatistics);
+    d->output = output;
+    d->clock.start();
+}
+
+/*!
+ * Destroys the QWaylandFrameStatistics.
+ */
+QWaylandFrameStatistics::~QWaylandFrameStatistics()
+{
+}
+
+/*!
+ * \qmlproperty WaylandOutput QtWaylandCompositor::WaylandFrameStatistics::output
+ *
+ * This property holds the output whose frames are measured.
+ */
+
+/*!
+ * \property QWaylandFrameStatistics::output
+ *
+ * This property holds the output whose frames are measured.
+ */
+QWaylandOutput *QWaylandFrameStatistics::output() const
+{
+    Q_D(const QWaylandFrameStatistics);
+    return d->output;
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandFrameStatistics::frameCount
+ *
+ * This property holds the number of frames measured since the statistics were created or
+ * last reset.
+ */
+
+/*!
+ * \property QWaylandFrameStatistics::frameCount
+ *
+ * This property holds the number of frames measured since the statistics were created or
+ * last reset.
+ */
+int QWaylandFrameStatistics::frameCount() const
+{
+    Q_D(const QWaylandFrameStatistics);
+    QMutexLocker locker(&d->mutex);
+    return d->frameCount;
+}
+
+/*!
+ * \qmlproperty real QtWaylandCompositor::WaylandFrameStatistics::eventDispatchTime
+ *
+ * This property holds the time the compositor spent dispatching Wayland requests between
+ * the start of the previous frame and the start of the last one.
+ */
+
+/*!
+ * \property QWaylandFrameStatistics::eventDispatchTime
+ *
+ * This property holds the time the compositor spent dispatching Wayland requests, in
+ * QWaylandCompositor::processWaylandEvents(), between the start of the previous frame and
+ * the start of the last one.
+ */
+qreal QWaylandFrameStatistics::eventDispatchTime() const
+{
+    return lastFrame().eventDispatchTime;
+}
+
+/*!
+ * \qmlproperty real QtWaylandCompositor::WaylandFrameStatistics::textureUploadTime
+ *
+ * This property holds the time spent turning client buffers into textures for the last
+ * frame.
+ */
+
+/*!
+ * \property QWaylandFrameStatistics::textureUploadTime
+ *
+ * This property holds the time spent turning client buffers into textures for the last
+ * frame, by the QWaylandQuickItem instances shown on the output.
+ */
+qreal QWaylandFrameStatistics::textureUploadTime() const
+{
+    return lastFrame().textureUploadTime;
+}
+
+/*!
+ * \qmlproperty real QtWaylandCompositor::WaylandFrameStatistics::renderTime
+ *
+ * This property holds the time spent rendering the last frame.
+ */
+
+/*!
+ * \property QWaylandFrameStatistics::renderTime
+ *
+ * This property holds the time spent rendering the last frame. For Qt Quick outputs this
+ * is the time between QQuickWindow::beforeRendering() and QQuickWindow::afterRendering(),
+ * which does not include waiting for the GPU.
+ */
+qreal QWaylandFrameStatistics::renderTime() const
+{
+    return lastFrame().renderTime;
+}
+
+/*!
+ * \qmlproperty real QtWaylandCompositor::WaylandFrameStatistics::commitToDisplayTime
+ *
+ * This property holds the time from the earliest surface commit shown in the last frame
+ * until the frame was displayed.
+ */
+
+/*!
+ * \property QWaylandFrameStatistics::commitToDisplayTime
+ *
+ * This property holds the time from the earliest surface commit shown in the last frame
+ * until the frame was displayed. For Qt Quick outputs the frame counts as displayed when
+ * QQuickWindow::frameSwapped() is emitted, for other outputs when the frame callbacks are
+ * sent. It is \c 0 if no surface on the output committed a new buffer for the frame.
+ */
+qreal QWaylandFrameStatistics::commitToDisplayTime() const
+{
+    return lastFrame().commitToDisplayTime;
+}
+
+/*!
+ * \qmlproperty real QtWaylandCompositor::WaylandFrameStatistics::frameCallbackLatency
+ *
+ * This property holds the time from the start of the last frame until its frame callbacks
+ * were sent.
+ */
+
+/*!
+ * \property QWaylandFrameStatistics::frameCallbackLatency
+ *
+ * This property holds the time from the start of the last frame until its frame callbacks
+ * were sent, which is when clients start drawing their next frame. It is \c 0 if no frame
+ * callbacks were sent for the frame.
+ */
+qreal QWaylandFrameStatistics::frameCallbackLatency() const
+{
+    return lastFrame().frameCallbackLatency;
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandFrameStatistics::surfacesUpdated
+ *
+ * This property holds the number of surface commits with a new buffer shown in the
+ * last frame.
+ */
+
+/*!
+ * \property QWaylandFrameStatistics::surfacesUpdated
+ *
+ * This property holds the number of surface commits with a new buffer shown in the
+ * last frame, counting each view of a surface on the output.
+ */
+int QWaylandFrameStatistics::surfacesUpdated() const
+{
+    return lastFrame().surfacesUpdated;
+}
+
+/*!
+ * Returns the timings of the last finished frame.
+ */
+QWaylandFrameStatistics::Frame QWaylandFrameStatistics::lastFrame() const
+{
+    Q_D(const QWaylandFrameStatistics);
+    QMutexLocker locker(&d->mutex);
+    return d->last;
+}
+
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandFrameStatistics::historySize
+ *
+ * This property holds the number of frames kept in the history. The default is \c 0,
+ * which disables the history.
+ */
+
+/*!
+ * \property QWaylandFrameStatistics::historySize
+ *
+ * This property holds the number of frames kept in the history. Once it is full, each
+ * new frame replaces the oldest one. The default is \c 0, which disables the history.
+ *
+ * \sa history(), writeHistory()
+ */
+int QWaylandFrameStatistics::historySize() const
+{
+    Q_D(const QWaylandFrameStatistics);
+    QMutexLocker locker(&d->mutex);
+    return d->historySize;
+}
+
+void QWaylandFrameStatistics::setHistorySize(int size)
+{
+    Q_D(QWaylandFrameStatistics);
+    size = qMax(0, size);
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->historySize == size)
+            return;
+
+        // Keep the most recent frames that still fit
+        QVector<Frame> frames = d->orderedHistory();
+        if (frames.size() > size)
+            frames.erase(frames.begin(), frames.end() - size);
+        d->history = frames;
+        d->historySize = size;
+        d->historyNext = size ? d->history.size() % size : 0;
+        d->history.reserve(size);
+    }
+    emit historySizeChanged();
+}
+
+/*!
+ * Returns the frames in the history, oldest first.
+ *
+ * \sa historySize
+ */
+QVector<QWaylandFrameStatistics::Frame> QWaylandFrameStatistics::history() const
+{
+    Q_D(const QWaylandFrameStatistics);
+    QMutexLocker locker(&d->mutex);
+    return d->orderedHistory();
+}
+
+/*!
+ * \qmlmethod bool QtWaylandCompositor::WaylandFrameStatistics::writeHistory(string fileName)
+ *
+ * Writes the frames in the history to \a fileName as comma-separated values, oldest
+ * first. Returns \c true on success.
+ */
+
+/*!
+ * Writes the frames in the history to \a fileName as comma-separated values, oldest
+ * first, with a header line naming the columns. Returns \c true on success.
+ *
+ * \sa history()
+ */
+bool QWaylandFrameStatistics::writeHistory(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    out << "startTime,eventDispatchTime,textureUploadTime,renderTime,commitToDisplayTime,"
+           "frameCallbackLatency,surfacesUpdated\n";
+    const QVector<Frame> frames = history();
+    for (const Frame &frame : frames) {
+        out << frame.startTime << ','
+            << frame.eventDispatchTime << ','
+            << frame.textureUploadTime << ','
+            << frame.renderTime << ','
+            << frame.commitToDisplayTime << ','
+            << frame.frameCallbackLatency << ','
+            << frame.surfacesUpdated << '\n';
+    }
+    out.flush();
+    return file.error() == QFile::NoError;
+}
+
+/*!
+ * \qmlmethod void QtWaylandCompositor::WaylandFrameStatistics::reset()
+ *
+ * Clears the frame count, the last frame and the history.
+ */
+
+/*!
+ * Clears the frame count, the last frame and the history.
+ */
+void QWaylandFrameStatistics::reset()
+{
+    Q_D(QWaylandFrameStatistics);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->frameCount = 0;
+        d->last = Frame();
+        d->history.clear();
+        d->historyNext = 0;
+    }
+    emit frameFinished();
+}
+
+/*!
+ * \qmlsignal QtWaylandCompositor::WaylandFrameStatistics::frameFinished()
+ *
+ * This signal is emitted when a frame has been measured.
+ */
+
+/*!
+ * \fn void QWaylandFrameStatistics::frameFinished()
+ *
+ * This signal is emitted when a frame has been measured.
+ */
+
+QT_END_NAMESPACE
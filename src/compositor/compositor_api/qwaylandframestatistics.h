@@ -0,0 +1,101 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QWAYLANDFRAMESTATISTICS_H
+#define QWAYLANDFRAMESTATISTICS_H
+
+#include <QtWaylandCompositor/qtwaylandcompositorglobal.h>
+#include <QtCore/QObject>
+#include <QtCore/QVector>
+
+QT_BEGIN_NAMESPACE
+
+class QWaylandOutput;
+class QWaylandFrameStatisticsPrivate;
+
+class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandFrameStatistics : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(QWaylandFrameStatistics)
+    Q_PROPERTY(QWaylandOutput *output READ output CONSTANT)
+    Q_PROPERTY(int frameCount READ frameCount NOTIFY frameFinished)
+    Q_PROPERTY(qreal eventDispatchTime READ eventDispatchTime NOTIFY frameFinished)
+    Q_PROPERTY(qreal textureUploadTime READ textureUploadTime NOTIFY frameFinished)
+    Q_PROPERTY(qreal renderTime READ renderTime NOTIFY frameFinished)
+    Q_PROPERTY(qreal commitToDisplayTime READ commitToDisplayTime NOTIFY frameFinished)
+    Q_PROPERTY(qreal frameCallbackLatency READ frameCallbackLatency NOTIFY frameFinished)
+    Q_PROPERTY(int surfacesUpdated READ surfacesUpdated NOTIFY frameFinished)
+    Q_PROPERTY(int historySize READ historySize WRITE setHistorySize NOTIFY historySizeChanged)
+public:
+    struct Frame {
+        qint64 startTime = 0; // Milliseconds since the epoch
+        qreal eventDispatchTime = 0;
+        qreal textureUploadTime = 0;
+        qreal renderTime = 0;
+        qreal commitToDisplayTime = 0;
+        qreal frameCallbackLatency = 0;
+        int surfacesUpdated = 0;
+    };
+
+    ~QWaylandFrameStatistics() override;
+
+    QWaylandOutput *output() const;
+
+    int frameCount() const;
+    qreal eventDispatchTime() const;
+    qreal textureUploadTime() const;
+    qreal renderTime() const;
+    qreal commitToDisplayTime() const;
+    qreal frameCallbackLatency() const;
+    int surfacesUpdated() const;
+
+    Frame lastFrame() const;
+
+    int historySize() const;
+    void setHistorySize(int size);
+    QVector<Frame> history() const;
+    Q_INVOKABLE bool writeHistory(const QString &fileName) const;
+
+    Q_INVOKABLE void reset();
+
+Q_SIGNALS:
+    void frameFinished();
+    void historySizeChanged();
+
+private:
+    explicit QWaylandFrameStatistics(QWaylandOutput *output);
+    friend class QWaylandOutput;
+};
+
+Q_DECLARE_TYPEINFO(QWaylandFrameStatistics::Frame, Q_MOVABLE_TYPE);
+
+QT_END_NAMESPACE
+
+#endif // QWAYLANDFRAMESTATISTICS_H
@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QWAYLANDFRAMESTATISTICS_P_H
+#define QWAYLANDFRAMESTATISTICS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtWaylandCompositor/qwaylandframestatistics.h>
+
+#include <QtCore/private/qobject_p.h>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+
+QT_BEGIN_NAMESPACE
+
+// Frames are prepared and rendered on the render thread for Qt Quick outputs, while commits
+// and event dispatching happen on the compositor thread, hence the lock. Each frame is
+// finished when the next one starts, so everything the render thread reports about it,
+// up to the buffer swap, has arrived by then.
+class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandFrameStatisticsPrivate : public QObjectPrivate
+{
+    Q_DECLARE_PUBLIC(QWaylandFrameStatistics)
+public:
+    static QWaylandFrameStatisticsPrivate *get(QWaylandFrameStatistics *statistics) { return statistics->d_func(); }
+
+    void frameStarted(qint64 eventDispatchTotal);
+    void frameCallbacksSent();
+    void surfaceCommitted();
+    void renderStarted();
+    void renderFinished();
+    void frameSwapped();
+    void addTextureUploadTime(qint64 nsecs);
+
+    QWaylandOutput *output = nullptr;
+    QElapsedTimer clock;
+
+    mutable QMutex mutex;
+
+    // All in nanoseconds of clock
+    struct CurrentFrame {
+        bool active = false;
+        qint64 startWallTime = 0;
+        qint64 start = 0;
+        qint64 eventDispatchTime = 0;
+        qint64 textureUploadTime = 0;
+        qint64 renderStart = 0;
+        qint64 renderTime = 0;
+        qint64 swap = 0;
+        qint64 frameCallbacksSent = 0;
+        qint64 earliestCommit = 0;
+        int surfacesUpdated = 0;
+    } current;
+
+    // Commits made since the current frame started show up in the next one
+    qint64 earliestPendingCommit = 0;
+    int pendingSurfaceUpdates = 0;
+    qint64 lastEventDispatchTotal = -1;
+
+    int frameCount = 0;
+    QWaylandFrameStatistics::Frame last;
+    QVector<QWaylandFrameStatistics::Frame> history; // Ring buffer
+    int historySize = 0;
+    int historyNext = 0;
+
+    QVector<QWaylandFrameStatistics::Frame> orderedHistory() const;
+
+private:
+    bool finishFrame();
+};
+
+QT_END_NAMESPACE
+
+#endif // QWAYLANDFRAMESTATISTICS_P_H
@@ -107,7 +107,7 @@ void QWaylandKeyboardPrivate::focused(QWaylandSurface *surface)
             focusDestroyListener.listenForDestruction(surface->resource());
     }
 
-    Resource *resource = surface ? resourceMap().value(surface->waylandClient()) : 0;
+    Resource *resource = surface ? clientResource(surface->waylandClient()) : 0;
 
     if (resource && (focus != surface || focusResource != resource))
         sendEnter(surface, resource);
@@ -246,7 +246,7 @@ void QWaylandKeyboardPrivate::maybeUpdateKeymap()
         return;
 
     createXKBKeymap();
-    const auto resMap = resourceMap();
+    const auto resMap = resourceHash();
     for (Resource *res : resMap) {
         send_keymap(res->handle, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1, keymap_fd, keymap_size);
     }
@@ -384,7 +384,7 @@ void QWaylandKeyboardPrivate::createXKBKeymap()
 
 void QWaylandKeyboardPrivate::sendRepeatInfo()
 {
-    const auto resMap = resourceMap();
+    const auto resMap = resourceHash();
     for (Resource *resource : resMap) {
         if (resource->version() >= WL_KEYBOARD_REPEAT_INFO_SINCE_VERSION)
             send_repeat_info(resource->handle, repeatRate, repeatDelay);
@@ -475,7 +475,7 @@ QWaylandClient *QWaylandKeyboard::focusClient() const
 void QWaylandKeyboard::sendKeyModifiers(QWaylandClient *client, uint32_t serial)
 {
     Q_D(QWaylandKeyboard);
-    QtWaylandServer::wl_keyboard::Resource *resource = d->resourceMap().value(client->client());
+    QtWaylandServer::wl_keyboard::Resource *resource = d->clientResource(client->client());
     if (resource)
         d->send_modifiers(resource->handle, serial, d->modsDepressed, d->modsLatched, d->modsLocked, d->group);
 }
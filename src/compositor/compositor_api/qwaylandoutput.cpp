@@ -33,12 +33,15 @@
 
 #include <QtWaylandCompositor/QWaylandCompositor>
 #include <QtWaylandCompositor/QWaylandView>
+#include <QtWaylandCompositor/QWaylandFrameStatistics>
 
 #include <QtWaylandCompositor/private/qwaylandsurface_p.h>
 #include <QtWaylandCompositor/private/qwaylandcompositor_p.h>
+#include <QtWaylandCompositor/private/qwaylandframestatistics_p.h>
 #include <QtWaylandCompositor/private/qwaylandview_p.h>
 #include <QtWaylandCompositor/private/qwaylandutils_p.h>
 #include <QtWaylandCompositor/private/qwaylandxdgoutputv1_p.h>
+#include <QtWaylandCompositor/private/qwltrace_p.h>
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QtMath>
@@ -148,7 +151,7 @@ void QWaylandOutputPrivate::sendGeometry(const Resource *resource)
 
 void QWaylandOutputPrivate::sendGeometryInfo()
 {
-    for (const Resource *resource : resourceMap().values()) {
+    for (const Resource *resource : resourceHash()) {
         sendGeometry(resource);
         if (resource->version() >= 2)
             send_done(resource->handle);
@@ -173,7 +176,7 @@ void QWaylandOutputPrivate::sendMode(const Resource *resource, const QWaylandOut
 
 void QWaylandOutputPrivate::sendModesInfo()
 {
-    for (const Resource *resource : resourceMap().values()) {
+    for (const Resource *resource : resourceHash()) {
         for (const QWaylandOutputMode &mode : modes)
             sendMode(resource, mode);
         if (resource->version() >= 2)
@@ -213,33 +216,77 @@ void QWaylandOutputPrivate::handleWindowPixelSizeChanged()
 
 void QWaylandOutputPrivate::addView(QWaylandView *view, QWaylandSurface *surface)
 {
-    for (int i = 0; i < surfaceViews.size(); i++) {
-        if (surface == surfaceViews.at(i).surface) {
-            if (!surfaceViews.at(i).views.contains(view)) {
-                surfaceViews[i].views.append(view);
-            }
-            return;
-        }
+    const auto it = surfaceViewIndex.constFind(surface);
+    if (it != surfaceViewIndex.constEnd()) {
+        QWaylandSurfaceViewMapper &mapper = surfaceViews[it.value()];
+        if (!mapper.views.contains(view))
+            mapper.views.append(view);
+        return;
     }
 
+    surfaceViewIndex.insert(surface, surfaceViews.size());
     surfaceViews.append(QWaylandSurfaceViewMapper(surface,view));
+    surfacesToEnter.append(surface);
+    if (!QWaylandSurfacePrivate::get(surface)->frameCallbacks.isEmpty())
+        scheduleFrameCallbacks(surface);
 }
 
 void QWaylandOutputPrivate::removeView(QWaylandView *view, QWaylandSurface *surface)
 {
     Q_Q(QWaylandOutput);
-    for (int i = 0; i < surfaceViews.size(); i++) {
-        if (surface == surfaceViews.at(i).surface) {
-            bool removed = surfaceViews[i].views.removeOne(view);
-            if (surfaceViews.at(i).views.isEmpty() && removed) {
-                if (surfaceViews.at(i).has_entered)
-                    q->surfaceLeave(surface);
-                surfaceViews.remove(i);
-            }
-            return;
-        }
+    const auto it = surfaceViewIndex.constFind(surface);
+    if (it == surfaceViewIndex.constEnd()) {
+        qWarning("%s Could not find view %p for surface %p to remove. Possible invalid state", Q_FUNC_INFO, view, surface);
+        return;
     }
-    qWarning("%s Could not find view %p for surface %p to remove. Possible invalid state", Q_FUNC_INFO, view, surface);
+
+    const int index = it.value();
+    QWaylandSurfaceViewMapper &mapper = surfaceViews[index];
+    bool removed = mapper.views.removeOne(view);
+    if (!mapper.views.isEmpty() || !removed)
+        return;
+
+    if (mapper.has_entered)
+        q->surfaceLeave(surface);
+    else
+        surfacesToEnter.removeOne(surface);
+    if (mapper.has_frame_callbacks)
+        frameCallbackSurfaces.removeOne(surface);
+
+    // Move the last entry into the free slot, the order of surfaceViews does not matter
+    surfaceViewIndex.remove(surface);
+    const int last = surfaceViews.size() - 1;
+    if (index != last) {
+        surfaceViews[index] = surfaceViews.at(last);
+        surfaceViewIndex[surfaceViews.at(index).surface] = index;
+    }
+    surfaceViews.removeLast();
+}
+
+/*!
+ * \internal
+ *
+ * Makes the output consider \a surface in frameStarted() and sendFrameCallbacks() until
+ * all its frame callbacks have been sent. Only surfaces that have been committed with
+ * frame callbacks are visited on each frame, however many surfaces are mapped.
+ */
+void QWaylandOutputPrivate::scheduleFrameCallbacks(QWaylandSurface *surface)
+{
+    const auto it = surfaceViewIndex.constFind(surface);
+    if (it == surfaceViewIndex.constEnd())
+        return;
+
+    QWaylandSurfaceViewMapper &mapper = surfaceViews[it.value()];
+    if (mapper.has_frame_callbacks)
+        return;
+    mapper.has_frame_callbacks = true;
+    frameCallbackSurfaces.append(surface);
+}
+
+QWaylandFrameStatisticsPrivate *QWaylandOutputPrivate::statistics() const
+{
+    QWaylandFrameStatistics *statistics = frameStatistics.loadAcquire();
+    return statistics ? QWaylandFrameStatisticsPrivate::get(statistics) : nullptr;
 }
 
 QWaylandOutput::QWaylandOutput()
@@ -292,6 +339,14 @@ QWaylandOutput::QWaylandOutput(QWaylandCompositor *compositor, QWindow *window)
     QWaylandCompositorPrivate::get(compositor)->addPolishObject(this);
 }
 
+/*!
+ * \internal
+ */
+QWaylandOutput::QWaylandOutput(QWaylandOutputPrivate &dptr)
+    : QWaylandObject(dptr)
+{
+}
+
 /*!
  * Destroys the QWaylandOutput.
  */
@@ -359,7 +414,7 @@ QWaylandOutput *QWaylandOutput::fromResource(wl_resource *resource)
 struct ::wl_resource *QWaylandOutput::resourceForClient(QWaylandClient *client) const
 {
     Q_D(const QWaylandOutput);
-    QWaylandOutputPrivate::Resource *r = d->resourceMap().value(client->client());
+    QWaylandOutputPrivate::Resource *r = d->clientResource(client->client());
     if (r)
         return r->handle;
 
@@ -828,7 +883,7 @@ void QWaylandOutput::setScaleFactor(int scale)
 
     d->scaleFactor = scale;
 
-    const auto resMap = d->resourceMap();
+    const auto resMap = d->resourceHash();
     for (QWaylandOutputPrivate::Resource *resource : resMap) {
         if (resource->version() >= 2) {
             d->send_scale(resource->handle, scale);
@@ -880,6 +935,33 @@ void QWaylandOutput::setSizeFollowsWindow(bool follow)
     }
 }
 
+/*!
+ * \qmlproperty WaylandFrameStatistics QtWaylandCompositor::WaylandOutput::frameStatistics
+ * \since 5.15
+ *
+ * This property holds the timings of the frames rendered on this WaylandOutput. Frames
+ * are measured from the first time this property is read.
+ */
+
+/*!
+ * \property QWaylandOutput::frameStatistics
+ * \since 5.15
+ *
+ * This property holds the timings of the frames rendered on this QWaylandOutput. The
+ * statistics object is created, and frames are measured, from the first time this
+ * property is read. It is owned by the output.
+ */
+QWaylandFrameStatistics *QWaylandOutput::frameStatistics()
+{
+    Q_D(QWaylandOutput);
+    QWaylandFrameStatistics *statistics = d->frameStatistics.loadAcquire();
+    if (!statistics) {
+        statistics = new QWaylandFrameStatistics(this);
+        d->frameStatistics.storeRelease(statistics);
+    }
+    return statistics;
+}
+
 /*!
  * \qmlproperty Window QtWaylandCompositor::WaylandOutput::window
  *
@@ -918,10 +1000,16 @@ void QWaylandOutput::setWindow(QWindow *window)
 void QWaylandOutput::frameStarted()
 {
     Q_D(QWaylandOutput);
-    for (int i = 0; i < d->surfaceViews.size(); i++) {
-        QWaylandSurfaceViewMapper &surfacemapper = d->surfaceViews[i];
-        if (surfacemapper.maybePrimaryView())
-            surfacemapper.surface->frameStarted();
+    if (QWaylandFrameStatisticsPrivate *statistics = d->statistics()) {
+        const qint64 eventDispatchTime = d->compositor
+                ? QWaylandCompositorPrivate::get(d->compositor)->eventDispatchTime.loadRelaxed()
+                : 0;
+        statistics->frameStarted(eventDispatchTime);
+    }
+    for (QWaylandSurface *surface : qAsConst(d->frameCallbackSurfaces)) {
+        QWaylandView *view = QWaylandSurfacePrivate::get(surface)->frameCallbackView();
+        if (view && view->output() == this)
+            surface->frameStarted();
     }
 }
 
@@ -931,20 +1019,42 @@ void QWaylandOutput::frameStarted()
 void QWaylandOutput::sendFrameCallbacks()
 {
     Q_D(QWaylandOutput);
-    for (int i = 0; i < d->surfaceViews.size(); i++) {
-        const QWaylandSurfaceViewMapper &surfacemapper = d->surfaceViews.at(i);
-        if (surfacemapper.surface && surfacemapper.surface->hasContent()) {
-            if (!surfacemapper.has_entered) {
-                surfaceEnter(surfacemapper.surface);
-                d->surfaceViews[i].has_entered = true;
-            }
-            if (auto primaryView = surfacemapper.maybePrimaryView()) {
-                if (!QWaylandViewPrivate::get(primaryView)->independentFrameCallback)
-                    surfacemapper.surface->sendFrameCallbacks();
-            }
+    const qint64 traceStart = QtWayland::Trace::isEnabled() ? QtWayland::Trace::timestamp() : 0;
+    int remaining = 0;
+    for (int i = 0; i < d->surfacesToEnter.size(); i++) {
+        QWaylandSurface *surface = d->surfacesToEnter.at(i);
+        if (surface->hasContent()) {
+            surfaceEnter(surface);
+            d->surfaceViews[d->surfaceViewIndex.value(surface)].has_entered = true;
+        } else {
+            d->surfacesToEnter[remaining++] = surface;
+        }
+    }
+    d->surfacesToEnter.resize(remaining);
+
+    remaining = 0;
+    for (int i = 0; i < d->frameCallbackSurfaces.size(); i++) {
+        QWaylandSurface *surface = d->frameCallbackSurfaces.at(i);
+        QWaylandSurfaceViewMapper &surfacemapper = d->surfaceViews[d->surfaceViewIndex.value(surface)];
+        if (surface->hasContent()) {
+            QWaylandView *view = QWaylandSurfacePrivate::get(surface)->frameCallbackView();
+            if (view && view->output() == this && !QWaylandViewPrivate::get(view)->independentFrameCallback)
+                surface->sendFrameCallbacks();
         }
+        if (QWaylandSurfacePrivate::get(surface)->frameCallbacks.isEmpty())
+            surfacemapper.has_frame_callbacks = false;
+        else
+            d->frameCallbackSurfaces[remaining++] = surface;
     }
+    d->frameCallbackSurfaces.resize(remaining);
+
+    if (QWaylandFrameStatisticsPrivate *statistics = d->statistics())
+        statistics->frameCallbacksSent();
+
     wl_display_flush_clients(d->compositor->display());
+
+    if (traceStart)
+        QtWayland::Trace::complete("sendFrameCallbacks", traceStart);
 }
 
 /*!
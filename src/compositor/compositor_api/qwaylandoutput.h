@@ -50,6 +50,7 @@ class QWaylandSurface;
 class QWaylandView;
 class QWaylandClient;
 class QWaylandOutputSpace;
+class QWaylandFrameStatistics;
 
 class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandOutput : public QWaylandObject
 {
@@ -67,6 +68,7 @@ class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandOutput : public QWaylandObject
     Q_PROPERTY(QWaylandOutput::Transform transform READ transform WRITE setTransform NOTIFY transformChanged)
     Q_PROPERTY(int scaleFactor READ scaleFactor WRITE setScaleFactor NOTIFY scaleFactorChanged)
     Q_PROPERTY(bool sizeFollowsWindow READ sizeFollowsWindow WRITE setSizeFollowsWindow NOTIFY sizeFollowsWindowChanged)
+    Q_PROPERTY(QWaylandFrameStatistics *frameStatistics READ frameStatistics CONSTANT REVISION 15)
     Q_ENUMS(Subpixel Transform)
 
 public:
@@ -144,6 +146,8 @@ public:
     bool physicalSizeFollowsSize() const;
     void setPhysicalSizeFollowsSize(bool follow);
 
+    QWaylandFrameStatistics *frameStatistics();
+
     void frameStarted();
     void sendFrameCallbacks();
 
@@ -171,6 +175,8 @@ Q_SIGNALS:
     void windowDestroyed();
 
 protected:
+    QWaylandOutput(QWaylandOutputPrivate &dptr);
+
     bool event(QEvent *event) override;
 
     virtual void initialize();
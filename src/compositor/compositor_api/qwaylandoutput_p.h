@@ -51,6 +51,8 @@
 
 #include <QtWaylandCompositor/private/qwayland-server-wayland.h>
 
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QHash>
 #include <QtCore/QRect>
 #include <QtCore/QVector>
 
@@ -68,20 +70,14 @@ struct QWaylandSurfaceViewMapper
         , views(1, v)
     {}
 
-    QWaylandView *maybePrimaryView() const
-    {
-        for (int i = 0; i < views.size(); i++) {
-            if (surface && surface->primaryView() == views.at(i))
-                return views.at(i);
-        }
-        return nullptr;
-    }
-
     QWaylandSurface *surface = nullptr;
     QVector<QWaylandView *> views;
     bool has_entered = false;
+    bool has_frame_callbacks = false;
 };
 
+class QWaylandFrameStatisticsPrivate;
+
 class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandOutputPrivate : public QObjectPrivate, public QtWaylandServer::wl_output
 {
 public:
@@ -90,8 +86,9 @@ public:
     ~QWaylandOutputPrivate() override;
     static QWaylandOutputPrivate *get(QWaylandOutput *output) { return output->d_func(); }
 
-    void addView(QWaylandView *view, QWaylandSurface *surface);
-    void removeView(QWaylandView *view, QWaylandSurface *surface);
+    virtual void addView(QWaylandView *view, QWaylandSurface *surface);
+    virtual void removeView(QWaylandView *view, QWaylandSurface *surface);
+    void scheduleFrameCallbacks(QWaylandSurface *surface);
 
     void sendGeometry(const Resource *resource);
     void sendGeometryInfo();
@@ -101,6 +98,9 @@ public:
 
     void handleWindowPixelSizeChanged();
 
+    // Null until QWaylandOutput::frameStatistics() is first called. Read from the render thread.
+    QWaylandFrameStatisticsPrivate *statistics() const;
+
     QPointer<QWaylandXdgOutputV1> xdgOutput;
 
 protected:
@@ -120,6 +120,9 @@ private:
     int preferredMode = -1;
     QRect availableGeometry;
     QVector<QWaylandSurfaceViewMapper> surfaceViews;
+    QHash<QWaylandSurface *, int> surfaceViewIndex; // Position of each surface in surfaceViews
+    QVector<QWaylandSurface *> frameCallbackSurfaces; // Surfaces with frame callbacks left to send
+    QVector<QWaylandSurface *> surfacesToEnter; // Surfaces that have not been sent enter yet
     QSize physicalSize;
     QWaylandOutput::Subpixel subpixel = QWaylandOutput::SubpixelUnknown;
     QWaylandOutput::Transform transform = QWaylandOutput::TransformNormal;
@@ -127,6 +130,7 @@ private:
     bool sizeFollowsWindow = false;
     bool initialized = false;
     QSize windowPixelSize;
+    QAtomicPointer<QWaylandFrameStatistics> frameStatistics;
 
     Q_DECLARE_PUBLIC(QWaylandOutput)
     Q_DISABLE_COPY(QWaylandOutputPrivate)
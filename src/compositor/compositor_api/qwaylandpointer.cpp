@@ -51,7 +51,7 @@ uint QWaylandPointerPrivate::sendButton(Qt::MouseButton button, uint32_t state)
     wl_client *client = q->mouseFocus()->surface()->waylandClient();
     uint32_t time = compositor()->currentTimeMsecs();
     uint32_t serial = compositor()->nextSerial();
-    for (auto resource : resourceMap().values(client))
+    for (auto resource : resourceHash().values(client))
         send_button(resource->handle, serial, time, q->toWaylandButton(button), state);
     return serial;
 }
@@ -62,7 +62,7 @@ void QWaylandPointerPrivate::sendMotion()
     uint32_t time = compositor()->currentTimeMsecs();
     wl_fixed_t x = wl_fixed_from_double(localPosition.x());
     wl_fixed_t y = wl_fixed_from_double(localPosition.y());
-    for (auto resource : resourceMap().values(enteredSurface->waylandClient()))
+    for (auto resource : resourceHash().values(enteredSurface->waylandClient()))
         wl_pointer_send_motion(resource->handle, time, x, y);
 }
 
@@ -77,7 +77,7 @@ void QWaylandPointerPrivate::sendEnter(QWaylandSurface *surface)
 
     wl_fixed_t x = wl_fixed_from_double(localPosition.x());
     wl_fixed_t y = wl_fixed_from_double(localPosition.y());
-    for (auto resource : resourceMap().values(surface->waylandClient()))
+    for (auto resource : resourceHash().values(surface->waylandClient()))
         send_enter(resource->handle, enterSerial, surface->resource(), x, y);
 
     enteredSurface = surface;
@@ -88,7 +88,7 @@ void QWaylandPointerPrivate::sendLeave()
 {
     Q_ASSERT(enteredSurface);
     uint32_t serial = compositor()->nextSerial();
-    for (auto resource : resourceMap().values(enteredSurface->waylandClient()))
+    for (auto resource : resourceHash().values(enteredSurface->waylandClient()))
         send_leave(resource->handle, serial, enteredSurface->resource());
     enteredSurface = nullptr;
     localPosition = QPointF();
@@ -271,7 +271,7 @@ void QWaylandPointer::sendMouseWheelEvent(Qt::Orientation orientation, int delta
     uint32_t axis = orientation == Qt::Horizontal ? WL_POINTER_AXIS_HORIZONTAL_SCROLL
                                                   : WL_POINTER_AXIS_VERTICAL_SCROLL;
 
-    for (auto resource : d->resourceMap().values(d->enteredSurface->waylandClient()))
+    for (auto resource : d->resourceHash().values(d->enteredSurface->waylandClient()))
         d->send_axis(resource->handle, time, axis, wl_fixed_from_int(-delta / 12));
 }
 
@@ -339,7 +339,7 @@ struct wl_resource *QWaylandPointer::focusResource() const
         return nullptr;
 
     // Just return the first resource we can find.
-    return d->resourceMap().value(focus->surface()->waylandClient())->handle;
+    return d->clientResource(focus->surface()->waylandClient())->handle;
 }
 
 /*!
@@ -30,12 +30,7 @@
 
 #include <QtQml/QQmlEngine>
 #include <QQuickWindow>
-#if QT_CONFIG(opengl)
-#  include <QOpenGLTextureBlitter>
-#  include <QOpenGLTexture>
-#  include <QOpenGLFramebufferObject>
-#endif
-#include <QMatrix4x4>
+#include <QPointer>
 #include <QRunnable>
 
 #include "qwaylandclient.h"
@@ -43,6 +38,7 @@
 #include "qwaylandquicksurface.h"
 #include "qwaylandquickoutput.h"
 #include "qwaylandquickitem.h"
+#include "qwaylandsurfacegrabber_p.h"
 #include "qwaylandoutput.h"
 #include <QtWaylandCompositor/private/qwaylandcompositor_p.h>
 #include <QtWaylandCompositor/QWaylandViewporter>
@@ -132,36 +128,41 @@ void QWaylandQuickCompositor::grabSurface(QWaylandSurfaceGrabber *grabber, const
     class GrabState : public QRunnable
     {
     public:
+        QQuickWindow *window = nullptr;
         QWaylandSurfaceGrabber *grabber = nullptr;
         QWaylandBufferRef buffer;
+        QRect rect;
 
         void run() override
         {
-            QOpenGLFramebufferObject fbo(buffer.size());
-            fbo.bind();
-            QOpenGLTextureBlitter blitter;
-            blitter.create();
-
-            glViewport(0, 0, buffer.size().width(), buffer.size().height());
-
-            QOpenGLTextureBlitter::Origin surfaceOrigin =
-                buffer.origin() == QWaylandSurface::OriginTopLeft
-                ? QOpenGLTextureBlitter::OriginTopLeft
-                : QOpenGLTextureBlitter::OriginBottomLeft;
-
-            auto texture = buffer.toOpenGLTexture();
-            blitter.bind(texture->target());
-            blitter.blit(texture->textureId(), QMatrix4x4(), surfaceOrigin);
-            blitter.release();
-
-            emit grabber->success(fbo.toImage());
+            QWaylandSurfaceGrabberPrivate *grabberPrivate = QWaylandSurfaceGrabberPrivate::get(grabber);
+            if (buffer.hasBuffer())
+                grabberPrivate->grabTexture(buffer, rect);
+            if (!grabberPrivate->pollReadbacks(false))
+                return;
+
+            // Asynchronous read backs still in flight get polled for after the next frames.
+            // Render jobs can only be scheduled from the GUI thread.
+            QPointer<QQuickWindow> pollWindow(window);
+            QWaylandSurfaceGrabber *pollGrabber = grabber;
+            QMetaObject::invokeMethod(grabber, [pollWindow, pollGrabber] {
+                if (!pollWindow)
+                    return;
+                GrabState *poll = new GrabState;
+                poll->window = pollWindow;
+                poll->grabber = pollGrabber;
+                pollWindow->scheduleRenderJob(poll, QQuickWindow::AfterRenderingStage);
+                pollWindow->update();
+            }, Qt::QueuedConnection);
         }
     };
 
     GrabState *state = new GrabState;
+    state->window = static_cast<QQuickWindow *>(output->window());
     state->grabber = grabber;
     state->buffer = buffer;
-    static_cast<QQuickWindow *>(output->window())->scheduleRenderJob(state, QQuickWindow::AfterRenderingStage);
+    state->rect = QWaylandSurfaceGrabberPrivate::get(grabber)->requestedRect;
+    state->window->scheduleRenderJob(state, QQuickWindow::AfterRenderingStage);
 #else
     emit grabber->failed(QWaylandSurfaceGrabber::UnknownBufferType);
 #endif
@@ -41,7 +41,7 @@ class QWaylandQuickHardwareLayerPrivate : public QObjectPrivate
 {
     Q_DECLARE_PUBLIC(QWaylandQuickHardwareLayer)
 public:
-    QtWayland::HardwareLayerIntegration *layerIntegration();
+    static QtWayland::HardwareLayerIntegration *layerIntegration();
     QWaylandQuickItem *m_waylandItem = nullptr;
     int m_stackingLevel = 0;
     QMatrix4x4 m_matrixFromRenderThread;
@@ -90,6 +90,13 @@ QtWayland::HardwareLayerIntegration *QWaylandQuickHardwareLayerPrivate::layerInt
  *
  * The preferred hardware layer integration may be overridden by setting the
  * QT_WAYLAND_HARDWARE_LAYER_INTEGRATION environment variable.
+ *
+ * The \c drm-atomic integration works with any KMS driver that supports atomic mode setting,
+ * including vkms, when using the eglfs platform plugin with the eglfs_kms integration. Before
+ * each frame it picks the layers that fit the overlay planes of the screen best, judged by their
+ * format, scale, stacking level, opacity and how much of them is visible. Layers that don't get a
+ * plane are drawn by the scene graph as usual. Set \c QT_QPA_EGLFS_KMS_ATOMIC=1 to have the planes
+ * updated in the same commit as the rest of the screen.
  */
 
 QWaylandQuickHardwareLayer::QWaylandQuickHardwareLayer(QObject *parent)
@@ -104,6 +111,19 @@ QWaylandQuickHardwareLayer::~QWaylandQuickHardwareLayer()
         d->layerIntegration()->remove(this);
 }
 
+/*!
+ * \internal
+ *
+ * Returns \c true if a hardware layer integration could be loaded, i.e. if creating a
+ * QWaylandQuickHardwareLayer has any effect. Doesn't warn if there are no integrations.
+ */
+bool QWaylandQuickHardwareLayer::isAvailable()
+{
+    if (QtWayland::HardwareLayerIntegrationFactory::keys().isEmpty())
+        return false;
+    return QWaylandQuickHardwareLayerPrivate::layerIntegration() != nullptr;
+}
+
 /*!
  * \qmlproperty int QtWaylandCompositor::WaylandHardwareLayer::stackingLevel
  *
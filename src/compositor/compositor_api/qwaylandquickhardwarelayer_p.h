@@ -67,6 +67,8 @@ public:
 
     void disableSceneGraphPainting();
 
+    static bool isAvailable();
+
 Q_SIGNALS:
     void stackingLevelChanged();
 };
@@ -41,6 +41,10 @@
 #endif
 #include <QtWaylandCompositor/private/qwlclientbufferintegration_p.h>
 #include <QtWaylandCompositor/private/qwaylandsurface_p.h>
+#include <QtWaylandCompositor/private/qwaylandoutput_p.h>
+#include <QtWaylandCompositor/private/qwaylandview_p.h>
+#include <QtWaylandCompositor/private/qwaylandframestatistics_p.h>
+#include <QtWaylandCompositor/private/qwltrace_p.h>
 
 #if QT_CONFIG(opengl)
 #  include <QtGui/QOpenGLTexture>
@@ -54,6 +58,7 @@
 #include <QtQuick/QSGSimpleTextureNode>
 #include <QtQuick/QQuickWindow>
 
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QMutexLocker>
 #include <QtCore/QMutex>
 
@@ -1337,6 +1342,23 @@ void QWaylandQuickItem::updateInputMethod(Qt::InputMethodQueries queries)
  * \sa QWaylandQuickItem::bufferLocked
  */
 
+// Called on the render thread while the GUI thread is blocked, so the output can be read
+static void addTextureUploadTime(QWaylandView *view, const QElapsedTimer &timer)
+{
+    const qint64 elapsed = timer.nsecsElapsed();
+    if (QWaylandOutput *output = view->output()) {
+        if (QWaylandFrameStatisticsPrivate *statistics = QWaylandOutputPrivate::get(output)->statistics())
+            statistics->addTextureUploadTime(elapsed);
+    }
+    if (QtWayland::Trace::isEnabled()) {
+        struct ::wl_resource *surface = view->surface() ? view->surface()->resource() : nullptr;
+        QtWayland::Trace::complete("textureUpload", QtWayland::Trace::timestamp() - elapsed, {
+            { "client", QtWayland::Trace::clientPid(surface) },
+            { "surface", surface ? wl_resource_get_id(surface) : 0 }
+        });
+    }
+}
+
 QSGNode *QWaylandQuickItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
 {
     Q_D(QWaylandQuickItem);
@@ -1356,11 +1378,23 @@ QSGNode *QWaylandQuickItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeDat
     const QRectF rect = invertY ? QRectF(0, height(), width(), -height())
                                 : QRectF(0, 0, width(), height());
 
-    if (ref.isSharedMemory()
 #if QT_CONFIG(opengl)
-            || bufferTypes[ref.bufferFormatEgl()].canProvideTexture
+    // YUV shared memory buffers come in planes, like EGL ones, and are converted by the material
+    const QWaylandBufferRef::BufferFormatEgl format = ref.bufferFormatEgl();
+    const bool useTextureNode = bufferTypes[format].canProvideTexture
+            || (ref.isSharedMemory() && format == QWaylandBufferRef::BufferFormatEgl_Null);
+#else
+    const bool useTextureNode = ref.isSharedMemory();
 #endif
-    ) {
+
+    // A client may switch between RGB and YUV buffers, which need different kinds of nodes
+    if (oldNode && useTextureNode != d->textureNode) {
+        delete oldNode;
+        oldNode = nullptr;
+    }
+    d->textureNode = useTextureNode;
+
+    if (useTextureNode) {
         // This case could covered by the more general path below, but this is more efficient (especially when using ShaderEffect items).
         QSGSimpleTextureNode *node = static_cast<QSGSimpleTextureNode *>(oldNode);
 
@@ -1374,8 +1408,11 @@ QSGNode *QWaylandQuickItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeDat
 
         if (d->newTexture) {
             d->newTexture = false;
+            QElapsedTimer uploadTimer;
+            uploadTimer.start();
             d->provider->setBufferRef(this, ref);
             node->setTexture(d->provider->texture());
+            addTextureUploadTime(d->view.data(), uploadTimer);
         }
 
         d->provider->setSmooth(smooth());
@@ -1389,8 +1426,6 @@ QSGNode *QWaylandQuickItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeDat
     }
 
 #if QT_CONFIG(opengl)
-    Q_ASSERT(!d->provider);
-
     QSGGeometryNode *node = static_cast<QSGGeometryNode *>(oldNode);
 
     if (!node) {
@@ -1404,15 +1439,21 @@ QSGNode *QWaylandQuickItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeDat
     if (!geometry)
         geometry = new QSGGeometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), 4);
 
-    if (!material)
-        material = new QWaylandBufferMaterial(ref.bufferFormatEgl());
+    if (!material || material->format() != format) {
+        // Setting the new material on the node deletes the old one
+        material = new QWaylandBufferMaterial(format);
+        d->newTexture = true;
+    }
 
     if (d->newTexture) {
         d->newTexture = false;
-        for (int plane = 0; plane < bufferTypes[ref.bufferFormatEgl()].planeCount; plane++)
+        QElapsedTimer uploadTimer;
+        uploadTimer.start();
+        for (int plane = 0; plane < bufferTypes[format].planeCount; plane++)
             if (auto texture = ref.toOpenGLTexture(plane))
                 material->setTextureForPlane(plane, texture);
         material->bind();
+        addTextureUploadTime(d->view.data(), uploadTimer);
     }
 
     QSGGeometry::updateTexturedRectGeometry(geometry, rect, QRectF(0, 0, 1, 1));
@@ -1518,6 +1559,20 @@ qreal QWaylandQuickItemPrivate::scaleFactor() const
     return f;
 }
 
+void QWaylandQuickItemPrivate::updateViewVisibility()
+{
+    Q_Q(QWaylandQuickItem);
+    bool visible = q->isVisible() && paintEnabled && q->window();
+    bool &viewVisible = QWaylandViewPrivate::get(view.data())->visible;
+    if (viewVisible == visible)
+        return;
+
+    viewVisible = visible;
+    // The surface may now be paced by a different output
+    if (QWaylandOutput *output = view->output())
+        output->update();
+}
+
 QWaylandQuickItem *QWaylandQuickItemPrivate::findSibling(QWaylandSurface *surface) const
 {
     Q_Q(const QWaylandQuickItem);
@@ -79,6 +79,7 @@ public:
     QWaylandBufferMaterial(QWaylandBufferRef::BufferFormatEgl format);
     ~QWaylandBufferMaterial() override;
 
+    QWaylandBufferRef::BufferFormatEgl format() const { return m_format; }
     void setTextureForPlane(int plane, QOpenGLTexture *texture);
 
     void bind();
@@ -123,8 +124,12 @@ public:
         QObject::connect(view.data(), &QWaylandView::outputChanged, q, &QWaylandQuickItem::updateOutput);
         QObject::connect(view.data(), &QWaylandView::bufferLockedChanged, q, &QWaylandQuickItem::bufferLockedChanged);
         QObject::connect(view.data(), &QWaylandView::allowDiscardFrontBufferChanged, q, &QWaylandQuickItem::allowDiscardFrontBuffer);
+        QObject::connect(q, &QQuickItem::visibleChanged, q, [this]() { updateViewVisibility(); });
+        QObject::connect(q, &QQuickItem::windowChanged, q, [this]() { updateViewVisibility(); });
+        QObject::connect(q, &QWaylandQuickItem::paintEnabledChanged, q, [this]() { updateViewVisibility(); });
 
         q->updateWindow();
+        updateViewVisibility();
     }
 
     static const QWaylandQuickItemPrivate* get(const QWaylandQuickItem *item) { return item->d_func(); }
@@ -143,6 +148,7 @@ public:
 
     bool shouldSendInputEvents() const { return view->surface() && inputEventsEnabled; }
     qreal scaleFactor() const;
+    void updateViewVisibility();
 
     QWaylandQuickItem *findSibling(QWaylandSurface *surface) const;
     void placeAboveSibling(QWaylandQuickItem *sibling);
@@ -160,6 +166,7 @@ public:
     bool inputEventsEnabled = true;
     bool isDragging = false;
     bool newTexture = false;
+    bool textureNode = false;
     bool focusOnClick = true;
     bool sizeFollowsSurface = true;
     bool belowParent = false;
@@ -31,6 +31,15 @@
 #include "qwaylandquickoutput.h"
 #include "qwaylandquickcompositor.h"
 #include "qwaylandquickitem_p.h"
+#include "qwaylandquicksurface.h"
+
+#include <QtWaylandCompositor/private/qwaylandframestatistics_p.h>
+#include <QtWaylandCompositor/private/qwaylandoutput_p.h>
+#include <QtWaylandCompositor/private/qwaylandsurface_p.h>
+#include <QtWaylandCompositor/private/qwltrace_p.h>
+#if QT_CONFIG(opengl)
+#include <QtWaylandCompositor/private/qwaylandquickhardwarelayer_p.h>
+#endif
 
 QT_BEGIN_NAMESPACE
 
@@ -58,6 +67,28 @@ void QWaylandQuickOutput::initialize()
 
     connect(quickWindow, &QQuickWindow::afterRendering,
             this, &QWaylandQuickOutput::doFrameCallbacks);
+
+    connect(quickWindow, &QQuickWindow::afterAnimating,
+            this, &QWaylandQuickOutput::updateBypass);
+
+    // Frame statistics and traces are gathered on the render thread, as the frame is being rendered
+    QWaylandOutputPrivate *d = QWaylandOutputPrivate::get(this);
+    connect(quickWindow, &QQuickWindow::beforeRendering, this, [d]() {
+        if (QWaylandFrameStatisticsPrivate *statistics = d->statistics())
+            statistics->renderStarted();
+        if (QtWayland::Trace::isEnabled())
+            QtWayland::Trace::begin("render");
+    }, Qt::DirectConnection);
+    connect(quickWindow, &QQuickWindow::afterRendering, this, [d]() {
+        if (QWaylandFrameStatisticsPrivate *statistics = d->statistics())
+            statistics->renderFinished();
+        if (QtWayland::Trace::isEnabled())
+            QtWayland::Trace::end("render");
+    }, Qt::DirectConnection);
+    connect(quickWindow, &QQuickWindow::frameSwapped, this, [d]() {
+        if (QWaylandFrameStatisticsPrivate *statistics = d->statistics())
+            statistics->frameSwapped();
+    }, Qt::DirectConnection);
 }
 
 void QWaylandQuickOutput::classBegin()
@@ -107,6 +138,76 @@ void QWaylandQuickOutput::setAutomaticFrameCallback(bool automatic)
     automaticFrameCallbackChanged();
 }
 
+/*!
+ * \qmlproperty bool QtWaylandCompositor::WaylandOutput::fullscreenBypass
+ * \since 5.15
+ *
+ * This property holds whether the WaylandOutput looks for a fullscreen client
+ * that can be shown without compositing.
+ *
+ * When the topmost item of the window is a WaylandQuickItem showing an opaque
+ * surface that covers the whole window untransformed, with a buffer of the
+ * same size as the window, the window is no longer cleared before rendering.
+ * If a hardware layer integration is available, the item is also given a
+ * WaylandHardwareLayer, so that its buffer can be scanned out directly and the
+ * scene graph has nothing left to draw. As soon as another item is shown on top
+ * of it, or the surface stops covering the window, the window is composited as
+ * usual again.
+ *
+ * The default is false.
+ *
+ * \sa bypassItem
+ */
+
+/*!
+ * \property QWaylandQuickOutput::fullscreenBypass
+ *
+ * This property holds whether the QWaylandQuickOutput looks for a fullscreen
+ * client that can be shown without compositing.
+ *
+ * The default is false.
+ *
+ * \sa bypassItem
+ */
+bool QWaylandQuickOutput::fullscreenBypass() const
+{
+    return m_fullscreenBypass;
+}
+
+void QWaylandQuickOutput::setFullscreenBypass(bool enable)
+{
+    if (m_fullscreenBypass == enable)
+        return;
+
+    m_fullscreenBypass = enable;
+    if (!enable)
+        setBypassItem(nullptr);
+    emit fullscreenBypassChanged();
+}
+
+/*!
+ * \qmlproperty WaylandQuickItem QtWaylandCompositor::WaylandOutput::bypassItem
+ * \since 5.15
+ *
+ * This read-only property holds the item currently shown without compositing,
+ * or \c null if the window is composited as usual.
+ *
+ * \sa fullscreenBypass
+ */
+
+/*!
+ * \property QWaylandQuickOutput::bypassItem
+ *
+ * This read-only property holds the item currently shown without compositing,
+ * or \c nullptr if the window is composited as usual.
+ *
+ * \sa fullscreenBypass
+ */
+QWaylandQuickItem *QWaylandQuickOutput::bypassItem() const
+{
+    return m_bypassItem;
+}
+
 static QQuickItem* clickableItemAtPosition(QQuickItem *rootItem, const QPointF &position)
 {
     if (!rootItem->isEnabled() || !rootItem->isVisible())
@@ -163,4 +264,148 @@ void QWaylandQuickOutput::doFrameCallbacks()
     if (m_automaticFrameCallback)
         sendFrameCallbacks();
 }
+
+// Returns the item painted on top at every point of \a rect, if any
+static QQuickItem *topmostItemInRect(QQuickItem *rootItem, const QRectF &rect)
+{
+    if (!rootItem->isVisible() || qFuzzyIsNull(rootItem->opacity()))
+        return nullptr;
+
+    QList<QQuickItem *> paintOrderItems = QQuickItemPrivate::get(rootItem)->paintOrderChildItems();
+    auto negativeZStart = paintOrderItems.crend();
+    for (auto it = paintOrderItems.crbegin(); it != paintOrderItems.crend(); ++it) {
+        if ((*it)->z() < 0) {
+            negativeZStart = it;
+            break;
+        }
+        if (QQuickItem *item = topmostItemInRect(*it, rect))
+            return item;
+    }
+
+    if (rootItem->flags() & QQuickItem::ItemHasContents
+            && rootItem->mapRectToScene(rootItem->boundingRect()).intersects(rect))
+        return rootItem;
+
+    for (auto it = negativeZStart; it != paintOrderItems.crend(); ++it) {
+        if (QQuickItem *item = topmostItemInRect(*it, rect))
+            return item;
+    }
+
+    return nullptr;
+}
+
+static bool isOpaque(QWaylandSurface *surface, const QWaylandBufferRef &buffer)
+{
+    if (auto *quickSurface = qobject_cast<QWaylandQuickSurface *>(surface)) {
+        if (!quickSurface->useTextureAlpha())
+            return true;
+    }
+
+    switch (buffer.bufferFormatEgl()) {
+    case QWaylandBufferRef::BufferFormatEgl_RGB:
+    case QWaylandBufferRef::BufferFormatEgl_Y_U_V:
+    case QWaylandBufferRef::BufferFormatEgl_Y_UV:
+    case QWaylandBufferRef::BufferFormatEgl_Y_XUXV:
+        return true;
+    default:
+        break;
+    }
+
+    if (buffer.isSharedMemory() && !buffer.image().hasAlphaChannel())
+        return true;
+
+    QRegion opaqueRegion = QWaylandSurfacePrivate::get(surface)->opaqueRegion;
+    return opaqueRegion.contains(QRect(QPoint(), surface->destinationSize()));
+}
+
+// Whether the client buffer of \a item can be put on the screen as is
+static bool isBypassCandidate(QWaylandQuickItem *item, QQuickWindow *window)
+{
+    QWaylandSurface *surface = item->surface();
+    if (!surface || !surface->hasContent() || !item->view())
+        return false;
+
+    qreal opacity = 1;
+    for (QQuickItem *p = item; p; p = p->parentItem())
+        opacity *= p->opacity();
+    if (opacity < 1)
+        return false;
+
+    // The item needs to cover the window exactly, without rotation or scaling
+    const QPointF corners[] = {
+        item->mapToScene(QPointF(0, 0)),
+        item->mapToScene(QPointF(item->width(), 0)) - QPointF(window->width(), 0),
+        item->mapToScene(QPointF(item->width(), item->height())) - QPointF(window->width(), window->height())
+    };
+    for (const QPointF &offset : corners) {
+        if (qAbs(offset.x()) > 0.5 || qAbs(offset.y()) > 0.5)
+            return false;
+    }
+
+    const QSize pixelSize = window->size() * window->effectiveDevicePixelRatio();
+    if (surface->bufferSize() != pixelSize || surface->origin() != QWaylandSurface::OriginTopLeft)
+        return false;
+
+    const QRectF bufferRect(QPointF(), QSizeF(surface->bufferSize()) / surface->bufferScale());
+    if (surface->sourceGeometry() != bufferRect)
+        return false;
+
+    return isOpaque(surface, item->view()->currentBuffer());
+}
+
+void QWaylandQuickOutput::updateBypass()
+{
+    QQuickWindow *quickWindow = static_cast<QQuickWindow *>(window());
+    QWaylandQuickItem *item = nullptr;
+
+    if (m_fullscreenBypass && compositor()) {
+        const QRectF windowRect(QPointF(), quickWindow->size());
+        item = qobject_cast<QWaylandQuickItem *>(topmostItemInRect(quickWindow->contentItem(), windowRect));
+        // An item moved to a hardware layer no longer paints, so only the current one may do that
+        if (item && !item->paintEnabled() && item != m_bypassItem)
+            item = nullptr;
+        if (item && !isBypassCandidate(item, quickWindow))
+            item = nullptr;
+    }
+
+    setBypassItem(item);
+}
+
+#if QT_CONFIG(opengl)
+static bool hasHardwareLayerIntegration()
+{
+    static const bool available = QWaylandQuickHardwareLayer::isAvailable();
+    return available;
+}
+#endif
+
+void QWaylandQuickOutput::setBypassItem(QWaylandQuickItem *item)
+{
+    if (item == m_bypassItem && m_bypassActive == (item != nullptr))
+        return;
+
+    QQuickWindow *quickWindow = static_cast<QQuickWindow *>(window());
+
+    delete m_bypassLayer;
+    if (!m_bypassActive)
+        m_clearBeforeRendering = quickWindow->clearBeforeRendering();
+
+    m_bypassItem = item;
+    m_bypassActive = item != nullptr;
+
+    // Nothing beneath the item is visible, so there is no need to clear it
+    quickWindow->setClearBeforeRendering(m_bypassActive ? false : m_clearBeforeRendering);
+
+#if QT_CONFIG(opengl)
+    if (item && hasHardwareLayerIntegration()
+            && !item->findChild<QWaylandQuickHardwareLayer *>(QString(), Qt::FindDirectChildrenOnly)) {
+        auto *layer = new QWaylandQuickHardwareLayer(item);
+        layer->classBegin();
+        layer->componentComplete();
+        m_bypassLayer = layer;
+    }
+#endif
+
+    emit bypassItemChanged();
+}
 QT_END_NAMESPACE
@@ -31,6 +31,7 @@
 #ifndef QWAYLANDQUICKOUTPUT_H
 #define QWAYLANDQUICKOUTPUT_H
 
+#include <QtCore/QPointer>
 #include <QtQuick/QQuickWindow>
 #include <QtWaylandCompositor/qwaylandoutput.h>
 #include <QtWaylandCompositor/qwaylandquickchildren.h>
@@ -38,6 +39,7 @@
 QT_BEGIN_NAMESPACE
 
 class QWaylandQuickCompositor;
+class QWaylandQuickItem;
 class QQuickWindow;
 
 class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandQuickOutput : public QWaylandOutput, public QQmlParserStatus
@@ -46,6 +48,8 @@ class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandQuickOutput : public QWaylandOutput, p
     Q_OBJECT
     Q_WAYLAND_COMPOSITOR_DECLARE_QUICK_CHILDREN(QWaylandQuickOutput)
     Q_PROPERTY(bool automaticFrameCallback READ automaticFrameCallback WRITE setAutomaticFrameCallback NOTIFY automaticFrameCallbackChanged)
+    Q_PROPERTY(bool fullscreenBypass READ fullscreenBypass WRITE setFullscreenBypass NOTIFY fullscreenBypassChanged REVISION 15)
+    Q_PROPERTY(QWaylandQuickItem *bypassItem READ bypassItem NOTIFY bypassItemChanged REVISION 15)
 public:
     QWaylandQuickOutput();
     QWaylandQuickOutput(QWaylandCompositor *compositor, QWindow *window);
@@ -55,6 +59,11 @@ public:
     bool automaticFrameCallback() const;
     void setAutomaticFrameCallback(bool automatic);
 
+    bool fullscreenBypass() const;
+    void setFullscreenBypass(bool enable);
+
+    QWaylandQuickItem *bypassItem() const;
+
     QQuickItem *pickClickableItem(const QPointF &position);
 
 public Q_SLOTS:
@@ -62,6 +71,8 @@ public Q_SLOTS:
 
 Q_SIGNALS:
     void automaticFrameCallbackChanged();
+    Q_REVISION(15) void fullscreenBypassChanged();
+    Q_REVISION(15) void bypassItemChanged();
 
 protected:
     void initialize() override;
@@ -70,9 +81,16 @@ protected:
 
 private:
     void doFrameCallbacks();
+    void updateBypass();
+    void setBypassItem(QWaylandQuickItem *item);
 
     bool m_updateScheduled = false;
     bool m_automaticFrameCallback = true;
+    bool m_fullscreenBypass = false;
+    bool m_bypassActive = false;
+    bool m_clearBeforeRendering = true;
+    QPointer<QWaylandQuickItem> m_bypassItem;
+    QPointer<QObject> m_bypassLayer;
 };
 
 QT_END_NAMESPACE
@@ -82,7 +82,7 @@ void QWaylandSeatPrivate::setCapabilities(QWaylandSeat::CapabilityFlags caps)
         }
 
         capabilities = caps;
-        QList<Resource *> resources = resourceMap().values();
+        QList<Resource *> resources = resourceHash().values();
         for (int i = 0; i < resources.size(); i++) {
             wl_seat::send_capabilities(resources.at(i)->handle, (uint32_t)capabilities);
         }
@@ -0,0 +1,606 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwaylandsoftwareoutput.h"
+#include "qwaylandsoftwareoutput_p.h"
+
+#include <QtWaylandCompositor/QWaylandBufferRef>
+#include <QtWaylandCompositor/QWaylandCompositor>
+#include <QtWaylandCompositor/QWaylandOutputMode>
+#include <QtWaylandCompositor/QWaylandSurface>
+#include <QtWaylandCompositor/QWaylandView>
+#include <QtWaylandCompositor/private/qwaylandframestatistics_p.h>
+#include <QtWaylandCompositor/private/qwaylandsurface_p.h>
+#include <QtWaylandCompositor/private/qwltrace_p.h>
+
+#include <QtGui/QPainter>
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef Q_OS_LINUX
+#  include <sys/syscall.h>
+// from linux/memfd.h:
+#  ifndef MFD_CLOEXEC
+#    define MFD_CLOEXEC     0x0001U
+#  endif
+#endif
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+struct FramebufferMapping
+{
+    void *data;
+    size_t size;
+};
+
+void unmapFramebuffer(void *info)
+{
+    auto *mapping = static_cast<FramebufferMapping *>(info);
+    munmap(mapping->data, mapping->size);
+    delete mapping;
+}
+}
+
+QWaylandSoftwareOutputPrivate::~QWaylandSoftwareOutputPrivate()
+{
+    releaseFramebuffer();
+}
+
+void QWaylandSoftwareOutputPrivate::addView(QWaylandView *view, QWaylandSurface *surface)
+{
+    Q_Q(QWaylandSoftwareOutput);
+    QWaylandOutputPrivate::addView(view, surface);
+
+    ViewState *state = viewState(view);
+    if (!state) {
+        views.append(ViewState());
+        state = &views.last();
+        state->view = view;
+    }
+
+    QObject::disconnect(state->damagedConnection);
+    QObject::disconnect(state->redrawConnection);
+    state->damagedConnection = QObject::connect(surface, &QWaylandSurface::damaged, q, [this, view](const QRegion &region) {
+        surfaceDamaged(view, region);
+    });
+    state->redrawConnection = QObject::connect(surface, &QWaylandSurface::redraw, q, &QWaylandSoftwareOutput::update);
+
+    // The new rect is picked up as damage on the next frame
+    q->update();
+}
+
+void QWaylandSoftwareOutputPrivate::removeView(QWaylandView *view, QWaylandSurface *surface)
+{
+    Q_Q(QWaylandSoftwareOutput);
+    QWaylandOutputPrivate::removeView(view, surface);
+
+    for (int i = 0; i < views.size(); ++i) {
+        if (views.at(i).view == view) {
+            QObject::disconnect(views.at(i).damagedConnection);
+            QObject::disconnect(views.at(i).redrawConnection);
+            damage += views.at(i).composedRect;
+            views.remove(i);
+            q->update();
+            return;
+        }
+    }
+}
+
+QWaylandSoftwareOutputPrivate::ViewState *QWaylandSoftwareOutputPrivate::viewState(QWaylandView *view)
+{
+    for (ViewState &state : views) {
+        if (state.view == view)
+            return &state;
+    }
+    return nullptr;
+}
+
+QRect QWaylandSoftwareOutputPrivate::viewRect(const ViewState &state) const
+{
+    QWaylandSurface *surface = state.view->surface();
+    if (!surface || !surface->hasContent())
+        return QRect();
+    return QRect(state.position, surface->destinationSize());
+}
+
+void QWaylandSoftwareOutputPrivate::surfaceDamaged(QWaylandView *view, const QRegion &region)
+{
+    if (ViewState *state = viewState(view))
+        damage += region.translated(state->position);
+}
+
+bool QWaylandSoftwareOutputPrivate::isOpaque(const ViewState &state) const
+{
+    const QWaylandBufferRef buffer = state.view->currentBuffer();
+    if (!buffer.isSharedMemory())
+        return false;
+    const QImage image = buffer.image();
+    if (image.isNull())
+        return false;
+    if (!image.hasAlphaChannel())
+        return true;
+
+    QWaylandSurface *surface = state.view->surface();
+    return QWaylandSurfacePrivate::get(surface)->opaqueRegion.contains(QRect(QPoint(), surface->destinationSize()));
+}
+
+/*
+ * Returns the index of the topmost view that covers the whole output with opaque content, or -1.
+ * The views beneath it can't be seen.
+ */
+int QWaylandSoftwareOutputPrivate::coveringView() const
+{
+    const QRect outputRect(QPoint(), logicalSize());
+    for (int i = views.size() - 1; i >= 0; --i) {
+        if (views.at(i).composedRect.contains(outputRect) && isOpaque(views.at(i)))
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * Copies the damaged part of the buffer of a view covering the whole output straight into the
+ * framebuffer. Returns false if the buffer would have to be transformed or converted.
+ */
+bool QWaylandSoftwareOutputPrivate::copyView(const ViewState &state, const QRegion &damage)
+{
+    Q_Q(QWaylandSoftwareOutput);
+    if (q->transform() != QWaylandOutput::TransformNormal)
+        return false;
+    if (state.composedRect != QRect(QPoint(), logicalSize()))
+        return false;
+
+    const QImage image = state.view->currentBuffer().image();
+    if (image.size() != framebuffer.size())
+        return false;
+    if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32
+            && image.format() != QImage::Format_ARGB32_Premultiplied)
+        return false;
+
+    const QRectF source = state.view->surface()->sourceGeometry();
+    if (source.isValid() && source != QRectF(image.rect()))
+        return false;
+
+    // The view is opaque, but the alpha channel may still hold anything
+    const bool setAlpha = image.format() != QImage::Format_RGB32;
+    const int scale = qMax(q->scaleFactor(), 1);
+    for (const QRect &rect : damage) {
+        const QRect pixels = QRect(rect.topLeft() * scale, rect.size() * scale) & framebuffer.rect();
+        for (int y = pixels.top(); y <= pixels.bottom(); ++y) {
+            const QRgb *src = reinterpret_cast<const QRgb *>(image.constScanLine(y)) + pixels.left();
+            QRgb *dst = reinterpret_cast<QRgb *>(framebuffer.scanLine(y)) + pixels.left();
+            if (setAlpha) {
+                for (int x = 0; x < pixels.width(); ++x)
+                    dst[x] = src[x] | 0xff000000;
+            } else {
+                memcpy(dst, src, size_t(pixels.width()) * sizeof(QRgb));
+            }
+        }
+    }
+    return true;
+}
+
+void QWaylandSoftwareOutputPrivate::invalidate()
+{
+    Q_Q(QWaylandSoftwareOutput);
+    damage = QRect(QPoint(), logicalSize());
+    q->update();
+}
+
+/*
+ * The size of the output in the coordinate system views are positioned in, that is the
+ * mode size with the output transform applied, divided by the scale factor.
+ */
+QSize QWaylandSoftwareOutputPrivate::logicalSize() const
+{
+    Q_Q(const QWaylandSoftwareOutput);
+    QSize size = q->currentMode().size();
+    switch (q->transform()) {
+    case QWaylandOutput::Transform90:
+    case QWaylandOutput::Transform270:
+    case QWaylandOutput::TransformFlipped90:
+    case QWaylandOutput::TransformFlipped270:
+        size.transpose();
+        break;
+    default:
+        break;
+    }
+    return size / qMax(q->scaleFactor(), 1);
+}
+
+/*
+ * Maps output coordinates to framebuffer pixels. The rotations are counter-clockwise,
+ * and the flipped variants flip around the vertical axis before rotating, as defined
+ * by wl_output.transform.
+ */
+QTransform QWaylandSoftwareOutputPrivate::framebufferTransform() const
+{
+    Q_Q(const QWaylandSoftwareOutput);
+    const int scale = qMax(q->scaleFactor(), 1);
+    const QSize size = logicalSize() * scale;
+    const qreal w = size.width();
+    const qreal h = size.height();
+
+    QTransform orientation;
+    switch (q->transform()) {
+    case QWaylandOutput::TransformNormal:
+        break;
+    case QWaylandOutput::Transform90:
+        orientation = QTransform(0, -1, 1, 0, 0, w);
+        break;
+    case QWaylandOutput::Transform180:
+        orientation = QTransform(-1, 0, 0, -1, w, h);
+        break;
+    case QWaylandOutput::Transform270:
+        orientation = QTransform(0, 1, -1, 0, h, 0);
+        break;
+    case QWaylandOutput::TransformFlipped:
+        orientation = QTransform(-1, 0, 0, 1, w, 0);
+        break;
+    case QWaylandOutput::TransformFlipped90:
+        orientation = QTransform(0, 1, 1, 0, 0, 0);
+        break;
+    case QWaylandOutput::TransformFlipped180:
+        orientation = QTransform(1, 0, 0, -1, 0, h);
+        break;
+    case QWaylandOutput::TransformFlipped270:
+        orientation = QTransform(0, -1, -1, 0, h, w);
+        break;
+    }
+    return QTransform::fromScale(scale, scale) * orientation;
+}
+
+bool QWaylandSoftwareOutputPrivate::ensureFramebuffer()
+{
+    Q_Q(QWaylandSoftwareOutput);
+    const QSize size = q->currentMode().size();
+    if (size.isEmpty())
+        return false;
+    if (framebuffer.size() == size)
+        return true;
+
+    releaseFramebuffer();
+
+    const int stride = size.width() * 4;
+    const size_t alloc = size_t(stride) * size.height();
+
+#ifdef SYS_memfd_create
+    int fd = syscall(SYS_memfd_create, "wayland-software-output", MFD_CLOEXEC);
+    if (fd != -1 && ftruncate(fd, off_t(alloc)) == 0) {
+        void *data = mmap(nullptr, alloc, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            framebuffer = QImage(static_cast<uchar *>(data), size.width(), size.height(), stride,
+                                 QImage::Format_RGB32, unmapFramebuffer,
+                                 new FramebufferMapping{data, alloc});
+            framebufferFd = fd;
+        } else {
+            qErrnoWarning("QWaylandSoftwareOutput: mmap failed");
+        }
+    }
+    if (framebufferFd == -1 && fd != -1)
+        close(fd);
+#endif
+
+    // Fall back to plain memory, the framebuffer just can't be shared by fd then
+    if (framebuffer.isNull())
+        framebuffer = QImage(size, QImage::Format_RGB32);
+    if (framebuffer.isNull())
+        return false;
+
+    damage = QRect(QPoint(), logicalSize());
+    return true;
+}
+
+void QWaylandSoftwareOutputPrivate::releaseFramebuffer()
+{
+    framebuffer = QImage();
+    if (framebufferFd != -1) {
+        close(framebufferFd);
+        framebufferFd = -1;
+    }
+}
+
+/*!
+ * \class QWaylandSoftwareOutput
+ * \inmodule QtWaylandCompositor
+ * \since 5.15
+ * \brief The QWaylandSoftwareOutput class is a headless output composited on the CPU.
+ *
+ * QWaylandSoftwareOutput renders the shared memory buffers of the views shown on it into an
+ * in-memory framebuffer, without a window, OpenGL or QtQuick. This makes it possible to run
+ * compositors on machines without a GPU, for instance to stream their content over VNC or
+ * to render it in automated tests.
+ *
+ * Views are added to the output with QWaylandView::setOutput() and stacked in the order they
+ * were added, the last one on top. Their positions are set with setViewPosition(), in output
+ * coordinates, which are the current mode size with transform() applied and divided by
+ * scaleFactor(). Views of surfaces backed by anything else than shared memory are not drawn.
+ *
+ * Rendering is driven by damage: only the regions the clients damaged or that were uncovered
+ * by views moving or going away are redrawn, and frames are rendered at most at the refresh
+ * rate of the current mode. Blending is done by QPainter, which uses the SIMD optimized
+ * raster paint engine routines of the CPU it runs on. Views beneath a view that covers the whole
+ * output with opaque content are not drawn at all. When such a view is on top and its buffer has
+ * the size and layout of the framebuffer, for instance a fullscreen video or game, the damaged
+ * parts of the buffer are copied into the framebuffer without compositing.
+ *
+ * The framebuffer is always in QImage::Format_RGB32. On Linux it lives in a memfd, so it can be
+ * handed to another process, see framebufferFd().
+ */
+
+/*!
+ * Constructs an uninitialized QWaylandSoftwareOutput. The compositor and a mode have to be set
+ * before it is used.
+ */
+QWaylandSoftwareOutput::QWaylandSoftwareOutput()
+    : QWaylandOutput(*new QWaylandSoftwareOutputPrivate())
+{
+    Q_D(QWaylandSoftwareOutput);
+    d->frameTimer.setSingleShot(true);
+    d->frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&d->frameTimer, &QTimer::timeout, this, &QWaylandSoftwareOutput::renderFrame);
+    connect(this, &QWaylandOutput::currentModeChanged, this, [d] { d->invalidate(); });
+    connect(this, &QWaylandOutput::transformChanged, this, [d] { d->invalidate(); });
+    connect(this, &QWaylandOutput::scaleFactorChanged, this, [d] { d->invalidate(); });
+}
+
+/*!
+ * Constructs a QWaylandSoftwareOutput for \a compositor with a single mode of \a size pixels,
+ * refreshed \a refreshRate times per thousand seconds.
+ */
+QWaylandSoftwareOutput::QWaylandSoftwareOutput(QWaylandCompositor *compositor, const QSize &size, int refreshRate)
+    : QWaylandSoftwareOutput()
+{
+    QWaylandOutputMode mode(size, refreshRate);
+    addMode(mode, true);
+    setCurrentMode(mode);
+    setCompositor(compositor);
+}
+
+/*!
+ * Destroys the QWaylandSoftwareOutput.
+ */
+QWaylandSoftwareOutput::~QWaylandSoftwareOutput()
+{
+}
+
+/*!
+ * Returns the position of \a view in output coordinates.
+ */
+QPoint QWaylandSoftwareOutput::viewPosition(QWaylandView *view) const
+{
+    Q_D(const QWaylandSoftwareOutput);
+    for (const auto &state : d->views) {
+        if (state.view == view)
+            return state.position;
+    }
+    return QPoint();
+}
+
+/*!
+ * Moves \a view to \a position, in output coordinates. The view must be shown on this output.
+ */
+void QWaylandSoftwareOutput::setViewPosition(QWaylandView *view, const QPoint &position)
+{
+    Q_D(QWaylandSoftwareOutput);
+    auto *state = d->viewState(view);
+    if (!state) {
+        qWarning("%s: view %p is not shown on this output", Q_FUNC_INFO, view);
+        return;
+    }
+    if (state->position == position)
+        return;
+    state->position = position;
+    update();
+}
+
+/*!
+ * \property QWaylandSoftwareOutput::clearColor
+ *
+ * This property holds the color of the parts of the output not covered by any view. The alpha
+ * channel is ignored. The default is black.
+ */
+QColor QWaylandSoftwareOutput::clearColor() const
+{
+    Q_D(const QWaylandSoftwareOutput);
+    return d->clearColor;
+}
+
+void QWaylandSoftwareOutput::setClearColor(const QColor &color)
+{
+    Q_D(QWaylandSoftwareOutput);
+    if (d->clearColor == color)
+        return;
+    d->clearColor = color;
+    d->invalidate();
+    emit clearColorChanged();
+}
+
+/*!
+ * \property QWaylandSoftwareOutput::automaticFrameCallback
+ *
+ * This property holds whether frame callbacks are sent automatically after each rendered frame.
+ * The default is \c true.
+ */
+bool QWaylandSoftwareOutput::automaticFrameCallback() const
+{
+    Q_D(const QWaylandSoftwareOutput);
+    return d->automaticFrameCallback;
+}
+
+void QWaylandSoftwareOutput::setAutomaticFrameCallback(bool automatic)
+{
+    Q_D(QWaylandSoftwareOutput);
+    if (d->automaticFrameCallback == automatic)
+        return;
+    d->automaticFrameCallback = automatic;
+    emit automaticFrameCallbackChanged();
+}
+
+/*!
+ * Returns the framebuffer as of the last rendered frame. The image references the memory of
+ * the framebuffer, which is overwritten by the next frame and released when the current mode
+ * changes, so it has to be copied to be kept around.
+ */
+QImage QWaylandSoftwareOutput::framebuffer() const
+{
+    Q_D(const QWaylandSoftwareOutput);
+    const QImage &fb = d->framebuffer;
+    if (fb.isNull())
+        return QImage();
+    return QImage(fb.constBits(), fb.width(), fb.height(), fb.bytesPerLine(), fb.format());
+}
+
+/*!
+ * Returns the memfd holding the framebuffer, or -1 if it is not backed by one. The pixel layout
+ * is that of framebuffer(). The file descriptor is owned by the output and closed when the
+ * current mode changes.
+ */
+int QWaylandSoftwareOutput::framebufferFd() const
+{
+    Q_D(const QWaylandSoftwareOutput);
+    return d->framebufferFd;
+}
+
+/*!
+ * Schedules a new frame. Frames are rendered at most at the refresh rate of the current mode.
+ */
+void QWaylandSoftwareOutput::update()
+{
+    Q_D(QWaylandSoftwareOutput);
+    if (d->frameTimer.isActive())
+        return;
+
+    const int refreshRate = currentMode().refreshRate();
+    const qint64 interval = refreshRate > 0 ? 1000000 / refreshRate : 16;
+    const qint64 elapsed = d->lastFrame.isValid() ? d->lastFrame.elapsed() : interval;
+    d->frameTimer.start(int(qMax<qint64>(0, interval - elapsed)));
+}
+
+/*!
+ * Renders a frame right away and returns the region of the framebuffer that changed, in
+ * framebuffer pixels. frameReady() is emitted if that region is not empty.
+ *
+ * This is called automatically when the output is updated, but can be called directly to
+ * render synchronously, for instance in tests.
+ */
+QRegion QWaylandSoftwareOutput::renderFrame()
+{
+    Q_D(QWaylandSoftwareOutput);
+    d->frameTimer.stop();
+    d->lastFrame.start();
+
+    if (!compositor() || !compositor()->isCreated() || !d->ensureFramebuffer())
+        return QRegion();
+
+    frameStarted();
+    QWaylandFrameStatisticsPrivate *statistics = d->statistics();
+    if (statistics)
+        statistics->renderStarted();
+    const qint64 traceStart = QtWayland::Trace::isEnabled() ? QtWayland::Trace::timestamp() : 0;
+
+    QRegion damage = d->damage;
+    d->damage = QRegion();
+    for (auto &state : d->views) {
+        state.view->advance();
+        const QRect rect = d->viewRect(state);
+        if (rect != state.composedRect) {
+            damage += state.composedRect;
+            damage += rect;
+            state.composedRect = rect;
+        }
+    }
+    damage &= QRect(QPoint(), d->logicalSize());
+
+    // A fullscreen client on top is shown as is, without compositing
+    const int covering = damage.isEmpty() ? -1 : d->coveringView();
+    const bool copied = covering != -1 && covering == d->views.size() - 1
+            && d->copyView(d->views.at(covering), damage);
+
+    if (!damage.isEmpty() && !copied) {
+        QPainter painter(&d->framebuffer);
+        painter.setTransform(d->framebufferTransform());
+        painter.setClipRegion(damage);
+
+        // Whatever is beneath a covering view is hidden, unless its buffer still gets blended
+        const bool clear = covering == -1
+                || d->views.at(covering).view->currentBuffer().image().hasAlphaChannel();
+        if (clear) {
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            for (const QRect &rect : damage)
+                painter.fillRect(rect, d->clearColor);
+            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        }
+
+        for (int i = qMax(covering, 0); i < d->views.size(); ++i) {
+            const auto &state = d->views.at(i);
+            if (!damage.intersects(state.composedRect))
+                continue;
+
+            const QWaylandBufferRef buffer = state.view->currentBuffer();
+            if (!buffer.isSharedMemory())
+                continue;
+            const QImage image = buffer.image();
+            if (image.isNull())
+                continue;
+
+            QRectF source = state.view->surface()->sourceGeometry();
+            if (!source.isValid())
+                source = image.rect();
+
+            // Only filter when the buffer is actually resampled
+            const QSizeF target = d->framebufferTransform().mapRect(QRectF(state.composedRect)).size();
+            painter.setRenderHint(QPainter::SmoothPixmapTransform,
+                                  target != source.size() && target.transposed() != source.size());
+            painter.drawImage(QRectF(state.composedRect), image, source);
+        }
+    }
+
+    if (traceStart)
+        QtWayland::Trace::complete("render", traceStart);
+
+    // The framebuffer is what is displayed, so the frame is shown as soon as it is drawn
+    if (statistics) {
+        statistics->renderFinished();
+        statistics->frameSwapped();
+    }
+
+    if (d->automaticFrameCallback)
+        sendFrameCallbacks();
+
+    const QRegion frameDamage = d->framebufferTransform().map(damage);
+    if (!frameDamage.isEmpty())
+        emit frameReady(frameDamage);
+    return frameDamage;
+}
+
+QT_END_NAMESPACE
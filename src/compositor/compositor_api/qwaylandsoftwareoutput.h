@@ -0,0 +1,78 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWAYLANDSOFTWAREOUTPUT_H
+#define QWAYLANDSOFTWAREOUTPUT_H
+
+#include <QtWaylandCompositor/qwaylandoutput.h>
+#include <QtGui/QColor>
+#include <QtGui/QImage>
+#include <QtGui/QRegion>
+
+QT_BEGIN_NAMESPACE
+
+class QWaylandSoftwareOutputPrivate;
+
+class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandSoftwareOutput : public QWaylandOutput
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(QWaylandSoftwareOutput)
+    Q_PROPERTY(QColor clearColor READ clearColor WRITE setClearColor NOTIFY clearColorChanged)
+    Q_PROPERTY(bool automaticFrameCallback READ automaticFrameCallback WRITE setAutomaticFrameCallback NOTIFY automaticFrameCallbackChanged)
+public:
+    QWaylandSoftwareOutput();
+    QWaylandSoftwareOutput(QWaylandCompositor *compositor, const QSize &size, int refreshRate = 60000);
+    ~QWaylandSoftwareOutput() override;
+
+    QPoint viewPosition(QWaylandView *view) const;
+    void setViewPosition(QWaylandView *view, const QPoint &position);
+
+    QColor clearColor() const;
+    void setClearColor(const QColor &color);
+
+    bool automaticFrameCallback() const;
+    void setAutomaticFrameCallback(bool automatic);
+
+    QImage framebuffer() const;
+    int framebufferFd() const;
+
+    void update() override;
+
+public Q_SLOTS:
+    QRegion renderFrame();
+
+Q_SIGNALS:
+    void frameReady(const QRegion &damage);
+    void clearColorChanged();
+    void automaticFrameCallbackChanged();
+};
+
+QT_END_NAMESPACE
+
+#endif // QWAYLANDSOFTWAREOUTPUT_H
@@ -0,0 +1,101 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWAYLANDSOFTWAREOUTPUT_P_H
+#define QWAYLANDSOFTWAREOUTPUT_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtWaylandCompositor/QWaylandSoftwareOutput>
+#include <QtWaylandCompositor/private/qwaylandoutput_p.h>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QPointer>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+#include <QtGui/QTransform>
+
+QT_BEGIN_NAMESPACE
+
+class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandSoftwareOutputPrivate : public QWaylandOutputPrivate
+{
+    Q_DECLARE_PUBLIC(QWaylandSoftwareOutput)
+public:
+    struct ViewState {
+        QWaylandView *view = nullptr;
+        QPoint position;
+        QRect composedRect; // In output coordinates, as of the last frame
+        QMetaObject::Connection damagedConnection;
+        QMetaObject::Connection redrawConnection;
+    };
+
+    QWaylandSoftwareOutputPrivate() = default;
+    ~QWaylandSoftwareOutputPrivate() override;
+    static QWaylandSoftwareOutputPrivate *get(QWaylandSoftwareOutput *output) { return output->d_func(); }
+
+    void addView(QWaylandView *view, QWaylandSurface *surface) override;
+    void removeView(QWaylandView *view, QWaylandSurface *surface) override;
+
+    ViewState *viewState(QWaylandView *view);
+    QRect viewRect(const ViewState &state) const;
+    void surfaceDamaged(QWaylandView *view, const QRegion &region);
+    bool isOpaque(const ViewState &state) const;
+    int coveringView() const;
+    bool copyView(const ViewState &state, const QRegion &damage);
+    void invalidate();
+
+    QSize logicalSize() const;
+    QTransform framebufferTransform() const;
+    bool ensureFramebuffer();
+    void releaseFramebuffer();
+
+    QVector<ViewState> views; // Bottom to top
+    QRegion damage; // In output coordinates
+    QColor clearColor = Qt::black;
+    bool automaticFrameCallback = true;
+
+    QImage framebuffer;
+    int framebufferFd = -1;
+
+    QTimer frameTimer;
+    QElapsedTimer lastFrame;
+};
+
+QT_END_NAMESPACE
+
+#endif // QWAYLANDSOFTWAREOUTPUT_P_H
@@ -33,6 +33,7 @@
 
 #include "wayland_wrapper/qwlbuffermanager_p.h"
 #include "wayland_wrapper/qwlregion_p.h"
+#include "wayland_wrapper/qwltrace_p.h"
 #include <QtWaylandCompositor/private/qtwaylandcompositorglobal_p.h>
 #if QT_CONFIG(wayland_datadevice)
 #include "wayland_wrapper/qwldatadevice_p.h"
@@ -46,7 +47,10 @@
 #include <QtWaylandCompositor/QWaylandView>
 #include <QtWaylandCompositor/QWaylandBufferRef>
 
+#include <QtWaylandCompositor/private/qwaylandclient_p.h>
 #include <QtWaylandCompositor/private/qwaylandcompositor_p.h>
+#include <QtWaylandCompositor/private/qwaylandframestatistics_p.h>
+#include <QtWaylandCompositor/private/qwaylandoutput_p.h>
 #include <QtWaylandCompositor/private/qwaylandview_p.h>
 #include <QtWaylandCompositor/private/qwaylandseat_p.h>
 #include <QtWaylandCompositor/private/qwaylandutils_p.h>
@@ -62,16 +66,64 @@
 QT_BEGIN_NAMESPACE
 
 namespace QtWayland {
+// Most clients request a frame callback with every commit, so spent callbacks are kept around
+// and reused rather than going through the allocator every frame. Frame callbacks are only
+// ever created and destroyed on the compositor thread.
+class FrameCallbackFreeList
+{
+public:
+    enum { MaxFree = 64 };
+
+    ~FrameCallbackFreeList()
+    {
+        for (int i = 0; i < m_count; ++i)
+            ::operator delete(m_free[i]);
+    }
+
+    void *take() { return m_count ? m_free[--m_count] : nullptr; }
+
+    bool put(void *ptr)
+    {
+        if (m_count == MaxFree)
+            return false;
+        m_free[m_count++] = ptr;
+        return true;
+    }
+
+private:
+    void *m_free[MaxFree];
+    int m_count = 0;
+};
+
+Q_GLOBAL_STATIC(FrameCallbackFreeList, frameCallbackFreeList)
+
 class FrameCallback {
 public:
+    static void *operator new(std::size_t size)
+    {
+        void *ptr = frameCallbackFreeList.isDestroyed() ? nullptr : frameCallbackFreeList()->take();
+        return ptr ? ptr : ::operator new(size);
+    }
+    static void operator delete(void *ptr)
+    {
+        if (frameCallbackFreeList.isDestroyed() || !frameCallbackFreeList()->put(ptr))
+            ::operator delete(ptr);
+    }
+
     FrameCallback(QWaylandSurface *surf, wl_resource *res)
         : surface(surf)
         , resource(res)
     {
         wl_resource_set_implementation(res, nullptr, this, destroyCallback);
+        if (QWaylandClientPrivate *client = QWaylandClientPrivate::get(surf->client())) {
+            usage = client->usage;
+            usage->addFrameCallbacks(1);
+        }
     }
     ~FrameCallback()
     {
+        if (usage)
+            usage->addFrameCallbacks(-1);
     }
     void destroy()
     {
@@ -82,7 +134,15 @@ public:
     }
     void send(uint time)
     {
-        wl_callback_send_done(resource, time);
+        if (Trace::isEnabled()) {
+            const qint64 start = Trace::timestamp();
+            const qint64 client = Trace::clientPid(resource);
+            const uint id = wl_resource_get_id(resource);
+            wl_callback_send_done(resource, time);
+            Trace::complete("frameCallback", start, { { "client", client }, { "frameCallback", id } });
+        } else {
+            wl_callback_send_done(resource, time);
+        }
         wl_resource_destroy(resource);
     }
     static void destroyCallback(wl_resource *res)
@@ -94,6 +154,7 @@ public:
     }
     QWaylandSurface *surface = nullptr;
     wl_resource *resource = nullptr;
+    QExplicitlySharedDataPointer<ClientResourceUsage> usage;
     bool canSend = false;
 };
 }
@@ -139,6 +200,38 @@ void QWaylandSurfacePrivate::removeFrameCallback(QtWayland::FrameCallback *callb
     frameCallbacks.removeOne(callback);
 }
 
+/*!
+ * \internal
+ *
+ * Returns the view whose output paces the frame callbacks of the surface, according to
+ * the frame callback policy, or null if no output should send them.
+ */
+QWaylandView *QWaylandSurfacePrivate::frameCallbackView() const
+{
+    if (views.isEmpty())
+        return nullptr;
+
+    if (frameCallbackPolicy == QWaylandSurface::PrimaryViewFrameCallbacks)
+        return views.first();
+
+    // Views are in order of preference, starting with the primary view, so ties go to it
+    QWaylandView *fastest = nullptr;
+    int fastestRefreshRate = -1;
+    for (QWaylandView *view : views) {
+        QWaylandOutput *output = view->output();
+        if (!output || !QWaylandViewPrivate::get(view)->visible)
+            continue;
+        if (frameCallbackPolicy == QWaylandSurface::ChosenOutputFrameCallbacks && output == frameCallbackOutput)
+            return view;
+        const int refreshRate = output->currentMode().refreshRate();
+        if (refreshRate > fastestRefreshRate) {
+            fastest = view;
+            fastestRefreshRate = refreshRate;
+        }
+    }
+    return fastest;
+}
+
 void QWaylandSurfacePrivate::notifyViewsAboutDestruction()
 {
     Q_Q(QWaylandSurface);
@@ -197,7 +290,10 @@ void QWaylandSurfacePrivate::surface_attach(Resource *, struct wl_resource *buff
 
 void QWaylandSurfacePrivate::surface_damage(Resource *, int32_t x, int32_t y, int32_t width, int32_t height)
 {
-    pending.damage = pending.damage.united(QRect(x, y, width, height));
+    if (pending.damageRects.size() < MaxDamageRects)
+        pending.damageRects.append(QRect(x, y, width, height));
+    else
+        pending.damageOverflow += QRect(x, y, width, height);
 }
 
 void QWaylandSurfacePrivate::surface_frame(Resource *resource, uint32_t callback)
@@ -210,6 +306,7 @@ void QWaylandSurfacePrivate::surface_frame(Resource *resource, uint32_t callback
 void QWaylandSurfacePrivate::surface_set_opaque_region(Resource *, struct wl_resource *region)
 {
     pending.opaqueRegion = region ? QtWayland::Region::fromResource(region)->region() : QRegion();
+    pending.opaqueRegionChanged = true;
 }
 
 void QWaylandSurfacePrivate::surface_set_input_region(Resource *, struct wl_resource *region)
@@ -219,12 +316,46 @@ void QWaylandSurfacePrivate::surface_set_input_region(Resource *, struct wl_reso
     } else {
         pending.inputRegion = infiniteRegion();
     }
+    pending.inputRegionChanged = true;
 }
 
-void QWaylandSurfacePrivate::surface_commit(Resource *)
+// Merges the damage collected since the last commit into the committed damage region.
+void QWaylandSurfacePrivate::applyPendingDamage()
+{
+    const QRect bounds(QPoint(), destinationSize);
+
+    if (!pending.damageOverflow.isEmpty()) {
+        QRegion region = pending.damageOverflow;
+        for (const QRect &rect : qAsConst(pending.damageRects))
+            region += rect;
+        damage = region.intersected(bounds);
+        damageFromRects = false;
+    } else if (!damageFromRects || damageBounds != destinationSize || damageRects != pending.damageRects) {
+        if (pending.damageRects.size() == 1) {
+            damage = QRegion(pending.damageRects.first().intersected(bounds));
+        } else {
+            QRegion region;
+            for (const QRect &rect : qAsConst(pending.damageRects))
+                region += rect;
+            damage = region.intersected(bounds);
+        }
+        damageRects = pending.damageRects;
+        damageBounds = destinationSize;
+        damageFromRects = true;
+    }
+
+    pending.damageRects.clear();
+    pending.damageOverflow = QRegion();
+}
+
+void QWaylandSurfacePrivate::surface_commit(Resource *resource)
 {
     Q_Q(QWaylandSurface);
 
+    const qint64 traceStart = QtWayland::Trace::isEnabled() ? QtWayland::Trace::timestamp() : 0;
+    const uint traceFrameCallback = traceStart && !pendingFrameCallbacks.isEmpty()
+            ? wl_resource_get_id(pendingFrameCallbacks.last()->resource) : 0;
+
     // Needed in order to know whether we want to emit signals later
     QSize oldBufferSize = bufferSize;
     QRectF oldSourceGeometry = sourceGeometry;
@@ -240,12 +371,28 @@ void QWaylandSurfacePrivate::surface_commit(Resource *)
     QSize surfaceSize = bufferSize / bufferScale;
     sourceGeometry = !pending.sourceGeometry.isValid() ? QRect(QPoint(), surfaceSize) : pending.sourceGeometry;
     destinationSize = pending.destinationSize.isEmpty() ? sourceGeometry.size().toSize() : pending.destinationSize;
-    damage = pending.damage.intersected(QRect(QPoint(), destinationSize));
+    applyPendingDamage();
     hasContent = bufferRef.hasContent();
-    frameCallbacks << pendingFrameCallbacks;
-    inputRegion = pending.inputRegion.intersected(QRect(QPoint(), destinationSize));
-    opaqueRegion = pending.opaqueRegion.intersected(QRect(QPoint(), destinationSize));
+    // Appended one by one, as appending the whole vector would share its data when
+    // frameCallbacks is empty, and clearing pendingFrameCallbacks would then reallocate.
+    for (QtWayland::FrameCallback *callback : qAsConst(pendingFrameCallbacks))
+        frameCallbacks.append(callback);
+    if (!pendingFrameCallbacks.isEmpty()) {
+        for (QWaylandView *view : qAsConst(views)) {
+            if (QWaylandOutput *output = view->output())
+                QWaylandOutputPrivate::get(output)->scheduleFrameCallbacks(q);
+        }
+    }
+    if (pending.inputRegionChanged || destinationSize != oldDestinationSize) {
+        inputRegion = pending.inputRegion.intersected(QRect(QPoint(), destinationSize));
+        pending.inputRegionChanged = false;
+    }
+    if (pending.opaqueRegionChanged || destinationSize != oldDestinationSize) {
+        opaqueRegion = pending.opaqueRegion.intersected(QRect(QPoint(), destinationSize));
+        pending.opaqueRegionChanged = false;
+    }
     QPoint offsetForNextFrame = pending.offset;
+    const bool newlyAttached = pending.newlyAttached;
 
     if (viewport)
         viewport->checkCommittedState();
@@ -254,14 +401,30 @@ void QWaylandSurfacePrivate::surface_commit(Resource *)
     pending.buffer = QWaylandBufferRef();
     pending.offset = QPoint();
     pending.newlyAttached = false;
-    pending.damage = QRegion();
-    pendingFrameCallbacks.clear();
+    pendingFrameCallbacks.clear(); // Keeps the capacity for the next commit
 
     // Notify buffers and views
     if (auto *buffer = bufferRef.buffer())
         buffer->setCommitted(damage);
-    for (auto *view : qAsConst(views))
+    for (auto *view : qAsConst(views)) {
         view->bufferCommitted(bufferRef, damage);
+        if (newlyAttached) {
+            if (QWaylandOutput *output = view->output()) {
+                if (QWaylandFrameStatisticsPrivate *statistics = QWaylandOutputPrivate::get(output)->statistics())
+                    statistics->surfaceCommitted();
+            }
+        }
+    }
+
+    if (traceStart) {
+        QtWayland::Trace::complete("surface_commit", traceStart, {
+            { "client", QtWayland::Trace::clientPid(resource->handle) },
+            { "surface", wl_resource_get_id(resource->handle) },
+            { "seq", ++commitSequence },
+            { "frameCallback", traceFrameCallback },
+            { "newBuffer", newlyAttached }
+        });
+    }
 
     // Now all double-buffered state has been applied so it's safe to emit general signals
     // i.e. we won't have inconsistensies such as mismatched surface size and buffer scale in
@@ -680,16 +843,17 @@ void QWaylandSurface::sendFrameCallbacks()
 {
     Q_D(QWaylandSurface);
     uint time = d->compositor->currentTimeMsecs();
-    int i = 0;
-    while (i < d->frameCallbacks.size()) {
-        if (d->frameCallbacks.at(i)->canSend) {
-            d->frameCallbacks.at(i)->surface = nullptr;
-            d->frameCallbacks.at(i)->send(time);
-            d->frameCallbacks.removeAt(i);
+    int remaining = 0;
+    for (int i = 0; i < d->frameCallbacks.size(); i++) {
+        QtWayland::FrameCallback *callback = d->frameCallbacks.at(i);
+        if (callback->canSend) {
+            callback->surface = nullptr;
+            callback->send(time);
         } else {
-            i++;
+            d->frameCallbacks[remaining++] = callback;
         }
     }
+    d->frameCallbacks.erase(d->frameCallbacks.begin() + remaining, d->frameCallbacks.end());
 }
 
 /*!
@@ -824,7 +988,7 @@ void QWaylandSurface::updateSelection()
         const QtWayland::DataDevice *dataDevice = QWaylandSeatPrivate::get(seat)->dataDevice();
         if (dataDevice) {
             QWaylandCompositorPrivate::get(d->compositor)->dataDeviceManager()->offerRetainedSelection(
-                        dataDevice->resourceMap().value(d->resource()->client())->handle);
+                        dataDevice->clientResource(d->resource()->client())->handle);
         }
     }
 }
@@ -874,6 +1038,102 @@ void QWaylandSurface::setPrimaryView(QWaylandView *view)
     d->views.move(index, 0);
 }
 
+/*!
+ * \enum QWaylandSurface::FrameCallbackPolicy
+ * \since 5.15
+ *
+ * This enum type decides which output sends the frame callbacks of a surface that is
+ * shown on several outputs, and thereby paces the client.
+ *
+ * \value PrimaryViewFrameCallbacks The output of the primary view sends the frame callbacks.
+ * \value FastestOutputFrameCallbacks The output with the highest refresh rate that shows the
+ *        surface sends the frame callbacks.
+ * \value ChosenOutputFrameCallbacks The frameCallbackOutput sends the frame callbacks while it
+ *        shows the surface, otherwise the output with the highest refresh rate that does.
+ *
+ * \sa frameCallbackPolicy
+ */
+
+/*!
+ * \qmlproperty enum QtWaylandCompositor::WaylandSurface::frameCallbackPolicy
+ * \since 5.15
+ *
+ * This property holds which output sends the frame callbacks of the surface when it is
+ * shown on several outputs. Frame callbacks tell the client when to draw its next frame,
+ * so the output sending them decides how often the client draws.
+ *
+ * \value WaylandSurface.PrimaryViewFrameCallbacks The output of the primary view sends the
+ *        frame callbacks, whether or not the view is visible. This is the default.
+ * \value WaylandSurface.FastestOutputFrameCallbacks The output with the highest refresh rate
+ *        that shows the surface sends the frame callbacks.
+ * \value WaylandSurface.ChosenOutputFrameCallbacks The \l frameCallbackOutput sends the frame
+ *        callbacks while it shows the surface, otherwise the output with the highest refresh
+ *        rate that does.
+ *
+ * With the last two policies, outputs where the surface is hidden stop sending frame
+ * callbacks, and the client is not asked to draw while the surface is hidden everywhere.
+ */
+
+/*!
+ * \property QWaylandSurface::frameCallbackPolicy
+ * \since 5.15
+ *
+ * This property holds which output sends the frame callbacks of the surface when it is
+ * shown on several outputs. Frame callbacks tell the client when to draw its next frame,
+ * so the output sending them decides how often the client draws.
+ *
+ * By default, the output of the primary view sends them, whatever its refresh rate and
+ * whether or not the view is visible. With FastestOutputFrameCallbacks and
+ * ChosenOutputFrameCallbacks, only outputs that show the surface send frame callbacks:
+ * those with a view of the surface, for QWaylandQuickItem a visible one.
+ *
+ * \sa frameCallbackOutput, setPrimaryView()
+ */
+QWaylandSurface::FrameCallbackPolicy QWaylandSurface::frameCallbackPolicy() const
+{
+    Q_D(const QWaylandSurface);
+    return d->frameCallbackPolicy;
+}
+
+void QWaylandSurface::setFrameCallbackPolicy(FrameCallbackPolicy policy)
+{
+    Q_D(QWaylandSurface);
+    if (d->frameCallbackPolicy == policy)
+        return;
+    d->frameCallbackPolicy = policy;
+    emit frameCallbackPolicyChanged();
+}
+
+/*!
+ * \qmlproperty WaylandOutput QtWaylandCompositor::WaylandSurface::frameCallbackOutput
+ * \since 5.15
+ *
+ * This property holds the output that sends the frame callbacks of the surface while it
+ * shows the surface, when \l frameCallbackPolicy is \c WaylandSurface.ChosenOutputFrameCallbacks.
+ */
+
+/*!
+ * \property QWaylandSurface::frameCallbackOutput
+ * \since 5.15
+ *
+ * This property holds the output that sends the frame callbacks of the surface while it
+ * shows the surface, when frameCallbackPolicy is ChosenOutputFrameCallbacks.
+ */
+QWaylandOutput *QWaylandSurface::frameCallbackOutput() const
+{
+    Q_D(const QWaylandSurface);
+    return d->frameCallbackOutput;
+}
+
+void QWaylandSurface::setFrameCallbackOutput(QWaylandOutput *output)
+{
+    Q_D(QWaylandSurface);
+    if (d->frameCallbackOutput == output)
+        return;
+    d->frameCallbackOutput = output;
+    emit frameCallbackOutputChanged();
+}
+
 /*!
  * Returns the views for this QWaylandSurface.
  */
@@ -51,6 +51,7 @@ class QWaylandSurfacePrivate;
 class QWaylandCompositor;
 class QWaylandBufferRef;
 class QWaylandView;
+class QWaylandOutput;
 class QWaylandSurfaceOp;
 class QWaylandInputMethodControl;
 class QWaylandDrag;
@@ -83,6 +84,8 @@ class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandSurface : public QWaylandObject
     Q_PROPERTY(bool hasContent READ hasContent NOTIFY hasContentChanged)
     Q_PROPERTY(bool cursorSurface READ isCursorSurface WRITE markAsCursorSurface NOTIFY cursorSurfaceChanged)
     Q_PROPERTY(bool inhibitsIdle READ inhibitsIdle NOTIFY inhibitsIdleChanged REVISION 14)
+    Q_PROPERTY(QWaylandSurface::FrameCallbackPolicy frameCallbackPolicy READ frameCallbackPolicy WRITE setFrameCallbackPolicy NOTIFY frameCallbackPolicyChanged REVISION 15)
+    Q_PROPERTY(QWaylandOutput *frameCallbackOutput READ frameCallbackOutput WRITE setFrameCallbackOutput NOTIFY frameCallbackOutputChanged REVISION 15)
 
 public:
     enum Origin {
@@ -91,6 +94,13 @@ public:
     };
     Q_ENUM(Origin)
 
+    enum FrameCallbackPolicy {
+        PrimaryViewFrameCallbacks,
+        FastestOutputFrameCallbacks,
+        ChosenOutputFrameCallbacks
+    };
+    Q_ENUM(FrameCallbackPolicy)
+
     QWaylandSurface();
     QWaylandSurface(QWaylandCompositor *compositor, QWaylandClient *client, uint id, int version);
     ~QWaylandSurface() override;
@@ -134,6 +144,12 @@ public:
 
     QList<QWaylandView *> views() const;
 
+    FrameCallbackPolicy frameCallbackPolicy() const;
+    void setFrameCallbackPolicy(FrameCallbackPolicy policy);
+
+    QWaylandOutput *frameCallbackOutput() const;
+    void setFrameCallbackOutput(QWaylandOutput *output);
+
     static QWaylandSurface *fromResource(::wl_resource *resource);
     struct wl_resource *resource() const;
 
@@ -176,6 +192,8 @@ Q_SIGNALS:
     void dragStarted(QWaylandDrag *drag);
     void cursorSurfaceChanged();
     Q_REVISION(14) void inhibitsIdleChanged();
+    Q_REVISION(15) void frameCallbackPolicyChanged();
+    Q_REVISION(15) void frameCallbackOutputChanged();
 
     void configure(bool hasBuffer);
     void redraw();
@@ -51,7 +51,9 @@
 
 #include <QtWaylandCompositor/private/qwlregion_p.h>
 
+#include <QtCore/QPointer>
 #include <QtCore/QVector>
+#include <QtCore/QVarLengthArray>
 #include <QtCore/QRect>
 #include <QtGui/QRegion>
 #include <QtGui/QImage>
@@ -95,6 +97,8 @@ public:
     using QtWaylandServer::wl_surface::resource;
 
     void removeFrameCallback(QtWayland::FrameCallback *callback);
+    QWaylandView *frameCallbackView() const;
+    void applyPendingDamage();
 
     void notifyViewsAboutDestruction();
 
@@ -138,23 +142,37 @@ public: //member variables
     QWaylandSurfaceRole *role = nullptr;
     QWaylandViewporterPrivate::Viewport *viewport = nullptr;
 
+    enum { MaxDamageRects = 8 };
+
     struct {
         QWaylandBufferRef buffer;
-        QRegion damage;
+        QVarLengthArray<QRect, MaxDamageRects> damageRects;
+        QRegion damageOverflow; // Only used once damageRects is full
         QPoint offset;
         bool newlyAttached = false;
         QRegion inputRegion;
+        bool inputRegionChanged = true;
         int bufferScale = 1;
         QRectF sourceGeometry;
         QSize destinationSize;
         QRegion opaqueRegion;
+        bool opaqueRegionChanged = true;
     } pending;
 
+    // The damage rects that the committed damage was built from, so that a client damaging
+    // the same area every frame does not have us build a new QRegion every frame
+    QVarLengthArray<QRect, MaxDamageRects> damageRects;
+    QSize damageBounds;
+    bool damageFromRects = false;
+
     QPoint lastLocalMousePos;
     QPoint lastGlobalMousePos;
 
-    QList<QtWayland::FrameCallback *> pendingFrameCallbacks;
-    QList<QtWayland::FrameCallback *> frameCallbacks;
+    QVector<QtWayland::FrameCallback *> pendingFrameCallbacks;
+    QVector<QtWayland::FrameCallback *> frameCallbacks;
+    qint64 commitSequence = 0; // Only counted when tracing
+    QWaylandSurface::FrameCallbackPolicy frameCallbackPolicy = QWaylandSurface::PrimaryViewFrameCallbacks;
+    QPointer<QWaylandOutput> frameCallbackOutput;
 
     QList<QPointer<QWaylandSurface>> subsurfaceChildren;
 
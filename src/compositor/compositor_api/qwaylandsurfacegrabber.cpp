@@ -28,12 +28,36 @@
 ****************************************************************************/
 
 #include "qwaylandsurfacegrabber.h"
+#include "qwaylandsurfacegrabber_p.h"
 
-#include <QtCore/private/qobject_p.h>
+#include <QtCore/QThread>
+#include <QtGui/QPainter>
 #include <QtWaylandCompositor/qwaylandsurface.h>
 #include <QtWaylandCompositor/qwaylandcompositor.h>
 #include <QtWaylandCompositor/private/qwaylandsurface_p.h>
 
+#if QT_CONFIG(opengl)
+#include <QtGui/QMatrix4x4>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLExtraFunctions>
+#include <QtGui/QOpenGLTexture>
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED 0x911B
+#endif
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED 0x911D
+#endif
+#endif
+
+#include <string.h>
+
 QT_BEGIN_NAMESPACE
 
 /*!
@@ -46,6 +70,13 @@ QT_BEGIN_NAMESPACE
     to the user. The QWaylandSurfaceGrabber class provides a simple method to do so, without
     having to care what type of buffer backs the surface, be it shared memory, OpenGL or something
     else.
+
+    Grabbers are meant to be kept around when grabbing repeatedly, for instance for thumbnails:
+    the framebuffer object and blitter used to read back OpenGL buffers are kept between grabs,
+    only part of the buffer can be grabbed with setSourceRect() or grabDamage(), and the result
+    can be written into an image owned by the caller with setTargetImage(). With
+    setAsynchronous(), OpenGL read backs go through a ring of pixel buffer objects and complete
+    without stalling the renderer.
 */
 
 /*!
@@ -57,14 +88,244 @@ QT_BEGIN_NAMESPACE
     \value NoBufferAttached The client has not attached a buffer on the surface yet.
     \value UnknownBufferType The buffer attached on the surface is of an unknown type.
     \value RendererNotReady The compositor renderer is not ready to grab the surface content.
+    \value InvalidSourceRect The source rectangle does not intersect the buffer. This value
+           was added in Qt 5.15.
+ */
+
+QWaylandSurfaceGrabberPrivate::~QWaylandSurfaceGrabberPrivate()
+{
+#if QT_CONFIG(opengl)
+    releaseGLResources();
+#endif
+}
+
+void QWaylandSurfaceGrabberPrivate::startGrab(const QRect &rect)
+{
+    Q_Q(QWaylandSurfaceGrabber);
+    if (!surface) {
+        emit q->failed(QWaylandSurfaceGrabber::InvalidSurface);
+        return;
+    }
+
+    QWaylandSurfacePrivate *surf = QWaylandSurfacePrivate::get(surface);
+    QWaylandBufferRef buf = surf->bufferRef;
+    if (!buf.hasBuffer()) {
+        emit q->failed(QWaylandSurfaceGrabber::NoBufferAttached);
+        return;
+    }
+
+    const QRect bufferRect(QPoint(), buf.size());
+    requestedRect = rect.isValid() ? rect & bufferRect : bufferRect;
+    if (requestedRect.isEmpty()) {
+        emit q->failed(QWaylandSurfaceGrabber::InvalidSourceRect);
+        return;
+    }
+
+    surface->compositor()->grabSurface(q, buf);
+}
+
+void QWaylandSurfaceGrabberPrivate::grabSharedMemory(const QWaylandBufferRef &buffer)
+{
+    const QImage image = buffer.image();
+    const QRect rect = requestedRect.isValid() ? requestedRect & image.rect() : image.rect();
+    if (rect == image.rect()) {
+        deliver(image, rect);
+        return;
+    }
+
+    // Reference the part of the buffer we want rather than copying it
+    const uchar *bits = image.constBits() + rect.y() * image.bytesPerLine()
+            + rect.x() * image.depth() / 8;
+    deliver(QImage(bits, rect.width(), rect.height(), image.bytesPerLine(), image.format()), rect);
+}
+
+/*
+ * Hands a grabbed \a image covering \a rect of the buffer over to the grabber, writing it into
+ * the target image if there is one. Can be called from any thread.
+ */
+void QWaylandSurfaceGrabberPrivate::deliver(const QImage &image, const QRect &rect)
+{
+    Q_Q(QWaylandSurfaceGrabber);
+    if (QThread::currentThread() != q->thread()) {
+        QMetaObject::invokeMethod(q, [this, image, rect] { deliver(image, rect); }, Qt::QueuedConnection);
+        return;
+    }
+
+    grabbedRect = rect;
+    if (targetImage && !targetImage->isNull()) {
+        QPainter painter(targetImage);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(rect.topLeft(), image);
+        painter.end();
+        emit q->success(*targetImage);
+    } else {
+        emit q->success(image);
+    }
+}
+
+/*
+ * Can be called from any thread.
  */
+void QWaylandSurfaceGrabberPrivate::fail(QWaylandSurfaceGrabber::Error error)
+{
+    Q_Q(QWaylandSurfaceGrabber);
+    if (QThread::currentThread() != q->thread()) {
+        QMetaObject::invokeMethod(q, [this, error] { fail(error); }, Qt::QueuedConnection);
+        return;
+    }
+    emit q->failed(error);
+}
+
+#if QT_CONFIG(opengl)
+static bool hasAsynchronousReadback(QOpenGLContext *context)
+{
+    const QSurfaceFormat format = context->format();
+    if (context->isOpenGLES())
+        return format.majorVersion() >= 3;
+    return format.version() >= qMakePair(3, 2);
+}
+
+/*
+ * Blits the texture of \a buffer into the framebuffer object and reads back \a rect of it,
+ * either right away or, in asynchronous mode, into the next pixel buffer object of the ring.
+ */
+void QWaylandSurfaceGrabberPrivate::grabTexture(const QWaylandBufferRef &buffer, const QRect &requested)
+{
+    QOpenGLContext *currentContext = QOpenGLContext::currentContext();
+    if (!currentContext) {
+        fail(QWaylandSurfaceGrabber::RendererNotReady);
+        return;
+    }
+    if (currentContext != context) {
+        releaseGLResources();
+        context = currentContext;
+    }
+
+    // Deliver whatever finished since the last grab first, to keep the order
+    pollReadbacks(false);
+
+    const QSize size = buffer.size();
+    const QRect bufferRect(QPoint(), size);
+    const QRect rect = requested.isValid() ? requested & bufferRect : bufferRect;
+    if (!fbo || fbo->size() != size)
+        fbo.reset(new QOpenGLFramebufferObject(size));
+    if (!blitter) {
+        blitter.reset(new QOpenGLTextureBlitter);
+        blitter->create();
+    }
+
+    QOpenGLFunctions *f = context->functions();
+    fbo->bind();
+    f->glViewport(0, 0, size.width(), size.height());
+
+    // Blit upside down, so glReadPixels, which starts at the bottom row, returns the rows
+    // top to bottom, the way QImage wants them
+    QOpenGLTextureBlitter::Origin surfaceOrigin =
+        buffer.origin() == QWaylandSurface::OriginTopLeft
+        ? QOpenGLTextureBlitter::OriginBottomLeft
+        : QOpenGLTextureBlitter::OriginTopLeft;
+
+    auto texture = buffer.toOpenGLTexture();
+    blitter->bind(texture->target());
+    blitter->blit(texture->textureId(), QMatrix4x4(), surfaceOrigin);
+    blitter->release();
+
+    if (asynchronous && hasAsynchronousReadback(context)) {
+        // The slot we are about to reuse holds the oldest read back, which is done by now
+        // unless grabs are issued faster than the GPU can keep up with
+        Readback &readback = readbacks[nextReadback];
+        if (readback.fence)
+            finishReadback(readback, true);
+        nextReadback = (nextReadback + 1) % ReadbackRingSize;
+
+        const int bytes = rect.width() * rect.height() * 4;
+        if (!readback.pbo.isCreated()) {
+            readback.pbo.setUsagePattern(QOpenGLBuffer::StreamRead);
+            readback.pbo.create();
+        }
+        readback.pbo.bind();
+        if (readback.pbo.size() < bytes)
+            readback.pbo.allocate(bytes);
+        f->glReadPixels(rect.x(), rect.y(), rect.width(), rect.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        readback.pbo.release();
+
+        readback.fence = context->extraFunctions()->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readback.rect = rect;
+        f->glFlush();
+    } else {
+        QImage image(rect.size(), QImage::Format_RGBA8888_Premultiplied);
+        f->glReadPixels(rect.x(), rect.y(), rect.width(), rect.height(), GL_RGBA, GL_UNSIGNED_BYTE, image.bits());
+        deliver(image, rect);
+    }
+
+    fbo->release();
+}
+
+bool QWaylandSurfaceGrabberPrivate::finishReadback(Readback &readback, bool wait)
+{
+    QOpenGLExtraFunctions *f = context->extraFunctions();
+    const GLuint64 timeout = wait ? 1000000000 : 0; // One second, in nanoseconds
+    const GLenum status = f->glClientWaitSync(readback.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+    if (status == GL_TIMEOUT_EXPIRED && !wait)
+        return false;
+
+    f->glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+        fail(QWaylandSurfaceGrabber::RendererNotReady);
+        return true;
+    }
 
-class QWaylandSurfaceGrabberPrivate : public QObjectPrivate
+    const int bytes = readback.rect.width() * readback.rect.height() * 4;
+    readback.pbo.bind();
+    if (auto *data = readback.pbo.mapRange(0, bytes, QOpenGLBuffer::RangeRead)) {
+        QImage image(readback.rect.size(), QImage::Format_RGBA8888_Premultiplied);
+        memcpy(image.bits(), data, size_t(bytes));
+        readback.pbo.unmap();
+        deliver(image, readback.rect);
+    } else {
+        fail(QWaylandSurfaceGrabber::RendererNotReady);
+    }
+    readback.pbo.release();
+    return true;
+}
+
+/*
+ * Delivers the asynchronous read backs that are done, oldest first, waiting for them if
+ * \a wait is true. Returns whether any are still in flight.
+ */
+bool QWaylandSurfaceGrabberPrivate::pollReadbacks(bool wait)
 {
-    Q_DECLARE_PUBLIC(QWaylandSurfaceGrabber)
+    if (!context || QOpenGLContext::currentContext() != context)
+        return false;
 
-    QWaylandSurface *surface = nullptr;
-};
+    for (int i = 0; i < ReadbackRingSize; ++i) {
+        Readback &readback = readbacks[(nextReadback + i) % ReadbackRingSize];
+        if (readback.fence && !finishReadback(readback, wait))
+            return true;
+    }
+    return false;
+}
+
+void QWaylandSurfaceGrabberPrivate::releaseGLResources()
+{
+    // Fences can only be deleted with their context current; otherwise they go away with it.
+    // The buffer objects defer their deletion to the context by themselves.
+    const bool isCurrent = context && QOpenGLContext::currentContext() == context;
+    for (Readback &readback : readbacks) {
+        if (readback.fence && isCurrent)
+            context->extraFunctions()->glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+        readback.pbo.destroy();
+    }
+    nextReadback = 0;
+    fbo.reset();
+    blitter.reset();
+    context = nullptr;
+    pollTimer.stop();
+}
+#endif
 
 /*!
  * Create a QWaylandSurfaceGrabber object with the given \a surface and \a parent
@@ -74,6 +335,28 @@ QWaylandSurfaceGrabber::QWaylandSurfaceGrabber(QWaylandSurface *surface, QObject
 {
     Q_D(QWaylandSurfaceGrabber);
     d->surface = surface;
+
+    if (surface) {
+        connect(surface, &QWaylandSurface::damaged, this, [d](const QRegion &region) {
+            // Damage is in surface coordinates; only map it when the buffer isn't cropped or scaled
+            const int scale = d->surface->bufferScale();
+            const QSize bufferSize = d->surface->destinationSize() * scale;
+            if (d->surface->sourceGeometry() != QRectF(QPointF(), bufferSize)) {
+                d->damageIsEverything = true;
+                return;
+            }
+            for (const QRect &rect : region)
+                d->damage += QRect(rect.topLeft() * scale, rect.size() * scale);
+        });
+    }
+
+#if QT_CONFIG(opengl)
+    d->pollTimer.setInterval(4);
+    connect(&d->pollTimer, &QTimer::timeout, this, [d] {
+        if (!d->pollReadbacks(false))
+            d->pollTimer.stop();
+    });
+#endif
 }
 
 /*!
@@ -85,27 +368,131 @@ QWaylandSurface *QWaylandSurfaceGrabber::surface() const
     return d->surface;
 }
 
+/*!
+ * \since 5.15
+ *
+ * Returns the part of the buffer grab() reads, in buffer pixels. A null rectangle, the default,
+ * means the whole buffer.
+ */
+QRect QWaylandSurfaceGrabber::sourceRect() const
+{
+    Q_D(const QWaylandSurfaceGrabber);
+    return d->sourceRect;
+}
+
+/*!
+ * \since 5.15
+ *
+ * Restricts grabs to \a rect of the buffer, in buffer pixels. Pass a null rectangle to grab the
+ * whole buffer again.
+ */
+void QWaylandSurfaceGrabber::setSourceRect(const QRect &rect)
+{
+    Q_D(QWaylandSurfaceGrabber);
+    d->sourceRect = rect;
+}
+
+/*!
+ * \since 5.15
+ *
+ * Returns whether OpenGL buffers are read back asynchronously. The default is \c false.
+ */
+bool QWaylandSurfaceGrabber::isAsynchronous() const
+{
+    Q_D(const QWaylandSurfaceGrabber);
+    return d->asynchronous;
+}
+
+/*!
+ * \since 5.15
+ *
+ * If \a asynchronous is \c true, OpenGL buffers are read back into pixel buffer objects, and
+ * success() is emitted once the GPU is done with them, typically one or two frames later,
+ * instead of stalling the pipeline until the pixels arrive. This requires OpenGL 3.2 or
+ * OpenGL ES 3.0; with older versions grabs stay synchronous. Shared memory buffers are always
+ * grabbed right away.
+ */
+void QWaylandSurfaceGrabber::setAsynchronous(bool asynchronous)
+{
+    Q_D(QWaylandSurfaceGrabber);
+    d->asynchronous = asynchronous;
+}
+
+/*!
+ * \since 5.15
+ *
+ * Returns the image grabs are written into, or \c nullptr if every grab creates a new image.
+ */
+QImage *QWaylandSurfaceGrabber::targetImage() const
+{
+    Q_D(const QWaylandSurfaceGrabber);
+    return d->targetImage;
+}
+
+/*!
+ * \since 5.15
+ *
+ * Writes the grabbed pixels into \a image, which is owned by the caller, at their position in
+ * the buffer, and passes that image to success(). Partial grabs thereby keep \a image up to
+ * date as a whole. The image should be as large as the buffer; pixels outside of it are
+ * dropped. Pass \c nullptr to get a new image for every grab instead.
+ */
+void QWaylandSurfaceGrabber::setTargetImage(QImage *image)
+{
+    Q_D(QWaylandSurfaceGrabber);
+    d->targetImage = image;
+}
+
+/*!
+ * \since 5.15
+ *
+ * Returns the part of the buffer, in buffer pixels, the image passed to the last success()
+ * signal was grabbed from. Without a target image, this is where that image belongs in the
+ * buffer.
+ */
+QRect QWaylandSurfaceGrabber::grabbedRect() const
+{
+    Q_D(const QWaylandSurfaceGrabber);
+    return d->grabbedRect;
+}
+
 /*!
  * Grab the content of the surface set on this object.
  * It may not be possible to do that immediately so the success and failed signals
  * should be used to be notified of when the grab is completed.
+ *
+ * \sa sourceRect()
  */
 void QWaylandSurfaceGrabber::grab()
 {
     Q_D(QWaylandSurfaceGrabber);
-    if (!d->surface) {
-        emit failed(InvalidSurface);
-        return;
-    }
+    d->startGrab(d->sourceRect);
+}
 
-    QWaylandSurfacePrivate *surf = QWaylandSurfacePrivate::get(d->surface);
-    QWaylandBufferRef buf = surf->bufferRef;
-    if (!buf.hasBuffer()) {
-        emit failed(NoBufferAttached);
-        return;
+/*!
+ * \since 5.15
+ *
+ * Grabs the bounding rectangle of what the client damaged since the previous call, within
+ * sourceRect(). The first call grabs everything. If nothing was damaged, neither success()
+ * nor failed() are emitted.
+ */
+void QWaylandSurfaceGrabber::grabDamage()
+{
+    Q_D(QWaylandSurfaceGrabber);
+    QRect rect = d->sourceRect;
+    if (!d->damageIsEverything) {
+        rect = d->damage.boundingRect();
+        if (d->sourceRect.isValid())
+            rect &= d->sourceRect;
+        if (rect.isEmpty()) {
+            d->damage = QRegion();
+            return;
+        }
     }
 
-    d->surface->compositor()->grabSurface(this, buf);
+    d->damage = QRegion();
+    d->damageIsEverything = false;
+    d->startGrab(rect);
 }
 
 QT_END_NAMESPACE
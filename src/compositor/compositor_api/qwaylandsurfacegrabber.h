@@ -32,9 +32,11 @@
 
 #include <QtWaylandCompositor/qtwaylandcompositorglobal.h>
 #include <QtCore/QObject>
+#include <QtCore/QRect>
 
 QT_BEGIN_NAMESPACE
 
+class QImage;
 class QWaylandSurface;
 class QWaylandSurfaceGrabberPrivate;
 
@@ -48,12 +50,26 @@ public:
         NoBufferAttached,
         UnknownBufferType,
         RendererNotReady,
+        InvalidSourceRect
     };
     Q_ENUM(Error)
     explicit QWaylandSurfaceGrabber(QWaylandSurface *surface, QObject *parent = nullptr);
 
     QWaylandSurface *surface() const;
+
+    QRect sourceRect() const;
+    void setSourceRect(const QRect &rect);
+
+    bool isAsynchronous() const;
+    void setAsynchronous(bool asynchronous);
+
+    QImage *targetImage() const;
+    void setTargetImage(QImage *image);
+
+    QRect grabbedRect() const;
+
     void grab();
+    void grabDamage();
 
 Q_SIGNALS:
     void success(const QImage &image);
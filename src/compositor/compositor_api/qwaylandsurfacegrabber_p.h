@@ -0,0 +1,115 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWAYLANDSURFACEGRABBER_P_H
+#define QWAYLANDSURFACEGRABBER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtWaylandCompositor/qtwaylandcompositorglobal.h>
+#include <QtWaylandCompositor/QWaylandSurfaceGrabber>
+#include <QtWaylandCompositor/QWaylandBufferRef>
+
+#include <QtCore/QRect>
+#include <QtCore/QTimer>
+#include <QtCore/private/qobject_p.h>
+#include <QtGui/QImage>
+#include <QtGui/QRegion>
+
+#if QT_CONFIG(opengl)
+#include <QtGui/QOpenGLBuffer>
+#include <QtGui/QOpenGLExtraFunctions>
+#include <QtGui/QOpenGLFramebufferObject>
+#include <QtGui/QOpenGLTextureBlitter>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandSurfaceGrabberPrivate : public QObjectPrivate
+{
+    Q_DECLARE_PUBLIC(QWaylandSurfaceGrabber)
+public:
+    QWaylandSurfaceGrabberPrivate() = default;
+    ~QWaylandSurfaceGrabberPrivate() override;
+    static QWaylandSurfaceGrabberPrivate *get(QWaylandSurfaceGrabber *grabber) { return grabber->d_func(); }
+
+    void startGrab(const QRect &rect);
+    void grabSharedMemory(const QWaylandBufferRef &buffer);
+    void deliver(const QImage &image, const QRect &rect);
+    void fail(QWaylandSurfaceGrabber::Error error);
+
+#if QT_CONFIG(opengl)
+    // These run on the thread the buffer's texture lives on, with its context current
+    void grabTexture(const QWaylandBufferRef &buffer, const QRect &rect);
+    bool pollReadbacks(bool wait);
+    void releaseGLResources();
+#endif
+
+    QWaylandSurface *surface = nullptr;
+    QRect sourceRect;
+    QImage *targetImage = nullptr;
+    bool asynchronous = false;
+
+    QRegion damage; // In buffer coordinates, since the last grabDamage()
+    bool damageIsEverything = true;
+
+    QRect requestedRect; // Of the grab being started
+    QRect grabbedRect;
+
+#if QT_CONFIG(opengl)
+    struct Readback {
+        QOpenGLBuffer pbo { QOpenGLBuffer::PixelPackBuffer };
+        GLsync fence = nullptr;
+        QRect rect;
+    };
+    static const int ReadbackRingSize = 3;
+
+    bool finishReadback(Readback &readback, bool wait);
+
+    QOpenGLContext *context = nullptr;
+    QScopedPointer<QOpenGLFramebufferObject> fbo;
+    QScopedPointer<QOpenGLTextureBlitter> blitter;
+    Readback readbacks[ReadbackRingSize];
+    int nextReadback = 0; // Also the oldest readback in flight, if any
+    QTimer pollTimer;
+#endif
+};
+
+QT_END_NAMESPACE
+
+#endif // QWAYLANDSURFACEGRABBER_P_H
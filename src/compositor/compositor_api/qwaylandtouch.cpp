@@ -53,7 +53,7 @@ void QWaylandTouchPrivate::touch_release(Resource *resource)
 uint QWaylandTouchPrivate::sendDown(QWaylandSurface *surface, uint32_t time, int touch_id, const QPointF &position)
 {
     Q_Q(QWaylandTouch);
-    auto focusResource = resourceMap().value(surface->client()->client());
+    auto focusResource = clientResource(surface->client()->client());
     if (!focusResource)
         return 0;
 
@@ -66,7 +66,7 @@ uint QWaylandTouchPrivate::sendDown(QWaylandSurface *surface, uint32_t time, int
 
 uint QWaylandTouchPrivate::sendUp(QWaylandClient *client, uint32_t time, int touch_id)
 {
-    auto focusResource = resourceMap().value(client->client());
+    auto focusResource = clientResource(client->client());
 
     if (!focusResource)
         return 0;
@@ -79,7 +79,7 @@ uint QWaylandTouchPrivate::sendUp(QWaylandClient *client, uint32_t time, int tou
 
 void QWaylandTouchPrivate::sendMotion(QWaylandClient *client, uint32_t time, int touch_id, const QPointF &position)
 {
-    auto focusResource = resourceMap().value(client->client());
+    auto focusResource = clientResource(client->client());
 
     if (!focusResource)
         return;
@@ -174,7 +174,7 @@ uint QWaylandTouch::sendTouchPointEvent(QWaylandSurface *surface, int id, const
 void QWaylandTouch::sendFrameEvent(QWaylandClient *client)
 {
     Q_D(QWaylandTouch);
-    auto focusResource = d->resourceMap().value(client->client());
+    auto focusResource = d->clientResource(client->client());
     if (focusResource)
         d->send_frame(focusResource->handle);
 }
@@ -185,7 +185,7 @@ void QWaylandTouch::sendFrameEvent(QWaylandClient *client)
 void QWaylandTouch::sendCancelEvent(QWaylandClient *client)
 {
     Q_D(QWaylandTouch);
-    auto focusResource = d->resourceMap().value(client->client());
+    auto focusResource = d->clientResource(client->client());
     if (focusResource)
         d->send_cancel(focusResource->handle);
 }
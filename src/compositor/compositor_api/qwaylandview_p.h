@@ -82,6 +82,7 @@ public:
     bool forceAdvanceSucceed = false;
     bool allowDiscardFrontBuffer = false;
     bool independentFrameCallback = false; //If frame callbacks are independent of the main quick scene graph
+    bool visible = true; // Hidden views don't pace frame callbacks, see QWaylandSurface::frameCallbackPolicy
 };
 
 QT_END_NAMESPACE
@@ -17,6 +17,7 @@ WAYLANDSERVERSOURCES += \
     ../3rdparty/protocol/xdg-output-unstable-v1.xml \
     ../3rdparty/protocol/ivi-application.xml \
     ../3rdparty/protocol/idle-inhibit-unstable-v1.xml \
+    ../3rdparty/protocol/wlr-screencopy-unstable-v1.xml \
     ../extensions/qt-texture-sharing-unstable-v1.xml \
 
 HEADERS += \
@@ -53,6 +54,8 @@ HEADERS += \
     extensions/qwaylandiviapplication_p.h \
     extensions/qwaylandivisurface.h \
     extensions/qwaylandivisurface_p.h \
+    extensions/qwaylandscreencopyv1.h \
+    extensions/qwaylandscreencopyv1_p.h \
 
 SOURCES += \
     extensions/qwlqttouch.cpp \
@@ -73,6 +76,7 @@ SOURCES += \
     extensions/qwaylandidleinhibitv1.cpp \
     extensions/qwaylandiviapplication.cpp \
     extensions/qwaylandivisurface.cpp \
+    extensions/qwaylandscreencopyv1.cpp \
 
 qtHaveModule(quick) {
     QT += quick quick-private
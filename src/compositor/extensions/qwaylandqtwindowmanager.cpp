@@ -99,7 +99,7 @@ void QWaylandQtWindowManager::setShowIsFullScreen(bool value)
         return;
 
     d->showIsFullScreen = value;
-    const auto resMap = d->resourceMap();
+    const auto resMap = d->resourceHash();
     for (QWaylandQtWindowManagerPrivate::Resource *resource : resMap) {
         d->send_hints(resource->handle, static_cast<int32_t>(d->showIsFullScreen));
     }
@@ -109,7 +109,7 @@ void QWaylandQtWindowManager::setShowIsFullScreen(bool value)
 void QWaylandQtWindowManager::sendQuitMessage(QWaylandClient *client)
 {
     Q_D(QWaylandQtWindowManager);
-    QWaylandQtWindowManagerPrivate::Resource *resource = d->resourceMap().value(client->client());
+    QWaylandQtWindowManagerPrivate::Resource *resource = d->clientResource(client->client());
 
     if (resource)
         d->send_quit(resource->handle);
@@ -0,0 +1,715 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwaylandscreencopyv1_p.h"
+
+#include <QtWaylandCompositor/QWaylandCompositor>
+#include <QtWaylandCompositor/QWaylandOutput>
+#include <QtWaylandCompositor/QWaylandSoftwareOutput>
+#include <QtWaylandCompositor/private/qwaylandsoftwareoutput_p.h>
+#include <QtWaylandCompositor/private/wayland-wayland-server-protocol.h>
+#include <QtWaylandCompositor/QWaylandSurface>
+#include <QtWaylandCompositor/QWaylandView>
+#if QT_CONFIG(wayland_compositor_quick)
+#include <QtWaylandCompositor/QWaylandQuickItem>
+#include <QtWaylandCompositor/QWaylandQuickOutput>
+#include <QtQuick/QQuickWindow>
+#include <QtQuick/private/qquickitem_p.h>
+#include <QtQuick/private/qquickwindow_p.h>
+#endif
+#if QT_CONFIG(opengl)
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions>
+#endif
+
+#include <QtCore/QDeadlineTimer>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \qmltype ScreencopyManagerV1
+    \inqmlmodule QtWayland.Compositor
+    \since 5.15
+    \brief Lets clients copy the contents of outputs into their own buffers.
+
+    The ScreencopyManagerV1 extension provides a way for clients such as screen recorders to
+    capture the contents of an output, or a region of it, into a shared memory buffer.
+
+    ScreencopyManagerV1 corresponds to the Wayland interface, \c zwlr_screencopy_manager_v1.
+
+    To provide the functionality of the extension in a compositor, create an instance of the
+    ScreencopyManagerV1 component and add it to the list of extensions supported by the
+    compositor:
+
+    \qml \QtMinorVersion
+    import QtWayland.Compositor 1.\1
+
+    WaylandCompositor {
+        ScreencopyManagerV1 {
+            // ...
+        }
+    }
+    \endqml
+
+    Outputs rendered by a QQuickWindow are read back after a frame only while a client waits for
+    one, so the extension costs nothing while nobody is capturing.
+*/
+
+/*!
+    \class QWaylandScreencopyManagerV1
+    \inmodule QtWaylandCompositor
+    \since 5.15
+    \brief Lets clients copy the contents of outputs into their own buffers.
+
+    The QWaylandScreencopyManagerV1 extension provides a way for clients such as screen
+    recorders to capture the contents of an output, or a region of it, into a shared memory
+    buffer. Frames are delivered in \c WL_SHM_FORMAT_XRGB8888.
+
+    QWaylandScreencopyManagerV1 corresponds to the Wayland interface,
+    \c zwlr_screencopy_manager_v1.
+
+    Contents of a QWaylandSoftwareOutput are copied straight from its framebuffer, and a
+    QWaylandQuickOutput is read back after a frame only while a client waits for one. Only the
+    parts of a QWaylandQuickOutput that changed since it was last read back are read again.
+    Compositors that render outputs in other ways report their frames with frameRendered().
+
+    Copies are damage aware: a client asking to be notified of changes only gets a frame when
+    the captured region changed, and a client that keeps reusing the same buffer for the same
+    region only has the parts that changed since its previous copy rewritten.
+*/
+
+/*!
+    Constructs a QWaylandScreencopyManagerV1 object.
+*/
+QWaylandScreencopyManagerV1::QWaylandScreencopyManagerV1()
+    : QWaylandCompositorExtensionTemplate<QWaylandScreencopyManagerV1>(*new QWaylandScreencopyManagerV1Private())
+{
+}
+
+/*!
+    Constructs a QWaylandScreencopyManagerV1 object for the provided \a compositor.
+*/
+QWaylandScreencopyManagerV1::QWaylandScreencopyManagerV1(QWaylandCompositor *compositor)
+    : QWaylandCompositorExtensionTemplate<QWaylandScreencopyManagerV1>(compositor, *new QWaylandScreencopyManagerV1Private())
+{
+}
+
+/*!
+    Destroys the QWaylandScreencopyManagerV1 object. Pending captures fail.
+*/
+QWaylandScreencopyManagerV1::~QWaylandScreencopyManagerV1() = default;
+
+/*!
+    Initializes the extension.
+*/
+void QWaylandScreencopyManagerV1::initialize()
+{
+    Q_D(QWaylandScreencopyManagerV1);
+
+    QWaylandCompositorExtensionTemplate::initialize();
+    QWaylandCompositor *compositor = static_cast<QWaylandCompositor *>(extensionContainer());
+    if (!compositor) {
+        qCWarning(qLcWaylandCompositor) << "Failed to find QWaylandCompositor when initializing QWaylandScreencopyManagerV1";
+        return;
+    }
+    d->init(compositor->display(), d->interfaceVersion());
+}
+
+/*!
+    Returns \c true if a client is waiting for the next frame of \a output.
+
+    Compositors that report frames with frameRendered() can use this to avoid reading back
+    their output when nobody is going to use the contents.
+
+    \sa captureRequested()
+*/
+bool QWaylandScreencopyManagerV1::hasPendingCaptures(QWaylandOutput *output) const
+{
+    Q_D(const QWaylandScreencopyManagerV1);
+    const auto *state = d->outputs.value(output);
+    return state && !state->pendingFrames.isEmpty();
+}
+
+/*!
+    Reports that a new frame of \a output has been rendered. The \a contents hold the whole
+    output in buffer pixels, the way it is shown on screen, and \a damage is the part that
+    changed since the previous frame, in the same coordinates.
+
+    There is no need to call this for a QWaylandSoftwareOutput or a QWaylandQuickOutput, which
+    are handled by the extension itself. The \a contents are only used during the call.
+*/
+void QWaylandScreencopyManagerV1::frameRendered(QWaylandOutput *output, const QImage &contents, const QRegion &damage)
+{
+    Q_D(QWaylandScreencopyManagerV1);
+    d->frameRendered(output, contents, damage);
+}
+
+/*!
+    \fn void QWaylandScreencopyManagerV1::captureRequested(QWaylandOutput *output)
+
+    This signal is emitted when a client waits for a frame of \a output that the extension
+    cannot read by itself. The compositor should render \a output and report the result with
+    frameRendered().
+*/
+
+/*!
+    Returns the Wayland interface for the QWaylandScreencopyManagerV1.
+*/
+const wl_interface *QWaylandScreencopyManagerV1::interface()
+{
+    return QWaylandScreencopyManagerV1Private::interface();
+}
+
+QWaylandScreencopyManagerV1Private::~QWaylandScreencopyManagerV1Private()
+{
+    for (Frame *frame : qAsConst(frames)) {
+        frame->fail();
+        frame->manager = nullptr;
+        frame->target = nullptr;
+    }
+    for (CopyTarget *target : qAsConst(copyTargets)) {
+        wl_list_remove(&target->destroyListener.link);
+        delete target;
+    }
+    for (OutputState *state : qAsConst(outputs)) {
+        for (const auto &connection : qAsConst(state->connections))
+            QObject::disconnect(connection);
+        delete state;
+    }
+}
+
+QWaylandScreencopyManagerV1Private::OutputState *QWaylandScreencopyManagerV1Private::outputState(QWaylandOutput *output)
+{
+    Q_Q(QWaylandScreencopyManagerV1);
+    if (OutputState *state = outputs.value(output))
+        return state;
+
+    auto *state = new OutputState;
+    state->output = output;
+    state->sequence = 1; // Whatever the output shows right now
+    outputs.insert(output, state);
+
+    state->connections << QObject::connect(output, &QObject::destroyed, q, [this, output]() {
+        removeOutput(output);
+    });
+    if (auto *softwareOutput = qobject_cast<QWaylandSoftwareOutput *>(output)) {
+        state->connections << QObject::connect(softwareOutput, &QWaylandSoftwareOutput::frameReady, q,
+                                               [this, softwareOutput](const QRegion &damage) {
+            frameRendered(softwareOutput, softwareOutput->framebuffer(), damage);
+        });
+    } else {
+        watchQuickOutput(state);
+    }
+    return state;
+}
+
+void QWaylandScreencopyManagerV1Private::removeOutput(QWaylandOutput *output)
+{
+    OutputState *state = outputs.take(output);
+    if (!state)
+        return;
+
+    for (Frame *frame : qAsConst(state->pendingFrames))
+        frame->fail();
+    for (Frame *frame : qAsConst(frames)) {
+        if (frame->output == output)
+            frame->output = nullptr;
+    }
+    for (const auto &connection : qAsConst(state->connections))
+        QObject::disconnect(connection);
+    delete state;
+}
+
+// Quick outputs are read back on the render thread right after a frame has been rendered,
+// but only when a client is waiting for one. Only the parts that changed since the previous
+// read back are read: the damage of the surfaces shown on the output, or all of it as soon
+// as anything else in the scene changed.
+void QWaylandScreencopyManagerV1Private::watchQuickOutput(OutputState *state)
+{
+#if QT_CONFIG(wayland_compositor_quick) && QT_CONFIG(opengl)
+    Q_Q(QWaylandScreencopyManagerV1);
+    auto *quickOutput = qobject_cast<QWaylandQuickOutput *>(state->output);
+    auto *window = quickOutput ? qobject_cast<QQuickWindow *>(quickOutput->window()) : nullptr;
+    if (!window)
+        return;
+
+    QSharedPointer<QuickReadback> readback(new QuickReadback);
+    state->readback = readback;
+    QPointer<QWaylandScreencopyManagerV1> manager(q);
+    QPointer<QWaylandOutput> output(quickOutput);
+
+    state->surfaceWatcher.reset(new QObject);
+    if (QWaylandCompositor *compositor = quickOutput->compositor()) {
+        const auto surfaces = compositor->surfaces();
+        for (QWaylandSurface *surface : surfaces)
+            watchSurface(state, surface);
+        QObject::connect(compositor, &QWaylandCompositor::surfaceCreated, state->surfaceWatcher.data(),
+                         [this, state](QWaylandSurface *surface) {
+            watchSurface(state, surface);
+        });
+    }
+
+    // The GUI thread is blocked while the scene graph synchronizes, so this is where the
+    // damage it collected is taken over.
+    state->connections << QObject::connect(window, &QQuickWindow::beforeSynchronizing, window, [window, readback]() {
+        const QRect bounds(QPoint(), window->size() * window->effectiveDevicePixelRatio());
+        QRegion damage = readback->surfaceDamage;
+        for (QQuickItem *item = QQuickWindowPrivate::get(window)->dirtyItemList; item;
+             item = QQuickItemPrivate::get(item)->nextDirtyItem) {
+            // Surface items whose contents changed are covered by the surface damage
+            if (QQuickItemPrivate::get(item)->dirtyAttributes == QQuickItemPrivate::Content
+                    && readback->damagedItems.contains(item)) {
+                continue;
+            }
+            damage = bounds;
+            break;
+        }
+        readback->surfaceDamage = QRegion();
+        readback->damagedItems.clear();
+
+        if (readback->contents.size() != bounds.size())
+            damage = bounds;
+        damage &= bounds;
+        if (!damage.isEmpty()) {
+            readback->unreadDamage += damage;
+            readback->hasUnreadDamage.storeRelease(1);
+        }
+    }, Qt::DirectConnection);
+
+    state->connections << QObject::connect(window, &QQuickWindow::afterRendering, window, [window, readback, manager, output]() {
+        if (!readback->requested.testAndSetOrdered(1, 0))
+            return;
+        QOpenGLContext *context = QOpenGLContext::currentContext();
+        if (!context)
+            return;
+
+        const QSize size = window->size() * window->effectiveDevicePixelRatio();
+        if (readback->contents.size() != size) {
+            readback->contents = QImage(size, QImage::Format_RGBA8888_Premultiplied);
+            readback->unreadDamage = QRect(QPoint(), size);
+        }
+        const QRegion damage = readback->unreadDamage;
+        readback->unreadDamage = QRegion();
+        readback->hasUnreadDamage.storeRelease(0);
+
+        // Many small reads cost more than one bigger one
+        enum { MaxReadsPerFrame = 8 };
+        const QRegion readRegion = damage.rectCount() > MaxReadsPerFrame ? QRegion(damage.boundingRect()) : damage;
+        QOpenGLFunctions *functions = context->functions();
+        for (const QRect &rect : readRegion) {
+            QImage pixels(rect.size(), QImage::Format_RGBA8888_Premultiplied);
+            functions->glReadPixels(rect.x(), size.height() - rect.y() - rect.height(), rect.width(), rect.height(),
+                                    GL_RGBA, GL_UNSIGNED_BYTE, pixels.bits());
+            for (int y = 0; y < rect.height(); ++y) {
+                memcpy(readback->contents.scanLine(rect.y() + y) + rect.x() * 4,
+                       pixels.constScanLine(rect.height() - 1 - y), size_t(rect.width()) * 4);
+            }
+        }
+
+        const QImage contents = readback->contents;
+        QMetaObject::invokeMethod(window, [manager, output, contents, damage]() {
+            if (manager && output)
+                manager->frameRendered(output, contents, damage);
+        }, Qt::QueuedConnection);
+    }, Qt::DirectConnection);
+#else
+    Q_UNUSED(state);
+#endif
+}
+
+void QWaylandScreencopyManagerV1Private::watchSurface(OutputState *state, QWaylandSurface *surface)
+{
+#if QT_CONFIG(wayland_compositor_quick) && QT_CONFIG(opengl)
+    QSharedPointer<QuickReadback> readback = state->readback;
+    QPointer<QQuickWindow> window = qobject_cast<QQuickWindow *>(state->output->window());
+    QObject::connect(surface, &QWaylandSurface::damaged, state->surfaceWatcher.data(),
+                     [surface, readback, window](const QRegion &damage) {
+        if (!window)
+            return;
+        const qreal dpr = window->effectiveDevicePixelRatio();
+        const auto views = surface->views();
+        for (QWaylandView *view : views) {
+            auto *item = qobject_cast<QWaylandQuickItem *>(view->renderObject());
+            if (!item || item->window() != window || !item->isVisible())
+                continue;
+            for (const QRect &rect : damage) {
+                const QRectF itemRect(item->mapFromSurface(rect.topLeft()), item->mapFromSurface(rect.bottomRight() + QPoint(1, 1)));
+                const QRectF sceneRect = item->mapRectToScene(itemRect.normalized());
+                const QRectF frameRect(sceneRect.topLeft() * dpr, sceneRect.size() * dpr);
+                // Leave room for smooth scaling
+                readback->surfaceDamage += frameRect.toAlignedRect().adjusted(-1, -1, 1, 1);
+            }
+            readback->damagedItems.insert(item);
+        }
+    });
+#else
+    Q_UNUSED(state);
+    Q_UNUSED(surface);
+#endif
+}
+
+QSize QWaylandScreencopyManagerV1Private::frameSize(QWaylandOutput *output)
+{
+#if QT_CONFIG(wayland_compositor_quick)
+    if (auto *quickOutput = qobject_cast<QWaylandQuickOutput *>(output)) {
+        if (auto *window = qobject_cast<QQuickWindow *>(quickOutput->window()))
+            return window->size() * window->effectiveDevicePixelRatio();
+    }
+#endif
+    const QSize modeSize = output->currentMode().size();
+    if (!modeSize.isEmpty())
+        return modeSize;
+    return output->geometry().size() * qMax(output->scaleFactor(), 1);
+}
+
+// Maps output logical coordinates to frame pixels
+QTransform QWaylandScreencopyManagerV1Private::frameTransform(QWaylandOutput *output)
+{
+    if (auto *softwareOutput = qobject_cast<QWaylandSoftwareOutput *>(output))
+        return QWaylandSoftwareOutputPrivate::get(softwareOutput)->framebufferTransform();
+
+    const QSize size = frameSize(output);
+    const QSize logicalSize = output->geometry().size();
+    if (logicalSize.isEmpty())
+        return QTransform();
+    return QTransform::fromScale(qreal(size.width()) / logicalSize.width(),
+                                 qreal(size.height()) / logicalSize.height());
+}
+
+// Returns the contents of the output as of its latest frame, if they can be read at any time
+QImage QWaylandScreencopyManagerV1Private::currentContents(QWaylandOutput *output) const
+{
+    if (auto *softwareOutput = qobject_cast<QWaylandSoftwareOutput *>(output))
+        return softwareOutput->framebuffer();
+    return QImage();
+}
+
+QWaylandScreencopyManagerV1Private::CopyTarget *QWaylandScreencopyManagerV1Private::copyTarget(wl_resource *buffer)
+{
+    if (CopyTarget *target = copyTargets.value(buffer))
+        return target;
+
+    auto *target = new CopyTarget;
+    target->manager = this;
+    target->buffer = buffer;
+    target->destroyListener.notify = bufferDestroyed;
+    wl_resource_add_destroy_listener(buffer, &target->destroyListener);
+    copyTargets.insert(buffer, target);
+    return target;
+}
+
+void QWaylandScreencopyManagerV1Private::bufferDestroyed(wl_listener *listener, void *data)
+{
+    Q_UNUSED(data);
+    CopyTarget *target = wl_container_of(listener, target, destroyListener);
+    QWaylandScreencopyManagerV1Private *manager = target->manager;
+
+    for (Frame *frame : qAsConst(manager->frames)) {
+        if (frame->target == target) {
+            frame->target = nullptr;
+            frame->fail();
+        }
+    }
+    wl_list_remove(&target->destroyListener.link);
+    manager->copyTargets.remove(target->buffer);
+    delete target;
+}
+
+// Returns the union of the damage of the frames after \a sequence up to the current one,
+// or all of \a clip if that is no longer known.
+QRegion QWaylandScreencopyManagerV1Private::damageSince(const OutputState *state, quint64 sequence, const QRect &clip) const
+{
+    if (sequence == 0 || sequence > state->sequence || state->sequence - sequence >= OutputState::HistorySize)
+        return QRegion(clip);
+
+    QRegion damage;
+    for (quint64 s = sequence + 1; s <= state->sequence; ++s)
+        damage += state->damageHistory[s % OutputState::HistorySize];
+    return damage & clip;
+}
+
+void QWaylandScreencopyManagerV1Private::requestCapture(Frame *frame)
+{
+    Q_Q(QWaylandScreencopyManagerV1);
+    OutputState *state = outputState(frame->output);
+
+    const QImage contents = currentContents(frame->output);
+    if (!contents.isNull()) {
+        // Plain copies are served right away, the others once something changed since the
+        // previous copy through the same manager.
+        const quint64 copied = state->copiedSequence.value(frame->managerResource);
+        if (!frame->withDamage || !damageSince(state, copied, frame->sourceRect).isEmpty()) {
+            deliver(state, frame, contents);
+            return;
+        }
+    }
+
+    state->pendingFrames.append(frame);
+    if (QuickReadback *readback = state->readback.data()) {
+        readback->requested.storeRelease(1);
+        // Damage based captures wait for the output to render something new on its own,
+        // unless it already did since the previous read back.
+        const quint64 copied = state->copiedSequence.value(frame->managerResource);
+        if (!frame->withDamage || readback->hasUnreadDamage.loadAcquire()
+                || !damageSince(state, copied, frame->sourceRect).isEmpty()) {
+            frame->output->update();
+        }
+        return;
+    }
+
+    if (contents.isNull())
+        emit q->captureRequested(frame->output);
+
+    // Damage based captures wait for something to change; the others need a new frame now.
+    if (!frame->withDamage || contents.isNull())
+        frame->output->update();
+}
+
+void QWaylandScreencopyManagerV1Private::deliver(OutputState *state, Frame *frame, const QImage &contents)
+{
+    state->pendingFrames.removeOne(frame);
+
+    CopyTarget *target = frame->target;
+    wl_shm_buffer *shmBuffer = target ? wl_shm_buffer_get(target->buffer) : nullptr;
+    if (!shmBuffer || contents.size() != frameSize(frame->output)) {
+        frame->fail();
+        return;
+    }
+
+    // The client may have changed the buffer since a previous copy, so the whole region is
+    // copied every time. The damage history only decides which damage events are sent.
+    const QRect &source = frame->sourceRect;
+    QImage converted;
+    const uchar *src = nullptr;
+    int srcStride = 0;
+    if (contents.format() == QImage::Format_RGB32
+            || contents.format() == QImage::Format_ARGB32
+            || contents.format() == QImage::Format_ARGB32_Premultiplied) {
+        src = contents.constScanLine(source.y()) + source.x() * 4;
+        srcStride = contents.bytesPerLine();
+    } else {
+        converted = contents.copy(source).convertToFormat(QImage::Format_RGB32);
+        src = converted.constBits();
+        srcStride = converted.bytesPerLine();
+    }
+
+    wl_shm_buffer_begin_access(shmBuffer);
+    uchar *dst = static_cast<uchar *>(wl_shm_buffer_get_data(shmBuffer));
+    const int stride = wl_shm_buffer_get_stride(shmBuffer);
+    for (int y = 0; y < source.height(); ++y)
+        memcpy(dst + y * stride, src + y * srcStride, size_t(source.width()) * 4);
+    wl_shm_buffer_end_access(shmBuffer);
+
+    frame->send_flags(0);
+    if (frame->withDamage && frame->resource()->version() >= ZWLR_SCREENCOPY_FRAME_V1_DAMAGE_SINCE_VERSION) {
+        const quint64 copied = state->copiedSequence.value(frame->managerResource);
+        const QRegion damage = damageSince(state, copied, source).translated(-source.topLeft());
+        for (const QRect &rect : damage)
+            frame->send_damage(rect.x(), rect.y(), rect.width(), rect.height());
+    }
+    if (frame->managerResource)
+        state->copiedSequence.insert(frame->managerResource, state->sequence);
+
+    const qint64 nsecs = QDeadlineTimer::current(Qt::PreciseTimer).deadlineNSecs();
+    const quint64 secs = quint64(nsecs / 1000000000);
+    frame->send_ready(uint32_t(secs >> 32), uint32_t(secs), uint32_t(nsecs % 1000000000));
+    frame->output = nullptr;
+    frame->finished = true;
+}
+
+void QWaylandScreencopyManagerV1Private::frameRendered(QWaylandOutput *output, const QImage &contents, const QRegion &damage)
+{
+    OutputState *state = outputs.value(output);
+    if (!state)
+        return;
+
+    ++state->sequence;
+    state->damageHistory[state->sequence % OutputState::HistorySize] = damage;
+
+    const auto pending = state->pendingFrames;
+    for (Frame *frame : pending) {
+        const quint64 copied = state->copiedSequence.value(frame->managerResource);
+        if (frame->withDamage && damageSince(state, copied, frame->sourceRect).isEmpty())
+            continue;
+        deliver(state, frame, contents);
+    }
+
+    // Frames still waiting for damage need the next frame read back too
+    if (state->readback && !state->pendingFrames.isEmpty())
+        state->readback->requested.storeRelease(1);
+}
+
+void QWaylandScreencopyManagerV1Private::createFrame(Resource *resource, uint32_t id, wl_resource *outputResource,
+                                                     const QRect &region, bool wholeOutput)
+{
+    QWaylandOutput *output = QWaylandOutput::fromResource(outputResource);
+    auto *frame = new Frame(this, resource, output, QRect(), resource->client(), int(id), resource->version());
+    frames.append(frame);
+
+    if (!output) {
+        frame->fail();
+        return;
+    }
+
+    const QRect bounds(QPoint(), frameSize(output));
+    frame->sourceRect = wholeOutput ? bounds : frameTransform(output).mapRect(region) & bounds;
+    if (frame->sourceRect.isEmpty()) {
+        frame->fail();
+        return;
+    }
+    frame->sendBufferInfo();
+}
+
+void QWaylandScreencopyManagerV1Private::zwlr_screencopy_manager_v1_capture_output(Resource *resource, uint32_t frame, int32_t overlay_cursor, wl_resource *output)
+{
+    // The cursor is whatever the compositor renders on the output, so there is nothing to
+    // overlay separately.
+    Q_UNUSED(overlay_cursor);
+    createFrame(resource, frame, output, QRect(), true);
+}
+
+void QWaylandScreencopyManagerV1Private::zwlr_screencopy_manager_v1_capture_output_region(Resource *resource, uint32_t frame, int32_t overlay_cursor, wl_resource *output, int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    Q_UNUSED(overlay_cursor);
+    createFrame(resource, frame, output, QRect(x, y, width, height), false);
+}
+
+void QWaylandScreencopyManagerV1Private::zwlr_screencopy_manager_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void QWaylandScreencopyManagerV1Private::zwlr_screencopy_manager_v1_destroy_resource(Resource *resource)
+{
+    for (OutputState *state : qAsConst(outputs))
+        state->copiedSequence.remove(resource);
+    for (Frame *frame : qAsConst(frames)) {
+        if (frame->managerResource == resource)
+            frame->managerResource = nullptr;
+    }
+}
+
+QWaylandScreencopyManagerV1Private::Frame::Frame(QWaylandScreencopyManagerV1Private *manager,
+                                                 QtWaylandServer::zwlr_screencopy_manager_v1::Resource *managerResource,
+                                                 QWaylandOutput *output, const QRect &sourceRect,
+                                                 wl_client *client, int id, int version)
+    : QtWaylandServer::zwlr_screencopy_frame_v1(client, id, version)
+    , manager(manager)
+    , managerResource(managerResource)
+    , output(output)
+    , sourceRect(sourceRect)
+{
+}
+
+QWaylandScreencopyManagerV1Private::Frame::~Frame()
+{
+    if (!manager)
+        return;
+    manager->frames.removeOne(this);
+    if (OutputState *state = manager->outputs.value(output))
+        state->pendingFrames.removeOne(this);
+}
+
+void QWaylandScreencopyManagerV1Private::Frame::sendBufferInfo()
+{
+    send_buffer(WL_SHM_FORMAT_XRGB8888, uint32_t(sourceRect.width()), uint32_t(sourceRect.height()),
+                uint32_t(sourceRect.width() * 4));
+    if (resource()->version() >= ZWLR_SCREENCOPY_FRAME_V1_BUFFER_DONE_SINCE_VERSION)
+        send_buffer_done();
+}
+
+void QWaylandScreencopyManagerV1Private::Frame::fail()
+{
+    if (finished)
+        return;
+    finished = true;
+    if (manager) {
+        if (OutputState *state = manager->outputs.value(output))
+            state->pendingFrames.removeOne(this);
+    }
+    output = nullptr;
+    send_failed();
+}
+
+void QWaylandScreencopyManagerV1Private::Frame::copy(Resource *resource, wl_resource *buffer, bool damage)
+{
+    if (used) {
+        wl_resource_post_error(resource->handle, error_already_used,
+                               "frame has already been used to copy a buffer");
+        return;
+    }
+    used = true;
+
+    if (!manager || !output) {
+        fail();
+        return;
+    }
+
+    wl_shm_buffer *shmBuffer = wl_shm_buffer_get(buffer);
+    if (!shmBuffer) {
+        wl_resource_post_error(resource->handle, error_invalid_buffer, "only wl_shm buffers are supported");
+        return;
+    }
+    const uint32_t format = wl_shm_buffer_get_format(shmBuffer);
+    if (format != WL_SHM_FORMAT_XRGB8888
+            || wl_shm_buffer_get_width(shmBuffer) != sourceRect.width()
+            || wl_shm_buffer_get_height(shmBuffer) != sourceRect.height()
+            || wl_shm_buffer_get_stride(shmBuffer) < sourceRect.width() * 4) {
+        wl_resource_post_error(resource->handle, error_invalid_buffer,
+                               "buffer does not match the advertised size or format");
+        return;
+    }
+
+    target = manager->copyTarget(buffer);
+    withDamage = damage;
+    manager->requestCapture(this);
+}
+
+void QWaylandScreencopyManagerV1Private::Frame::zwlr_screencopy_frame_v1_copy(Resource *resource, wl_resource *buffer)
+{
+    copy(resource, buffer, false);
+}
+
+void QWaylandScreencopyManagerV1Private::Frame::zwlr_screencopy_frame_v1_copy_with_damage(Resource *resource, wl_resource *buffer)
+{
+    copy(resource, buffer, true);
+}
+
+void QWaylandScreencopyManagerV1Private::Frame::zwlr_screencopy_frame_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void QWaylandScreencopyManagerV1Private::Frame::zwlr_screencopy_frame_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource);
+    delete this;
+}
+
+QT_END_NAMESPACE
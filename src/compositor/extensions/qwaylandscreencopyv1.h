@@ -0,0 +1,64 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWAYLANDSCREENCOPYV1_H
+#define QWAYLANDSCREENCOPYV1_H
+
+#include <QtWaylandCompositor/QWaylandCompositorExtension>
+
+QT_BEGIN_NAMESPACE
+
+class QImage;
+class QRegion;
+class QWaylandOutput;
+class QWaylandScreencopyManagerV1Private;
+
+class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandScreencopyManagerV1 : public QWaylandCompositorExtensionTemplate<QWaylandScreencopyManagerV1>
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(QWaylandScreencopyManagerV1)
+public:
+    QWaylandScreencopyManagerV1();
+    explicit QWaylandScreencopyManagerV1(QWaylandCompositor *compositor);
+    ~QWaylandScreencopyManagerV1() override;
+
+    void initialize() override;
+
+    bool hasPendingCaptures(QWaylandOutput *output) const;
+    void frameRendered(QWaylandOutput *output, const QImage &contents, const QRegion &damage);
+
+    static const struct wl_interface *interface();
+
+Q_SIGNALS:
+    void captureRequested(QWaylandOutput *output);
+};
+
+QT_END_NAMESPACE
+
+#endif // QWAYLANDSCREENCOPYV1_H
@@ -0,0 +1,175 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWAYLANDSCREENCOPYV1_P_H
+#define QWAYLANDSCREENCOPYV1_P_H
+
+#include <QtWaylandCompositor/QWaylandScreencopyManagerV1>
+#include <QtWaylandCompositor/private/qwaylandcompositorextension_p.h>
+#include <QtWaylandCompositor/private/qwayland-server-wlr-screencopy-unstable-v1.h>
+
+#include <QtCore/QHash>
+#include <QtCore/QPointer>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QSet>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
+#include <QtGui/QRegion>
+#include <QtGui/QTransform>
+
+#include <wayland-server-core.h>
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+QT_BEGIN_NAMESPACE
+
+class QQuickItem;
+class QWaylandSurface;
+
+class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandScreencopyManagerV1Private
+        : public QWaylandCompositorExtensionPrivate
+        , public QtWaylandServer::zwlr_screencopy_manager_v1
+{
+    Q_DECLARE_PUBLIC(QWaylandScreencopyManagerV1)
+public:
+    class Frame;
+
+    // A client buffer frames copy into, tracked so that frames notice when it is destroyed
+    struct CopyTarget {
+        wl_listener destroyListener;
+        QWaylandScreencopyManagerV1Private *manager = nullptr;
+        wl_resource *buffer = nullptr;
+    };
+
+    // Reads back the damaged parts of a QWaylandQuickOutput after it rendered a frame
+    struct QuickReadback {
+        QAtomicInt requested;
+        QAtomicInt hasUnreadDamage;
+
+        // Collected on the GUI thread, taken over while the scene graph synchronizes
+        QRegion surfaceDamage; // In frame pixels
+        QSet<QQuickItem *> damagedItems;
+
+        // Render thread only
+        QRegion unreadDamage; // Changed since the previous read back
+        QImage contents;
+    };
+
+    struct OutputState {
+        enum { HistorySize = 16 };
+
+        QWaylandOutput *output = nullptr;
+        quint64 sequence = 0;
+        QRegion damageHistory[HistorySize]; // Indexed by sequence % HistorySize
+        QVector<Frame *> pendingFrames;
+        QHash<Resource *, quint64> copiedSequence; // Last frame copied through each manager
+        QSharedPointer<QuickReadback> readback;
+        QScopedPointer<QObject> surfaceWatcher; // Context of the surface damage connections
+        QVector<QMetaObject::Connection> connections;
+    };
+
+    class Frame : public QtWaylandServer::zwlr_screencopy_frame_v1
+    {
+    public:
+        Frame(QWaylandScreencopyManagerV1Private *manager, QtWaylandServer::zwlr_screencopy_manager_v1::Resource *managerResource,
+              QWaylandOutput *output, const QRect &sourceRect,
+              wl_client *client, int id, int version);
+        ~Frame() override;
+
+        void sendBufferInfo();
+        void fail();
+
+        QWaylandScreencopyManagerV1Private *manager = nullptr;
+        QtWaylandServer::zwlr_screencopy_manager_v1::Resource *managerResource = nullptr;
+        QWaylandOutput *output = nullptr;
+        QRect sourceRect; // In frame pixels
+        CopyTarget *target = nullptr;
+        bool withDamage = false;
+        bool used = false;
+        bool finished = false;
+
+    protected:
+        void zwlr_screencopy_frame_v1_copy(Resource *resource, wl_resource *buffer) override;
+        void zwlr_screencopy_frame_v1_copy_with_damage(Resource *resource, wl_resource *buffer) override;
+        void zwlr_screencopy_frame_v1_destroy(Resource *resource) override;
+        void zwlr_screencopy_frame_v1_destroy_resource(Resource *resource) override;
+
+    private:
+        void copy(Resource *resource, wl_resource *buffer, bool damage);
+    };
+
+    QWaylandScreencopyManagerV1Private() = default;
+    ~QWaylandScreencopyManagerV1Private() override;
+
+    static QWaylandScreencopyManagerV1Private *get(QWaylandScreencopyManagerV1 *manager) { return manager ? manager->d_func() : nullptr; }
+
+    OutputState *outputState(QWaylandOutput *output);
+    void removeOutput(QWaylandOutput *output);
+    void watchQuickOutput(OutputState *state);
+    void watchSurface(OutputState *state, QWaylandSurface *surface);
+
+    static QSize frameSize(QWaylandOutput *output);
+    static QTransform frameTransform(QWaylandOutput *output);
+    QImage currentContents(QWaylandOutput *output) const;
+
+    CopyTarget *copyTarget(wl_resource *buffer);
+    static void bufferDestroyed(wl_listener *listener, void *data);
+
+    void requestCapture(Frame *frame);
+    QRegion damageSince(const OutputState *state, quint64 sequence, const QRect &clip) const;
+    void deliver(OutputState *state, Frame *frame, const QImage &contents);
+    void frameRendered(QWaylandOutput *output, const QImage &contents, const QRegion &damage);
+
+    QHash<QWaylandOutput *, OutputState *> outputs;
+    QHash<wl_resource *, CopyTarget *> copyTargets;
+    QVector<Frame *> frames;
+
+protected:
+    void zwlr_screencopy_manager_v1_capture_output(Resource *resource, uint32_t frame, int32_t overlay_cursor, wl_resource *output) override;
+    void zwlr_screencopy_manager_v1_capture_output_region(Resource *resource, uint32_t frame, int32_t overlay_cursor, wl_resource *output, int32_t x, int32_t y, int32_t width, int32_t height) override;
+    void zwlr_screencopy_manager_v1_destroy(Resource *resource) override;
+    void zwlr_screencopy_manager_v1_destroy_resource(Resource *resource) override;
+
+private:
+    void createFrame(Resource *resource, uint32_t id, wl_resource *outputResource, const QRect &region, bool wholeOutput);
+};
+
+QT_END_NAMESPACE
+
+#endif // QWAYLANDSCREENCOPYV1_P_H
@@ -293,7 +293,7 @@ void QWaylandTextInputPrivate::setFocus(QWaylandSurface *surface)
         focusDestroyListener.reset();
     }
 
-    Resource *resource = surface ? resourceMap().value(surface->waylandClient()) : 0;
+    Resource *resource = surface ? clientResource(surface->waylandClient()) : 0;
 
     if (resource && (focus != surface || focusResource != resource)) {
         uint32_t serial = compositor->nextSerial();
@@ -476,7 +476,7 @@ QRect QWaylandXdgOutputV1::logicalGeometry() const
 
 void QWaylandXdgOutputV1Private::sendLogicalPosition(const QPoint &position)
 {
-    const auto values = resourceMap().values();
+    const auto values = resourceHash().values();
     for (auto *resource : values)
         send_logical_position(resource->handle, position.x(), position.y());
     needToSendDone = true;
@@ -484,7 +484,7 @@ void QWaylandXdgOutputV1Private::sendLogicalPosition(const QPoint &position)
 
 void QWaylandXdgOutputV1Private::sendLogicalSize(const QSize &size)
 {
-    const auto values = resourceMap().values();
+    const auto values = resourceHash().values();
     for (auto *resource : values)
         send_logical_size(resource->handle, size.width(), size.height());
     needToSendDone = true;
@@ -493,7 +493,7 @@ void QWaylandXdgOutputV1Private::sendLogicalSize(const QSize &size)
 void QWaylandXdgOutputV1Private::sendDone()
 {
     if (needToSendDone) {
-        const auto values = resourceMap().values();
+        const auto values = resourceHash().values();
         for (auto *resource : values) {
             if (resource->version() < 3)
                 send_done(resource->handle);
@@ -241,7 +241,7 @@ uint QWaylandXdgShell::ping(QWaylandClient *client)
 
     uint32_t serial = compositor->nextSerial();
 
-    QWaylandXdgShellPrivate::Resource *clientResource = d->resourceMap().value(client->client(), nullptr);
+    QWaylandXdgShellPrivate::Resource *clientResource = d->clientResource(client->client());
     Q_ASSERT(clientResource);
 
     d->ping(clientResource, serial);
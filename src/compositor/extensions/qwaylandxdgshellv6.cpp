@@ -257,7 +257,7 @@ uint QWaylandXdgShellV6::ping(QWaylandClient *client)
 
     uint32_t serial = compositor->nextSerial();
 
-    QWaylandXdgShellV6Private::Resource *clientResource = d->resourceMap().value(client->client(), nullptr);
+    QWaylandXdgShellV6Private::Resource *clientResource = d->clientResource(client->client());
     Q_ASSERT(clientResource);
 
     d->ping(clientResource, serial);
@@ -47,7 +47,7 @@ bool QtKeyExtensionGlobal::postQtKeyEvent(QKeyEvent *event, QWaylandSurface *sur
 {
     uint32_t time = m_compositor->currentTimeMsecs();
 
-    Resource *target = surface ? resourceMap().value(surface->waylandClient()) : 0;
+    Resource *target = surface ? clientResource(surface->waylandClient()) : 0;
 
     if (target) {
         send_key(target->handle,
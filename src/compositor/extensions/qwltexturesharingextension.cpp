@@ -46,6 +46,15 @@
 #include <QtQuick/QSGTexture>
 #include <QQmlContext>
 #include <QThread>
+#include <QRunnable>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+#include <QSharedPointer>
+
+#include <algorithm>
+#include <limits>
 
 QT_BEGIN_NAMESPACE
 
@@ -227,17 +236,268 @@ void QWaylandSharedTextureProvider::setExtensionReady(QWaylandTextureSharingExte
     m_pendingResponses.squeeze();
 }
 
+// A file in the texture cache is this header, followed by the pixel data at dataOffset.
+// The data is aligned so that it can be used straight from the mapped file.
+struct SharedTextureCacheHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 compressed;
+    quint32 width;
+    quint32 height;
+    quint32 bytesPerLine;
+    quint32 glInternalFormat;
+    quint64 dataOffset;
+    quint64 dataLength;
+};
+
+static const char sharedTextureCacheMagic[8] = { 'Q', 'W', 'L', 'T', 'E', 'X', 'C', '\0' };
+static const quint32 sharedTextureCacheVersion = 1;
+static const quint64 sharedTextureCacheDataOffset = 64;
+Q_STATIC_ASSERT(sizeof(SharedTextureCacheHeader) <= sharedTextureCacheDataOffset);
+
+bool SharedTextureCache::read(const QString &cachePath, SharedTextureData *data)
+{
+    QSharedPointer<QFile> file(new QFile(cachePath));
+    if (!file->open(QIODevice::ReadOnly))
+        return false;
+
+    SharedTextureCacheHeader header;
+    if (file->read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header))
+            || memcmp(header.magic, sharedTextureCacheMagic, sizeof(header.magic)) != 0
+            || header.version != sharedTextureCacheVersion
+            || header.dataOffset < sizeof(header)
+            || header.dataLength == 0 || header.dataLength > quint64(std::numeric_limits<int>::max())
+            || quint64(file->size()) < header.dataOffset + header.dataLength) {
+        qWarning() << "QWaylandTextureSharingExtension: ignoring invalid cache file" << cachePath;
+        return false;
+    }
+
+    if (!header.compressed && quint64(header.bytesPerLine) * header.height != header.dataLength)
+        return false;
+
+    const uchar *mapped = file->map(qint64(header.dataOffset), qint64(header.dataLength));
+    if (!mapped)
+        return false;
+
+    // Recently used files are the last to be pruned
+    file->setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+
+    data->mappedFile = file;
+    data->fileOffset = qint64(header.dataOffset);
+    if (header.compressed) {
+        data->pixelData = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), int(header.dataLength));
+        data->size = QSize(int(header.width), int(header.height));
+        data->glInternalFormat = header.glInternalFormat;
+    } else {
+        // The image keeps the file mapped for as long as it, or any copy of it, lives
+        data->image = QImage(mapped, int(header.width), int(header.height), int(header.bytesPerLine),
+                             QImage::Format_RGBA8888_Premultiplied,
+                             [](void *file) { delete static_cast<QSharedPointer<QFile> *>(file); },
+                             new QSharedPointer<QFile>(file));
+    }
+    return true;
+}
+
+bool SharedTextureCache::write(const QString &cachePath, const SharedTextureData &data)
+{
+    SharedTextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, sharedTextureCacheMagic, sizeof(header.magic));
+    header.version = sharedTextureCacheVersion;
+    header.dataOffset = sharedTextureCacheDataOffset;
+
+    const char *pixels = nullptr;
+    if (!data.image.isNull()) {
+        header.width = quint32(data.image.width());
+        header.height = quint32(data.image.height());
+        header.bytesPerLine = quint32(data.image.bytesPerLine());
+        header.dataLength = quint64(data.image.sizeInBytes());
+        pixels = reinterpret_cast<const char *>(data.image.constBits());
+    } else if (!data.pixelData.isEmpty()) {
+        header.compressed = 1;
+        header.width = quint32(data.size.width());
+        header.height = quint32(data.size.height());
+        header.glInternalFormat = data.glInternalFormat;
+        header.dataLength = quint64(data.pixelData.size());
+        pixels = data.pixelData.constData();
+    } else {
+        return false;
+    }
+
+    // Written to a temporary file that is renamed when complete, so that other
+    // compositor instances never map a partial file
+    QDir().mkpath(QFileInfo(cachePath).path());
+    QSaveFile file(cachePath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(QByteArray(int(header.dataOffset - sizeof(header)), '\0'));
+        file.write(pixels, qint64(header.dataLength));
+    }
+    if (!file.commit()) {
+        qWarning() << "QWaylandTextureSharingExtension: could not write cache file" << cachePath << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+/*
+    Deletes the least recently used files of the cache in \a cacheDir until the rest take up
+    no more than \a maxBytes. Files are touched when read, so their modification time tells
+    when they were last used.
+*/
+void SharedTextureCache::prune(const QString &cacheDir, qint64 maxBytes)
+{
+    const QFileInfoList files = QDir(cacheDir).entryInfoList({ QStringLiteral("*.qwltex") }, QDir::Files,
+                                                             QDir::Time | QDir::Reversed);
+    qint64 size = 0;
+    for (const QFileInfo &info : files)
+        size += info.size();
+
+    for (const QFileInfo &info : files) {
+        if (size <= maxBytes)
+            break;
+        if (QFile::remove(info.filePath()))
+            size -= info.size();
+    }
+}
+
+// Looks up and decodes an image file on a worker thread, then hands the result over to the
+// extension on the main thread, where the server buffer is created.
+class SharedTextureDecoder : public QRunnable
+{
+public:
+    SharedTextureDecoder(QWaylandTextureSharingExtension *extension, const QString &key)
+        : m_extension(extension)
+        , m_key(key)
+        , m_imageDirs(extension->m_image_dirs)
+        , m_imageSuffixes(extension->m_image_suffixes)
+        , m_cacheDir(extension->m_cache_dir)
+        , m_cacheDirLimit(extension->m_cache_dir_limit)
+    {
+    }
+
+    void run() override
+    {
+        SharedTextureData data;
+        const QString pathName = existingFilePath();
+        if (!pathName.isEmpty()) {
+            const QString cachePath = cacheFilePath(pathName);
+            if (cachePath.isEmpty() || !SharedTextureCache::read(cachePath, &data)) {
+                if (!readCompressedTexture(pathName, &data)) {
+                    QImage img(pathName);
+                    if (!img.isNull())
+                        data.image = img.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+                }
+                if (!cachePath.isEmpty() && SharedTextureCache::write(cachePath, data))
+                    SharedTextureCache::prune(m_cacheDir, m_cacheDirLimit);
+            }
+        }
+
+        // The extension waits for all decoders before it is destroyed, and drops the
+        // queued call along with its other posted events.
+        QWaylandTextureSharingExtension *extension = m_extension;
+        const QString key = m_key;
+        QMetaObject::invokeMethod(extension, [extension, key, data] {
+            extension->finishLoading(key, data);
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    QString existingFilePath() const
+    {
+        // The default search path blocks absolute pathnames, but this does not prevent relative
+        // paths containing '../'. We handle that here, at the price of also blocking directory
+        // names ending with two or more dots.
+
+        if (m_key.contains(QLatin1String("../")))
+            return QString();
+
+        for (const QString &dir : m_imageDirs) {
+            QString path = dir + m_key;
+            if (QFileInfo::exists(path))
+                return path;
+        }
+
+        for (const QString &dir : m_imageDirs) {
+            for (const QString &ext : m_imageSuffixes) {
+                QString fp = dir + m_key + ext;
+                if (QFileInfo::exists(fp))
+                    return fp;
+            }
+        }
+        return QString();
+    }
+
+    // Cached data is keyed by the source file, its modification time and size, and the
+    // format images are converted to, so that changed sources are decoded again.
+    QString cacheFilePath(const QString &pathName) const
+    {
+        if (m_cacheDir.isEmpty())
+            return QString();
+
+        const QFileInfo info(pathName);
+        const QDateTime modified = info.lastModified();
+        if (!modified.isValid())
+            return QString();
+
+        QByteArray key = info.absoluteFilePath().toUtf8();
+        key += '\0';
+        key += QByteArray::number(modified.toMSecsSinceEpoch());
+        key += '\0';
+        key += QByteArray::number(info.size());
+        key += '\0';
+        key += "RGBA8888_Premultiplied";
+        const QByteArray hash = QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex();
+        return m_cacheDir + QString::fromLatin1(hash) + QLatin1String(".qwltex");
+    }
+
+    static bool readCompressedTexture(const QString &pathName, SharedTextureData *data)
+    {
+        QFile f(pathName);
+        if (!f.open(QIODevice::ReadOnly))
+            return false;
+
+        QTextureFileReader r(&f, pathName);
+
+        if (!r.canRead())
+            return false;
+
+        QTextureFileData td(r.read());
+
+        if (!td.isValid()) {
+            qWarning() << "QWaylandTextureSharingExtension:" << pathName << "not valid compressed texture";
+            return false;
+        }
+
+        data->storage = td.data();
+        data->pixelData = QByteArray::fromRawData(data->storage.constData() + td.dataOffset(), td.dataLength());
+        data->size = td.size();
+        data->glInternalFormat = td.glInternalFormat();
+        return true;
+    }
+
+    QWaylandTextureSharingExtension *m_extension = nullptr;
+    QString m_key;
+    QStringList m_imageDirs;
+    QStringList m_imageSuffixes;
+    QString m_cacheDir;
+    qint64 m_cacheDirLimit = 0;
+};
+
 QWaylandTextureSharingExtension *QWaylandTextureSharingExtension::s_self = nullptr; // theoretical race conditions, but OK as long as we don't delete it while we are running
 
 QWaylandTextureSharingExtension::QWaylandTextureSharingExtension()
 {
     s_self = this;
+    initCache();
 }
 
 QWaylandTextureSharingExtension::QWaylandTextureSharingExtension(QWaylandCompositor *compositor)
     :QWaylandCompositorExtensionTemplate(compositor)
 {
     s_self = this;
+    initCache();
 }
 
 QWaylandTextureSharingExtension::~QWaylandTextureSharingExtension()
@@ -245,6 +505,9 @@ QWaylandTextureSharingExtension::~QWaylandTextureSharingExtension()
     //qDebug() << Q_FUNC_INFO;
     //dumpBufferInfo();
 
+    m_decode_pool.clear();
+    m_decode_pool.waitForDone();
+
     for (auto b : m_server_buffers)
         delete b.buffer;
 
@@ -252,6 +515,13 @@ QWaylandTextureSharingExtension::~QWaylandTextureSharingExtension()
         s_self = nullptr;
 }
 
+void QWaylandTextureSharingExtension::initCache()
+{
+    m_decode_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, 4));
+    m_cleanup_timer.setSingleShot(true);
+    connect(&m_cleanup_timer, &QTimer::timeout, this, &QWaylandTextureSharingExtension::cleanupBuffers);
+}
+
 void QWaylandTextureSharingExtension::setImageSearchPath(const QString &path)
 {
     m_image_dirs = path.split(QLatin1Char(';'));
@@ -261,16 +531,104 @@ void QWaylandTextureSharingExtension::setImageSearchPath(const QString &path)
             (*it) += QLatin1Char('/');
 }
 
+/*
+    Images that are loaded as soon as the extension is initialized, so that clients asking
+    for them at startup don't have to wait for them to be decoded. Prefetched images are
+    kept regardless of the cacheBudget until they are first requested, or removed from this
+    list, and are cached like any other image from then on.
+*/
+void QWaylandTextureSharingExtension::setPrefetchImages(const QStringList &keys)
+{
+    if (m_prefetch_images == keys)
+        return;
+
+    bool dropped = false;
+    for (const QString &key : qAsConst(m_prefetch_images)) {
+        if (!keys.contains(key))
+            dropped |= m_unrequested_images.remove(key);
+    }
+
+    m_prefetch_images = keys;
+    emit prefetchImagesChanged();
+
+    if (m_initialized)
+        prefetch(keys);
+    if (dropped)
+        scheduleCleanup(0);
+}
+
+/*
+    Images that are never evicted from the cache once loaded, whether or not they are used.
+*/
+void QWaylandTextureSharingExtension::setPinnedImages(const QStringList &keys)
+{
+    QSet<QString> pinned(keys.cbegin(), keys.cend());
+    if (m_pinned_images == pinned)
+        return;
+    m_pinned_images = pinned;
+    emit pinnedImagesChanged();
+    scheduleCleanup(0);
+}
+
+/*
+    The number of bytes of buffers no longer used by any client or by the compositor itself
+    that are kept for later requests. The least recently used buffers are deleted first. The
+    default, 0, deletes buffers as soon as they are no longer used.
+*/
+void QWaylandTextureSharingExtension::setCacheBudget(qint64 bytes)
+{
+    bytes = qMax<qint64>(0, bytes);
+    if (m_cache_budget == bytes)
+        return;
+    m_cache_budget = bytes;
+    emit cacheBudgetChanged();
+    scheduleCleanup(0);
+}
+
+/*
+    A directory where decoded images are stored, so that later runs can map them instead of
+    decoding the image files again. Images are decoded every time if it is empty, which is
+    the default. The directory is kept within the cacheDirectoryLimit.
+*/
+void QWaylandTextureSharingExtension::setCacheDirectory(const QString &path)
+{
+    QString dir = path;
+    if (!dir.isEmpty() && !dir.endsWith(QLatin1Char('/')))
+        dir += QLatin1Char('/');
+    if (m_cache_dir == dir)
+        return;
+    m_cache_dir = dir;
+    emit cacheDirectoryChanged();
+}
+
+/*
+    The number of bytes the files in the cacheDirectory may take up. Whenever an image is
+    added to it, the least recently used ones are deleted until the directory fits. The
+    default is 256 MiB.
+*/
+void QWaylandTextureSharingExtension::setCacheDirectoryLimit(qint64 bytes)
+{
+    bytes = qMax<qint64>(0, bytes);
+    if (m_cache_dir_limit == bytes)
+        return;
+    m_cache_dir_limit = bytes;
+    emit cacheDirectoryLimitChanged();
+}
+
 void QWaylandTextureSharingExtension::initialize()
 {
     QWaylandCompositorExtensionTemplate::initialize();
     QWaylandCompositor *compositor = static_cast<QWaylandCompositor *>(extensionContainer());
-    init(compositor->display(), 1);
+    init(compositor->display(), 2);
 
     QString image_search_path = qEnvironmentVariable("QT_WAYLAND_SHAREDTEXTURE_SEARCH_PATH");
     if (!image_search_path.isEmpty())
         setImageSearchPath(image_search_path);
 
+    QString cache_dir = qEnvironmentVariable("QT_WAYLAND_SHAREDTEXTURE_CACHE_DIR");
+    if (!cache_dir.isEmpty())
+        setCacheDirectory(cache_dir);
+
     if (m_image_dirs.isEmpty())
         m_image_dirs << QLatin1String(":/") << QLatin1String("./");
 
@@ -281,6 +639,9 @@ void QWaylandTextureSharingExtension::initialize()
 
     //qDebug() << "m_image_suffixes" << m_image_suffixes << "m_image_dirs" << m_image_dirs;
 
+    m_initialized = true;
+    prefetch(m_prefetch_images);
+
     auto *ctx = QQmlEngine::contextForObject(this);
     if (ctx) {
         QQmlEngine *engine = ctx->engine();
@@ -292,43 +653,30 @@ void QWaylandTextureSharingExtension::initialize()
     }
 }
 
-QString QWaylandTextureSharingExtension::getExistingFilePath(const QString &key) const
-{
-    // The default search path blocks absolute pathnames, but this does not prevent relative
-    // paths containing '../'. We handle that here, at the price of also blocking directory
-    // names ending with two or more dots.
-
-    if (key.contains(QLatin1String("../")))
-        return QString();
-
-    for (auto dir : qAsConst(m_image_dirs)) {
-        QString path = dir + key;
-        if (QFileInfo::exists(path))
-            return path;
-    }
-
-    for (auto dir : qAsConst(m_image_dirs)) {
-        for (auto ext : m_image_suffixes) {
-            QString fp = dir + key + ext;
-            //qDebug() << "trying" << fp;
-            if (QFileInfo::exists(fp))
-                return fp;
-        }
-    }
-    return QString();
-}
+/*
+    Looks up the buffer for \a key. Returns true if the lookup is done, with \a buffer set
+    to the buffer or to null if there is no such image, or false if the image is being
+    decoded and finishLoading() will be called for it later.
 
-QtWayland::ServerBuffer *QWaylandTextureSharingExtension::getBuffer(const QString &key)
+    Custom pixel data is produced right away on the calling thread, as subclasses
+    implementing customPixelData() expect to be called on the main thread.
+*/
+bool QWaylandTextureSharingExtension::loadBuffer(const QString &key, QtWayland::ServerBuffer **buffer)
 {
-    if (!initServerBufferIntegration())
-        return nullptr;
+    *buffer = nullptr;
 
-//qDebug() << "getBuffer" << key;
+    if (!initServerBufferIntegration())
+        return true;
 
-    QtWayland::ServerBuffer *buffer = nullptr;
+    auto it = m_server_buffers.find(key);
+    if (it != m_server_buffers.end()) {
+        it->lastUsed = ++m_use_counter;
+        *buffer = it->buffer;
+        return true;
+    }
 
-    if ((buffer = m_server_buffers.value(key).buffer))
-        return buffer;
+    if (m_pending_images.contains(key))
+        return false;
 
     QByteArray pixelData;
     QSize size;
@@ -336,34 +684,84 @@ QtWayland::ServerBuffer *QWaylandTextureSharingExtension::getBuffer(const QStrin
 
     if (customPixelData(key, &pixelData, &size, &glInternalFormat)) {
         if (!pixelData.isEmpty()) {
-            buffer = m_server_buffer_integration->createServerBufferFromData(pixelData, size, glInternalFormat);
-            if (!buffer)
+            *buffer = m_server_buffer_integration->createServerBufferFromData(pixelData, size, glInternalFormat);
+            if (*buffer)
+                insertBuffer(key, *buffer, pixelData.size());
+            else
                 qWarning() << "QWaylandTextureSharingExtension: could not create buffer from custom data for key:" << key;
         }
-    } else {
-        QString pathName = getExistingFilePath(key);
-        //qDebug() << "pathName" << pathName;
-        if (pathName.isEmpty())
-            return nullptr;
-
-        buffer = getCompressedBuffer(pathName);
-        //qDebug() << "getCompressedBuffer" << buffer;
-
-        if (!buffer) {
-            QImage img(pathName);
-            if (!img.isNull()) {
-                img = img.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
-                buffer = m_server_buffer_integration->createServerBufferFromImage(img, QtWayland::ServerBuffer::RGBA32);
+        return true;
+    }
+
+    m_pending_images.insert(key, PendingImage());
+    m_decode_pool.start(new SharedTextureDecoder(this, key));
+    return false;
+}
+
+void QWaylandTextureSharingExtension::finishLoading(const QString &key, const SharedTextureData &data)
+{
+    const PendingImage pending = m_pending_images.take(key);
+
+    QtWayland::ServerBuffer *buffer = nullptr;
+    if (initServerBufferIntegration()) {
+        if (!data.pixelData.isEmpty()) {
+            buffer = m_server_buffer_integration->createServerBufferFromData(data.pixelData, data.size, data.glInternalFormat);
+            if (buffer)
+                insertBuffer(key, buffer, data.pixelData.size());
+        } else if (!data.image.isNull()) {
+            // Cached pixels can be read into the buffer without faulting in the mapping first
+            if (data.mappedFile) {
+                buffer = m_server_buffer_integration->createServerBufferFromFile(data.mappedFile->handle(), data.fileOffset,
+                                                                                 data.image.size(), data.image.bytesPerLine(),
+                                                                                 QtWayland::ServerBuffer::RGBA32);
             }
-            //qDebug() << "createServerBufferFromImage" << buffer;
+            if (!buffer)
+                buffer = m_server_buffer_integration->createServerBufferFromImage(data.image, QtWayland::ServerBuffer::RGBA32);
+            if (buffer)
+                insertBuffer(key, buffer, data.image.sizeInBytes());
         }
     }
-    if (buffer)
-        m_server_buffers.insert(key, BufferInfo(buffer));
 
     //qDebug() << ">>>>" << key << buffer;
 
-    return buffer;
+    if (!buffer)
+        m_unrequested_images.remove(key);
+
+    for (Resource *resource : pending.resources)
+        provideBuffer(resource, key, buffer);
+
+    if (pending.requestedLocally) {
+        if (buffer)
+            m_server_buffers[key].usedLocally = true;
+        emit bufferResult(key, buffer);
+    }
+}
+
+void QWaylandTextureSharingExtension::insertBuffer(const QString &key, QtWayland::ServerBuffer *buffer, qint64 byteCount)
+{
+    BufferInfo info(buffer, byteCount);
+    info.lastUsed = ++m_use_counter;
+    m_server_buffers.insert(key, info);
+    m_cache_size += byteCount;
+    emit cacheSizeChanged();
+
+    // Evicting right away could delete the buffer before it is handed out
+    scheduleCleanup(100);
+}
+
+void QWaylandTextureSharingExtension::provideBuffer(Resource *resource, const QString &key, QtWayland::ServerBuffer *buffer)
+{
+    if (buffer) {
+        struct ::wl_client *client = resource->client();
+        struct ::wl_resource *buffer_resource = buffer->resourceForClient(client);
+        //qDebug() << "          server_buffer resource" << buffer_resource;
+        if (buffer_resource)
+            send_provide_buffer(resource->handle, buffer_resource, key);
+        else
+            qWarning() << "QWaylandTextureSharingExtension: no buffer resource for client";
+    } else {
+        send_image_failed(resource->handle, key, QString());
+    }
 }
 
 // Compositor requesting image for its own UI
@@ -374,7 +772,13 @@ void QWaylandTextureSharingExtension::requestBuffer(const QString &key)
     if (thread() != QThread::currentThread())
         qWarning("QWaylandTextureSharingExtension::requestBuffer() called from outside main thread: possible race condition");
 
-    auto *buffer = getBuffer(key);
+    m_unrequested_images.remove(key);
+
+    QtWayland::ServerBuffer *buffer = nullptr;
+    if (!loadBuffer(key, &buffer)) {
+        m_pending_images[key].requestedLocally = true;
+        return;
+    }
 
     if (buffer)
         m_server_buffers[key].usedLocally = true;
@@ -384,39 +788,66 @@ void QWaylandTextureSharingExtension::requestBuffer(const QString &key)
     emit bufferResult(key, buffer);
 }
 
+/*
+    Starts loading the images for \a keys in the background, so that they are ready when
+    requested. Images loaded this way aren't evicted before they are requested.
+*/
+void QWaylandTextureSharingExtension::prefetch(const QStringList &keys)
+{
+    QtWayland::ServerBuffer *buffer = nullptr;
+    for (const QString &key : keys) {
+        const bool loading = m_server_buffers.contains(key) || m_pending_images.contains(key);
+        if (loadBuffer(key, &buffer) && !buffer)
+            continue;
+        if (!loading)
+            m_unrequested_images.insert(key);
+    }
+}
+
 void QWaylandTextureSharingExtension::zqt_texture_sharing_v1_request_image(Resource *resource, const QString &key)
 {
     //qDebug() << "texture_sharing_request_image" << key;
-    auto *buffer = getBuffer(key);
-    if (buffer) {
-        struct ::wl_client *client = resource->client();
-        struct ::wl_resource *buffer_resource = buffer->resourceForClient(client);
-        //qDebug() << "          server_buffer resource" << buffer_resource;
-        if (buffer_resource)
-            send_provide_buffer(resource->handle, buffer_resource, key);
-        else
-            qWarning() << "QWaylandTextureSharingExtension: no buffer resource for client";
-    } else {
-        send_image_failed(resource->handle, key, QString());
-    }
+    m_unrequested_images.remove(key);
+
+    QtWayland::ServerBuffer *buffer = nullptr;
+    if (loadBuffer(key, &buffer))
+        provideBuffer(resource, key, buffer);
+    else
+        m_pending_images[key].resources.append(resource);
     //dumpBufferInfo();
 }
 
+void QWaylandTextureSharingExtension::zqt_texture_sharing_v1_request_images(Resource *resource, const QByteArray &keys)
+{
+    for (const QByteArray &key : keys.split('\0')) {
+        if (!key.isEmpty())
+            zqt_texture_sharing_v1_request_image(resource, QString::fromUtf8(key));
+    }
+}
+
 void QWaylandTextureSharingExtension::zqt_texture_sharing_v1_abandon_image(Resource *resource, const QString &key)
 {
     Q_UNUSED(resource);
     Q_UNUSED(key);
 //    qDebug() << Q_FUNC_INFO << resource << key;
-    QTimer::singleShot(100, this, &QWaylandTextureSharingExtension::cleanupBuffers);
+    scheduleCleanup(100);
 }
 
 // A client has disconnected
 void QWaylandTextureSharingExtension::zqt_texture_sharing_v1_destroy_resource(Resource *resource)
 {
-    Q_UNUSED(resource);
 //    qDebug() << "texture_sharing_destroy_resource" << resource->handle << resource->handle->object.id << "client" << resource->client();
 //    dumpBufferInfo();
-    QTimer::singleShot(1000, this, &QWaylandTextureSharingExtension::cleanupBuffers);
+    for (auto it = m_pending_images.begin(); it != m_pending_images.end(); ++it)
+        it->resources.removeAll(resource);
+    scheduleCleanup(1000);
+}
+
+// Runs cleanupBuffers() in msec milliseconds, or sooner if it is already due
+void QWaylandTextureSharingExtension::scheduleCleanup(int msec)
+{
+    if (!m_cleanup_timer.isActive() || m_cleanup_timer.remainingTime() > msec)
+        m_cleanup_timer.start(msec);
 }
 
 bool QWaylandTextureSharingExtension::initServerBufferIntegration()
@@ -435,51 +866,43 @@ bool QWaylandTextureSharingExtension::initServerBufferIntegration()
     return true;
 }
 
-QtWayland::ServerBuffer *QWaylandTextureSharingExtension::getCompressedBuffer(const QString &pathName)
-{
-    QFile f(pathName);
-    if (!f.open(QIODevice::ReadOnly))
-        return nullptr;
-
-    QTextureFileReader r(&f, pathName);
-
-    if (!r.canRead())
-        return nullptr;
-
-    QTextureFileData td(r.read());
-
-    //qDebug() << "QWaylandTextureSharingExtension: reading compressed texture data" << td;
-
-    if (!td.isValid()) {
-        qWarning() << "VulkanServerBufferIntegration:" << pathName << "not valid compressed texture";
-        return nullptr;
-    }
-
-    QByteArray pixelData = QByteArray::fromRawData(td.data().constData() + td.dataOffset(), td.dataLength());
-
-    return m_server_buffer_integration->createServerBufferFromData(pixelData, td.size(), td.glInternalFormat());
-}
-
 void QWaylandTextureSharingExtension::cleanupBuffers()
 {
-    for (auto it = m_server_buffers.begin(); it != m_server_buffers.end(); ) {
-        auto *buffer = it.value().buffer;
-        if (!it.value().usedLocally && !buffer->bufferInUse()) {
-            //qDebug() << "deleting buffer for" << it.key();
-            it = m_server_buffers.erase(it);
-            delete buffer;
-        } else {
-            ++it;
-        }
+    // Buffers used by a client or by the compositor, pinned ones and prefetched ones no one
+    // has asked for yet are kept. The least recently used of the others are deleted until
+    // the cache fits into its budget.
+    QVector<QPair<quint64, QString>> unused;
+    qint64 unusedSize = 0;
+    for (auto it = m_server_buffers.cbegin(); it != m_server_buffers.cend(); ++it) {
+        const BufferInfo &info = it.value();
+        if (info.usedLocally || m_pinned_images.contains(it.key()) || m_unrequested_images.contains(it.key())
+                || info.buffer->bufferInUse())
+            continue;
+        unused.append(qMakePair(info.lastUsed, it.key()));
+        unusedSize += info.byteCount;
+    }
+    if (unusedSize <= m_cache_budget)
+        return;
+
+    std::sort(unused.begin(), unused.end());
+    for (const auto &entry : qAsConst(unused)) {
+        const BufferInfo info = m_server_buffers.take(entry.second);
+        //qDebug() << "deleting buffer for" << entry.second;
+        delete info.buffer;
+        m_cache_size -= info.byteCount;
+        unusedSize -= info.byteCount;
+        if (unusedSize <= m_cache_budget)
+            break;
     }
+    emit cacheSizeChanged();
     //dumpBufferInfo();
 }
 
 void QWaylandTextureSharingExtension::dumpBufferInfo()
 {
-    qDebug() << "shared buffers:" << m_server_buffers.count();
+    qDebug() << "shared buffers:" << m_server_buffers.count() << "cache size" << m_cache_size << "budget" << m_cache_budget;
     for (auto it = m_server_buffers.cbegin(); it != m_server_buffers.cend(); ++it)
-        qDebug() << "    " << it.key() << ":" << it.value().buffer << "in use" << it.value().buffer->bufferInUse() << "usedLocally" << it.value().usedLocally ;
+        qDebug() << "    " << it.key() << ":" << it.value().buffer << "in use" << it.value().buffer->bufferInUse() << "usedLocally" << it.value().usedLocally << "bytes" << it.value().byteCount;
 }
 
 QT_END_NAMESPACE
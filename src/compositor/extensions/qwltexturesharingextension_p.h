@@ -43,13 +43,20 @@
 
 #include "wayland-util.h"
 
+#include <QtCore/QFile>
 #include <QtCore/QMap>
 #include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
 
 #include <QtWaylandCompositor/QWaylandCompositorExtensionTemplate>
 #include <QtWaylandCompositor/QWaylandQuickExtension>
 #include <QtWaylandCompositor/QWaylandCompositor>
 
+#include <QtGui/QImage>
+
 #include <QQuickImageProvider>
 
 #include <QtWaylandCompositor/private/qwaylandcompositor_p.h>
@@ -66,6 +73,28 @@ namespace QtWayland
 
 class QWaylandTextureSharingExtension;
 class SharedTextureImageResponse;
+class SharedTextureDecoder;
+
+// Decoded pixels of an image file, either an uncompressed image or compressed texture data
+struct SharedTextureData
+{
+    QImage image;
+    QByteArray pixelData;
+    QSize size;
+    uint glInternalFormat = GL_NONE;
+    QByteArray storage; // backs pixelData when read from a texture file
+    QSharedPointer<QFile> mappedFile; // the texture cache file the pixels were read from
+    qint64 fileOffset = 0;
+};
+
+// The files of decoded images in QWaylandTextureSharingExtension::cacheDirectory
+class Q_WAYLAND_COMPOSITOR_EXPORT SharedTextureCache
+{
+public:
+    static bool read(const QString &cachePath, SharedTextureData *data);
+    static bool write(const QString &cachePath, const SharedTextureData &data);
+    static void prune(const QString &cacheDir, qint64 maxBytes);
+};
 
 class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandSharedTextureProvider : public QQuickAsyncImageProvider
 {
@@ -86,6 +115,12 @@ class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandTextureSharingExtension
 {
     Q_OBJECT
     Q_PROPERTY(QString imageSearchPath WRITE setImageSearchPath)
+    Q_PROPERTY(QStringList prefetchImages READ prefetchImages WRITE setPrefetchImages NOTIFY prefetchImagesChanged)
+    Q_PROPERTY(QStringList pinnedImages READ pinnedImages WRITE setPinnedImages NOTIFY pinnedImagesChanged)
+    Q_PROPERTY(qint64 cacheBudget READ cacheBudget WRITE setCacheBudget NOTIFY cacheBudgetChanged)
+    Q_PROPERTY(qint64 cacheSize READ cacheSize NOTIFY cacheSizeChanged)
+    Q_PROPERTY(QString cacheDirectory READ cacheDirectory WRITE setCacheDirectory NOTIFY cacheDirectoryChanged)
+    Q_PROPERTY(qint64 cacheDirectoryLimit READ cacheDirectoryLimit WRITE setCacheDirectoryLimit NOTIFY cacheDirectoryLimitChanged)
 public:
     QWaylandTextureSharingExtension();
     QWaylandTextureSharingExtension(QWaylandCompositor *compositor);
@@ -95,19 +130,44 @@ public:
 
     void setImageSearchPath(const QString &path);
 
+    QStringList prefetchImages() const { return m_prefetch_images; }
+    void setPrefetchImages(const QStringList &keys);
+
+    QStringList pinnedImages() const { return m_pinned_images.values(); }
+    void setPinnedImages(const QStringList &keys);
+
+    qint64 cacheBudget() const { return m_cache_budget; }
+    void setCacheBudget(qint64 bytes);
+
+    qint64 cacheSize() const { return m_cache_size; }
+
+    QString cacheDirectory() const { return m_cache_dir; }
+    void setCacheDirectory(const QString &path);
+
+    qint64 cacheDirectoryLimit() const { return m_cache_dir_limit; }
+    void setCacheDirectoryLimit(qint64 bytes);
+
     static QWaylandTextureSharingExtension *self() { return s_self; }
 
 public slots:
     void requestBuffer(const QString &key);
+    void prefetch(const QStringList &keys);
 
 signals:
      void bufferResult(const QString &key, QtWayland::ServerBuffer *buffer);
+     void prefetchImagesChanged();
+     void pinnedImagesChanged();
+     void cacheBudgetChanged();
+     void cacheSizeChanged();
+     void cacheDirectoryChanged();
+     void cacheDirectoryLimitChanged();
 
 protected slots:
     void cleanupBuffers();
 
 protected:
     void zqt_texture_sharing_v1_request_image(Resource *resource, const QString &key) override;
+    void zqt_texture_sharing_v1_request_images(Resource *resource, const QByteArray &keys) override;
     void zqt_texture_sharing_v1_abandon_image(Resource *resource, const QString &key) override;
     void zqt_texture_sharing_v1_destroy_resource(Resource *resource) override;
 
@@ -121,25 +181,51 @@ protected:
     }
 
 private:
-    QtWayland::ServerBuffer *getBuffer(const QString &key);
+    void initCache();
+    bool loadBuffer(const QString &key, QtWayland::ServerBuffer **buffer);
+    void finishLoading(const QString &key, const SharedTextureData &data);
+    void insertBuffer(const QString &key, QtWayland::ServerBuffer *buffer, qint64 byteCount);
+    void provideBuffer(Resource *resource, const QString &key, QtWayland::ServerBuffer *buffer);
+    void scheduleCleanup(int msec);
     bool initServerBufferIntegration();
-    QtWayland::ServerBuffer *getCompressedBuffer(const QString &key);
-    QString getExistingFilePath(const QString &key) const;
     void dumpBufferInfo();
 
     struct BufferInfo
     {
-        BufferInfo(QtWayland::ServerBuffer *b = nullptr) : buffer(b) {}
+        BufferInfo(QtWayland::ServerBuffer *b = nullptr, qint64 bytes = 0) : buffer(b), byteCount(bytes) {}
         QtWayland::ServerBuffer *buffer = nullptr;
+        qint64 byteCount = 0;
+        quint64 lastUsed = 0;
         bool usedLocally = false;
     };
 
+    // An image being decoded, and who is waiting for it
+    struct PendingImage
+    {
+        QVector<Resource *> resources;
+        bool requestedLocally = false;
+    };
+
     QStringList m_image_dirs;
     QStringList m_image_suffixes;
+    QString m_cache_dir;
+    qint64 m_cache_dir_limit = 256 * 1024 * 1024;
     QHash<QString, BufferInfo> m_server_buffers;
+    QHash<QString, PendingImage> m_pending_images;
+    QStringList m_prefetch_images;
+    QSet<QString> m_pinned_images;
+    QSet<QString> m_unrequested_images; // Prefetched, but not requested yet
+    qint64 m_cache_budget = 0;
+    qint64 m_cache_size = 0;
+    quint64 m_use_counter = 0;
+    bool m_initialized = false;
+    QThreadPool m_decode_pool;
+    QTimer m_cleanup_timer;
     QtWayland::ServerBufferIntegration *m_server_buffer_integration = nullptr;
 
     static QWaylandTextureSharingExtension *s_self;
+
+    friend class SharedTextureDecoder;
 };
 
 Q_COMPOSITOR_DECLARE_QUICK_EXTENSION_CLASS(QWaylandTextureSharingExtension)
@@ -5,9 +5,11 @@ WAYLANDSERVERSOURCES += \
 
 HEADERS += \
     hardware_integration/qwlclientbufferintegration_p.h \
+    hardware_integration/qwlhardwarelayerplanner_p.h \
 
 SOURCES += \
     hardware_integration/qwlclientbufferintegration.cpp \
+    hardware_integration/qwlhardwarelayerplanner.cpp \
 
 
 qtConfig(opengl) {
@@ -32,6 +34,14 @@ qtConfig(opengl) {
         hardware_integration/qwlhardwarelayerintegration.cpp \
         hardware_integration/qwlhardwarelayerintegrationfactory.cpp \
         hardware_integration/qwlhardwarelayerintegrationplugin.cpp \
+
+    qtConfig(wayland-compositor-quick) {
+        HEADERS += \
+            hardware_integration/qwlplannedhardwarelayerintegration_p.h \
+
+        SOURCES += \
+            hardware_integration/qwlplannedhardwarelayerintegration.cpp \
+    }
 } else {
     system(echo "Qt-Compositor configured as raster only compositor")
 }
@@ -0,0 +1,263 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qwlhardwarelayerplanner_p.h"
+
+#include <QtCore/QSet>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWayland {
+
+HardwarePlaneBackend::~HardwarePlaneBackend()
+{
+}
+
+static bool isValidConfiguration(const QVector<HardwarePlaneAssignment> &assignments, int maxActivePlanes)
+{
+    if (maxActivePlanes >= 0 && assignments.size() > maxActivePlanes)
+        return false;
+
+    QSet<uint> usedPlanes;
+    for (const auto &assignment : assignments) {
+        if (usedPlanes.contains(assignment.plane.id))
+            return false;
+        if (!HardwareLayerPlanner::fits(assignment.candidate, assignment.plane))
+            return false;
+        usedPlanes.insert(assignment.plane.id);
+    }
+    return true;
+}
+
+bool SimulatedHardwarePlaneBackend::test(const QVector<HardwarePlaneAssignment> &assignments)
+{
+    ++m_testCount;
+    return isValidConfiguration(assignments, m_maxActivePlanes);
+}
+
+bool SimulatedHardwarePlaneBackend::commit(const QVector<HardwarePlaneAssignment> &assignments)
+{
+    if (!isValidConfiguration(assignments, m_maxActivePlanes))
+        return false;
+
+    m_committed = assignments;
+    ++m_commitCount;
+    return true;
+}
+
+bool HardwareLayerPlanner::fits(const HardwareLayerCandidate &candidate, const HardwarePlane &plane)
+{
+    if (!candidate.drmFormat || candidate.transformed)
+        return false;
+
+    if (candidate.bufferSize.isEmpty() || candidate.destination.isEmpty())
+        return false;
+
+    // Negative stacking levels are drawn beneath the scene graph
+    if ((candidate.stackingLevel < 0) != plane.underlay)
+        return false;
+
+    auto format = plane.formats.constFind(candidate.drmFormat);
+    if (format == plane.formats.constEnd())
+        return false;
+
+    if (!format->isEmpty() && candidate.modifier != HardwareLayerCandidate::InvalidModifier
+            && !format->contains(candidate.modifier))
+        return false;
+
+    const qreal scaleX = qreal(candidate.destination.width()) / candidate.bufferSize.width();
+    const qreal scaleY = qreal(candidate.destination.height()) / candidate.bufferSize.height();
+    if (scaleX < plane.minScale || scaleX > plane.maxScale || scaleY < plane.minScale || scaleY > plane.maxScale)
+        return false;
+
+    if (candidate.opacity < 1 && !plane.supportsAlpha)
+        return false;
+
+    return true;
+}
+
+// The number of pixels the GPU no longer has to composite if the candidate is put on a plane
+qint64 HardwareLayerPlanner::score(const HardwareLayerCandidate &candidate, const QRegion &occluded)
+{
+    if (candidate.opacity <= 0)
+        return 0;
+
+    qint64 area = 0;
+    const QRegion visible = QRegion(candidate.destination).subtracted(occluded);
+    for (const QRect &rect : visible)
+        area += qint64(rect.width()) * rect.height();
+    return area;
+}
+
+// Assigns candidates to planes in the same stacking order, such that the sum of the scores is
+// as high as possible. Returns the index of the plane for each candidate, or -1.
+QVector<int> HardwareLayerPlanner::assign(const QVector<HardwareLayerCandidate> &candidates, const QVector<qint64> &scores,
+                                          const QVector<HardwarePlane> &planes, bool underlay) const
+{
+    QVector<int> result(candidates.size(), -1);
+
+    QVector<int> c;
+    for (int i = 0; i < candidates.size(); ++i) {
+        if ((candidates.at(i).stackingLevel < 0) == underlay && scores.at(i) > 0)
+            c.append(i);
+    }
+
+    QVector<int> p;
+    for (int j = 0; j < planes.size(); ++j) {
+        if (planes.at(j).underlay == underlay)
+            p.append(j);
+    }
+
+    const int n = c.size();
+    const int m = p.size();
+    if (n == 0 || m == 0)
+        return result;
+
+    // best[i][j] is the highest score using the first i candidates and the first j planes
+    QVector<qint64> best((n + 1) * (m + 1), 0);
+    auto at = [&best, m](int i, int j) -> qint64 & { return best[i * (m + 1) + j]; };
+
+    for (int i = 1; i <= n; ++i) {
+        for (int j = 1; j <= m; ++j) {
+            qint64 value = qMax(at(i - 1, j), at(i, j - 1));
+            if (fits(candidates.at(c.at(i - 1)), planes.at(p.at(j - 1))))
+                value = qMax(value, at(i - 1, j - 1) + scores.at(c.at(i - 1)));
+            at(i, j) = value;
+        }
+    }
+
+    for (int i = n, j = m; i > 0 && j > 0;) {
+        if (at(i, j) == at(i - 1, j)) {
+            --i;
+        } else if (at(i, j) == at(i, j - 1)) {
+            --j;
+        } else {
+            result[c.at(i - 1)] = p.at(j - 1);
+            --i;
+            --j;
+        }
+    }
+
+    return result;
+}
+
+QVector<HardwarePlaneAssignment> HardwareLayerPlanner::plan(const QVector<HardwareLayerCandidate> &candidates)
+{
+    QVector<HardwarePlaneAssignment> assignments;
+    if (!m_backend || candidates.isEmpty())
+        return assignments;
+
+    QVector<HardwarePlane> planes = m_backend->planes();
+    if (planes.isEmpty())
+        return assignments;
+
+    std::stable_sort(planes.begin(), planes.end(), [](const HardwarePlane &p1, const HardwarePlane &p2) {
+        return p1.zpos < p2.zpos;
+    });
+
+    QVector<HardwareLayerCandidate> sorted = candidates;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const HardwareLayerCandidate &c1, const HardwareLayerCandidate &c2) {
+        return c1.stackingLevel < c2.stackingLevel;
+    });
+
+    const int count = sorted.size();
+    QVector<qint64> scores(count);
+    QRegion occluded;
+    for (int i = count - 1; i >= 0; --i) {
+        const HardwareLayerCandidate &candidate = sorted.at(i);
+        if (m_outputRect.isEmpty() || m_outputRect.contains(candidate.destination))
+            scores[i] = score(candidate, occluded);
+        if (candidate.opaque && candidate.opacity >= 1)
+            occluded += candidate.destination;
+    }
+
+    // Every round either finds a configuration or gives up on at least one candidate
+    for (int round = 0; round <= count; ++round) {
+        const QVector<int> underlays = assign(sorted, scores, planes, true);
+        QVector<int> planeFor = assign(sorted, scores, planes, false);
+        for (int i = 0; i < count; ++i) {
+            if (underlays.at(i) != -1)
+                planeFor[i] = underlays.at(i);
+        }
+
+        // Candidates left to the GPU end up in the scene graph, which is above all underlays and
+        // beneath all overlays. Whatever they overlap in the wrong order has to go there too.
+        bool demoted = false;
+        QRegion composited;
+        for (int i = count - 1; i >= 0 && sorted.at(i).stackingLevel >= 0; --i) {
+            if (planeFor.at(i) != -1 && composited.intersects(sorted.at(i).destination)) {
+                planeFor[i] = -1;
+                scores[i] = 0;
+                demoted = true;
+            }
+            if (planeFor.at(i) == -1)
+                composited += sorted.at(i).destination;
+        }
+        composited = QRegion();
+        for (int i = 0; i < count && sorted.at(i).stackingLevel < 0; ++i) {
+            if (planeFor.at(i) != -1 && composited.intersects(sorted.at(i).destination)) {
+                planeFor[i] = -1;
+                scores[i] = 0;
+                demoted = true;
+            }
+            if (planeFor.at(i) == -1)
+                composited += sorted.at(i).destination;
+        }
+
+        // The planes freed up may be of use to others
+        if (demoted)
+            continue;
+
+        assignments.clear();
+        int leastValuable = -1;
+        for (int i = 0; i < count; ++i) {
+            if (planeFor.at(i) == -1)
+                continue;
+            assignments.append({sorted.at(i), planes.at(planeFor.at(i))});
+            if (leastValuable == -1 || scores.at(i) < scores.at(leastValuable))
+                leastValuable = i;
+        }
+
+        if (assignments.isEmpty() || m_backend->test(assignments))
+            return assignments;
+
+        // The hardware has further limits, e.g. on bandwidth. Leave the least valuable candidate
+        // to the GPU and try again.
+        scores[leastValuable] = 0;
+    }
+
+    return QVector<HardwarePlaneAssignment>();
+}
+
+} // namespace QtWayland
+
+QT_END_NAMESPACE
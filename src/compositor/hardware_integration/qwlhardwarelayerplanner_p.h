@@ -0,0 +1,158 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QWLHARDWARELAYERPLANNER_P_H
+#define QWLHARDWARELAYERPLANNER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtWaylandCompositor/qtwaylandcompositorglobal.h>
+#include <QtWaylandCompositor/QWaylandBufferRef>
+
+#include <QtCore/QHash>
+#include <QtCore/QRect>
+#include <QtCore/QVector>
+#include <QtGui/QRegion>
+
+QT_BEGIN_NAMESPACE
+
+class QWaylandQuickHardwareLayer;
+
+namespace QtWayland {
+
+// A display controller plane that a hardware layer may be shown on
+struct HardwarePlane
+{
+    uint id = 0;
+    int zpos = 0; // planes with a higher zpos are shown on top
+    bool underlay = false; // shown beneath the plane the scene graph is rendered to
+    QHash<uint32_t, QVector<uint64_t>> formats; // key=DRM format, value=DRM modifiers, empty if unknown
+    qreal minScale = 1;
+    qreal maxScale = 1;
+    bool supportsAlpha = false; // can blend the whole plane with a constant alpha
+};
+
+// A hardware layer as it would be shown in the current frame
+struct HardwareLayerCandidate
+{
+    static const uint64_t InvalidModifier = 0x00ffffffffffffffULL; // DRM_FORMAT_MOD_INVALID
+
+    QWaylandQuickHardwareLayer *layer = nullptr;
+    QWaylandBufferRef buffer;
+    uint32_t drmFormat = 0; // 0 if the buffer can't be scanned out
+    uint64_t modifier = InvalidModifier;
+    QSize bufferSize;
+    QRect destination; // in output coordinates
+    qreal opacity = 1;
+    bool opaque = false; // covers everything beneath it when fully opaque
+    bool transformed = false; // rotated, mirrored or otherwise not a plain scale
+    int stackingLevel = 0;
+};
+
+struct HardwarePlaneAssignment
+{
+    HardwareLayerCandidate candidate;
+    HardwarePlane plane;
+};
+
+class Q_WAYLAND_COMPOSITOR_EXPORT HardwarePlaneBackend
+{
+public:
+    virtual ~HardwarePlaneBackend();
+
+    virtual QVector<HardwarePlane> planes() const = 0;
+    // Whether the hardware can show this configuration, without changing what is shown
+    virtual bool test(const QVector<HardwarePlaneAssignment> &assignments) = 0;
+    // Shows the configuration with the next frame, planes not in it are disabled
+    virtual bool commit(const QVector<HardwarePlaneAssignment> &assignments) = 0;
+    // How many swapped frames it takes until a committed configuration is on screen. The buffers
+    // of the configuration it replaced are only given back to their clients after that.
+    virtual int commitLatency() const { return 1; }
+};
+
+// Records what would have been shown, for testing the planner without display hardware
+class Q_WAYLAND_COMPOSITOR_EXPORT SimulatedHardwarePlaneBackend : public HardwarePlaneBackend
+{
+public:
+    void setPlanes(const QVector<HardwarePlane> &planes) { m_planes = planes; }
+    void setMaxActivePlanes(int count) { m_maxActivePlanes = count; }
+
+    QVector<HardwarePlane> planes() const override { return m_planes; }
+    bool test(const QVector<HardwarePlaneAssignment> &assignments) override;
+    bool commit(const QVector<HardwarePlaneAssignment> &assignments) override;
+
+    QVector<HardwarePlaneAssignment> committed() const { return m_committed; }
+    int testCount() const { return m_testCount; }
+    int commitCount() const { return m_commitCount; }
+
+private:
+    QVector<HardwarePlane> m_planes;
+    QVector<HardwarePlaneAssignment> m_committed;
+    int m_maxActivePlanes = -1; // e.g. memory bandwidth limits, -1 for no limit
+    int m_testCount = 0;
+    int m_commitCount = 0;
+};
+
+class Q_WAYLAND_COMPOSITOR_EXPORT HardwareLayerPlanner
+{
+public:
+    explicit HardwareLayerPlanner(HardwarePlaneBackend *backend) : m_backend(backend) {}
+
+    void setOutputRect(const QRect &rect) { m_outputRect = rect; }
+    QRect outputRect() const { return m_outputRect; }
+
+    // Candidates that are not assigned to a plane must be composited by the GPU
+    QVector<HardwarePlaneAssignment> plan(const QVector<HardwareLayerCandidate> &candidates);
+
+    static bool fits(const HardwareLayerCandidate &candidate, const HardwarePlane &plane);
+    static qint64 score(const HardwareLayerCandidate &candidate, const QRegion &occluded);
+
+private:
+    QVector<int> assign(const QVector<HardwareLayerCandidate> &candidates, const QVector<qint64> &scores,
+                        const QVector<HardwarePlane> &planes, bool underlay) const;
+
+    HardwarePlaneBackend *m_backend = nullptr;
+    QRect m_outputRect;
+};
+
+} // namespace QtWayland
+
+QT_END_NAMESPACE
+
+#endif // QWLHARDWARELAYERPLANNER_P_H
@@ -0,0 +1,279 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qwlplannedhardwarelayerintegration_p.h"
+
+#include <QtWaylandCompositor/QWaylandCompositor>
+#include <QtWaylandCompositor/QWaylandQuickItem>
+#include <QtWaylandCompositor/private/qwaylandquickhardwarelayer_p.h>
+#include <QtWaylandCompositor/private/qwaylandsurface_p.h>
+#include <QtWaylandCompositor/private/qwaylandview_p.h>
+#include <QtWaylandCompositor/private/qwlbuffermanager_p.h>
+#include <QtWaylandCompositor/private/qwlclientbuffer_p.h>
+
+#include <QtQuick/QQuickWindow>
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWayland {
+
+static void setCandidateBuffer(HardwareLayerCandidate *candidate, const QWaylandBufferRef &buffer, QWaylandSurface *surface)
+{
+    candidate->buffer = buffer;
+    candidate->drmFormat = 0;
+
+    DmabufAttributes attributes;
+    ClientBuffer *clientBuffer = BufferManager::findBuffer(buffer.wl_buffer());
+    if (!clientBuffer || !clientBuffer->dmabufAttributes(&attributes))
+        return;
+
+    candidate->drmFormat = attributes.drmFormat;
+    candidate->modifier = attributes.modifier;
+    candidate->bufferSize = attributes.size;
+
+    // Planes show the whole buffer, top-down
+    if (buffer.origin() == QWaylandSurface::OriginBottomLeft)
+        candidate->transformed = true;
+    if (surface->sourceGeometry() != QRectF(QPointF(), attributes.size))
+        candidate->transformed = true;
+
+    const QRegion &opaqueRegion = QWaylandSurfacePrivate::get(surface)->opaqueRegion;
+    candidate->opaque = buffer.bufferFormatEgl() != QWaylandBufferRef::BufferFormatEgl_RGBA
+            || opaqueRegion.contains(QRect(QPoint(), surface->destinationSize()));
+}
+
+PlannedHardwareLayerIntegration::PlannedHardwareLayerIntegration(HardwarePlaneBackend *backend, QObject *parent)
+    : HardwareLayerIntegration(parent)
+    , m_backend(backend)
+    , m_planner(backend)
+{
+}
+
+PlannedHardwareLayerIntegration::~PlannedHardwareLayerIntegration()
+{
+    for (Layer &layer : m_layers)
+        setOnPlane(layer, false);
+}
+
+void PlannedHardwareLayerIntegration::add(QWaylandQuickHardwareLayer *hwLayer)
+{
+    Layer layer;
+    layer.layer = hwLayer;
+    layer.item = hwLayer->waylandItem();
+    m_layers.append(layer);
+
+    connect(hwLayer->waylandItem(), &QQuickItem::windowChanged, hwLayer, [this](QQuickWindow *window) {
+        watchWindow(window);
+    });
+    watchWindow(hwLayer->waylandItem()->window());
+
+    if (m_window)
+        m_window->update();
+}
+
+void PlannedHardwareLayerIntegration::remove(QWaylandQuickHardwareLayer *hwLayer)
+{
+    for (auto it = m_layers.begin(); it != m_layers.end(); ++it) {
+        if (it->layer == hwLayer) {
+            setOnPlane(*it, false);
+            m_layers.erase(it);
+            break;
+        }
+    }
+
+    for (auto it = m_assignments.begin(); it != m_assignments.end();) {
+        if (it->candidate.layer == hwLayer)
+            it = m_assignments.erase(it);
+        else
+            ++it;
+    }
+
+    // Have the plane disabled with the next frame
+    if (m_window)
+        m_window->update();
+}
+
+bool PlannedHardwareLayerIntegration::isOnPlane(QWaylandQuickHardwareLayer *hwLayer) const
+{
+    for (const Layer &layer : m_layers) {
+        if (layer.layer == hwLayer)
+            return layer.onPlane;
+    }
+    return false;
+}
+
+void PlannedHardwareLayerIntegration::watchWindow(QQuickWindow *window)
+{
+    // The planes of the backend belong to a single output
+    if (!window || m_window)
+        return;
+
+    m_window = window;
+    connect(window, &QQuickWindow::afterAnimating, this, &PlannedHardwareLayerIntegration::updatePlanes);
+    connect(window, &QQuickWindow::afterSynchronizing, this, &PlannedHardwareLayerIntegration::commitPlanes, Qt::DirectConnection);
+    connect(window, &QQuickWindow::frameSwapped, this, &PlannedHardwareLayerIntegration::retireBuffers, Qt::DirectConnection);
+    connect(window, &QQuickWindow::frameSwapped, this, &PlannedHardwareLayerIntegration::sendFrameCallbacks, Qt::QueuedConnection);
+}
+
+HardwareLayerCandidate PlannedHardwareLayerIntegration::candidate(const Layer &layer) const
+{
+    HardwareLayerCandidate candidate;
+    candidate.layer = layer.layer;
+    candidate.stackingLevel = layer.layer->stackingLevel();
+
+    QWaylandQuickItem *item = layer.item;
+    if (!item || item->window() != m_window || !item->isVisible() || !item->surface())
+        return candidate;
+
+    for (QQuickItem *i = item; i; i = i->parentItem())
+        candidate.opacity *= i->opacity();
+
+    const qreal dpr = m_window->effectiveDevicePixelRatio();
+    const QPoint topLeft = (item->mapToScene(QPointF(0, 0)) * dpr).toPoint();
+    const QPoint topRight = (item->mapToScene(QPointF(item->width(), 0)) * dpr).toPoint();
+    const QPoint bottomRight = (item->mapToScene(QPointF(item->width(), item->height())) * dpr).toPoint();
+    candidate.destination = QRect(topLeft, bottomRight - QPoint(1, 1));
+    candidate.transformed = topLeft.y() != topRight.y() || topRight.x() != bottomRight.x()
+            || candidate.destination.isEmpty();
+
+    // Planes are not clipped by the scene graph
+    for (QQuickItem *i = item->parentItem(); i; i = i->parentItem()) {
+        if (i->clip()) {
+            const QRectF clipRect = i->mapRectToScene(i->clipRect());
+            if (!QRectF(clipRect.topLeft() * dpr, clipRect.size() * dpr).toAlignedRect().contains(candidate.destination))
+                candidate.transformed = true;
+        }
+    }
+
+    setCandidateBuffer(&candidate, item->view()->currentBuffer(), item->surface());
+    return candidate;
+}
+
+void PlannedHardwareLayerIntegration::setOnPlane(Layer &layer, bool onPlane)
+{
+    if (layer.onPlane == onPlane)
+        return;
+
+    layer.onPlane = onPlane;
+    if (!layer.item)
+        return;
+
+    layer.item->setPaintEnabled(!onPlane);
+    QWaylandViewPrivate::get(layer.item->view())->independentFrameCallback = onPlane;
+}
+
+void PlannedHardwareLayerIntegration::updatePlanes()
+{
+    if (!m_window)
+        return;
+
+    QVector<HardwareLayerCandidate> candidates;
+    candidates.reserve(m_layers.size());
+    for (const Layer &layer : qAsConst(m_layers))
+        candidates.append(candidate(layer));
+
+    const QSize outputSize = m_window->size() * m_window->effectiveDevicePixelRatio();
+    m_planner.setOutputRect(QRect(QPoint(), outputSize));
+    m_assignments = m_planner.plan(candidates);
+
+    for (Layer &layer : m_layers) {
+        bool onPlane = false;
+        for (const HardwarePlaneAssignment &assignment : qAsConst(m_assignments))
+            onPlane |= assignment.candidate.layer == layer.layer;
+        setOnPlane(layer, onPlane);
+        if (onPlane)
+            layer.item->surface()->frameStarted();
+    }
+
+    qCDebug(qLcWaylandCompositorHardwareIntegration) << "Showing" << m_assignments.size()
+            << "of" << m_layers.size() << "hardware layers on planes";
+}
+
+void PlannedHardwareLayerIntegration::commitPlanes()
+{
+    if (m_assignments.isEmpty() && !m_committed)
+        return;
+
+    // The scene graph has just taken the buffers that will be shown with this frame
+    for (auto it = m_assignments.begin(); it != m_assignments.end();) {
+        QWaylandQuickItem *item = it->candidate.layer->waylandItem();
+        setCandidateBuffer(&it->candidate, item->view()->currentBuffer(), item->surface());
+        if (HardwareLayerPlanner::fits(it->candidate, it->plane)) {
+            ++it;
+        } else {
+            // Changed beyond what the plane can do, it is planned again for the next frame
+            it = m_assignments.erase(it);
+            QMetaObject::invokeMethod(m_window, "update", Qt::QueuedConnection);
+        }
+    }
+
+    if (!m_backend->commit(m_assignments)) {
+        // What is on the planes stays there, and keeps its buffers, until the next frame tries again
+        qCDebug(qLcWaylandCompositorHardwareIntegration) << "Failed to commit hardware layer planes";
+        QMetaObject::invokeMethod(m_window, "update", Qt::QueuedConnection);
+        return;
+    }
+    m_committed = !m_assignments.isEmpty();
+
+    CommittedBuffers committed;
+    for (const HardwarePlaneAssignment &assignment : qAsConst(m_assignments))
+        committed.buffers.append(assignment.candidate.buffer);
+    m_committedBuffers.append(committed);
+}
+
+void PlannedHardwareLayerIntegration::retireBuffers()
+{
+    for (CommittedBuffers &committed : m_committedBuffers)
+        ++committed.framesSwapped;
+
+    // A configuration is off the screen once the one committed after it is on the screen
+    QMutexLocker locker(&m_retiredMutex);
+    while (m_committedBuffers.size() > 1 && m_committedBuffers.at(1).framesSwapped >= m_backend->commitLatency())
+        m_retiredBuffers += m_committedBuffers.takeFirst().buffers;
+}
+
+void PlannedHardwareLayerIntegration::sendFrameCallbacks()
+{
+    // Dropping the references releases the buffers to their clients
+    QVector<QWaylandBufferRef> retired;
+    {
+        QMutexLocker locker(&m_retiredMutex);
+        retired.swap(m_retiredBuffers);
+    }
+
+    for (const Layer &layer : qAsConst(m_layers)) {
+        if (layer.onPlane && layer.item && layer.item->surface())
+            layer.item->surface()->sendFrameCallbacks();
+    }
+}
+
+} // namespace QtWayland
+
+QT_END_NAMESPACE
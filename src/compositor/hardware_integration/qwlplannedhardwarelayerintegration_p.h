@@ -0,0 +1,118 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QWLPLANNEDHARDWARELAYERINTEGRATION_P_H
+#define QWLPLANNEDHARDWARELAYERINTEGRATION_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtWaylandCompositor/private/qwlhardwarelayerintegration_p.h>
+#include <QtWaylandCompositor/private/qwlhardwarelayerplanner_p.h>
+
+#include <QtCore/QMutex>
+#include <QtCore/QPointer>
+#include <QtCore/QScopedPointer>
+
+QT_BEGIN_NAMESPACE
+
+class QQuickWindow;
+class QWaylandQuickItem;
+
+namespace QtWayland {
+
+// Puts hardware layers on the planes of a backend, as far as they fit, and lets the scene graph
+// draw the rest. Planning happens on the GUI thread before each frame, the planes are committed
+// on the render thread while it is synchronizing with the GUI thread.
+class Q_WAYLAND_COMPOSITOR_EXPORT PlannedHardwareLayerIntegration : public HardwareLayerIntegration
+{
+    Q_OBJECT
+public:
+    explicit PlannedHardwareLayerIntegration(HardwarePlaneBackend *backend, QObject *parent = nullptr);
+    ~PlannedHardwareLayerIntegration() override;
+
+    void add(QWaylandQuickHardwareLayer *layer) override;
+    void remove(QWaylandQuickHardwareLayer *layer) override;
+
+    HardwarePlaneBackend *backend() const { return m_backend.data(); }
+    QQuickWindow *window() const { return m_window; }
+    bool isOnPlane(QWaylandQuickHardwareLayer *layer) const;
+
+    void updatePlanes();
+    void commitPlanes();
+
+private:
+    struct Layer
+    {
+        QWaylandQuickHardwareLayer *layer = nullptr;
+        QPointer<QWaylandQuickItem> item;
+        bool onPlane = false;
+    };
+
+    HardwareLayerCandidate candidate(const Layer &layer) const;
+    void setOnPlane(Layer &layer, bool onPlane);
+    void watchWindow(QQuickWindow *window);
+    void retireBuffers();
+    void sendFrameCallbacks();
+
+    QScopedPointer<HardwarePlaneBackend> m_backend;
+    HardwareLayerPlanner m_planner;
+    QVector<Layer> m_layers;
+    QPointer<QQuickWindow> m_window;
+    // Written on the GUI thread, read on the render thread while the GUI thread is blocked
+    QVector<HardwarePlaneAssignment> m_assignments;
+    bool m_committed = false;
+
+    // The buffers of each committed configuration, referenced until the display no longer
+    // scans them out. Only used on the render thread.
+    struct CommittedBuffers
+    {
+        QVector<QWaylandBufferRef> buffers;
+        int framesSwapped = 0;
+    };
+    QVector<CommittedBuffers> m_committedBuffers;
+    // Handed to the GUI thread, where the clients are told they can reuse them
+    QMutex m_retiredMutex;
+    QVector<QWaylandBufferRef> m_retiredBuffers;
+};
+
+} // namespace QtWayland
+
+QT_END_NAMESPACE
+
+#endif // QWLPLANNEDHARDWARELAYERINTEGRATION_P_H
@@ -104,6 +104,16 @@ public:
         Q_UNUSED(glInternalFormat);
         return nullptr;
     }
+    // Reads the pixels straight from the file, sparing the copy through a QImage where supported
+    virtual ServerBuffer *createServerBufferFromFile(int fd, qint64 offset, const QSize &size, int bytesPerLine, ServerBuffer::Format format)
+    {
+        Q_UNUSED(fd);
+        Q_UNUSED(offset);
+        Q_UNUSED(size);
+        Q_UNUSED(bytesPerLine);
+        Q_UNUSED(format);
+        return nullptr;
+    }
 };
 
 }
@@ -33,6 +33,8 @@
 #include <QtWaylandCompositor/private/qwlclientbufferintegration_p.h>
 #include <QDebug>
 
+#include <string.h>
+
 QT_BEGIN_NAMESPACE
 
 namespace QtWayland {
@@ -41,63 +43,152 @@ BufferManager::BufferManager(QWaylandCompositor *compositor)
     : QObject(compositor)
     , m_compositor(compositor)
 {
-
+#if WAYLAND_VERSION_MAJOR >= 1 && (WAYLAND_VERSION_MAJOR != 1 || WAYLAND_VERSION_MINOR >= 14)
+    m_shmLogger = wl_display_add_protocol_logger(QWaylandCompositorPrivate::get(compositor)->display, logRequest, this);
+#endif
 }
 
-struct buffer_manager_destroy_listener : wl_listener
+BufferManager::~BufferManager()
 {
-    buffer_manager_destroy_listener()
-    {
-        notify = BufferManager::destroy_listener_callback;
-        wl_list_init(&this->link);
+#if WAYLAND_VERSION_MAJOR >= 1 && (WAYLAND_VERSION_MAJOR != 1 || WAYLAND_VERSION_MINOR >= 14)
+    if (m_shmLogger)
+        wl_protocol_logger_destroy(m_shmLogger);
+#endif
+    for (ShmClient *shmClient : qAsConst(m_shmClients)) {
+        wl_list_remove(&shmClient->destroyListener.link);
+        delete shmClient;
     }
-
-    BufferManager *d = nullptr;
-};
+}
 
 ClientBuffer *BufferManager::getBuffer(wl_resource *buffer_resource)
 {
     if (!buffer_resource)
         return nullptr;
 
-    auto it = m_buffers.find(buffer_resource);
-    if (it != m_buffers.end())
-        return it.value();
+    if (ClientBuffer *buffer = findBuffer(buffer_resource))
+        return buffer;
 
     auto bufferIntegration = QWaylandCompositorPrivate::get(m_compositor)->clientBufferIntegration();
     ClientBuffer *newBuffer = nullptr;
     if (bufferIntegration)
         newBuffer = bufferIntegration->createBufferFor(buffer_resource);
     if (!newBuffer)
-        newBuffer = new SharedMemoryBuffer(buffer_resource);
-    m_buffers[buffer_resource] = newBuffer;
+        newBuffer = new SharedMemoryBuffer(buffer_resource, shmBufferBytes(buffer_resource));
 
-    auto *destroy_listener = new buffer_manager_destroy_listener;
-    destroy_listener->d = this;
-    wl_resource_add_destroy_listener(buffer_resource, destroy_listener);
+    newBuffer->setResourceUsage(QWaylandClientPrivate::get(
+            QWaylandClient::fromWlClient(m_compositor, wl_resource_get_client(buffer_resource)))->usage.data());
+
+    ClientBuffer::DestroyListener *destroy_listener = &newBuffer->m_destroyListener;
+    destroy_listener->buffer = newBuffer;
+    destroy_listener->listener.notify = destroy_listener_callback;
+    wl_resource_add_destroy_listener(buffer_resource, &destroy_listener->listener);
     return newBuffer;
 }
 
+// Returns the buffer if one has been created for the wl_buffer already
+ClientBuffer *BufferManager::findBuffer(wl_resource *buffer_resource)
+{
+    if (!buffer_resource)
+        return nullptr;
+
+    // Known buffers are found through the destroy listener embedded in them, so there is no
+    // lookup table to maintain and nothing else to allocate per wl_buffer.
+    ClientBuffer::DestroyListener *destroy_listener = nullptr;
+    if (wl_listener *listener = wl_resource_get_destroy_listener(buffer_resource, destroy_listener_callback)) {
+        destroy_listener = wl_container_of(listener, destroy_listener, listener);
+        return destroy_listener->buffer;
+    }
+    return nullptr;
+}
 
 void BufferManager::destroy_listener_callback(wl_listener *listener, void *data)
 {
-    buffer_manager_destroy_listener *destroy_listener = static_cast<buffer_manager_destroy_listener *>(listener);
-    BufferManager *self = destroy_listener->d;
-    struct ::wl_resource *buffer = static_cast<struct ::wl_resource *>(data);
+    Q_UNUSED(data);
+    ClientBuffer::DestroyListener *destroy_listener = nullptr;
+    destroy_listener = wl_container_of(listener, destroy_listener, listener);
+
+    wl_list_remove(&destroy_listener->listener.link);
+    wl_list_init(&destroy_listener->listener.link);
+
+    Q_ASSERT(destroy_listener->buffer);
+    destroy_listener->buffer->setDestroyed();
+}
+
+// Returns true if shmBufferBytes() knows how much of their pool the wl_shm buffers can use
+bool BufferManager::tracksShmPools() const
+{
+#if WAYLAND_VERSION_MAJOR >= 1 && (WAYLAND_VERSION_MAJOR != 1 || WAYLAND_VERSION_MINOR >= 14)
+    return m_shmLogger;
+#else
+    return false;
+#endif
+}
 
-    wl_list_remove(&destroy_listener->link);
-    delete destroy_listener;
+// Returns the number of bytes of its pool that a wl_shm buffer can use from its data pointer,
+// or -1 if that is not known
+qint64 BufferManager::shmBufferBytes(wl_resource *buffer_resource) const
+{
+    const ShmClient *shmClient = m_shmClients.value(wl_resource_get_client(buffer_resource));
+    if (!shmClient)
+        return -1;
+    return shmClient->bufferBytes.value(wl_resource_get_id(buffer_resource), -1);
+}
+
+void BufferManager::shmClientDestroyed(wl_listener *listener, void *data)
+{
+    Q_UNUSED(data);
+    ShmClient *shmClient = wl_container_of(listener, shmClient, destroyListener);
+    wl_list_remove(&shmClient->destroyListener.link);
+    shmClient->manager->m_shmClients.remove(shmClient->client);
+    delete shmClient;
+}
 
-    Q_ASSERT(self);
-    Q_ASSERT(buffer);
+#if WAYLAND_VERSION_MAJOR >= 1 && (WAYLAND_VERSION_MAJOR != 1 || WAYLAND_VERSION_MINOR >= 14)
+// Requests are logged before they are handled, so the sizes are known by the time the
+// buffers are used. Pools can only grow, so the size a buffer was created with stays valid.
+void BufferManager::logRequest(void *data, wl_protocol_logger_type type, const wl_protocol_logger_message *message)
+{
+    if (type != WL_PROTOCOL_LOGGER_REQUEST)
+        return;
 
-    ClientBuffer *clientBuffer = self->m_buffers.take(buffer);
+    enum { ShmCreatePool = 0, ShmPoolCreateBuffer = 0, ShmPoolResize = 2 };
+    const int opcode = message->message_opcode;
+    if (opcode != ShmCreatePool && opcode != ShmPoolResize)
+        return;
 
-    if (!clientBuffer)
+    const char *interfaceName = wl_resource_get_class(message->resource);
+    const bool isShm = strcmp(interfaceName, "wl_shm") == 0;
+    if (!isShm && strcmp(interfaceName, "wl_shm_pool") != 0)
         return;
 
-    clientBuffer->setDestroyed();
+    auto *manager = static_cast<BufferManager *>(data);
+    wl_client *client = wl_resource_get_client(message->resource);
+    ShmClient *shmClient = manager->m_shmClients.value(client);
+    if (!shmClient) {
+        shmClient = new ShmClient;
+        shmClient->manager = manager;
+        shmClient->client = client;
+        shmClient->destroyListener.notify = shmClientDestroyed;
+        wl_client_add_destroy_listener(client, &shmClient->destroyListener);
+        manager->m_shmClients.insert(client, shmClient);
+    }
+
+    const wl_argument *args = message->arguments;
+    const quint32 id = wl_resource_get_id(message->resource);
+    if (isShm) {
+        // create_pool(id, fd, size)
+        shmClient->poolSizes.insert(args[0].n, args[2].i);
+    } else if (opcode == ShmPoolCreateBuffer) {
+        // create_buffer(id, offset, width, height, stride, format)
+        const qint64 poolSize = shmClient->poolSizes.value(id, -1);
+        const int offset = args[1].i;
+        shmClient->bufferBytes.insert(args[0].n, poolSize >= 0 && offset >= 0 && offset <= poolSize ? poolSize - offset : -1);
+    } else {
+        // resize(size)
+        shmClient->poolSizes.insert(id, args[0].i);
+    }
 }
+#endif
 
 }
 QT_END_NAMESPACE
@@ -41,6 +41,7 @@
 // We mean it.
 //
 
+#include <QtCore/QHash>
 #include <QtCore/QObject>
 #include "qwlclientbuffer_p.h"
 QT_BEGIN_NAMESPACE
@@ -55,13 +56,35 @@ class Q_WAYLAND_COMPOSITOR_EXPORT BufferManager : public QObject
 {
 public:
     BufferManager(QWaylandCompositor *compositor);
+    ~BufferManager() override;
     ClientBuffer *getBuffer(struct ::wl_resource *buffer_resource);
+    static ClientBuffer *findBuffer(struct ::wl_resource *buffer_resource);
+
+    bool tracksShmPools() const;
+    qint64 shmBufferBytes(struct ::wl_resource *buffer_resource) const;
+
 private:
-    friend struct buffer_manager_destroy_listener;
     static void destroy_listener_callback(wl_listener *listener, void *data);
 
-    QHash<struct ::wl_resource *, ClientBuffer*> m_buffers;
+    // libwayland only checks that wl_shm buffers fit their pool as far as stride * height
+    // goes, and has no API to get the size of a pool, so the requests that set it are
+    // followed through the protocol logger.
+    struct ShmClient {
+        wl_listener destroyListener;
+        BufferManager *manager = nullptr;
+        wl_client *client = nullptr;
+        QHash<quint32, qint64> poolSizes; // By wl_shm_pool id
+        QHash<quint32, qint64> bufferBytes; // By wl_buffer id, from the buffer's offset
+    };
+
+    static void shmClientDestroyed(wl_listener *listener, void *data);
+#if WAYLAND_VERSION_MAJOR >= 1 && (WAYLAND_VERSION_MAJOR != 1 || WAYLAND_VERSION_MINOR >= 14)
+    static void logRequest(void *data, wl_protocol_logger_type type, const wl_protocol_logger_message *message);
+    wl_protocol_logger *m_shmLogger = nullptr;
+#endif
+
     QWaylandCompositor *m_compositor = nullptr;
+    QHash<wl_client *, ShmClient *> m_shmClients;
 };
 
 }
@@ -32,10 +32,13 @@
 #if QT_CONFIG(opengl)
 #include "hardware_integration/qwlclientbufferintegration_p.h"
 #include <qpa/qplatformopenglcontext.h>
+#include <QOpenGLContext>
 #include <QOpenGLTexture>
 #endif
 
 #include <QtCore/QDebug>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
 
 #include <QtWaylandCompositor/private/wayland-wayland-server-protocol.h>
 #include "qwaylandsharedmemoryformathelper_p.h"
@@ -46,9 +49,89 @@ QT_BEGIN_NAMESPACE
 
 namespace QtWayland {
 
+// A ClientBuffer comes and goes with every wl_buffer, and clients that allocate a buffer per
+// frame would otherwise keep the general purpose allocator busy on the compositor thread.
+// Buffers are carved out of slabs instead, and recycled through a free list per size class.
+// Buffers can be released from the render thread, hence the lock.
+class ClientBufferPool
+{
+public:
+    enum {
+        Granularity = 16,
+        SizeClasses = 32, // Objects up to 496 bytes are pooled
+        SlabObjects = 32
+    };
+
+    ~ClientBufferPool()
+    {
+        for (char *slab : qAsConst(m_slabs))
+            ::operator delete(slab);
+    }
+
+    static bool isPooled(std::size_t size) { return sizeClass(size) < SizeClasses; }
+
+    void *allocate(std::size_t size)
+    {
+        const std::size_t index = sizeClass(size);
+        QMutexLocker locker(&m_mutex);
+        FreeBlock *&freeList = m_freeLists[index];
+        if (!freeList) {
+            const std::size_t blockSize = index * Granularity;
+            char *slab = static_cast<char *>(::operator new(blockSize * SlabObjects));
+            m_slabs.append(slab);
+            for (int i = SlabObjects - 1; i >= 0; --i) {
+                auto *block = reinterpret_cast<FreeBlock *>(slab + i * blockSize);
+                block->next = freeList;
+                freeList = block;
+            }
+        }
+        FreeBlock *block = freeList;
+        freeList = block->next;
+        return block;
+    }
+
+    void release(void *ptr, std::size_t size)
+    {
+        auto *block = static_cast<FreeBlock *>(ptr);
+        QMutexLocker locker(&m_mutex);
+        FreeBlock *&freeList = m_freeLists[sizeClass(size)];
+        block->next = freeList;
+        freeList = block;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    static std::size_t sizeClass(std::size_t size) { return (size + Granularity - 1) / Granularity; }
+
+    QBasicMutex m_mutex;
+    FreeBlock *m_freeLists[SizeClasses] = {};
+    QVector<char *> m_slabs;
+};
+
+Q_GLOBAL_STATIC(ClientBufferPool, clientBufferPool)
+
+void *ClientBuffer::operator new(std::size_t size)
+{
+    if (!ClientBufferPool::isPooled(size))
+        return ::operator new(size);
+    return clientBufferPool()->allocate(size);
+}
+
+void ClientBuffer::operator delete(void *ptr, std::size_t size)
+{
+    if (!ClientBufferPool::isPooled(size))
+        ::operator delete(ptr);
+    else if (!clientBufferPool.isDestroyed()) // Otherwise the slabs are gone already
+        clientBufferPool()->release(ptr, size);
+}
+
 ClientBuffer::ClientBuffer(struct ::wl_resource *buffer)
     : m_buffer(buffer)
 {
+    wl_list_init(&m_destroyListener.listener.link);
 }
 
 
@@ -56,6 +139,46 @@ ClientBuffer::~ClientBuffer()
 {
     if (m_buffer && m_committed && !m_destroyed)
         sendRelease();
+    wl_list_remove(&m_destroyListener.listener.link);
+
+    if (m_resourceUsage) {
+        m_resourceUsage->addSharedMemory(-m_accounted.sharedMemoryBytes);
+        m_resourceUsage->addTextures(-m_accounted.textureCount, -m_accounted.textureBytes);
+        m_resourceUsage->addEglImages(-m_accounted.eglImageCount);
+    }
+}
+
+void ClientBuffer::setResourceUsage(ClientResourceUsage *usage)
+{
+    Q_ASSERT(!m_resourceUsage);
+    m_resourceUsage = usage;
+    if (m_resourceUsage) {
+        m_resourceUsage->addSharedMemory(m_accounted.sharedMemoryBytes);
+        m_resourceUsage->addTextures(m_accounted.textureCount, m_accounted.textureBytes);
+        m_resourceUsage->addEglImages(m_accounted.eglImageCount);
+    }
+}
+
+void ClientBuffer::accountSharedMemory(qint64 bytes)
+{
+    m_accounted.sharedMemoryBytes += bytes;
+    if (m_resourceUsage)
+        m_resourceUsage->addSharedMemory(bytes);
+}
+
+void ClientBuffer::accountTextures(int count, qint64 bytes)
+{
+    m_accounted.textureCount += count;
+    m_accounted.textureBytes += bytes;
+    if (m_resourceUsage)
+        m_resourceUsage->addTextures(count, bytes);
+}
+
+void ClientBuffer::accountEglImages(int count)
+{
+    m_accounted.eglImageCount += count;
+    if (m_resourceUsage)
+        m_resourceUsage->addEglImages(count);
 }
 
 void ClientBuffer::sendRelease()
@@ -102,10 +225,145 @@ QWaylandBufferRef::BufferFormatEgl ClientBuffer::bufferFormatEgl() const
     return QWaylandBufferRef::BufferFormatEgl_Null;
 }
 
-SharedMemoryBuffer::SharedMemoryBuffer(wl_resource *bufferResource)
+// A plane of a YUV wl_shm buffer. All planes live in the same pool, with the chroma planes
+// following the luma plane. Chroma is subsampled horizontally by two.
+struct YuvPlane
+{
+    int offset;
+    int stride;
+    QSize size;
+    int bytesPerPixel;
+};
+
+static const int MaxYuvPlanes = 3;
+
+// Returns the number of planes of a YUV buffer, or 0 if it isn't one, its strides are too small
+// or its planes don't fit in the \a poolBytes it can use. YUYV is described as two planes over
+// the same memory: luma in pairs of bytes, and chroma in groups of four, which is how the
+// Y_XUXV shader samples it.
+static int yuvPlanes(wl_shm_buffer *shmBuffer, qint64 poolBytes, YuvPlane *planes)
+{
+    const int width = wl_shm_buffer_get_width(shmBuffer);
+    const int height = wl_shm_buffer_get_height(shmBuffer);
+    const int stride = wl_shm_buffer_get_stride(shmBuffer);
+    const QSize chromaSize((width + 1) / 2, (height + 1) / 2);
+
+    int planeCount = 0;
+    switch (wl_shm_buffer_get_format(shmBuffer)) {
+    case WL_SHM_FORMAT_YUV420:
+        planes[0] = { 0, stride, QSize(width, height), 1 };
+        planes[1] = { stride * height, stride / 2, chromaSize, 1 };
+        planes[2] = { planes[1].offset + stride / 2 * chromaSize.height(), stride / 2, chromaSize, 1 };
+        planeCount = 3;
+        break;
+    case WL_SHM_FORMAT_NV12:
+        planes[0] = { 0, stride, QSize(width, height), 1 };
+        planes[1] = { stride * height, stride, chromaSize, 2 };
+        planeCount = 2;
+        break;
+    case WL_SHM_FORMAT_YUYV:
+        planes[0] = { 0, stride, QSize(width, height), 2 };
+        planes[1] = { 0, stride, QSize(chromaSize.width(), height), 4 };
+        planeCount = 2;
+        break;
+    default:
+        return 0;
+    }
+
+    for (int i = 0; i < planeCount; ++i) {
+        const YuvPlane &p = planes[i];
+        const int rowBytes = p.size.width() * p.bytesPerPixel;
+        if (p.stride < rowBytes)
+            return 0;
+        if (p.size.height() > 0 && p.offset + qint64(p.stride) * (p.size.height() - 1) + rowBytes > poolBytes)
+            return 0;
+    }
+    return planeCount;
+}
+
+static qint64 sharedMemorySize(wl_shm_buffer *shmBuffer, qint64 poolBytes)
+{
+    YuvPlane planes[MaxYuvPlanes];
+    const int planeCount = yuvPlanes(shmBuffer, poolBytes, planes);
+    if (!planeCount)
+        return qint64(wl_shm_buffer_get_stride(shmBuffer)) * wl_shm_buffer_get_height(shmBuffer);
+
+    const YuvPlane &last = planes[planeCount - 1];
+    return last.offset + qint64(last.stride) * last.size.height();
+}
+
+// BT.601 with limited range, like the surface_y_*.frag shaders
+static inline QRgb yuvToRgb(int y, int u, int v)
+{
+    const int c = 298 * (y - 16) + 128;
+    const int d = u - 128;
+    const int e = v - 128;
+    return qRgb(qBound(0, (c + 409 * e) >> 8, 255),
+                qBound(0, (c - 100 * d - 208 * e) >> 8, 255),
+                qBound(0, (c + 516 * d) >> 8, 255));
+}
+
+static QImage yuvToImage(const uchar *data, wl_shm_format format, const YuvPlane *planes)
+{
+    const YuvPlane &luma = planes[0];
+    const YuvPlane &chroma = planes[1];
+
+    // Where U and V are within a chroma sample, and how many rows share one
+    int uOffset = 0;
+    int vOffset = 0;
+    int chromaRows = 2;
+    switch (format) {
+    case WL_SHM_FORMAT_YUV420:
+        vOffset = planes[2].offset - chroma.offset;
+        break;
+    case WL_SHM_FORMAT_NV12:
+        vOffset = 1;
+        break;
+    case WL_SHM_FORMAT_YUYV:
+        uOffset = 1;
+        vOffset = 3;
+        chromaRows = 1;
+        break;
+    default:
+        return QImage();
+    }
+
+    QImage image(luma.size, QImage::Format_RGB32);
+    for (int y = 0; y < luma.size.height(); ++y) {
+        const uchar *lumaLine = data + luma.offset + y * luma.stride;
+        const uchar *chromaLine = data + chroma.offset + (y / chromaRows) * chroma.stride;
+        QRgb *dst = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < luma.size.width(); ++x) {
+            const uchar *sample = chromaLine + (x / 2) * chroma.bytesPerPixel;
+            dst[x] = yuvToRgb(lumaLine[x * luma.bytesPerPixel], sample[uOffset], sample[vOffset]);
+        }
+    }
+    return image;
+}
+
+SharedMemoryBuffer::SharedMemoryBuffer(wl_resource *bufferResource, qint64 poolBytes)
     : ClientBuffer(bufferResource)
+    , m_poolBytes(poolBytes)
 {
+    if (wl_shm_buffer *shmBuffer = wl_shm_buffer_get(bufferResource))
+        accountSharedMemory(sharedMemorySize(shmBuffer, m_poolBytes));
+}
+
+/*
+ * YUV buffers are uploaded one texture per plane, and converted to RGB by the shader of the
+ * matching QWaylandBufferMaterial. NV12's interleaved chroma is uploaded as luminance-alpha, which
+ * the Y_XUXV shader samples just like YUYV's, so it works without GL_RG textures on OpenGL ES 2.
+ */
+QWaylandBufferRef::BufferFormatEgl SharedMemoryBuffer::bufferFormatEgl() const
+{
+    wl_shm_buffer *shmBuffer = wl_shm_buffer_get(m_buffer);
+    YuvPlane planes[MaxYuvPlanes];
+    if (!shmBuffer || !yuvPlanes(shmBuffer, m_poolBytes, planes))
+        return QWaylandBufferRef::BufferFormatEgl_Null;
 
+    if (wl_shm_buffer_get_format(shmBuffer) == WL_SHM_FORMAT_YUV420)
+        return QWaylandBufferRef::BufferFormatEgl_Y_U_V;
+    return QWaylandBufferRef::BufferFormatEgl_Y_XUXV;
 }
 
 QSize SharedMemoryBuffer::size() const
@@ -135,20 +393,107 @@ QImage SharedMemoryBuffer::image() const
         QImage::Format format = QWaylandSharedMemoryFormatHelper::fromWaylandShmFormat(shmFormat);
 
         uchar *data = static_cast<uchar *>(wl_shm_buffer_get_data(shmBuffer));
-        return QImage(data, width, height, bytesPerLine, format);
+        if (format != QImage::Format_Invalid)
+            return QImage(data, width, height, bytesPerLine, format);
+
+        YuvPlane planes[MaxYuvPlanes];
+        if (m_yuvImage.isNull() && yuvPlanes(shmBuffer, m_poolBytes, planes))
+            m_yuvImage = yuvToImage(data, shmFormat, planes);
+        return m_yuvImage;
     }
 
     return QImage();
 }
 
+void SharedMemoryBuffer::setCommitted(QRegion &damage)
+{
+    ClientBuffer::setCommitted(damage);
+    m_yuvImage = QImage();
+}
+
 #if QT_CONFIG(opengl)
+#ifndef GL_UNPACK_ROW_LENGTH
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+
+static void uploadYuvPlane(const uchar *data, const YuvPlane &plane, bool hasRowLength)
+{
+    static const GLenum formats[] = { 0, GL_LUMINANCE, GL_LUMINANCE_ALPHA, 0, GL_RGBA };
+    const GLenum format = formats[plane.bytesPerPixel];
+    const int width = plane.size.width();
+    const int height = plane.size.height();
+    const uchar *bits = data + plane.offset;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (plane.stride == width * plane.bytesPerPixel) {
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, bits);
+    } else if (hasRowLength && plane.stride % plane.bytesPerPixel == 0) {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, plane.stride / plane.bytesPerPixel);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, bits);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        for (int y = 0; y < height; ++y)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, 1, format, GL_UNSIGNED_BYTE, bits + y * plane.stride);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+QOpenGLTexture *SharedMemoryBuffer::toYuvTexture(int plane)
+{
+    wl_shm_buffer *shmBuffer = wl_shm_buffer_get(m_buffer);
+    YuvPlane planes[MaxYuvPlanes];
+    const int planeCount = yuvPlanes(shmBuffer, m_poolBytes, planes);
+    if (plane < 0 || plane >= planeCount)
+        return nullptr;
+
+    static const QOpenGLTexture::TextureFormat textureFormats[] = {
+        QOpenGLTexture::NoFormat, QOpenGLTexture::LuminanceFormat, QOpenGLTexture::LuminanceAlphaFormat,
+        QOpenGLTexture::NoFormat, QOpenGLTexture::RGBAFormat
+    };
+
+    if (!m_yuvTextures[0]) {
+        qint64 textureBytes = 0;
+        for (int i = 0; i < planeCount; ++i) {
+            const YuvPlane &p = planes[i];
+            m_yuvTextures[i] = new QOpenGLTexture(QOpenGLTexture::Target2D);
+            m_yuvTextures[i]->create();
+            m_yuvTextures[i]->setSize(p.size.width(), p.size.height());
+            m_yuvTextures[i]->setFormat(textureFormats[p.bytesPerPixel]);
+            textureBytes += qint64(p.size.width()) * p.size.height() * p.bytesPerPixel;
+        }
+        accountTextures(planeCount, textureBytes);
+    }
+
+    // All planes are uploaded together, whichever is asked for first
+    if (m_textureDirty) {
+        m_textureDirty = false;
+        QOpenGLContext *context = QOpenGLContext::currentContext();
+        const bool hasRowLength = !context->isOpenGLES() || context->format().majorVersion() >= 3
+                || context->hasExtension(QByteArrayLiteral("GL_EXT_unpack_subimage"));
+        const uchar *data = static_cast<const uchar *>(wl_shm_buffer_get_data(shmBuffer));
+        for (int i = 0; i < planeCount; ++i) {
+            m_yuvTextures[i]->bind();
+            uploadYuvPlane(data, planes[i], hasRowLength);
+        }
+        //we can release the buffer after uploading, since we have a copy
+        if (isCommitted())
+            sendRelease();
+    }
+    return m_yuvTextures[plane];
+}
+
 QOpenGLTexture *SharedMemoryBuffer::toOpenGlTexture(int plane)
 {
-    Q_UNUSED(plane);
+    if (bufferFormatEgl() != QWaylandBufferRef::BufferFormatEgl_Null)
+        return toYuvTexture(plane);
+
     if (isSharedMemory()) {
         if (!m_shmTexture) {
             m_shmTexture = new QOpenGLTexture(QOpenGLTexture::Target2D);
             m_shmTexture->create();
+            const QSize textureSize = size();
+            accountTextures(1, qint64(textureSize.width()) * textureSize.height() * 4);
         }
         if (m_textureDirty) {
             m_textureDirty = false;
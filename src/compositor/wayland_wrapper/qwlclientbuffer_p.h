@@ -48,6 +48,7 @@
 
 #include <QtWaylandCompositor/QWaylandSurface>
 #include <QtWaylandCompositor/QWaylandBufferRef>
+#include <QtWaylandCompositor/private/qwaylandclient_p.h>
 
 #include <wayland-server-core.h>
 
@@ -60,6 +61,20 @@ class QOpenGLTexture;
 
 namespace QtWayland {
 
+// What display hardware needs to show a buffer without copying it
+struct DmabufAttributes
+{
+    static const int MaxPlanes = 4;
+
+    uint32_t drmFormat = 0;
+    uint64_t modifier = 0x00ffffffffffffffULL; // DRM_FORMAT_MOD_INVALID
+    QSize size;
+    int planeCount = 0;
+    int fds[MaxPlanes] = { -1, -1, -1, -1 };
+    uint32_t offsets[MaxPlanes] = {};
+    uint32_t strides[MaxPlanes] = {};
+};
+
 struct surface_buffer_destroy_listener
 {
     struct wl_listener listener;
@@ -73,6 +88,9 @@ public:
 
     virtual ~ClientBuffer();
 
+    static void *operator new(std::size_t size);
+    static void operator delete(void *ptr, std::size_t size);
+
     virtual QWaylandBufferRef::BufferFormatEgl bufferFormatEgl() const;
     virtual QSize size() const = 0;
     virtual QWaylandSurface::Origin origin() const = 0;
@@ -81,6 +99,7 @@ public:
     virtual void unlockNativeBuffer(quintptr native_buffer) const { Q_UNUSED(native_buffer); }
 
     virtual QImage image() const { return QImage(); }
+    virtual bool dmabufAttributes(DmabufAttributes *attributes) const { Q_UNUSED(attributes); return false; }
 
     inline bool isCommitted() const { return m_committed; }
     virtual void setCommitted(QRegion &damage);
@@ -96,7 +115,14 @@ public:
 
     static bool hasContent(ClientBuffer *buffer) { return buffer && buffer->waylandBufferHandle(); }
 
+    // Accounts what the compositor holds on behalf of the buffer to the client that owns it.
+    // Whatever is still accounted when the buffer goes away is given back then.
+    void accountTextures(int count, qint64 bytes);
+    void accountEglImages(int count);
+
 protected:
+    void accountSharedMemory(qint64 bytes);
+
     void ref();
     void deref();
     void sendRelease();
@@ -112,6 +138,22 @@ private:
 
     QAtomicInt m_refCount;
 
+    void setResourceUsage(ClientResourceUsage *usage);
+
+    QExplicitlySharedDataPointer<ClientResourceUsage> m_resourceUsage;
+    struct {
+        qint64 sharedMemoryBytes = 0;
+        int textureCount = 0;
+        qint64 textureBytes = 0;
+        int eglImageCount = 0;
+    } m_accounted;
+
+    // Installed on the wl_buffer by BufferManager, which also finds the buffer through it
+    struct DestroyListener {
+        wl_listener listener;
+        ClientBuffer *buffer = nullptr;
+    } m_destroyListener;
+
     friend class ::QWaylandBufferRef;
     friend class BufferManager;
 };
@@ -119,17 +161,31 @@ private:
 class Q_WAYLAND_COMPOSITOR_EXPORT SharedMemoryBuffer : public ClientBuffer
 {
 public:
-    SharedMemoryBuffer(struct ::wl_resource *bufferResource);
+    SharedMemoryBuffer(struct ::wl_resource *bufferResource, qint64 poolBytes = -1);
 
+    QWaylandBufferRef::BufferFormatEgl bufferFormatEgl() const override;
     QSize size() const override;
     QWaylandSurface::Origin origin() const  override;
     QImage image() const override;
+    void setCommitted(QRegion &damage) override;
 
 #if QT_CONFIG(opengl)
     QOpenGLTexture *toOpenGlTexture(int plane = 0) override;
+#endif
 
 private:
+    // How much of its pool the buffer can use, or -1 if unknown. Only checked for YUV buffers,
+    // since libwayland already checks the others.
+    qint64 m_poolBytes = -1;
+
+    // YUV buffers are converted for image() once per commit
+    mutable QImage m_yuvImage;
+
+#if QT_CONFIG(opengl)
+    QOpenGLTexture *toYuvTexture(int plane);
+
     QOpenGLTexture *m_shmTexture = nullptr;
+    QOpenGLTexture *m_yuvTextures[3] = {};
 #endif
 };
 
@@ -61,7 +61,7 @@ void DataDevice::setFocus(QWaylandClient *focusClient)
     if (!focusClient)
         return;
 
-    Resource *resource = resourceMap().value(focusClient->client());
+    Resource *resource = clientResource(focusClient->client());
 
     if (!resource)
         return;
@@ -93,7 +93,7 @@ void DataDevice::setDragFocus(QWaylandSurface *focus, const QPointF &localPositi
     if (!m_dragDataSource && m_dragClient != focus->waylandClient())
         return;
 
-    Resource *resource = resourceMap().value(focus->waylandClient());
+    Resource *resource = clientResource(focus->waylandClient());
 
     if (!resource)
         return;
@@ -189,7 +189,7 @@ void DataDevice::data_device_set_selection(Resource *, struct ::wl_resource *sou
         m_selectionSource->setDevice(this);
 
     QWaylandClient *focusClient = m_seat->keyboard()->focusClient();
-    Resource *resource = focusClient ? resourceMap().value(focusClient->client()) : 0;
+    Resource *resource = focusClient ? clientResource(focusClient->client()) : 0;
 
     if (resource && m_selectionSource) {
         DataOffer *offer = new DataOffer(m_selectionSource, resource);
@@ -192,7 +192,7 @@ void DataDeviceManager::overrideSelection(const QMimeData &mimeData)
     QWaylandSurface *focusSurface = dev->keyboardFocus();
     if (focusSurface)
         offerFromCompositorToClient(
-                    QWaylandSeatPrivate::get(dev)->dataDevice()->resourceMap().value(focusSurface->waylandClient())->handle);
+                    QWaylandSeatPrivate::get(dev)->dataDevice()->clientResource(focusSurface->waylandClient())->handle);
 }
 
 bool DataDeviceManager::offerFromCompositorToClient(wl_resource *clientDataDeviceResource)
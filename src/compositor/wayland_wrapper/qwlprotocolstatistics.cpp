@@ -0,0 +1,155 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwlprotocolstatistics_p.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include <wayland-server-core.h>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWayland {
+
+namespace {
+
+struct Counter
+{
+    quint64 messages = 0;
+    quint64 bytes = 0;
+};
+
+struct InterfaceCounters
+{
+    QVector<Counter> requests;
+    QVector<Counter> events;
+};
+
+struct StatisticsData
+{
+    QMutex mutex;
+    QHash<const struct ::wl_interface *, InterfaceCounters> interfaces;
+    QHash<pid_t, Counter> clients;
+};
+
+Q_GLOBAL_STATIC(StatisticsData, statisticsData)
+
+}
+
+QBasicAtomicInt ProtocolStatistics::s_enabled = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+void ProtocolStatistics::setEnabled(bool enabled)
+{
+    s_enabled.storeRelaxed(enabled ? 1 : 0);
+}
+
+void ProtocolStatistics::record(const struct ::wl_interface *interface, int opcode, bool request,
+                                struct ::wl_resource *resource, uint32_t size)
+{
+    pid_t pid = 0;
+    if (resource)
+        wl_client_get_credentials(wl_resource_get_client(resource), &pid, nullptr, nullptr);
+
+    StatisticsData *data = statisticsData();
+    QMutexLocker locker(&data->mutex);
+
+    auto it = data->interfaces.find(interface);
+    if (it == data->interfaces.end()) {
+        it = data->interfaces.insert(interface, InterfaceCounters());
+        it->requests.resize(interface->method_count);
+        it->events.resize(interface->event_count);
+    }
+
+    QVector<Counter> &counters = request ? it->requests : it->events;
+    if (opcode < 0 || opcode >= counters.size())
+        return;
+
+    Counter &counter = counters[opcode];
+    ++counter.messages;
+    counter.bytes += size;
+
+    Counter &client = data->clients[pid];
+    ++client.messages;
+    client.bytes += size;
+}
+
+void ProtocolStatistics::reset()
+{
+    StatisticsData *data = statisticsData();
+    QMutexLocker locker(&data->mutex);
+    data->interfaces.clear();
+    data->clients.clear();
+}
+
+QString ProtocolStatistics::dump()
+{
+    struct Line {
+        QString name;
+        Counter counter;
+    };
+    QVector<Line> messages;
+    QVector<Line> clients;
+
+    {
+        StatisticsData *data = statisticsData();
+        QMutexLocker locker(&data->mutex);
+        for (auto it = data->interfaces.cbegin(), end = data->interfaces.cend(); it != end; ++it) {
+            const struct ::wl_interface *interface = it.key();
+            for (int i = 0; i < it->requests.size(); ++i) {
+                if (it->requests.at(i).messages)
+                    messages.append({ QString::asprintf("%s.%s (request)", interface->name, interface->methods[i].name), it->requests.at(i) });
+            }
+            for (int i = 0; i < it->events.size(); ++i) {
+                if (it->events.at(i).messages)
+                    messages.append({ QString::asprintf("%s.%s (event)", interface->name, interface->events[i].name), it->events.at(i) });
+            }
+        }
+        for (auto it = data->clients.cbegin(), end = data->clients.cend(); it != end; ++it)
+            clients.append({ QString::asprintf("client pid %d", int(it.key())), it.value() });
+    }
+
+    auto byBytes = [](const Line &a, const Line &b) { return a.counter.bytes > b.counter.bytes; };
+    std::sort(messages.begin(), messages.end(), byBytes);
+    std::sort(clients.begin(), clients.end(), byBytes);
+
+    QString result;
+    for (const Line &line : qAsConst(messages))
+        result += QString::asprintf("%s: %llu messages, %llu bytes\n", qPrintable(line.name), line.counter.messages, line.counter.bytes);
+    for (const Line &line : qAsConst(clients))
+        result += QString::asprintf("%s: %llu messages, %llu bytes\n", qPrintable(line.name), line.counter.messages, line.counter.bytes);
+    return result;
+}
+
+}
+
+QT_END_NAMESPACE
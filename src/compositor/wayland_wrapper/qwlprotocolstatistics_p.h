@@ -0,0 +1,79 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWLPROTOCOLSTATISTICS_P_H
+#define QWLPROTOCOLSTATISTICS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtWaylandCompositor/qtwaylandcompositorglobal.h>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QString>
+
+struct wl_interface;
+struct wl_resource;
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWayland {
+
+// Counts the messages and bytes that pass through the qtwaylandscanner generated
+// server code, per interface and opcode and per client. The generated code only
+// calls record() when it is built with QT_WAYLAND_PROTOCOL_STATISTICS defined and
+// counting has been enabled at runtime.
+class Q_WAYLAND_COMPOSITOR_EXPORT ProtocolStatistics
+{
+public:
+    static bool isEnabled() { return s_enabled.loadRelaxed(); }
+    static void setEnabled(bool enabled);
+
+    static void record(const struct ::wl_interface *interface, int opcode, bool request,
+                       struct ::wl_resource *resource, uint32_t size);
+    static void reset();
+    static QString dump();
+
+private:
+    static QBasicAtomicInt s_enabled;
+};
+
+}
+
+QT_END_NAMESPACE
+
+#endif // QWLPROTOCOLSTATISTICS_P_H
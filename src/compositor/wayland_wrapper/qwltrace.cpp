@@ -0,0 +1,96 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwltrace_p.h"
+
+#include <qwaylandtracewriter_p.h>
+
+#include <QtWaylandCompositor/QWaylandCompositor>
+
+#include <QtCore/QCoreApplication>
+
+#include <wayland-server-core.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWayland {
+
+Q_GLOBAL_STATIC(QWaylandTraceWriter, traceWriter)
+
+QBasicAtomicInt Trace::s_enabled = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+void Trace::initialize()
+{
+    if (isEnabled())
+        return;
+
+    const QString fileName = qEnvironmentVariable("QT_WAYLAND_COMPOSITOR_TRACE");
+    if (fileName.isEmpty())
+        return;
+
+    const QByteArray processName = QCoreApplication::applicationName().toUtf8();
+    if (!traceWriter()->open(fileName, processName)) {
+        qCWarning(qLcWaylandCompositor) << "Could not open trace file" << fileName;
+        return;
+    }
+    s_enabled.storeRelaxed(1);
+}
+
+qint64 Trace::timestamp()
+{
+    return QWaylandTraceWriter::timestamp();
+}
+
+void Trace::complete(const char *name, qint64 start, std::initializer_list<Arg> args)
+{
+    const qint64 end = QWaylandTraceWriter::timestamp();
+    traceWriter()->writeEvent(name, 'X', start, end - start, QWaylandTraceWriter::formatArgs(args));
+}
+
+void Trace::begin(const char *name, std::initializer_list<Arg> args)
+{
+    traceWriter()->writeEvent(name, 'B', QWaylandTraceWriter::timestamp(), 0, QWaylandTraceWriter::formatArgs(args));
+}
+
+void Trace::end(const char *name)
+{
+    traceWriter()->writeEvent(name, 'E', QWaylandTraceWriter::timestamp(), 0, QByteArray());
+}
+
+qint64 Trace::clientPid(struct ::wl_resource *resource)
+{
+    pid_t pid = 0;
+    if (resource)
+        wl_client_get_credentials(wl_resource_get_client(resource), &pid, nullptr, nullptr);
+    return pid;
+}
+
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,89 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWLTRACE_P_H
+#define QWLTRACE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtWaylandCompositor/qtwaylandcompositorglobal.h>
+
+#include <QtCore/QAtomicInt>
+
+#include <initializer_list>
+
+struct wl_resource;
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWayland {
+
+// Records surface commits, texture uploads, rendering and frame callbacks as Chrome
+// trace events when QT_WAYLAND_COMPOSITOR_TRACE names a file ("%p" is replaced by the
+// process id). Events about a client's objects carry the client's pid and the ids of its
+// wl_surface and wl_callback objects, as the client traces them; qtwaylandtracemerge
+// uses them to connect both sides. Callers check isEnabled() before gathering any
+// arguments.
+class Q_WAYLAND_COMPOSITOR_EXPORT Trace
+{
+public:
+    struct Arg
+    {
+        const char *name;
+        qint64 value;
+    };
+
+    static bool isEnabled() { return s_enabled.loadRelaxed(); }
+    static void initialize();
+
+    static qint64 timestamp();
+    static void complete(const char *name, qint64 start, std::initializer_list<Arg> args = {});
+    static void begin(const char *name, std::initializer_list<Arg> args = {});
+    static void end(const char *name);
+
+    static qint64 clientPid(struct ::wl_resource *resource);
+
+private:
+    static QBasicAtomicInt s_enabled;
+};
+
+}
+
+QT_END_NAMESPACE
+
+#endif // QWLTRACE_P_H
@@ -5,11 +5,15 @@ WAYLANDSERVERSOURCES += \
 HEADERS += \
     wayland_wrapper/qwlbuffermanager_p.h \
     wayland_wrapper/qwlclientbuffer_p.h \
+    wayland_wrapper/qwlprotocolstatistics_p.h \
+    wayland_wrapper/qwltrace_p.h \
     wayland_wrapper/qwlregion_p.h
 
 SOURCES += \
     wayland_wrapper/qwlbuffermanager.cpp \
     wayland_wrapper/qwlclientbuffer.cpp \
+    wayland_wrapper/qwlprotocolstatistics.cpp \
+    wayland_wrapper/qwltrace.cpp \
     wayland_wrapper/qwlregion.cpp
 
 qtConfig(wayland-datadevice) {
@@ -43,8 +43,12 @@
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLTexture>
 #include <QtGui/QImage>
+#include <QtGui/QOpenGLPixelTransferOptions>
 #include <QtCore/QSharedMemory>
 
+#include <unistd.h>
+#include <sys/mman.h>
+
 QT_BEGIN_NAMESPACE
 
 static QOpenGLTexture *createTextureFromShm(const QString &key, int w, int h, int bpl, int format)
@@ -86,6 +90,43 @@ static QOpenGLTexture *createTextureFromShm(const QString &key, int w, int h, in
     return tex;
 }
 
+// Uploads straight from the mapped memfd, RGBA32 buffers without going through a QImage
+static QOpenGLTexture *createTextureFromFd(int fd, int w, int h, int bpl, int format)
+{
+    const size_t size = size_t(bpl) * size_t(h);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        qErrnoWarning("ShmServerBuffer: could not map buffer");
+        return nullptr;
+    }
+
+    if (!QOpenGLContext::currentContext())
+        qWarning("ShmServerBuffer: creating texture with no current context");
+
+    QOpenGLTexture *tex = nullptr;
+    if (format == QtWayland::qt_shm_emulation_server_buffer::format_A8) {
+        // The right alpha texture format depends on the context, which QOpenGLTexture knows
+        QImage image(static_cast<const uchar *>(data), w, h, bpl, QImage::Format_Alpha8);
+        tex = new QOpenGLTexture(image, QOpenGLTexture::DontGenerateMipMaps);
+    } else {
+        if (format != QtWayland::qt_shm_emulation_server_buffer::format_RGBA32)
+            qWarning() << "ShmServerBuffer: unknown format" << format;
+        tex = new QOpenGLTexture(QOpenGLTexture::Target2D);
+        tex->setFormat(QOpenGLTexture::RGBA8_UNorm);
+        tex->setSize(w, h);
+        tex->setMipLevels(1);
+        tex->setMinificationFilter(QOpenGLTexture::Linear);
+        tex->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+        QOpenGLPixelTransferOptions options;
+        options.setAlignment(4);
+        if (bpl != w * 4)
+            options.setRowLength(bpl / 4);
+        tex->setData(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, data, &options);
+    }
+
+    munmap(data, size);
+    return tex;
+}
 
 namespace QtWaylandClient {
 
@@ -97,14 +138,34 @@ ShmServerBuffer::ShmServerBuffer(const QString &key, const QSize& size, int byte
     m_size = size;
 }
 
+ShmServerBuffer::ShmServerBuffer(int fd, const QSize& size, int bytesPerLine, QWaylandServerBuffer::Format format)
+    : m_fd(fd)
+    , m_bpl(bytesPerLine)
+{
+    m_format = format;
+    m_size = size;
+}
+
 ShmServerBuffer::~ShmServerBuffer()
 {
+    if (m_fd != -1)
+        close(m_fd);
 }
 
 QOpenGLTexture *ShmServerBuffer::toOpenGlTexture()
 {
-    if (!m_texture)
-        m_texture = createTextureFromShm(m_key, m_size.width(), m_size.height(), m_bpl, m_format);
+    if (!m_texture) {
+        if (m_fd != -1) {
+            m_texture = createTextureFromFd(m_fd, m_size.width(), m_size.height(), m_bpl, m_format);
+            // The texture is all that is needed from now on
+            if (m_texture) {
+                close(m_fd);
+                m_fd = -1;
+            }
+        } else {
+            m_texture = createTextureFromShm(m_key, m_size.width(), m_size.height(), m_bpl, m_format);
+        }
+    }
 
     return m_texture;
 }
@@ -122,10 +183,9 @@ QWaylandServerBuffer *ShmServerBufferIntegration::serverBuffer(struct qt_server_
 
 void ShmServerBufferIntegration::wlDisplayHandleGlobal(void *data, ::wl_registry *registry, uint32_t id, const QString &interface, uint32_t version)
 {
-    Q_UNUSED(version);
     if (interface == "qt_shm_emulation_server_buffer") {
         auto *integration = static_cast<ShmServerBufferIntegration *>(data);
-        integration->QtWayland::qt_shm_emulation_server_buffer::init(registry, id, 1);
+        integration->QtWayland::qt_shm_emulation_server_buffer::init(registry, id, qMin(version, 2u));
     }
 }
 
@@ -138,6 +198,14 @@ void QtWaylandClient::ShmServerBufferIntegration::shm_emulation_server_buffer_se
     qt_server_buffer_set_user_data(id, server_buffer);
 }
 
+void QtWaylandClient::ShmServerBufferIntegration::shm_emulation_server_buffer_server_buffer_created_fd(qt_server_buffer *id, int32_t fd, int32_t width, int32_t height, int32_t bytes_per_line, int32_t format)
+{
+    QSize size(width, height);
+    auto fmt = QWaylandServerBuffer::Format(format);
+    auto *server_buffer = new ShmServerBuffer(fd, size, bytes_per_line, fmt);
+    qt_server_buffer_set_user_data(id, server_buffer);
+}
+
 }
 
 QT_END_NAMESPACE
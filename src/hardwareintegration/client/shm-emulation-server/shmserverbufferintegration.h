@@ -58,11 +58,13 @@ class ShmServerBuffer : public QWaylandServerBuffer
 {
 public:
     ShmServerBuffer(const QString &key, const QSize &size, int bytesPerLine, QWaylandServerBuffer::Format format);
+    ShmServerBuffer(int fd, const QSize &size, int bytesPerLine, QWaylandServerBuffer::Format format);
     ~ShmServerBuffer() override;
     QOpenGLTexture* toOpenGlTexture() override;
 private:
     QOpenGLTexture *m_texture = nullptr;
     QString m_key;
+    int m_fd = -1;
     int m_bpl;
 };
 
@@ -77,6 +79,7 @@ public:
 
 protected:
     void shm_emulation_server_buffer_server_buffer_created(qt_server_buffer *id, const QString &key, int32_t width, int32_t height, int32_t bytes_per_line, int32_t format) override;
+    void shm_emulation_server_buffer_server_buffer_created_fd(qt_server_buffer *id, int32_t fd, int32_t width, int32_t height, int32_t bytes_per_line, int32_t format) override;
 
 private:
     static void wlDisplayHandleGlobal(void *data, struct ::wl_registry *registry, uint32_t id,
@@ -44,6 +44,7 @@
 #include <QtWaylandClient/private/qwaylandsubsurface_p.h>
 #include <QtWaylandClient/private/qwaylandabstractdecoration_p.h>
 #include <QtWaylandClient/private/qwaylandintegration_p.h>
+#include <QtWaylandClient/private/qwaylandtrace_p.h>
 #include "qwaylandeglwindow.h"
 
 #include <QDebug>
@@ -498,7 +499,10 @@ void QWaylandGLContext::swapBuffers(QPlatformSurface *surface)
         window->waitForFrameSync(100);
     }
     window->handleUpdate();
+    const qint64 traceStart = QWaylandTrace::isEnabled() ? QWaylandTrace::timestamp() : 0;
     eglSwapBuffers(m_eglDisplay, eglSurface);
+    if (traceStart)
+        window->traceCommit("swapBuffers", traceStart);
 
     window->setCanResize(true);
 }
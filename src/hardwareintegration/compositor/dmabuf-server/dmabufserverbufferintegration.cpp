@@ -99,9 +99,9 @@ DmaBufServerBuffer::~DmaBufServerBuffer()
 
 struct ::wl_resource *DmaBufServerBuffer::resourceForClient(struct ::wl_client *client)
 {
-    auto *bufferResource = resourceMap().value(client);
+    auto *bufferResource = clientResource(client);
     if (!bufferResource) {
-        auto integrationResource = m_integration->resourceMap().value(client);
+        auto integrationResource = m_integration->clientResource(client);
         if (!integrationResource) {
             qCWarning(qLcWaylandCompositorHardwareIntegration) << "DmaBufServerBuffer::resourceForClient: Trying to get resource for ServerBuffer. But client is not bound to the qt_dmabuf_server_buffer interface";
             return nullptr;
@@ -126,7 +126,7 @@ QOpenGLTexture *DmaBufServerBuffer::toOpenGlTexture()
 
 bool DmaBufServerBuffer::bufferInUse()
 {
-    return resourceMap().count() > 0;
+    return resourceHash().count() > 0;
 }
 
 DmaBufServerBufferIntegration::DmaBufServerBufferIntegration()
@@ -87,9 +87,9 @@ DrmEglServerBuffer::DrmEglServerBuffer(DrmEglServerBufferIntegration *integratio
 
 struct ::wl_resource *DrmEglServerBuffer::resourceForClient(struct ::wl_client *client)
 {
-    auto *bufferResource = resourceMap().value(client);
+    auto *bufferResource = clientResource(client);
     if (!bufferResource) {
-        auto integrationResource = m_integration->resourceMap().value(client);
+        auto integrationResource = m_integration->clientResource(client);
         if (!integrationResource) {
             qWarning("DrmEglServerBuffer::resourceForClient: Trying to get resource for ServerBuffer. But client is not bound to the drm_egl interface");
             return nullptr;
@@ -113,7 +113,7 @@ QOpenGLTexture *DrmEglServerBuffer::toOpenGlTexture()
 
 bool DrmEglServerBuffer::bufferInUse()
 {
-    return resourceMap().count() > 0;
+    return resourceHash().count() > 0;
 }
 
 DrmEglServerBufferIntegration::DrmEglServerBufferIntegration()
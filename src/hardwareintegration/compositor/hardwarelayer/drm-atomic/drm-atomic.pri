@@ -0,0 +1,9 @@
+INCLUDEPATH += $$PWD
+
+QMAKE_USE_PRIVATE += drm wayland-server
+
+SOURCES += \
+    $$PWD/drmatomicplanebackend.cpp
+
+HEADERS += \
+    $$PWD/drmatomicplanebackend.h
@@ -0,0 +1,405 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "drmatomicplanebackend.h"
+
+#include <QtWaylandCompositor/QWaylandCompositor>
+#include <QtWaylandCompositor/private/qwlbuffermanager_p.h>
+#include <QtWaylandCompositor/private/qwlclientbuffer_p.h>
+
+#include <QtGui/QGuiApplication>
+#include <QtGui/QScreen>
+#include <qpa/qplatformnativeinterface.h>
+
+#include <xf86drm.h>
+#include <drm_mode.h>
+
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+using namespace QtWayland;
+
+DrmAtomicPlaneBackend::DrmAtomicPlaneBackend(QScreen *screen)
+{
+    QPlatformNativeInterface *nativeInterface = QGuiApplication::platformNativeInterface();
+    if (nativeInterface && screen) {
+        m_fd = int(qintptr(nativeInterface->nativeResourceForIntegration("dri_fd")));
+        m_crtcId = uint32_t(qintptr(nativeInterface->nativeResourceForScreen("dri_crtcid", screen)));
+    }
+
+    if (m_fd <= 0 || !m_crtcId) {
+        qCWarning(qLcWaylandCompositorHardwareIntegration) << "DRM atomic hardware layers need the eglfs"
+                << "platform plugin with the eglfs_kms device integration, all layers are composited by the GPU";
+        m_fd = -1;
+        return;
+    }
+
+    if (drmSetClientCap(m_fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) || drmSetClientCap(m_fd, DRM_CLIENT_CAP_ATOMIC, 1)) {
+        qCWarning(qLcWaylandCompositorHardwareIntegration) << "The DRM device does not support atomic mode setting,"
+                << "all layers are composited by the GPU";
+        m_fd = -1;
+        return;
+    }
+
+    findPlanes(m_crtcId);
+}
+
+DrmAtomicPlaneBackend::~DrmAtomicPlaneBackend()
+{
+    if (m_fd == -1)
+        return;
+
+    if (!m_activePlanes.isEmpty())
+        commit(QVector<HardwarePlaneAssignment>());
+
+    for (Framebuffer *framebuffer : qAsConst(m_framebuffers)) {
+        wl_list_remove(&framebuffer->listener.link);
+        drmModeRmFB(m_fd, framebuffer->id);
+        delete framebuffer;
+    }
+    for (uint32_t id : qAsConst(m_orphanedFramebuffers))
+        drmModeRmFB(m_fd, id);
+    for (uint32_t id : qAsConst(m_releasableFramebuffers))
+        drmModeRmFB(m_fd, id);
+}
+
+static uint64_t propertyValue(drmModeObjectProperties *properties, int index)
+{
+    return properties->prop_values[index];
+}
+
+void DrmAtomicPlaneBackend::findPlanes(uint32_t crtcId)
+{
+    drmModeRes *resources = drmModeGetResources(m_fd);
+    if (!resources)
+        return;
+
+    int crtcIndex = -1;
+    for (int i = 0; i < resources->count_crtcs; ++i) {
+        if (resources->crtcs[i] == crtcId)
+            crtcIndex = i;
+    }
+    drmModeFreeResources(resources);
+
+    drmModePlaneRes *planeResources = drmModeGetPlaneResources(m_fd);
+    if (crtcIndex == -1 || !planeResources)
+        return;
+
+    struct FoundPlane {
+        HardwarePlane plane;
+        uint64_t type = DRM_PLANE_TYPE_OVERLAY;
+        bool hasZpos = false;
+    };
+    QVector<FoundPlane> found;
+
+    for (uint32_t i = 0; i < planeResources->count_planes; ++i) {
+        drmModePlane *drmPlane = drmModeGetPlane(m_fd, planeResources->planes[i]);
+        if (!drmPlane)
+            continue;
+
+        // Planes in use by other CRTCs are left alone
+        const bool usable = (drmPlane->possible_crtcs & (1u << crtcIndex))
+                && (!drmPlane->crtc_id || drmPlane->crtc_id == crtcId);
+
+        FoundPlane candidate;
+        candidate.plane.id = drmPlane->plane_id;
+        candidate.plane.zpos = int(i);
+        // Scaling limits are only known by trying, see test()
+        candidate.plane.minScale = 0;
+        candidate.plane.maxScale = std::numeric_limits<qreal>::max();
+        for (uint32_t f = 0; f < drmPlane->count_formats; ++f)
+            candidate.plane.formats.insert(drmPlane->formats[f], QVector<uint64_t>());
+        drmModeFreePlane(drmPlane);
+
+        if (!usable)
+            continue;
+
+        drmModeObjectProperties *properties = drmModeObjectGetProperties(m_fd, candidate.plane.id, DRM_MODE_OBJECT_PLANE);
+        if (!properties)
+            continue;
+
+        PlaneProperties ids;
+        for (uint32_t p = 0; p < properties->count_props; ++p) {
+            drmModePropertyRes *property = drmModeGetProperty(m_fd, properties->props[p]);
+            if (!property)
+                continue;
+
+            const QByteArray name(property->name);
+            if (name == "type") {
+                candidate.type = propertyValue(properties, p);
+            } else if (name == "zpos") {
+                candidate.plane.zpos = int(propertyValue(properties, p));
+                candidate.hasZpos = true;
+            } else if (name == "alpha") {
+                ids.alpha = property->prop_id;
+                candidate.plane.supportsAlpha = true;
+            } else if (name == "IN_FORMATS") {
+                if (drmModePropertyBlobRes *blob = drmModeGetPropertyBlob(m_fd, uint32_t(propertyValue(properties, p)))) {
+                    auto *header = static_cast<const drm_format_modifier_blob *>(blob->data);
+                    auto *formats = reinterpret_cast<const uint32_t *>(static_cast<const char *>(blob->data) + header->formats_offset);
+                    auto *modifiers = reinterpret_cast<const drm_format_modifier *>(static_cast<const char *>(blob->data) + header->modifiers_offset);
+                    for (uint32_t m = 0; m < header->count_modifiers; ++m) {
+                        for (uint32_t bit = 0; bit < 64; ++bit) {
+                            const uint32_t index = modifiers[m].offset + bit;
+                            if ((modifiers[m].formats & (1ull << bit)) && index < header->count_formats)
+                                candidate.plane.formats[formats[index]].append(modifiers[m].modifier);
+                        }
+                    }
+                    drmModeFreePropertyBlob(blob);
+                }
+            } else if (name == "FB_ID") {
+                ids.fbId = property->prop_id;
+            } else if (name == "CRTC_ID") {
+                ids.crtcId = property->prop_id;
+            } else if (name == "SRC_X") {
+                ids.srcX = property->prop_id;
+            } else if (name == "SRC_Y") {
+                ids.srcY = property->prop_id;
+            } else if (name == "SRC_W") {
+                ids.srcW = property->prop_id;
+            } else if (name == "SRC_H") {
+                ids.srcH = property->prop_id;
+            } else if (name == "CRTC_X") {
+                ids.crtcX = property->prop_id;
+            } else if (name == "CRTC_Y") {
+                ids.crtcY = property->prop_id;
+            } else if (name == "CRTC_W") {
+                ids.crtcW = property->prop_id;
+            } else if (name == "CRTC_H") {
+                ids.crtcH = property->prop_id;
+            }
+            drmModeFreeProperty(property);
+        }
+        drmModeFreeObjectProperties(properties);
+
+        m_properties.insert(candidate.plane.id, ids);
+        found.append(candidate);
+    }
+    drmModeFreePlaneResources(planeResources);
+
+    // The scene graph is rendered to the primary plane, overlays with a lower zpos are underlays
+    int primaryZpos = std::numeric_limits<int>::min();
+    for (const FoundPlane &plane : qAsConst(found)) {
+        if (plane.type == DRM_PLANE_TYPE_PRIMARY && plane.hasZpos)
+            primaryZpos = plane.plane.zpos;
+    }
+
+    for (FoundPlane &plane : found) {
+        if (plane.type != DRM_PLANE_TYPE_OVERLAY)
+            continue;
+        plane.plane.underlay = plane.hasZpos && plane.plane.zpos < primaryZpos;
+        m_planes.append(plane.plane);
+    }
+
+    qCDebug(qLcWaylandCompositorHardwareIntegration) << "Found" << m_planes.size()
+            << "overlay planes for DRM CRTC" << crtcId;
+}
+
+uint32_t DrmAtomicPlaneBackend::framebufferFor(const QWaylandBufferRef &buffer)
+{
+    wl_resource *resource = buffer.wl_buffer();
+    if (Framebuffer *framebuffer = m_framebuffers.value(resource))
+        return framebuffer->id;
+
+    DmabufAttributes attributes;
+    ClientBuffer *clientBuffer = BufferManager::findBuffer(resource);
+    if (!clientBuffer || !clientBuffer->dmabufAttributes(&attributes))
+        return 0;
+
+    uint32_t handles[4] = {};
+    uint32_t pitches[4] = {};
+    uint32_t offsets[4] = {};
+    uint64_t modifiers[4] = {};
+    bool imported = true;
+    for (int i = 0; i < attributes.planeCount; ++i) {
+        imported &= drmPrimeFDToHandle(m_fd, attributes.fds[i], &handles[i]) == 0;
+        pitches[i] = attributes.strides[i];
+        offsets[i] = attributes.offsets[i];
+        modifiers[i] = attributes.modifier;
+    }
+
+    uint32_t id = 0;
+    if (imported) {
+        const uint32_t width = uint32_t(attributes.size.width());
+        const uint32_t height = uint32_t(attributes.size.height());
+        if (attributes.modifier != HardwareLayerCandidate::InvalidModifier) {
+            imported = drmModeAddFB2WithModifiers(m_fd, width, height, attributes.drmFormat, handles, pitches,
+                                                  offsets, modifiers, &id, DRM_MODE_FB_MODIFIERS) == 0;
+        } else {
+            imported = drmModeAddFB2(m_fd, width, height, attributes.drmFormat, handles, pitches, offsets, &id, 0) == 0;
+        }
+    }
+
+    // The framebuffer keeps its own reference to the buffer objects
+    for (int i = 0; i < attributes.planeCount; ++i) {
+        if (!handles[i])
+            continue;
+        bool closed = false;
+        for (int j = 0; j < i; ++j)
+            closed |= handles[j] == handles[i];
+        if (!closed) {
+            drm_gem_close close = {};
+            close.handle = handles[i];
+            drmIoctl(m_fd, DRM_IOCTL_GEM_CLOSE, &close);
+        }
+    }
+
+    if (!imported) {
+        qCDebug(qLcWaylandCompositorHardwareIntegration) << "Could not create a DRM framebuffer for" << resource;
+        return 0;
+    }
+
+    auto *framebuffer = new Framebuffer;
+    framebuffer->backend = this;
+    framebuffer->buffer = resource;
+    framebuffer->id = id;
+    framebuffer->listener.notify = bufferDestroyed;
+    wl_resource_add_destroy_listener(resource, &framebuffer->listener);
+    m_framebuffers.insert(resource, framebuffer);
+    return id;
+}
+
+void DrmAtomicPlaneBackend::bufferDestroyed(wl_listener *listener, void *data)
+{
+    Q_UNUSED(data);
+    Framebuffer *framebuffer = wl_container_of(listener, framebuffer, listener);
+    wl_list_remove(&framebuffer->listener.link);
+
+    // Removing a framebuffer that is shown would disable the plane
+    DrmAtomicPlaneBackend *backend = framebuffer->backend;
+    backend->m_framebuffers.remove(framebuffer->buffer);
+    backend->m_orphanedFramebuffers.append(framebuffer->id);
+    delete framebuffer;
+}
+
+void DrmAtomicPlaneBackend::releaseFramebuffers()
+{
+    for (uint32_t id : qAsConst(m_releasableFramebuffers))
+        drmModeRmFB(m_fd, id);
+    m_releasableFramebuffers = m_orphanedFramebuffers;
+    m_orphanedFramebuffers.clear();
+}
+
+bool DrmAtomicPlaneBackend::addToRequest(drmModeAtomicReq *request, const QVector<HardwarePlaneAssignment> &assignments)
+{
+    QSet<uint> usedPlanes;
+    for (const HardwarePlaneAssignment &assignment : assignments) {
+        const uint32_t fb = framebufferFor(assignment.candidate.buffer);
+        if (!fb || !m_properties.contains(assignment.plane.id))
+            return false;
+
+        const PlaneProperties &ids = m_properties[assignment.plane.id];
+        const uint32_t planeId = assignment.plane.id;
+        const QSize size = assignment.candidate.bufferSize;
+        const QRect destination = assignment.candidate.destination;
+        drmModeAtomicAddProperty(request, planeId, ids.fbId, fb);
+        drmModeAtomicAddProperty(request, planeId, ids.crtcId, m_crtcId);
+        drmModeAtomicAddProperty(request, planeId, ids.srcX, 0);
+        drmModeAtomicAddProperty(request, planeId, ids.srcY, 0);
+        drmModeAtomicAddProperty(request, planeId, ids.srcW, uint64_t(size.width()) << 16);
+        drmModeAtomicAddProperty(request, planeId, ids.srcH, uint64_t(size.height()) << 16);
+        drmModeAtomicAddProperty(request, planeId, ids.crtcX, uint64_t(int64_t(destination.x())));
+        drmModeAtomicAddProperty(request, planeId, ids.crtcY, uint64_t(int64_t(destination.y())));
+        drmModeAtomicAddProperty(request, planeId, ids.crtcW, uint64_t(destination.width()));
+        drmModeAtomicAddProperty(request, planeId, ids.crtcH, uint64_t(destination.height()));
+        if (ids.alpha)
+            drmModeAtomicAddProperty(request, planeId, ids.alpha, uint64_t(qBound(0.0, assignment.candidate.opacity, 1.0) * 0xffff));
+        usedPlanes.insert(planeId);
+    }
+
+    for (uint planeId : qAsConst(m_activePlanes)) {
+        if (usedPlanes.contains(planeId))
+            continue;
+        const PlaneProperties &ids = m_properties[planeId];
+        drmModeAtomicAddProperty(request, planeId, ids.fbId, 0);
+        drmModeAtomicAddProperty(request, planeId, ids.crtcId, 0);
+    }
+
+    return true;
+}
+
+bool DrmAtomicPlaneBackend::test(const QVector<HardwarePlaneAssignment> &assignments)
+{
+    if (m_fd == -1)
+        return assignments.isEmpty();
+
+    drmModeAtomicReq *request = drmModeAtomicAlloc();
+    bool ok = addToRequest(request, assignments)
+            && drmModeAtomicCommit(m_fd, request, DRM_MODE_ATOMIC_TEST_ONLY, nullptr) == 0;
+    drmModeAtomicFree(request);
+    return ok;
+}
+
+bool DrmAtomicPlaneBackend::commit(const QVector<HardwarePlaneAssignment> &assignments)
+{
+    if (m_fd == -1)
+        return assignments.isEmpty();
+
+    // Buffers may have been destroyed since the configuration was tested
+    QVector<HardwarePlaneAssignment> shown;
+    for (const HardwarePlaneAssignment &assignment : assignments) {
+        if (framebufferFor(assignment.candidate.buffer))
+            shown.append(assignment);
+    }
+
+    // eglfs commits its request with the next page flip on this thread
+    QPlatformNativeInterface *nativeInterface = QGuiApplication::platformNativeInterface();
+    auto *eglfsRequest = static_cast<drmModeAtomicReq *>(nativeInterface->nativeResourceForIntegration("dri_atomic_request"));
+
+    bool ok = false;
+    if (eglfsRequest) {
+        ok = addToRequest(eglfsRequest, shown);
+        m_commitLatency = 1;
+    } else {
+        // The commit lands on the vblank after the one eglfs flips on, and eglfs owns the page
+        // flip events of the device. A frame later the planes are known to show it.
+        drmModeAtomicReq *request = drmModeAtomicAlloc();
+        if (addToRequest(request, shown)) {
+            // With a commit still pending, nothing changes and the next frame tries again,
+            // rather than blocking the render thread until the flip
+            ok = drmModeAtomicCommit(m_fd, request, DRM_MODE_ATOMIC_NONBLOCK, nullptr) == 0;
+        }
+        drmModeAtomicFree(request);
+        m_commitLatency = 2;
+    }
+
+    if (ok) {
+        m_activePlanes.clear();
+        for (const HardwarePlaneAssignment &assignment : qAsConst(shown))
+            m_activePlanes.insert(assignment.plane.id);
+        releaseFramebuffers();
+    }
+
+    // Buffers that are gone have no client to give them back to
+    return ok;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,103 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef DRMATOMICPLANEBACKEND_H
+#define DRMATOMICPLANEBACKEND_H
+
+#include <QtWaylandCompositor/private/qwlhardwarelayerplanner_p.h>
+
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+
+#include <wayland-server-core.h>
+#include <xf86drmMode.h>
+
+QT_BEGIN_NAMESPACE
+
+class QScreen;
+
+// Shows hardware layers on the overlay planes of the CRTC that eglfs_kms drives for a screen.
+// Configurations are checked with test-only atomic commits. When eglfs uses the atomic API as
+// well, the planes are updated in the same commit as the page flip.
+class DrmAtomicPlaneBackend : public QtWayland::HardwarePlaneBackend
+{
+public:
+    explicit DrmAtomicPlaneBackend(QScreen *screen);
+    ~DrmAtomicPlaneBackend() override;
+
+    QVector<QtWayland::HardwarePlane> planes() const override { return m_planes; }
+    bool test(const QVector<QtWayland::HardwarePlaneAssignment> &assignments) override;
+    bool commit(const QVector<QtWayland::HardwarePlaneAssignment> &assignments) override;
+    int commitLatency() const override { return m_commitLatency; }
+
+private:
+    struct PlaneProperties
+    {
+        uint32_t fbId = 0;
+        uint32_t crtcId = 0;
+        uint32_t srcX = 0;
+        uint32_t srcY = 0;
+        uint32_t srcW = 0;
+        uint32_t srcH = 0;
+        uint32_t crtcX = 0;
+        uint32_t crtcY = 0;
+        uint32_t crtcW = 0;
+        uint32_t crtcH = 0;
+        uint32_t alpha = 0;
+    };
+
+    struct Framebuffer
+    {
+        wl_listener listener;
+        DrmAtomicPlaneBackend *backend = nullptr;
+        wl_resource *buffer = nullptr;
+        uint32_t id = 0;
+    };
+
+    void findPlanes(uint32_t crtcId);
+    uint32_t framebufferFor(const QWaylandBufferRef &buffer);
+    bool addToRequest(drmModeAtomicReq *request, const QVector<QtWayland::HardwarePlaneAssignment> &assignments);
+    void releaseFramebuffers();
+    static void bufferDestroyed(wl_listener *listener, void *data);
+
+    int m_fd = -1;
+    uint32_t m_crtcId = 0;
+    QVector<QtWayland::HardwarePlane> m_planes;
+    QHash<uint, PlaneProperties> m_properties;
+    QSet<uint> m_activePlanes;
+    QHash<wl_resource *, Framebuffer *> m_framebuffers;
+    QVector<uint32_t> m_orphanedFramebuffers; // client buffer gone, maybe still scanned out
+    QVector<uint32_t> m_releasableFramebuffers; // no longer scanned out after the last commit
+    int m_commitLatency = 1;
+};
+
+QT_END_NAMESPACE
+
+#endif // DRMATOMICPLANEBACKEND_H
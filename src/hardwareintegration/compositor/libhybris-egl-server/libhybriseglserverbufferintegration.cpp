@@ -88,9 +88,9 @@ LibHybrisEglServerBuffer::LibHybrisEglServerBuffer(LibHybrisEglServerBufferInteg
 
 struct ::wl_resource *LibHybrisEglServerBuffer::resourceForClient(struct ::wl_client *client)
 {
-    auto *bufferResource = resourceMap().value(client);
+    auto *bufferResource = clientResource(client);
     if (!bufferResource) {
-        auto integrationResource = m_integration->resourceMap().value(client);
+        auto integrationResource = m_integration->clientResource(client);
         if (!integrationResource) {
             qWarning("LibHybrisEglServerBuffer::resourceForClient: Trying to get resource for ServerBuffer. But client is not bound to the libhybris_egl interface");
             return 0;
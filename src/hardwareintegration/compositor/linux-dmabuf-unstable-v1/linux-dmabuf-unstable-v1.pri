@@ -9,8 +9,10 @@ QT += egl_support-private
 
 SOURCES += \
     $$PWD/linuxdmabufclientbufferintegration.cpp \
-    $$PWD/linuxdmabuf.cpp
+    $$PWD/linuxdmabuf.cpp \
+    $$PWD/linuxdmabufimportcache.cpp
 
 HEADERS += \
     $$PWD/linuxdmabufclientbufferintegration.h \
-    $$PWD/linuxdmabuf.h
+    $$PWD/linuxdmabuf.h \
+    $$PWD/linuxdmabufimportcache.h
@@ -31,27 +31,191 @@
 #include "linuxdmabufclientbufferintegration.h"
 
 #include <QtWaylandCompositor/QWaylandCompositor>
+#include <QtWaylandCompositor/QWaylandSurface>
 
 #include <drm_fourcc.h>
 #include <drm_mode.h>
+#include <fcntl.h>
 #include <unistd.h>
 
+#include <limits>
+
+#ifdef Q_OS_LINUX
+#  include <sys/syscall.h>
+// from linux/memfd.h:
+#  ifndef MFD_CLOEXEC
+#    define MFD_CLOEXEC     0x0001U
+#  endif
+#  ifndef MFD_ALLOW_SEALING
+#    define MFD_ALLOW_SEALING 0x0002U
+#  endif
+// from linux/fcntl.h:
+#  ifndef F_ADD_SEALS
+#    define F_ADD_SEALS     1033
+#    define F_SEAL_SEAL     0x0001
+#    define F_SEAL_SHRINK   0x0002
+#    define F_SEAL_GROW     0x0004
+#    define F_SEAL_WRITE    0x0008
+#  endif
+#endif
+
 QT_BEGIN_NAMESPACE
 
-LinuxDmabuf::LinuxDmabuf(wl_display *display, LinuxDmabufClientBufferIntegration *clientBufferIntegration)
-    : zwp_linux_dmabuf_v1(display, 3 /*version*/)
+LinuxDmabuf::LinuxDmabuf(wl_display *display, LinuxDmabufClientBufferIntegration *clientBufferIntegration,
+                         const QHash<uint32_t, QVector<uint64_t>> &modifiers, dev_t mainDevice)
+    : m_modifiers(modifiers)
     , m_clientBufferIntegration(clientBufferIntegration)
+    , m_mainDevice(mainDevice)
+{
+    createFormatTable();
+
+    // Feedback needs the format table and a device to point clients at
+    int version = 3;
+    if (m_formatTableFd != -1 && m_mainDevice) {
+        version = 4;
+        m_defaultFeedback = new LinuxDmabufFeedback(this);
+        setDefaultFeedback(QVector<LinuxDmabufTranche>());
+    } else {
+        qCDebug(qLcWaylandCompositorHardwareIntegration) << "No main device or format table, dmabuf feedback disabled";
+    }
+    init(display, version);
+}
+
+LinuxDmabuf::~LinuxDmabuf()
+{
+    for (auto it = m_surfaceFeedback.begin(); it != m_surfaceFeedback.end(); ++it) {
+        QObject::disconnect(it->destroyConnection);
+        delete it->feedback;
+    }
+    delete m_defaultFeedback;
+    if (m_formatTableFd != -1)
+        close(m_formatTableFd);
+}
+
+// Writes all supported format/modifier pairs to a sealed memfd, which every client maps
+void LinuxDmabuf::createFormatTable()
+{
+    // tranche_formats refers to the pairs by 16 bit indices
+    const int maxEntries = std::numeric_limits<uint16_t>::max() + 1;
+    auto formats = m_modifiers.keys();
+    std::sort(formats.begin(), formats.end());
+    for (uint32_t format : qAsConst(formats)) {
+        auto modifiers = m_modifiers.value(format);
+        // use DRM_FORMAT_MOD_INVALID when no modifiers are supported for a format
+        if (modifiers.isEmpty())
+            modifiers << DRM_FORMAT_MOD_INVALID;
+        for (uint64_t modifier : qAsConst(modifiers)) {
+            if (m_formatTable.size() == maxEntries)
+                break;
+            m_formatTableIndices.insert(qMakePair(format, modifier), uint16_t(m_formatTable.size()));
+            m_formatTable.append({format, 0, modifier});
+        }
+    }
+    if (m_formatTable.size() == maxEntries)
+        qCWarning(qLcWaylandCompositorHardwareIntegration) << "Too many dmabuf formats and modifiers, the format table is truncated";
+
+#ifdef SYS_memfd_create
+    m_formatTableFd = syscall(SYS_memfd_create, "linux-dmabuf-format-table", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (m_formatTableFd == -1) {
+        qErrnoWarning("LinuxDmabuf: could not create format table");
+        return;
+    }
+
+    const ssize_t size = formatTableSize();
+    if (write(m_formatTableFd, m_formatTable.constData(), size) != size
+            || fcntl(m_formatTableFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        qErrnoWarning("LinuxDmabuf: could not write format table");
+        close(m_formatTableFd);
+        m_formatTableFd = -1;
+    }
+#endif
+}
+
+// Returns the format table indices of the tranche's pairs, as sent in tranche_formats
+QByteArray LinuxDmabuf::formatIndices(const LinuxDmabufTranche &tranche) const
+{
+    QVector<uint16_t> indices;
+    for (auto it = tranche.modifiers.constBegin(); it != tranche.modifiers.constEnd(); ++it) {
+        auto modifiers = it.value();
+        if (modifiers.isEmpty())
+            modifiers << DRM_FORMAT_MOD_INVALID;
+        for (uint64_t modifier : qAsConst(modifiers)) {
+            auto index = m_formatTableIndices.constFind(qMakePair(it.key(), modifier));
+            if (index != m_formatTableIndices.constEnd())
+                indices << *index;
+        }
+    }
+    std::sort(indices.begin(), indices.end());
+    return QByteArray(reinterpret_cast<const char *>(indices.constData()), indices.size() * int(sizeof(uint16_t)));
+}
+
+/*
+    Sets the tranches sent to clients that ask for the default feedback, and for surfaces
+    without feedback of their own. An empty list means a single tranche with everything the
+    main device can import.
+*/
+void LinuxDmabuf::setDefaultFeedback(const QVector<LinuxDmabufTranche> &tranches)
+{
+    if (!m_defaultFeedback)
+        return;
+
+    m_defaultTranches = tranches;
+    if (m_defaultTranches.isEmpty()) {
+        LinuxDmabufTranche tranche;
+        tranche.modifiers = m_modifiers;
+        m_defaultTranches << tranche;
+    }
+
+    m_defaultFeedback->setTranches(m_defaultTranches);
+    for (const SurfaceFeedback &surfaceFeedback : qAsConst(m_surfaceFeedback)) {
+        if (surfaceFeedback.tranches.isEmpty())
+            surfaceFeedback.feedback->setTranches(m_defaultTranches);
+    }
+}
+
+/*
+    Sets the tranches sent for buffers attached to surface, for instance to prefer scanout
+    capable modifiers while it is shown fullscreen. An empty list reverts to the default feedback.
+*/
+void LinuxDmabuf::setSurfaceFeedback(QWaylandSurface *surface, const QVector<LinuxDmabufTranche> &tranches)
+{
+    if (!m_defaultFeedback || !surface)
+        return;
+
+    SurfaceFeedback &feedback = surfaceFeedback(surface);
+    feedback.tranches = tranches;
+    feedback.feedback->setTranches(tranches.isEmpty() ? m_defaultTranches : tranches);
+}
+
+LinuxDmabuf::SurfaceFeedback &LinuxDmabuf::surfaceFeedback(QWaylandSurface *surface)
 {
+    auto it = m_surfaceFeedback.find(surface);
+    if (it == m_surfaceFeedback.end()) {
+        SurfaceFeedback feedback;
+        feedback.feedback = new LinuxDmabufFeedback(this);
+        feedback.feedback->setTranches(m_defaultTranches);
+        feedback.destroyConnection = QObject::connect(surface, &QObject::destroyed, [this, surface]() {
+            removeSurfaceFeedback(surface);
+        });
+        it = m_surfaceFeedback.insert(surface, feedback);
+    }
+    return *it;
 }
 
-void LinuxDmabuf::setSupportedModifiers(const QHash<uint32_t, QVector<uint64_t>> &modifiers)
+// Any feedback resources left for the surface become inert
+void LinuxDmabuf::removeSurfaceFeedback(QWaylandSurface *surface)
 {
-    Q_ASSERT(resourceMap().isEmpty());
-    m_modifiers = modifiers;
+    SurfaceFeedback feedback = m_surfaceFeedback.take(surface);
+    QObject::disconnect(feedback.destroyConnection);
+    delete feedback.feedback;
 }
 
 void LinuxDmabuf::zwp_linux_dmabuf_v1_bind_resource(Resource *resource)
 {
+    // Version 4 clients get the formats and modifiers through feedback objects instead
+    if (resource->version() >= ZWP_LINUX_DMABUF_V1_GET_DEFAULT_FEEDBACK_SINCE_VERSION)
+        return;
+
     for (auto it = m_modifiers.constBegin(); it != m_modifiers.constEnd(); ++it) {
         auto format = it.key();
         auto modifiers = it.value();
@@ -77,6 +241,74 @@ void LinuxDmabuf::zwp_linux_dmabuf_v1_create_params(Resource *resource, uint32_t
     new LinuxDmabufParams(m_clientBufferIntegration, r); // deleted by the client, or when it disconnects
 }
 
+void LinuxDmabuf::zwp_linux_dmabuf_v1_get_default_feedback(Resource *resource, uint32_t id)
+{
+    m_defaultFeedback->addResource(resource->client(), id, resource->version());
+}
+
+void LinuxDmabuf::zwp_linux_dmabuf_v1_get_surface_feedback(Resource *resource, uint32_t id, struct ::wl_resource *surface)
+{
+    QWaylandSurface *waylandSurface = QWaylandSurface::fromResource(surface);
+    if (!waylandSurface) {
+        // Not a surface we know about, so all we can offer is the default feedback
+        m_defaultFeedback->addResource(resource->client(), id, resource->version());
+        return;
+    }
+    surfaceFeedback(waylandSurface).feedback->addResource(resource->client(), id, resource->version());
+}
+
+LinuxDmabufFeedback::LinuxDmabufFeedback(LinuxDmabuf *linuxDmabuf)
+    : m_linuxDmabuf(linuxDmabuf)
+{
+}
+
+// Sends the new tranches to all clients listening, unless nothing changed
+void LinuxDmabufFeedback::setTranches(const QVector<LinuxDmabufTranche> &tranches)
+{
+    const dev_t mainDevice = m_linuxDmabuf->mainDevice();
+    QVector<EncodedTranche> encodedTranches;
+    for (const LinuxDmabufTranche &tranche : tranches) {
+        EncodedTranche encoded;
+        const dev_t targetDevice = tranche.targetDevice ? tranche.targetDevice : mainDevice;
+        encoded.targetDevice = QByteArray(reinterpret_cast<const char *>(&targetDevice), sizeof(dev_t));
+        encoded.indices = m_linuxDmabuf->formatIndices(tranche);
+        encoded.flags = tranche.scanout ? ZWP_LINUX_DMABUF_FEEDBACK_V1_TRANCHE_FLAGS_SCANOUT : 0;
+        if (!encoded.indices.isEmpty())
+            encodedTranches << encoded;
+    }
+
+    if (encodedTranches == m_tranches)
+        return;
+
+    m_tranches = encodedTranches;
+    for (Resource *resource : resourceHash())
+        sendFeedback(resource);
+}
+
+void LinuxDmabufFeedback::addResource(wl_client *client, uint32_t id, int version)
+{
+    sendFeedback(add(client, id, version));
+}
+
+void LinuxDmabufFeedback::sendFeedback(Resource *resource)
+{
+    const dev_t mainDevice = m_linuxDmabuf->mainDevice();
+    send_format_table(resource->handle, m_linuxDmabuf->formatTableFd(), m_linuxDmabuf->formatTableSize());
+    send_main_device(resource->handle, QByteArray(reinterpret_cast<const char *>(&mainDevice), sizeof(dev_t)));
+    for (const EncodedTranche &tranche : qAsConst(m_tranches)) {
+        send_tranche_target_device(resource->handle, tranche.targetDevice);
+        send_tranche_flags(resource->handle, tranche.flags);
+        send_tranche_formats(resource->handle, tranche.indices);
+        send_tranche_done(resource->handle);
+    }
+    send_done(resource->handle);
+}
+
+void LinuxDmabufFeedback::zwp_linux_dmabuf_feedback_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
 LinuxDmabufParams::LinuxDmabufParams(LinuxDmabufClientBufferIntegration *clientBufferIntegration, wl_resource *resource)
     : zwp_linux_buffer_params_v1(resource)
     , m_clientBufferIntegration(clientBufferIntegration)
@@ -283,15 +515,11 @@ LinuxDmabufWlBuffer::~LinuxDmabufWlBuffer()
 void LinuxDmabufWlBuffer::buffer_destroy(Resource *resource)
 {
     Q_UNUSED(resource);
+    if (m_import) {
+        m_clientBufferIntegration->releaseImport(m_import);
+        m_import = nullptr;
+    }
     for (uint32_t i = 0; i < m_planesNumber; ++i) {
-        if (m_textures[i] != nullptr) {
-            m_clientBufferIntegration->deleteGLTextureWhenPossible(m_textures[i]);
-            m_textures[i] = nullptr;
-        }
-        if (m_eglImages[i] != EGL_NO_IMAGE_KHR) {
-            m_clientBufferIntegration->deleteImage(m_eglImages[i]);
-            m_eglImages[i] = EGL_NO_IMAGE_KHR;
-        }
         if (m_planes[i].fd != -1)
             close(m_planes[i].fd);
         m_planes[i].fd = -1;
@@ -299,18 +527,18 @@ void LinuxDmabufWlBuffer::buffer_destroy(Resource *resource)
     m_planesNumber = 0;
 }
 
-void LinuxDmabufWlBuffer::initImage(uint32_t plane, EGLImageKHR image)
+void LinuxDmabufWlBuffer::setImport(LinuxDmabufImport *import)
 {
-    Q_ASSERT(plane < m_planesNumber);
-    Q_ASSERT(m_eglImages.at(plane) == EGL_NO_IMAGE_KHR);
-    m_eglImages[plane] = image;
+    Q_ASSERT(!m_import);
+    m_import = import;
 }
 
 void LinuxDmabufWlBuffer::initTexture(uint32_t plane, QOpenGLTexture *texture)
 {
-    Q_ASSERT(plane < m_planesNumber);
-    Q_ASSERT(m_textures.at(plane) == nullptr);
-    m_textures[plane] = texture;
+    Q_ASSERT(m_import);
+    Q_ASSERT(plane < MaxDmabufPlanes);
+    Q_ASSERT(m_import->textures.at(plane) == nullptr);
+    m_import->textures[plane] = texture;
 }
 
 void LinuxDmabufWlBuffer::buffer_destroy_resource(Resource *resource)
@@ -31,12 +31,14 @@
 #define LINUXDMABUF_H
 
 #include "qwayland-server-linux-dmabuf-unstable-v1.h"
+#include "linuxdmabufimportcache.h"
 
 #include <QtWaylandCompositor/private/qwayland-server-wayland.h>
 #include <QtWaylandCompositor/private/qwlclientbufferintegration_p.h>
 
 #include <QtCore/QObject>
 #include <QtCore/QHash>
+#include <QtCore/QPair>
 #include <QtCore/QSize>
 #include <QtCore/QTextStream>
 #include <QtGui/QOpenGLTexture>
@@ -44,6 +46,8 @@
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 
+#include <sys/types.h>
+
 // compatibility with libdrm <= 2.4.74
 #ifndef DRM_FORMAT_RESERVED
 #define DRM_FORMAT_RESERVED           ((1ULL << 56) - 1)
@@ -68,6 +72,8 @@ QT_BEGIN_NAMESPACE
 
 class QWaylandCompositor;
 class QWaylandResource;
+class QWaylandSurface;
+class LinuxDmabuf;
 class LinuxDmabufParams;
 class LinuxDmabufClientBufferIntegration;
 
@@ -78,20 +84,90 @@ struct Plane {
     uint64_t modifiers = 0;
 };
 
+// A group of format/modifier pairs of the same preference, see zwp_linux_dmabuf_feedback_v1
+struct LinuxDmabufTranche {
+    dev_t targetDevice = 0; // 0 means the main device
+    bool scanout = false;
+    QHash<uint32_t, QVector<uint64_t>> modifiers; // key=DRM format, value=DRM modifiers, empty for implicit
+};
+
+class LinuxDmabufFeedback : public QtWaylandServer::zwp_linux_dmabuf_feedback_v1
+{
+public:
+    explicit LinuxDmabufFeedback(LinuxDmabuf *linuxDmabuf);
+
+    void setTranches(const QVector<LinuxDmabufTranche> &tranches);
+    void addResource(wl_client *client, uint32_t id, int version);
+
+protected:
+    void zwp_linux_dmabuf_feedback_v1_destroy(Resource *resource) override;
+
+private:
+    struct EncodedTranche {
+        QByteArray targetDevice;
+        QByteArray indices;
+        uint32_t flags = 0;
+        bool operator==(const EncodedTranche &other) const
+        {
+            return targetDevice == other.targetDevice && indices == other.indices && flags == other.flags;
+        }
+    };
+
+    void sendFeedback(Resource *resource);
+
+    LinuxDmabuf *m_linuxDmabuf = nullptr;
+    QVector<EncodedTranche> m_tranches;
+};
+
 class LinuxDmabuf : public QtWaylandServer::zwp_linux_dmabuf_v1
 {
 public:
-    explicit LinuxDmabuf(wl_display *display, LinuxDmabufClientBufferIntegration *clientBufferIntegration);
+    explicit LinuxDmabuf(wl_display *display, LinuxDmabufClientBufferIntegration *clientBufferIntegration,
+                         const QHash<uint32_t, QVector<uint64_t>> &modifiers, dev_t mainDevice);
+    ~LinuxDmabuf() override;
 
-    void setSupportedModifiers(const QHash<uint32_t, QVector<uint64_t>> &modifiers);
+    void setDefaultFeedback(const QVector<LinuxDmabufTranche> &tranches);
+    void setSurfaceFeedback(QWaylandSurface *surface, const QVector<LinuxDmabufTranche> &tranches);
+
+    int formatTableFd() const { return m_formatTableFd; }
+    uint32_t formatTableSize() const { return uint32_t(m_formatTable.size() * sizeof(FormatTableEntry)); }
+    dev_t mainDevice() const { return m_mainDevice; }
+    QByteArray formatIndices(const LinuxDmabufTranche &tranche) const;
 
 protected:
     void zwp_linux_dmabuf_v1_bind_resource(Resource *resource) override;
     void zwp_linux_dmabuf_v1_create_params(Resource *resource, uint32_t params_id) override;
+    void zwp_linux_dmabuf_v1_get_default_feedback(Resource *resource, uint32_t id) override;
+    void zwp_linux_dmabuf_v1_get_surface_feedback(Resource *resource, uint32_t id, struct ::wl_resource *surface) override;
 
 private:
+    struct FormatTableEntry {
+        uint32_t format;
+        uint32_t padding;
+        uint64_t modifier;
+    };
+    struct SurfaceFeedback {
+        LinuxDmabufFeedback *feedback = nullptr;
+        QVector<LinuxDmabufTranche> tranches; // empty to follow the default feedback
+        QMetaObject::Connection destroyConnection;
+    };
+
+    void createFormatTable();
+    SurfaceFeedback &surfaceFeedback(QWaylandSurface *surface);
+    void removeSurfaceFeedback(QWaylandSurface *surface);
+
     QHash<uint32_t, QVector<uint64_t>> m_modifiers; // key=DRM format, value=supported DRM modifiers for format
     LinuxDmabufClientBufferIntegration *m_clientBufferIntegration;
+
+    // Shared by all feedback objects: a sealed memfd with the format/modifier pairs
+    QVector<FormatTableEntry> m_formatTable;
+    QHash<QPair<uint32_t, uint64_t>, uint16_t> m_formatTableIndices;
+    int m_formatTableFd = -1;
+    dev_t m_mainDevice = 0;
+
+    QVector<LinuxDmabufTranche> m_defaultTranches;
+    LinuxDmabufFeedback *m_defaultFeedback = nullptr;
+    QHash<QWaylandSurface *, SurfaceFeedback> m_surfaceFeedback;
 };
 
 class LinuxDmabufParams : public QtWaylandServer::zwp_linux_buffer_params_v1
@@ -125,18 +201,18 @@ public:
     explicit LinuxDmabufWlBuffer(::wl_client *client, LinuxDmabufClientBufferIntegration *clientBufferIntegration, uint id = 0);
     ~LinuxDmabufWlBuffer() override;
 
-    void initImage(uint32_t plane, EGLImageKHR image);
+    void setImport(LinuxDmabufImport *import);
     void initTexture(uint32_t plane, QOpenGLTexture *texture);
     inline QSize size() const { return m_size; }
     inline uint32_t flags() const { return m_flags; }
     inline uint32_t drmFormat() const { return m_drmFormat; }
     inline Plane& plane(uint index) { return m_planes.at(index); }
     inline uint32_t planesNumber() const { return m_planesNumber; }
-    inline EGLImageKHR image(uint32_t plane) { return m_eglImages.at(plane); }
-    inline QOpenGLTexture *texture(uint32_t plane) const { return m_textures.at(plane); }
+    inline EGLImageKHR image(uint32_t plane) { return m_import ? m_import->images.at(plane) : EGL_NO_IMAGE_KHR; }
+    inline QOpenGLTexture *texture(uint32_t plane) const { return m_import ? m_import->textures.at(plane) : nullptr; }
     void buffer_destroy_resource(Resource *resource) override;
 
-    static const uint32_t MaxDmabufPlanes = 4;
+    static const uint32_t MaxDmabufPlanes = LinuxDmabufImport::MaxPlanes;
 
 private:
     QSize m_size;
@@ -145,8 +221,7 @@ private:
     std::array<Plane, MaxDmabufPlanes> m_planes;
     uint32_t m_planesNumber = 1;
     LinuxDmabufClientBufferIntegration *m_clientBufferIntegration = nullptr;
-    std::array<EGLImageKHR, MaxDmabufPlanes> m_eglImages = { {EGL_NO_IMAGE_KHR, EGL_NO_IMAGE_KHR, EGL_NO_IMAGE_KHR, EGL_NO_IMAGE_KHR} };
-    std::array<QOpenGLTexture *, MaxDmabufPlanes> m_textures = { {nullptr, nullptr, nullptr, nullptr} };
+    LinuxDmabufImport *m_import = nullptr; // shared with other buffers for the same dmabufs
     void freeResources();
     void buffer_destroy(Resource *resource) override;
 
@@ -31,6 +31,7 @@
 #include "linuxdmabuf.h"
 
 #include <QtWaylandCompositor/QWaylandCompositor>
+#include <QtWaylandCompositor/QWaylandClient>
 #include <QtWaylandCompositor/private/qwayland-server-wayland.h>
 #include <qpa/qplatformnativeinterface.h>
 #include <QtGui/QGuiApplication>
@@ -40,6 +41,7 @@
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <drm_fourcc.h>
 
 QT_BEGIN_NAMESPACE
@@ -105,7 +107,7 @@ static QOpenGLTexture::TextureFormat openGLFormatFromBufferFormat(QWaylandBuffer
     }
 }
 
-bool LinuxDmabufClientBufferIntegration::initSimpleTexture(LinuxDmabufWlBuffer *dmabufBuffer)
+bool LinuxDmabufClientBufferIntegration::initSimpleTexture(LinuxDmabufWlBuffer *dmabufBuffer, LinuxDmabufImport *import)
 {
     bool success = true;
 
@@ -189,12 +191,12 @@ bool LinuxDmabufClientBufferIntegration::initSimpleTexture(LinuxDmabufWlBuffer *
             success = false;
         }
 
-        dmabufBuffer->initImage(i, image);
+        import->images[i] = image;
     }
     return success;
 }
 
-bool LinuxDmabufClientBufferIntegration::initYuvTexture(LinuxDmabufWlBuffer *dmabufBuffer)
+bool LinuxDmabufClientBufferIntegration::initYuvTexture(LinuxDmabufWlBuffer *dmabufBuffer, LinuxDmabufImport *import)
 {
     bool success = true;
 
@@ -242,13 +244,28 @@ bool LinuxDmabufClientBufferIntegration::initYuvTexture(LinuxDmabufWlBuffer *dma
             success = false;
         }
 
-        dmabufBuffer->initImage(i, image);
+        import->images[i] = image;
     }
     return success;
 }
 
 LinuxDmabufClientBufferIntegration::LinuxDmabufClientBufferIntegration()
+    : m_importCache([this](const LinuxDmabufImport &import) {
+                        for (QOpenGLTexture *texture : import.textures) {
+                            if (texture)
+                                deleteGLTextureWhenPossible(texture);
+                        }
+                        for (EGLImageKHR image : import.images) {
+                            if (image != EGL_NO_IMAGE_KHR)
+                                deleteImage(image);
+                        }
+                    })
 {
+    bool ok = false;
+    const int importCacheSize = qEnvironmentVariableIntValue("QT_WAYLAND_DMABUF_IMPORT_CACHE_SIZE", &ok);
+    if (ok)
+        m_importCache.setMaxUnusedImports(importCacheSize);
+
     YuvPlaneConversion firstPlane;
     firstPlane.format = DRM_FORMAT_GR88;
     firstPlane.widthDivisor = 1;
@@ -272,13 +289,13 @@ LinuxDmabufClientBufferIntegration::LinuxDmabufClientBufferIntegration()
 
 LinuxDmabufClientBufferIntegration::~LinuxDmabufClientBufferIntegration()
 {
+    for (const QMetaObject::Connection &connection : qAsConst(m_watchedClients))
+        QObject::disconnect(connection);
     m_importedBuffers.clear();
 }
 
 void LinuxDmabufClientBufferIntegration::initializeHardware(struct ::wl_display *display)
 {
-    m_linuxDmabuf.reset(new LinuxDmabuf(display, this));
-
     const bool ignoreBindDisplay = !qgetenv("QT_WAYLAND_IGNORE_BIND_DISPLAY").isEmpty() && qgetenv("QT_WAYLAND_IGNORE_BIND_DISPLAY").toInt() != 0;
 
     // initialize hardware extensions
@@ -341,7 +358,41 @@ void LinuxDmabufClientBufferIntegration::initializeHardware(struct ::wl_display
     for (const auto &format : supportedDrmFormats()) {
         modifiers[format] = supportedDrmModifiers(format);
     }
-    m_linuxDmabuf->setSupportedModifiers(modifiers);
+    m_linuxDmabuf.reset(new LinuxDmabuf(display, this, modifiers, findMainDevice()));
+}
+
+// Returns the DRM device behind the EGL display, which clients should allocate buffers for
+dev_t LinuxDmabufClientBufferIntegration::findMainDevice() const
+{
+    QByteArray devicePath = qgetenv("QT_WAYLAND_DMABUF_MAIN_DEVICE");
+    if (devicePath.isEmpty()) {
+        const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (!clientExtensions || !strstr(clientExtensions, "EGL_EXT_device_query"))
+            return 0;
+
+        auto queryDisplayAttrib = reinterpret_cast<PFNEGLQUERYDISPLAYATTRIBEXTPROC_compat>(eglGetProcAddress("eglQueryDisplayAttribEXT"));
+        auto queryDeviceString = reinterpret_cast<PFNEGLQUERYDEVICESTRINGEXTPROC_compat>(eglGetProcAddress("eglQueryDeviceStringEXT"));
+        EGLAttrib device = 0;
+        if (!queryDisplayAttrib || !queryDeviceString || !queryDisplayAttrib(m_eglDisplay, EGL_DEVICE_EXT, &device) || !device)
+            return 0;
+
+        // Prefer the render node, as clients do not need to be DRM master to use it
+        void *eglDevice = reinterpret_cast<void *>(device);
+        const char *deviceExtensions = queryDeviceString(eglDevice, EGL_EXTENSIONS);
+        if (deviceExtensions && strstr(deviceExtensions, "EGL_EXT_device_drm_render_node"))
+            devicePath = queryDeviceString(eglDevice, EGL_DRM_RENDER_NODE_FILE_EXT);
+        if (devicePath.isEmpty() && deviceExtensions && strstr(deviceExtensions, "EGL_EXT_device_drm"))
+            devicePath = queryDeviceString(eglDevice, EGL_DRM_DEVICE_FILE_EXT);
+        if (devicePath.isEmpty())
+            return 0;
+    }
+
+    struct stat deviceStat;
+    if (stat(devicePath.constData(), &deviceStat) != 0) {
+        qCWarning(qLcWaylandCompositorHardwareIntegration) << "Could not stat DRM device" << devicePath;
+        return 0;
+    }
+    return deviceStat.st_rdev;
 }
 
 QVector<uint32_t> LinuxDmabufClientBufferIntegration::supportedDrmFormats()
@@ -415,10 +466,73 @@ bool LinuxDmabufClientBufferIntegration::importBuffer(wl_resource *resource, Lin
         return false;
     }
     m_importedBuffers[resource] = linuxDmabufBuffer;
-    if (m_yuvFormats.contains(linuxDmabufBuffer->drmFormat()))
-        return initYuvTexture(linuxDmabufBuffer);
-    else
-        return initSimpleTexture(linuxDmabufBuffer);
+
+    auto createImages = [this, linuxDmabufBuffer](LinuxDmabufImport *import) {
+        if (m_yuvFormats.contains(linuxDmabufBuffer->drmFormat()))
+            return initYuvTexture(linuxDmabufBuffer, import);
+        else
+            return initSimpleTexture(linuxDmabufBuffer, import);
+    };
+
+    // Buffers for dmabufs that have been imported before reuse their images and textures
+    wl_client *client = wl_resource_get_client(resource);
+    LinuxDmabufImport *dmabufImport = m_importCache.acquire(importKey(linuxDmabufBuffer), client, createImages);
+    if (!dmabufImport)
+        return false;
+
+    linuxDmabufBuffer->setImport(dmabufImport);
+    watchClient(client);
+    return true;
+}
+
+void LinuxDmabufClientBufferIntegration::releaseImport(LinuxDmabufImport *import)
+{
+    m_importCache.release(import);
+}
+
+// Drops all cached imports, for instance when the dmabufs may have been written behind our back
+void LinuxDmabufClientBufferIntegration::invalidateImportCache()
+{
+    m_importCache.invalidate();
+}
+
+// Identifies the buffer by the dmabufs behind its fds, or returns an empty key if that fails
+LinuxDmabufImportKey LinuxDmabufClientBufferIntegration::importKey(LinuxDmabufWlBuffer *dmabufBuffer)
+{
+    LinuxDmabufImportKey key;
+    for (uint32_t i = 0; i < dmabufBuffer->planesNumber(); ++i) {
+        const Plane &plane = dmabufBuffer->plane(i);
+        struct stat planeStat;
+        if (fstat(plane.fd, &planeStat) != 0)
+            return LinuxDmabufImportKey();
+
+        LinuxDmabufPlaneKey planeKey;
+        planeKey.device = planeStat.st_dev;
+        planeKey.inode = planeStat.st_ino;
+        planeKey.offset = plane.offset;
+        planeKey.stride = plane.stride;
+        planeKey.modifier = plane.modifiers;
+        key.planes << planeKey;
+    }
+    key.drmFormat = dmabufBuffer->drmFormat();
+    key.size = dmabufBuffer->size();
+    return key;
+}
+
+// The dmabufs of a client that is gone cannot come back, so there is no need to cache them
+void LinuxDmabufClientBufferIntegration::watchClient(wl_client *client)
+{
+    if (!m_compositor || m_watchedClients.contains(client))
+        return;
+
+    QWaylandClient *waylandClient = QWaylandClient::fromWlClient(m_compositor, client);
+    if (!waylandClient)
+        return;
+
+    m_watchedClients.insert(client, QObject::connect(waylandClient, &QObject::destroyed, [this, client]() {
+        m_watchedClients.remove(client);
+        m_importCache.invalidate(client);
+    }));
 }
 
 void LinuxDmabufClientBufferIntegration::removeBuffer(wl_resource *resource)
@@ -433,6 +547,13 @@ LinuxDmabufClientBuffer::LinuxDmabufClientBuffer(LinuxDmabufClientBufferIntegrat
     , m_integration(integration)
 {
     d = dmabufBuffer;
+
+    int images = 0;
+    for (uint32_t i = 0; i < LinuxDmabufWlBuffer::MaxDmabufPlanes; ++i) {
+        if (d->image(i) != EGL_NO_IMAGE_KHR)
+            ++images;
+    }
+    accountEglImages(images);
 }
 
 QOpenGLTexture *LinuxDmabufClientBuffer::toOpenGlTexture(int plane)
@@ -440,7 +561,7 @@ QOpenGLTexture *LinuxDmabufClientBuffer::toOpenGlTexture(int plane)
     // At this point we should have a valid OpenGL context, so it's safe to destroy textures
     m_integration->deleteOrphanedTextures();
 
-    if (!m_buffer)
+    if (!m_buffer || d->image(plane) == EGL_NO_IMAGE_KHR)
         return nullptr;
 
     QOpenGLTexture *texture = d->texture(plane);
@@ -453,6 +574,7 @@ QOpenGLTexture *LinuxDmabufClientBuffer::toOpenGlTexture(int plane)
         texture->setSize(d->size().width(), d->size().height());
         texture->create();
         d->initTexture(plane, texture);
+        accountTextures(1, qint64(d->size().width()) * d->size().height() * 4);
     }
 
     if (m_textureDirty) {
@@ -486,6 +608,24 @@ QSize LinuxDmabufClientBuffer::size() const
     return d->size();
 }
 
+bool LinuxDmabufClientBuffer::dmabufAttributes(QtWayland::DmabufAttributes *attributes) const
+{
+    if (!m_buffer || !d)
+        return false;
+
+    attributes->drmFormat = d->drmFormat();
+    attributes->modifier = d->plane(0).modifiers;
+    attributes->size = d->size();
+    attributes->planeCount = int(qMin<uint32_t>(d->planesNumber(), QtWayland::DmabufAttributes::MaxPlanes));
+    for (int i = 0; i < attributes->planeCount; ++i) {
+        const Plane &plane = d->plane(i);
+        attributes->fds[i] = plane.fd;
+        attributes->offsets[i] = plane.offset;
+        attributes->strides[i] = plane.stride;
+    }
+    return true;
+}
+
 QWaylandSurface::Origin LinuxDmabufClientBuffer::origin() const
 {
     return (d->flags() & QtWaylandServer::zwp_linux_buffer_params_v1::flags_y_invert) ? QWaylandSurface::OriginBottomLeft : QWaylandSurface::OriginTopLeft;
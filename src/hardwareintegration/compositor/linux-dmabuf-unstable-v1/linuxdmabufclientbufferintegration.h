@@ -43,6 +43,18 @@ QT_BEGIN_NAMESPACE
 typedef EGLBoolean (EGLAPIENTRYP PFNEGLQUERYWAYLANDBUFFERWL_compat) (EGLDisplay dpy, struct wl_resource *buffer, EGLint attribute, EGLint *value);
 typedef EGLBoolean (EGLAPIENTRYP PFNEGLQUERYDMABUFFORMATSEXTPROC) (EGLDisplay dpy, EGLint max_formats, EGLint *formats, EGLint *num_formats);
 typedef EGLBoolean (EGLAPIENTRYP PFNEGLQUERYDMABUFMODIFIERSEXTPROC) (EGLDisplay dpy, EGLint format, EGLint max_modifiers, EGLuint64KHR *modifiers, EGLBoolean *external_only, EGLint *num_modifiers);
+typedef EGLBoolean (EGLAPIENTRYP PFNEGLQUERYDISPLAYATTRIBEXTPROC_compat) (EGLDisplay dpy, EGLint attribute, EGLAttrib *value);
+typedef const char *(EGLAPIENTRYP PFNEGLQUERYDEVICESTRINGEXTPROC_compat) (void *device, EGLint name);
+
+#ifndef EGL_DEVICE_EXT
+#define EGL_DEVICE_EXT 0x322C
+#endif
+#ifndef EGL_DRM_DEVICE_FILE_EXT
+#define EGL_DRM_DEVICE_FILE_EXT 0x3233
+#endif
+#ifndef EGL_DRM_RENDER_NODE_FILE_EXT
+#define EGL_DRM_RENDER_NODE_FILE_EXT 0x3377
+#endif
 
 class LinuxDmabufClientBufferIntegrationPrivate;
 class LinuxDmabufParams;
@@ -73,7 +85,10 @@ public:
     void removeBuffer(wl_resource *resource);
     void deleteOrphanedTextures();
     void deleteImage(EGLImageKHR image);
+    void releaseImport(LinuxDmabufImport *import);
+    void invalidateImportCache();
     void deleteGLTextureWhenPossible(QOpenGLTexture *texture) { m_orphanedTextures << texture; }
+    LinuxDmabuf *linuxDmabuf() const { return m_linuxDmabuf.data(); }
     PFNGLEGLIMAGETARGETTEXTURE2DOESPROC gl_egl_image_target_texture_2d = nullptr;
 
 private:
@@ -86,10 +101,13 @@ private:
     PFNEGLQUERYDMABUFMODIFIERSEXTPROC egl_query_dmabuf_modifiers_ext = nullptr;
     PFNEGLQUERYDMABUFFORMATSEXTPROC egl_query_dmabuf_formats_ext = nullptr;
 
-    bool initSimpleTexture(LinuxDmabufWlBuffer *dmabufBuffer);
-    bool initYuvTexture(LinuxDmabufWlBuffer *dmabufBuffer);
+    bool initSimpleTexture(LinuxDmabufWlBuffer *dmabufBuffer, LinuxDmabufImport *import);
+    bool initYuvTexture(LinuxDmabufWlBuffer *dmabufBuffer, LinuxDmabufImport *import);
+    static LinuxDmabufImportKey importKey(LinuxDmabufWlBuffer *dmabufBuffer);
+    void watchClient(wl_client *client);
     QVector<uint32_t> supportedDrmFormats();
     QVector<uint64_t> supportedDrmModifiers(uint32_t format);
+    dev_t findMainDevice() const;
 
     EGLDisplay m_eglDisplay = EGL_NO_DISPLAY;
     bool m_displayBound = false;
@@ -97,6 +115,8 @@ private:
     QHash<EGLint, YuvFormatConversion> m_yuvFormats;
     bool m_supportsDmabufModifiers = false;
     QHash<struct ::wl_resource *, LinuxDmabufWlBuffer *> m_importedBuffers;
+    LinuxDmabufImportCache m_importCache;
+    QHash<wl_client *, QMetaObject::Connection> m_watchedClients;
     QScopedPointer<LinuxDmabuf> m_linuxDmabuf;
 };
 
@@ -109,6 +129,7 @@ public:
     QSize size() const override;
     QWaylandSurface::Origin origin() const override;
     QOpenGLTexture *toOpenGlTexture(int plane) override;
+    bool dmabufAttributes(QtWayland::DmabufAttributes *attributes) const override;
 
 protected:
     void setDestroyed() override;
@@ -0,0 +1,193 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "linuxdmabufimportcache.h"
+
+QT_BEGIN_NAMESPACE
+
+bool operator==(const LinuxDmabufPlaneKey &a, const LinuxDmabufPlaneKey &b)
+{
+    return a.device == b.device && a.inode == b.inode && a.offset == b.offset
+            && a.stride == b.stride && a.modifier == b.modifier;
+}
+
+bool operator==(const LinuxDmabufImportKey &a, const LinuxDmabufImportKey &b)
+{
+    return a.drmFormat == b.drmFormat && a.size == b.size && a.planes == b.planes;
+}
+
+uint qHash(const LinuxDmabufPlaneKey &key, uint seed)
+{
+    seed = ::qHash(quint64(key.device), seed);
+    seed = ::qHash(quint64(key.inode), seed);
+    seed = ::qHash(key.offset, seed);
+    seed = ::qHash(key.stride, seed);
+    return ::qHash(quint64(key.modifier), seed);
+}
+
+uint qHash(const LinuxDmabufImportKey &key, uint seed)
+{
+    seed = ::qHash(key.drmFormat, seed);
+    seed = ::qHash(key.size.width(), seed);
+    seed = ::qHash(key.size.height(), seed);
+    for (const LinuxDmabufPlaneKey &plane : key.planes)
+        seed = qHash(plane, seed);
+    return seed;
+}
+
+/*
+    Keeps the EGL images and textures made for dmabufs around after their wl_buffer is
+    gone, so that a client creating a new wl_buffer for the same dmabufs, like when
+    recreating a swapchain, does not pay for a new import. At most maxUnusedImports
+    imports without a buffer are kept; release is called for the ones dropped.
+
+    The images keep the dmabufs alive, so their device and inode numbers cannot be
+    reused for other memory while they are cached.
+*/
+LinuxDmabufImportCache::LinuxDmabufImportCache(const ReleaseFunction &release, int maxUnusedImports)
+    : m_release(release)
+    , m_maxUnused(qMax(0, maxUnusedImports))
+{
+}
+
+LinuxDmabufImportCache::~LinuxDmabufImportCache()
+{
+    for (Entry *entry : qAsConst(m_entries)) {
+        m_release(entry->import);
+        delete entry;
+    }
+}
+
+/*
+    Returns the import for key, calling import to make it if there is none, or nullptr if
+    that fails. Every successful call must be matched by a call to release().
+*/
+LinuxDmabufImport *LinuxDmabufImportCache::acquire(const LinuxDmabufImportKey &key, wl_client *client, const ImportFunction &import)
+{
+    if (!key.planes.isEmpty()) {
+        Entry *entry = m_cached.value(key);
+        if (entry) {
+            if (!entry->refCount++)
+                --m_unused;
+            return &entry->import;
+        }
+    }
+
+    auto *entry = new Entry;
+    if (!import(&entry->import)) {
+        m_release(entry->import);
+        delete entry;
+        return nullptr;
+    }
+
+    entry->key = key;
+    entry->client = client;
+    entry->refCount = 1;
+    entry->cached = !key.planes.isEmpty();
+    if (entry->cached)
+        m_cached.insert(key, entry);
+    m_entries.insert(&entry->import, entry);
+    return &entry->import;
+}
+
+void LinuxDmabufImportCache::release(LinuxDmabufImport *import)
+{
+    Entry *entry = m_entries.value(import);
+    Q_ASSERT(entry && entry->refCount > 0);
+    if (!entry || --entry->refCount)
+        return;
+
+    if (!entry->cached) {
+        destroy(entry);
+        return;
+    }
+
+    entry->lastUsed = ++m_usageCounter;
+    ++m_unused;
+    trim();
+}
+
+/*
+    Forgets the imports made for client, or all imports if client is nullptr. Unused
+    imports are released right away, the others when their last user is done.
+*/
+void LinuxDmabufImportCache::invalidate(wl_client *client)
+{
+    const auto entries = m_entries.values();
+    for (Entry *entry : entries) {
+        if (client && entry->client != client)
+            continue;
+        if (entry->refCount)
+            uncache(entry);
+        else
+            destroy(entry);
+    }
+}
+
+void LinuxDmabufImportCache::setMaxUnusedImports(int count)
+{
+    m_maxUnused = qMax(0, count);
+    trim();
+}
+
+void LinuxDmabufImportCache::uncache(Entry *entry)
+{
+    if (entry->cached) {
+        m_cached.remove(entry->key);
+        entry->cached = false;
+    }
+}
+
+void LinuxDmabufImportCache::destroy(Entry *entry)
+{
+    if (entry->cached && !entry->refCount)
+        --m_unused;
+    uncache(entry);
+    m_entries.remove(&entry->import);
+    m_release(entry->import);
+    delete entry;
+}
+
+// Drops the least recently used unused imports until there are no more than allowed
+void LinuxDmabufImportCache::trim()
+{
+    while (m_unused > m_maxUnused) {
+        Entry *oldest = nullptr;
+        for (Entry *entry : qAsConst(m_cached)) {
+            if (!entry->refCount && (!oldest || entry->lastUsed < oldest->lastUsed))
+                oldest = entry;
+        }
+        if (!oldest)
+            break;
+        destroy(oldest);
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,121 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef LINUXDMABUFIMPORTCACHE_H
+#define LINUXDMABUFIMPORTCACHE_H
+
+#include <QtCore/QHash>
+#include <QtCore/QSize>
+#include <QtCore/QVector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <array>
+#include <functional>
+#include <sys/types.h>
+
+struct wl_client;
+
+QT_BEGIN_NAMESPACE
+
+class QOpenGLTexture;
+
+// Identifies the memory behind a dmabuf plane, whichever fd refers to it
+struct LinuxDmabufPlaneKey {
+    dev_t device = 0;
+    ino_t inode = 0;
+    uint32_t offset = 0;
+    uint32_t stride = 0;
+    uint64_t modifier = 0;
+};
+
+// A key without planes identifies nothing, imports made with it are never shared
+struct LinuxDmabufImportKey {
+    uint32_t drmFormat = 0;
+    QSize size;
+    QVector<LinuxDmabufPlaneKey> planes;
+};
+
+bool operator==(const LinuxDmabufPlaneKey &a, const LinuxDmabufPlaneKey &b);
+bool operator==(const LinuxDmabufImportKey &a, const LinuxDmabufImportKey &b);
+uint qHash(const LinuxDmabufPlaneKey &key, uint seed = 0);
+uint qHash(const LinuxDmabufImportKey &key, uint seed = 0);
+
+struct LinuxDmabufImport {
+    static const uint32_t MaxPlanes = 4;
+    std::array<EGLImageKHR, MaxPlanes> images = { {EGL_NO_IMAGE_KHR, EGL_NO_IMAGE_KHR, EGL_NO_IMAGE_KHR, EGL_NO_IMAGE_KHR} };
+    std::array<QOpenGLTexture *, MaxPlanes> textures = { {nullptr, nullptr, nullptr, nullptr} };
+};
+
+class LinuxDmabufImportCache
+{
+public:
+    typedef std::function<bool(LinuxDmabufImport *import)> ImportFunction;
+    typedef std::function<void(const LinuxDmabufImport &import)> ReleaseFunction;
+
+    explicit LinuxDmabufImportCache(const ReleaseFunction &release, int maxUnusedImports = 8);
+    ~LinuxDmabufImportCache();
+
+    LinuxDmabufImport *acquire(const LinuxDmabufImportKey &key, wl_client *client, const ImportFunction &import);
+    void release(LinuxDmabufImport *import);
+    void invalidate(wl_client *client = nullptr);
+
+    void setMaxUnusedImports(int count);
+    int maxUnusedImports() const { return m_maxUnused; }
+    int count() const { return m_entries.size(); }
+    int unusedCount() const { return m_unused; }
+
+private:
+    Q_DISABLE_COPY(LinuxDmabufImportCache)
+
+    struct Entry {
+        LinuxDmabufImport import;
+        LinuxDmabufImportKey key;
+        wl_client *client = nullptr;
+        int refCount = 0;
+        quint64 lastUsed = 0;
+        bool cached = false;
+    };
+
+    void uncache(Entry *entry);
+    void destroy(Entry *entry);
+    void trim();
+
+    ReleaseFunction m_release;
+    QHash<LinuxDmabufImportKey, Entry *> m_cached;
+    QHash<LinuxDmabufImport *, Entry *> m_entries;
+    int m_maxUnused = 8;
+    int m_unused = 0;
+    quint64 m_usageCounter = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif // LINUXDMABUFIMPORTCACHE_H
@@ -31,20 +31,46 @@
 
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLTexture>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
 #include <QtCore/QSharedMemory>
 
 #include <QtCore/QDebug>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef Q_OS_LINUX
+#  include <sys/syscall.h>
+// from linux/memfd.h:
+#  ifndef MFD_CLOEXEC
+#    define MFD_CLOEXEC     0x0001U
+#  endif
+#  ifndef MFD_ALLOW_SEALING
+#    define MFD_ALLOW_SEALING 0x0002U
+#  endif
+// from linux/fcntl.h:
+#  ifndef F_ADD_SEALS
+#    define F_ADD_SEALS     1033
+#    define F_SEAL_SEAL     0x0001
+#    define F_SEAL_SHRINK   0x0002
+#    define F_SEAL_GROW     0x0004
+#    define F_SEAL_WRITE    0x0008
+#  endif
+#endif
+
 QT_BEGIN_NAMESPACE
 
-ShmServerBuffer::ShmServerBuffer(ShmServerBufferIntegration *integration, const QImage &qimage, QtWayland::ServerBuffer::Format format)
-    : QtWayland::ServerBuffer(qimage.size(),format)
+ShmServerBuffer::ShmServerBuffer(ShmServerBufferIntegration *integration, const QSize &size, int bytesPerLine, QtWayland::ServerBuffer::Format format)
+    : QtWayland::ServerBuffer(size, format)
     , m_integration(integration)
-    , m_width(qimage.width())
-    , m_height(qimage.height())
-    , m_bpl(qimage.bytesPerLine())
+    , m_width(size.width())
+    , m_height(size.height())
+    , m_bpl(bytesPerLine)
+    , m_byteCount(size_t(bytesPerLine) * size_t(size.height()))
 {
-    m_format = format;
     switch (m_format) {
         case RGBA32:
             m_shm_format = QtWaylandServer::qt_shm_emulation_server_buffer::format_RGBA32;
@@ -57,36 +83,146 @@ ShmServerBuffer::ShmServerBuffer(ShmServerBufferIntegration *integration, const
             m_shm_format = QtWaylandServer::qt_shm_emulation_server_buffer::format_RGBA32;
             break;
     }
+}
 
-    QString key = "qt_shm_emulation_" + QString::number(qimage.cacheKey());
-    m_shm = new QSharedMemory(key);
-    qsizetype shm_size = qimage.sizeInBytes();
-    bool ok = m_shm->create(shm_size) && m_shm->lock();
-    if (ok) {
-        memcpy(m_shm->data(), qimage.constBits(), shm_size);
-        m_shm->unlock();
-    } else {
-        qWarning() << "Could not create shared memory" << key << shm_size;
+ShmServerBuffer::ShmServerBuffer(ShmServerBufferIntegration *integration, const QImage &qimage, QtWayland::ServerBuffer::Format format)
+    : ShmServerBuffer(integration, qimage.size(), qimage.bytesPerLine(), format)
+{
+    if (uchar *data = beginWrite()) {
+        memcpy(data, qimage.constBits(), m_byteCount);
+        endWrite(data);
+    }
+}
+
+// Reads the pixels straight into the shared memory, without a copy in between
+ShmServerBuffer::ShmServerBuffer(ShmServerBufferIntegration *integration, int fd, qint64 offset, const QSize &size, int bytesPerLine, QtWayland::ServerBuffer::Format format)
+    : ShmServerBuffer(integration, size, bytesPerLine, format)
+{
+    uchar *data = beginWrite();
+    if (!data)
+        return;
+
+    size_t done = 0;
+    while (done < m_byteCount) {
+        ssize_t n = pread(fd, data + done, m_byteCount - done, off_t(offset) + off_t(done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += size_t(n);
+    }
+    endWrite(data);
+
+    if (done < m_byteCount) {
+        qWarning() << "ShmServerBuffer: could only read" << done << "of" << m_byteCount << "bytes";
+        if (m_fd != -1)
+            close(m_fd);
+        m_fd = -1;
+        delete m_shm;
+        m_shm = nullptr;
     }
 }
 
 ShmServerBuffer::~ShmServerBuffer()
 {
+    if (m_fd != -1)
+        close(m_fd);
     delete m_shm;
 }
 
+// Returns the memory to write the pixels to: a memfd where available, so that clients get
+// the buffer by fd and nothing outlives the compositor, otherwise a SysV segment shared by key.
+uchar *ShmServerBuffer::beginWrite()
+{
+    if (m_byteCount == 0)
+        return nullptr;
+
+#ifdef SYS_memfd_create
+    m_fd = syscall(SYS_memfd_create, "qt-shm-emulation-server-buffer", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (m_fd != -1) {
+        if (ftruncate(m_fd, off_t(m_byteCount)) == 0) {
+            void *data = mmap(nullptr, m_byteCount, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+            if (data != MAP_FAILED)
+                return static_cast<uchar *>(data);
+        }
+        qErrnoWarning("ShmServerBuffer: could not set up memfd");
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+
+    QSharedMemory *shm = sharedMemory();
+    return shm && shm->lock() ? static_cast<uchar *>(shm->data()) : nullptr;
+}
+
+void ShmServerBuffer::endWrite(uchar *data)
+{
+    if (m_fd == -1) {
+        m_shm->unlock();
+        return;
+    }
+
+    munmap(data, m_byteCount);
+#ifdef Q_OS_LINUX
+    // Clients can map the buffer, but can neither change nor resize it
+    if (fcntl(m_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1)
+        qErrnoWarning("ShmServerBuffer: could not seal memfd");
+#endif
+}
+
+// The SysV segment for clients that only know version 1 of the protocol, created on demand
+// when the pixels live in a memfd.
+QSharedMemory *ShmServerBuffer::sharedMemory()
+{
+    if (m_shm)
+        return m_shm;
+
+    static QAtomicInt serial;
+    QString key = QLatin1String("qt_shm_emulation_") + QString::number(QCoreApplication::applicationPid())
+            + QLatin1Char('_') + QString::number(serial.fetchAndAddRelaxed(1));
+    QScopedPointer<QSharedMemory> shm(new QSharedMemory(key));
+    if (!shm->create(int(m_byteCount))) {
+        qWarning() << "Could not create shared memory" << key << m_byteCount;
+        return nullptr;
+    }
+
+    if (m_fd != -1) {
+        void *data = mmap(nullptr, m_byteCount, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (data == MAP_FAILED || !shm->lock()) {
+            if (data != MAP_FAILED)
+                munmap(data, m_byteCount);
+            qWarning() << "Could not fill shared memory" << key;
+            return nullptr;
+        }
+        memcpy(shm->data(), data, m_byteCount);
+        shm->unlock();
+        munmap(data, m_byteCount);
+    }
+
+    m_shm = shm.take();
+    return m_shm;
+}
+
 struct ::wl_resource *ShmServerBuffer::resourceForClient(struct ::wl_client *client)
 {
-    auto *bufferResource = resourceMap().value(client);
+    auto *bufferResource = clientResource(client);
     if (!bufferResource) {
-        auto integrationResource = m_integration->resourceMap().value(client);
+        auto integrationResource = m_integration->clientResource(client);
         if (!integrationResource) {
             qWarning("ShmServerBuffer::resourceForClient: Trying to get resource for ServerBuffer. But client is not bound to the shm_emulation interface");
             return nullptr;
         }
         struct ::wl_resource *shm_integration_resource = integrationResource->handle;
+        if (m_fd != -1 && integrationResource->version() >= 2) {
+            Resource *resource = add(client, 1);
+            m_integration->send_server_buffer_created_fd(shm_integration_resource, resource->handle, m_fd, m_width, m_height, m_bpl, m_shm_format);
+            return resource->handle;
+        }
+        QSharedMemory *shm = sharedMemory();
+        if (!shm)
+            return nullptr;
         Resource *resource = add(client, 1);
-        m_integration->send_server_buffer_created(shm_integration_resource, resource->handle, m_shm->key(), m_width, m_height, m_bpl, m_shm_format);
+        m_integration->send_server_buffer_created(shm_integration_resource, resource->handle, shm->key(), m_width, m_height, m_bpl, m_shm_format);
         return resource->handle;
     }
     return bufferResource->handle;
@@ -94,7 +230,7 @@ struct ::wl_resource *ShmServerBuffer::resourceForClient(struct ::wl_client *cli
 
 bool ShmServerBuffer::bufferInUse()
 {
-    return resourceMap().count() > 0;
+    return resourceHash().count() > 0;
 }
 
 QOpenGLTexture *ShmServerBuffer::toOpenGlTexture()
@@ -117,7 +253,7 @@ bool ShmServerBufferIntegration::initializeHardware(QWaylandCompositor *composit
 {
     Q_ASSERT(QGuiApplication::platformNativeInterface());
 
-    QtWaylandServer::qt_shm_emulation_server_buffer::init(compositor->display(), 1);
+    QtWaylandServer::qt_shm_emulation_server_buffer::init(compositor->display(), 2);
     return true;
 }
 
@@ -138,4 +274,10 @@ QtWayland::ServerBuffer *ShmServerBufferIntegration::createServerBufferFromImage
     return new ShmServerBuffer(this, qimage, format);
 }
 
+QtWayland::ServerBuffer *ShmServerBufferIntegration::createServerBufferFromFile(int fd, qint64 offset, const QSize &size, int bytesPerLine, QtWayland::ServerBuffer::Format format)
+{
+    QScopedPointer<ShmServerBuffer> buffer(new ShmServerBuffer(this, fd, offset, size, bytesPerLine, format));
+    return buffer->isValid() ? buffer.take() : nullptr;
+}
+
 QT_END_NAMESPACE
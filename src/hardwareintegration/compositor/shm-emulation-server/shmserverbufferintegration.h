@@ -51,19 +51,29 @@ class ShmServerBuffer : public QtWayland::ServerBuffer, public QtWaylandServer::
 {
 public:
     ShmServerBuffer(ShmServerBufferIntegration *integration, const QImage &qimage, QtWayland::ServerBuffer::Format format);
+    ShmServerBuffer(ShmServerBufferIntegration *integration, int fd, qint64 offset, const QSize &size, int bytesPerLine, QtWayland::ServerBuffer::Format format);
     ~ShmServerBuffer() override;
 
     struct ::wl_resource *resourceForClient(struct ::wl_client *) override;
     bool bufferInUse() override;
     QOpenGLTexture *toOpenGlTexture() override;
 
+    bool isValid() const { return m_fd != -1 || m_shm; }
+
 private:
+    ShmServerBuffer(ShmServerBufferIntegration *integration, const QSize &size, int bytesPerLine, QtWayland::ServerBuffer::Format format);
+    uchar *beginWrite();
+    void endWrite(uchar *data);
+    QSharedMemory *sharedMemory();
+
     ShmServerBufferIntegration *m_integration = nullptr;
 
+    int m_fd = -1;
     QSharedMemory *m_shm = nullptr;
     int m_width;
     int m_height;
     int m_bpl;
+    size_t m_byteCount;
     QOpenGLTexture *m_texture = nullptr;
     QtWaylandServer::qt_shm_emulation_server_buffer::format m_shm_format;
 };
@@ -80,7 +90,7 @@ public:
 
     bool supportsFormat(QtWayland::ServerBuffer::Format format) const override;
     QtWayland::ServerBuffer *createServerBufferFromImage(const QImage &qimage, QtWayland::ServerBuffer::Format format) override;
-
+    QtWayland::ServerBuffer *createServerBufferFromFile(int fd, qint64 offset, const QSize &size, int bytesPerLine, QtWayland::ServerBuffer::Format format) override;
 
 private:
 };
@@ -179,14 +179,16 @@ VulkanServerBuffer::~VulkanServerBuffer()
 
 struct ::wl_resource *VulkanServerBuffer::resourceForClient(struct ::wl_client *client)
 {
-    auto *bufferResource = resourceMap().value(client);
+    auto *bufferResource = clientResource(client);
     if (!bufferResource) {
-        auto integrationResource = m_integration->resourceMap().value(client);
+        auto integrationResource = m_integration->clientResource(client);
         if (!integrationResource) {
             qWarning("VulkanServerBuffer::resourceForClient: Trying to get resource for ServerBuffer. But client is not bound to the vulkan interface");
             return nullptr;
         }
         struct ::wl_resource *shm_integration_resource = integrationResource->handle;
+        // The client may use the memory right away, so the upload has to be done by then
+        m_integration->vulkanWrapper()->waitForUpload(m_vImage);
         Resource *resource = add(client, 1);
         m_integration->send_server_buffer_created(shm_integration_resource, resource->handle, m_fd, m_width, m_height, m_memorySize, m_glInternalFormat);
         return resource->handle;
@@ -204,6 +206,8 @@ QOpenGLTexture *VulkanServerBuffer::toOpenGlTexture()
     if (!funcs && !VulkanServerBufferGlFunctions::create(current.context()))
         return nullptr;
 
+    m_integration->vulkanWrapper()->waitForUpload(m_vImage);
+
     funcs->glCreateMemoryObjectsEXT(1, &m_memoryObject);
     if (extraDebug) qDebug() << "glCreateMemoryObjectsEXT" << Qt::hex << glGetError();
 
@@ -248,7 +252,7 @@ void VulkanServerBuffer::releaseOpenGlTexture()
 
 bool VulkanServerBuffer::bufferInUse()
 {
-    return (m_texture && m_texture->isCreated()) || resourceMap().count() > 0;
+    return (m_texture && m_texture->isCreated()) || resourceHash().count() > 0;
 }
 
 void VulkanServerBuffer::server_buffer_release(Resource *resource)
@@ -75,6 +75,7 @@ public:
     VulkanImageWrapper *createTextureImageFromData(const uchar *pixels, uint bufferSize, const QSize &size, VkFormat vkFormat);
 
     void freeTextureImage(VulkanImageWrapper *imageWrapper);
+    void waitForUpload(VulkanImageWrapper *imageWrapper);
 
 private:
     DECL_VK_FUNCTION(vkAllocateCommandBuffers);
@@ -98,6 +99,11 @@ private:
     DECL_VK_FUNCTION(vkCreateBuffer);
     DECL_VK_FUNCTION(vkGetBufferMemoryRequirements);
     DECL_VK_FUNCTION(vkBindBufferMemory);
+    DECL_VK_FUNCTION(vkCreateFence);
+    DECL_VK_FUNCTION(vkDestroyFence);
+    DECL_VK_FUNCTION(vkResetFences);
+    DECL_VK_FUNCTION(vkWaitForFences);
+    DECL_VK_FUNCTION(vkResetCommandBuffer);
 
     DECL_VK_FUNCTION(vkCreateInstance);
     DECL_VK_FUNCTION(vkEnumeratePhysicalDevices);
@@ -136,6 +142,11 @@ private:
         IMPL_VK_FUNCTION(vkCreateBuffer);
         IMPL_VK_FUNCTION(vkGetBufferMemoryRequirements);
         IMPL_VK_FUNCTION(vkBindBufferMemory);
+        IMPL_VK_FUNCTION(vkCreateFence);
+        IMPL_VK_FUNCTION(vkDestroyFence);
+        IMPL_VK_FUNCTION(vkResetFences);
+        IMPL_VK_FUNCTION(vkWaitForFences);
+        IMPL_VK_FUNCTION(vkResetCommandBuffer);
 
         IMPL_VK_FUNCTION(vkCreateInstance);
         IMPL_VK_FUNCTION(vkEnumeratePhysicalDevices);
@@ -155,12 +166,33 @@ private:
 
     int findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+    // Uploads are recorded into the command buffer of a batch, copying from that batch's
+    // slice of a persistently mapped staging ring. A batch is submitted with a fence when its
+    // slice is full or when one of its images is needed, and its slice is reused once the
+    // fence has signaled.
+    struct UploadBatch
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        quint64 serial = 0;
+        VkDeviceSize stagingUsed = 0;
+        bool pending = false;
+    };
+    static constexpr int UploadBatchCount = 2;
+    static constexpr VkDeviceSize StagingSliceSize = 16 * 1024 * 1024;
+    static constexpr VkDeviceSize StagingAlignment = 16;
+
     VulkanImageWrapper *createImage(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, const QSize &size, int memSize);
-    bool transitionImageLayout(VkImage image, VkFormat /*format*/, VkImageLayout oldLayout, VkImageLayout newLayout);
+    void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout);
     bool createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+    void copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkImage image, uint32_t width, uint32_t height);
+    void recordUpload(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkImage image, const QSize &size);
+    bool ensureUploadResources();
+    UploadBatch *batchForUpload(VkDeviceSize size);
+    void submitBatch(UploadBatch *batch);
+    void waitForBatch(UploadBatch *batch);
     void createCommandPool();
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
     bool createLogicalDevice();
@@ -173,6 +205,14 @@ private:
 
     VkQueue m_graphicsQueue = VK_NULL_HANDLE;
 
+    UploadBatch m_batches[UploadBatchCount];
+    UploadBatch *m_recordingBatch = nullptr;
+    int m_nextBatch = 0;
+    quint64 m_batchSerial = 0;
+    VkBuffer m_stagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_stagingMemory = VK_NULL_HANDLE;
+    uchar *m_stagingData = nullptr;
+
     bool m_initFailed = false;
 };
 
@@ -183,6 +223,7 @@ struct VulkanImageWrapper
     QSize imgSize;
     int imgFd = -1;
     VkDeviceMemory textureImageMemory = VK_NULL_HANDLE;
+    quint64 uploadSerial = 0; // the batch uploading the pixels, 0 once they are known to be there
 };
 
 int VulkanWrapperPrivate::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
@@ -267,10 +308,8 @@ VulkanImageWrapper *VulkanWrapperPrivate::createImage(VkFormat format, VkImageTi
 }
 
 
-bool VulkanWrapperPrivate::transitionImageLayout(VkImage image, VkFormat /*format*/, VkImageLayout oldLayout, VkImageLayout newLayout)
+void VulkanWrapperPrivate::transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
     VkImageMemoryBarrier barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout = oldLayout;
@@ -293,15 +332,13 @@ bool VulkanWrapperPrivate::transitionImageLayout(VkImage image, VkFormat /*forma
 
         sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
         destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+    } else {
+        Q_ASSERT(oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        qCritical("VulkanWrapper: unsupported layout transition!");
-        return false;
     }
 
     vkCmdPipelineBarrier(
@@ -312,9 +349,6 @@ bool VulkanWrapperPrivate::transitionImageLayout(VkImage image, VkFormat /*forma
         0, nullptr,
         1, &barrier
         );
-
-    endSingleTimeCommands(commandBuffer);
-    return true;
 }
 
 bool VulkanWrapperPrivate::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
@@ -384,18 +418,26 @@ void VulkanWrapperPrivate::endSingleTimeCommands(VkCommandBuffer commandBuffer)
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(m_graphicsQueue);
+    // Waits for this submission only, rather than for everything on the queue
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence = VK_NULL_HANDLE;
+    if (vkCreateFence(m_device, &fenceInfo, nullptr, &fence) == VK_SUCCESS) {
+        vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, fence);
+        vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX);
+        vkDestroyFence(m_device, fence, nullptr);
+    } else {
+        vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(m_graphicsQueue);
+    }
 
     vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
 }
 
-void VulkanWrapperPrivate::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void VulkanWrapperPrivate::copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkImage image, uint32_t width, uint32_t height)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
     VkBufferImageCopy region = {};
-    region.bufferOffset = 0;
+    region.bufferOffset = offset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -410,8 +452,126 @@ void VulkanWrapperPrivate::copyBufferToImage(VkBuffer buffer, VkImage image, uin
     };
 
     vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
 
-    endSingleTimeCommands(commandBuffer);
+void VulkanWrapperPrivate::recordUpload(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkImage image, const QSize &size)
+{
+    transitionImageLayout(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    copyBufferToImage(commandBuffer, buffer, offset, image, static_cast<uint32_t>(size.width()), static_cast<uint32_t>(size.height()));
+    transitionImageLayout(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+bool VulkanWrapperPrivate::ensureUploadResources()
+{
+    if (m_stagingData)
+        return true;
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    for (UploadBatch &batch : m_batches) {
+        if (!batch.commandBuffer && vkAllocateCommandBuffers(m_device, &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+            qCritical("VulkanWrapper: failed to allocate upload command buffer!");
+            return false;
+        }
+        if (!batch.fence && vkCreateFence(m_device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+            qCritical("VulkanWrapper: failed to create upload fence!");
+            return false;
+        }
+    }
+
+    if (!m_stagingBuffer && !createBuffer(UploadBatchCount * StagingSliceSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                          m_stagingBuffer, m_stagingMemory)) {
+        return false;
+    }
+
+    void *data = nullptr;
+    if (vkMapMemory(m_device, m_stagingMemory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+        qCritical("VulkanWrapper: failed to map staging memory!");
+        return false;
+    }
+    m_stagingData = static_cast<uchar *>(data);
+    return true;
+}
+
+// Returns the batch to record an upload of size bytes into, starting a new one if needed
+VulkanWrapperPrivate::UploadBatch *VulkanWrapperPrivate::batchForUpload(VkDeviceSize size)
+{
+    UploadBatch *batch = m_recordingBatch;
+    if (batch) {
+        const VkDeviceSize offset = (batch->stagingUsed + StagingAlignment - 1) & ~(StagingAlignment - 1);
+        if (offset + size <= StagingSliceSize) {
+            batch->stagingUsed = offset;
+            return batch;
+        }
+        submitBatch(batch);
+    }
+
+    batch = &m_batches[m_nextBatch];
+    m_nextBatch = (m_nextBatch + 1) % UploadBatchCount;
+    if (batch->pending)
+        waitForBatch(batch);
+
+    vkResetCommandBuffer(batch->commandBuffer, 0);
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(batch->commandBuffer, &beginInfo);
+
+    batch->serial = ++m_batchSerial;
+    batch->stagingUsed = 0;
+    m_recordingBatch = batch;
+    return batch;
+}
+
+void VulkanWrapperPrivate::submitBatch(UploadBatch *batch)
+{
+    Q_ASSERT(batch == m_recordingBatch);
+    m_recordingBatch = nullptr;
+
+    vkEndCommandBuffer(batch->commandBuffer);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch->commandBuffer;
+
+    vkResetFences(m_device, 1, &batch->fence);
+    int res = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, batch->fence);
+    Q_UNUSED(res);
+    if (extraDebug) qDebug() << "submitted upload batch" << batch->serial << "res" << res;
+    batch->pending = true;
+}
+
+void VulkanWrapperPrivate::waitForBatch(UploadBatch *batch)
+{
+    vkWaitForFences(m_device, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+    batch->pending = false;
+}
+
+// Makes sure the pixels of the image have been uploaded, submitting its batch if needed
+void VulkanWrapperPrivate::waitForUpload(VulkanImageWrapper *imageWrapper)
+{
+    if (!imageWrapper || !imageWrapper->uploadSerial)
+        return;
+
+    for (UploadBatch &batch : m_batches) {
+        if (batch.serial != imageWrapper->uploadSerial)
+            continue;
+        if (&batch == m_recordingBatch)
+            submitBatch(&batch);
+        if (batch.pending)
+            waitForBatch(&batch);
+    }
+    // Otherwise the batch has been reused, which means it was waited for
+    imageWrapper->uploadSerial = 0;
 }
 
 void VulkanWrapperPrivate::createCommandPool()
@@ -420,6 +580,7 @@ void VulkanWrapperPrivate::createCommandPool()
 
     VkCommandPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
     poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
 
     if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
@@ -513,6 +674,26 @@ VulkanImageWrapper *VulkanWrapperPrivate::createTextureImageFromData(const uchar
         return nullptr;
     }
 
+    if (extraDebug) qDebug() << "creating image...";
+
+    QScopedPointer<VulkanImageWrapper> imageWrapper(createImage(vkFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, size, bufferSize));
+    if (imageWrapper.isNull())
+        return nullptr;
+
+    const VkImage textureImage = imageWrapper->textureImage;
+
+    if (VkDeviceSize(bufferSize) <= StagingSliceSize && ensureUploadResources()) {
+        UploadBatch *batch = batchForUpload(bufferSize);
+        const VkDeviceSize offset = VkDeviceSize(batch - m_batches) * StagingSliceSize + batch->stagingUsed;
+        memcpy(m_stagingData + offset, pixels, static_cast<size_t>(bufferSize));
+        recordUpload(batch->commandBuffer, m_stagingBuffer, offset, textureImage, QSize(texWidth, texHeight));
+        batch->stagingUsed += bufferSize;
+        imageWrapper->uploadSerial = batch->serial;
+        if (extraDebug) qDebug() << "queued upload in batch" << batch->serial << "at" << offset;
+        return imageWrapper.take();
+    }
+
+    // Too large for the staging ring: upload through a buffer of its own
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingBufferMemory;
     ok = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
@@ -526,24 +707,9 @@ VulkanImageWrapper *VulkanWrapperPrivate::createTextureImageFromData(const uchar
     memcpy(data, pixels, static_cast<size_t>(bufferSize));
     vkUnmapMemory(m_device, stagingBufferMemory);
 
-    if (extraDebug) qDebug() << "creating image...";
-
-    QScopedPointer<VulkanImageWrapper> imageWrapper(createImage(vkFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, size, bufferSize));
-    if (imageWrapper.isNull())
-        return nullptr;
-
-    if (extraDebug) qDebug() << "transition...";
-
-    const VkImage textureImage = imageWrapper->textureImage;
-
-    ok = transitionImageLayout(textureImage, vkFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-    if (!ok)
-        return nullptr;
-
-    if (extraDebug) qDebug() << "copyBufferToImage...";
-    copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    transitionImageLayout(textureImage, vkFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    recordUpload(commandBuffer, stagingBuffer, 0, textureImage, QSize(texWidth, texHeight));
+    endSingleTimeCommands(commandBuffer);
 
     vkDestroyBuffer(m_device, stagingBuffer, nullptr);
     vkFreeMemory(m_device, stagingBufferMemory, nullptr);
@@ -556,6 +722,9 @@ void VulkanWrapperPrivate::freeTextureImage(VulkanImageWrapper *imageWrapper)
     if (!imageWrapper)
         return;
 
+    // The image must not go away while it is being uploaded to
+    waitForUpload(imageWrapper);
+
     //"To avoid leaking resources, the application must release ownership of the file descriptor using the close system call"
     ::close(imageWrapper->imgFd);
 
@@ -718,4 +887,9 @@ void VulkanWrapper::freeTextureImage(VulkanImageWrapper *imageWrapper)
     d_ptr->freeTextureImage(imageWrapper);
 }
 
+void VulkanWrapper::waitForUpload(VulkanImageWrapper *imageWrapper)
+{
+    d_ptr->waitForUpload(imageWrapper);
+}
+
 QT_END_NAMESPACE
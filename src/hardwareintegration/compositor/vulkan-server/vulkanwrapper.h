@@ -50,6 +50,7 @@ public:
     VulkanImageWrapper *createTextureImageFromData(const uchar *pixels, uint bufferSize, const QSize &size, uint glInternalFormat);
     int getImageInfo(const VulkanImageWrapper *imgWrapper, int *memSize, int *w = nullptr, int *h = nullptr);
     void freeTextureImage(VulkanImageWrapper *imageWrapper);
+    void waitForUpload(VulkanImageWrapper *imageWrapper);
 
 private:
     VulkanWrapperPrivate *d_ptr;
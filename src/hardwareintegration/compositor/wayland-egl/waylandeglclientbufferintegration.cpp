@@ -332,6 +332,7 @@ bool WaylandEglClientBufferIntegrationPrivate::initEglStream(WaylandEglClientBuf
     auto texture = new QOpenGLTexture(static_cast<QOpenGLTexture::Target>(GL_TEXTURE_EXTERNAL_OES));
     texture->create();
     state.textures[0] = texture; // TODO: support multiple planes for the streaming case
+    buffer->accountTextures(1, qint64(state.size.width()) * state.size.height() * 4);
 
     texture->bind();
 
@@ -486,6 +487,10 @@ WaylandEglClientBuffer::WaylandEglClientBuffer(WaylandEglClientBufferIntegration
         d->size = QSize(width, height);
 
         p->initBuffer(this);
+        for (auto image : qAsConst(d->egl_images)) {
+            if (image != EGL_NO_IMAGE_KHR)
+                accountEglImages(1);
+        }
     }
 }
 
@@ -563,6 +568,7 @@ QOpenGLTexture *WaylandEglClientBuffer::toOpenGlTexture(int plane)
         texture->setSize(d->size.width(), d->size.height());
         texture->create();
         d->textures[plane] = texture;
+        accountTextures(1, qint64(d->size.width()) * d->size.height() * 4);
     }
 
     if (m_textureDirty) {
@@ -38,6 +38,7 @@
 #include <QtWaylandCompositor/QWaylandQuickSurface>
 #include <QtWaylandCompositor/QWaylandClient>
 #include <QtWaylandCompositor/QWaylandQuickOutput>
+#include <QtWaylandCompositor/QWaylandFrameStatistics>
 #include <QtWaylandCompositor/QWaylandCompositorExtension>
 #include <QtWaylandCompositor/QWaylandQuickExtension>
 #include <QtWaylandCompositor/QWaylandSeat>
@@ -60,6 +61,7 @@
 #include <QtWaylandCompositor/QWaylandQuickXdgOutputV1>
 #include <QtWaylandCompositor/QWaylandIviApplication>
 #include <QtWaylandCompositor/QWaylandIviSurface>
+#include <QtWaylandCompositor/QWaylandScreencopyManagerV1>
 
 #include <QtWaylandCompositor/qtwaylandcompositorglobal.h>
 #include "qwaylandmousetracker_p.h"
@@ -70,6 +72,7 @@ Q_COMPOSITOR_DECLARE_QUICK_EXTENSION_CONTAINER_CLASS(QWaylandQuickCompositor)
 Q_COMPOSITOR_DECLARE_QUICK_EXTENSION_CLASS(QWaylandQtWindowManager)
 Q_COMPOSITOR_DECLARE_QUICK_EXTENSION_CLASS(QWaylandIdleInhibitManagerV1)
 Q_COMPOSITOR_DECLARE_QUICK_EXTENSION_CLASS(QWaylandIviApplication)
+Q_COMPOSITOR_DECLARE_QUICK_EXTENSION_CLASS(QWaylandScreencopyManagerV1)
 #if QT_DEPRECATED_SINCE(5, 13)
 Q_COMPOSITOR_DECLARE_QUICK_EXTENSION_CLASS(QWaylandWlScaler)
 #endif
@@ -138,13 +141,17 @@ public:
 #endif
         qmlRegisterType<QWaylandMouseTracker>(uri, 1, 0, "WaylandMouseTracker");
         qmlRegisterType<QWaylandQuickOutput>(uri, 1, 0, "WaylandOutput");
+        qmlRegisterType<QWaylandQuickOutput, 15>(uri, 1, 15, "WaylandOutput");
         qmlRegisterType<QWaylandQuickSurface>(uri, 1, 0, "WaylandSurface");
         qmlRegisterType<QWaylandQuickSurface, 13>(uri, 1, 13, "WaylandSurface");
+        qmlRegisterType<QWaylandQuickSurface, 15>(uri, 1, 15, "WaylandSurface");
         qmlRegisterType<QWaylandKeymap>(uri, 1, 0, "WaylandKeymap");
 
         qmlRegisterUncreatableType<QWaylandCompositorExtension>(uri, 1, 0, "WaylandExtension", QObject::tr("Cannot create instance of WaylandExtension"));
         qmlRegisterUncreatableType<QWaylandClient>(uri, 1, 0, "WaylandClient", QObject::tr("Cannot create instance of WaylandClient"));
+        qmlRegisterUncreatableType<QWaylandClient, 15>(uri, 1, 15, "WaylandClient", QObject::tr("Cannot create instance of WaylandClient"));
         qmlRegisterUncreatableType<QWaylandOutput>(uri, 1, 0, "WaylandOutputBase", QObject::tr("Cannot create instance of WaylandOutputBase, use WaylandOutput instead"));
+        qmlRegisterUncreatableType<QWaylandFrameStatistics>(uri, 1, 15, "WaylandFrameStatistics", QObject::tr("Cannot create instance of WaylandFrameStatistics, use WaylandOutput.frameStatistics instead"));
         qmlRegisterUncreatableType<QWaylandSeat>(uri, 1, 0, "WaylandSeat", QObject::tr("Cannot create instance of WaylandSeat"));
 #if QT_CONFIG(draganddrop)
         qmlRegisterUncreatableType<QWaylandDrag>(uri, 1, 0, "WaylandDrag", QObject::tr("Cannot create instance of WaylandDrag"));
@@ -192,6 +199,8 @@ public:
 
         qmlRegisterType<QWaylandXdgOutputManagerV1QuickExtension>(uri, 1, 14, "XdgOutputManagerV1");
         qmlRegisterType<QWaylandQuickXdgOutputV1>(uri, 1, 14, "XdgOutputV1");
+
+        qmlRegisterType<QWaylandScreencopyManagerV1QuickExtension>(uri, 1, 15, "ScreencopyManagerV1");
     }
 };
 //![class decl]
@@ -80,6 +80,29 @@
     Image { source: "image://wlshared/wallpapers/mybackground.jpg" }
     \endcode
 
+    \section2 Caching
+
+    Images are decoded on worker threads, and clients get their buffers once decoding is
+    done, so loading many images does not block the compositor. Buffers that are no longer
+    used are deleted right away, unless a \e cacheBudget in bytes is set: the least recently
+    used buffers are then kept until they exceed the budget. Images listed in
+    \e prefetchImages are loaded on startup and kept until they are first requested, and
+    those listed in \e pinnedImages are never deleted once loaded.
+
+    Decoding can be skipped altogether on later runs by setting a \e cacheDirectory, or the
+    \c QT_WAYLAND_SHAREDTEXTURE_CACHE_DIR environment variable. Decoded pixels are stored
+    there, and mapped from the cache instead as long as the image file is unchanged. The
+    least recently used files are deleted when the directory grows beyond its
+    \e cacheDirectoryLimit in bytes, 256 MiB by default.
+
+    \code
+    TextureSharingExtension {
+        cacheBudget: 32 * 1024 * 1024
+        prefetchImages: ["icons/home", "icons/settings"]
+        pinnedImages: ["wallpapers/mybackground"]
+        cacheDirectory: "/var/cache/compositor/textures"
+    }
+    \endcode
 */
 
 QT_BEGIN_NAMESPACE
@@ -67,6 +67,18 @@
     Image { source: "image://wlshared/wallpapers/mybackground.jpg" }
     \endcode
 
+    Images requested during the same event loop iteration are sent to the
+    compositor together. If the compositor has not replied within the number
+    of milliseconds given by the \c QT_SHAREDTEXTURE_REQUEST_TIMEOUT
+    environment variable (5000 by default), or it reports an error, the image
+    is loaded from the directory given by \c QT_SHAREDTEXTURE_FALLBACK_DIR on a
+    background thread instead.
+
+    Shared images that are no longer used are kept for a while, so they can be
+    shown again without asking the compositor. The \c QT_SHAREDTEXTURE_CACHE_SIZE
+    environment variable sets how many bytes of such images to keep (16 MB by
+    default).
+
     The shared texture module does not provide any directly usable QML types.
 */
 
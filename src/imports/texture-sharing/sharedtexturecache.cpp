@@ -0,0 +1,180 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "sharedtexturecache.h"
+
+#include <QtWaylandClient/private/qwaylandserverbufferintegration_p.h>
+
+QT_BEGIN_NAMESPACE
+
+SharedTextureCache::SharedTextureCache(QObject *owner, qint64 cacheLimit)
+    : m_owner(owner), m_cacheLimit(cacheLimit)
+{
+}
+
+SharedTextureCache::~SharedTextureCache()
+{
+    // Only reached when the owner and all texture factories are gone
+    for (const CachedBuffer &cached : qAsConst(m_buffers))
+        delete cached.buffer;
+}
+
+qint64 SharedTextureCache::byteCount(const QtWaylandClient::QWaylandServerBuffer *buffer)
+{
+    return qint64(buffer->size().width()) * buffer->size().height() * 4;
+}
+
+// Returns the buffer for id, if it has been received, and adds a reference to it
+QtWaylandClient::QWaylandServerBuffer *SharedTextureCache::acquire(const QString &id)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_buffers.find(id);
+    if (it == m_buffers.end())
+        return nullptr;
+
+    if (!it->refCount++)
+        m_unusedBytes -= byteCount(it->buffer);
+    return it->buffer;
+}
+
+// Drops a reference, from any thread. Unreferenced buffers stay cached until the cache limit
+// is exceeded, and are then trimmed on the owner's thread. Without an owner, they are deleted.
+void SharedTextureCache::release(const QString &id)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_buffers.find(id);
+    if (it == m_buffers.end() || !it->refCount)
+        return;
+
+    if (--it->refCount)
+        return;
+
+    if (!m_owner) {
+        delete it->buffer;
+        m_buffers.erase(it);
+        return;
+    }
+
+    it->lastUsed = ++m_usageCounter;
+    m_unusedBytes += byteCount(it->buffer);
+    if (m_unusedBytes > m_cacheLimit && !m_trimScheduled) {
+        // Posted under the lock, so detach() cannot delete the owner in between
+        m_trimScheduled = true;
+        QMetaObject::invokeMethod(m_owner, "trimCache", Qt::QueuedConnection);
+    }
+}
+
+bool SharedTextureCache::contains(const QString &id) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_buffers.contains(id);
+}
+
+// Adds an unreferenced buffer, which a response may never pick up if it timed out.
+// Returns false if there already is a buffer for id.
+bool SharedTextureCache::insert(const QString &id, QtWaylandClient::QWaylandServerBuffer *buffer)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_buffers.contains(id))
+        return false;
+
+    CachedBuffer cached;
+    cached.buffer = buffer;
+    cached.lastUsed = ++m_usageCounter;
+    m_buffers.insert(id, cached);
+    m_unusedBytes += byteCount(buffer);
+    return true;
+}
+
+// Deletes the least recently used unreferenced buffers until the cache fits its limit,
+// and returns their ids, so the owner can abandon them
+QStringList SharedTextureCache::trim()
+{
+    QMutexLocker locker(&m_mutex);
+    m_trimScheduled = false;
+
+    QStringList trimmed;
+    while (m_unusedBytes > m_cacheLimit) {
+        auto oldest = m_buffers.end();
+        for (auto it = m_buffers.begin(); it != m_buffers.end(); ++it) {
+            if (!it->refCount && (oldest == m_buffers.end() || it->lastUsed < oldest->lastUsed))
+                oldest = it;
+        }
+        if (oldest == m_buffers.end())
+            break;
+
+        m_unusedBytes -= byteCount(oldest->buffer);
+        delete oldest->buffer;
+        trimmed << oldest.key();
+        m_buffers.erase(oldest);
+    }
+    return trimmed;
+}
+
+// Called by the owner before it is destroyed. Unreferenced buffers are deleted right away,
+// the others when their last reference is released.
+void SharedTextureCache::detach()
+{
+    QMutexLocker locker(&m_mutex);
+    m_owner = nullptr;
+    for (auto it = m_buffers.begin(); it != m_buffers.end();) {
+        if (!it->refCount) {
+            delete it->buffer;
+            it = m_buffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_unusedBytes = 0;
+}
+
+qint64 SharedTextureCache::unusedBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_unusedBytes;
+}
+
+int SharedTextureCache::bufferCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_buffers.size();
+}
+
+QT_END_NAMESPACE
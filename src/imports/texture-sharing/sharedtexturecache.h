@@ -0,0 +1,97 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef SHAREDTEXTURECACHE_H
+#define SHAREDTEXTURECACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWaylandClient {
+    class QWaylandServerBuffer;
+}
+
+// Reference counted server buffers. The registry fills the cache on the image reader thread,
+// while texture factories release their buffers on the GUI or render thread, possibly after
+// the registry is gone, so all access is serialized by the mutex.
+class SharedTextureCache
+{
+public:
+    // Evictions are handed to owner's trimCache() slot, on the owner's thread
+    SharedTextureCache(QObject *owner, qint64 cacheLimit);
+    ~SharedTextureCache();
+
+    QtWaylandClient::QWaylandServerBuffer *acquire(const QString &id);
+    void release(const QString &id);
+
+    bool contains(const QString &id) const;
+    bool insert(const QString &id, QtWaylandClient::QWaylandServerBuffer *buffer);
+    QStringList trim();
+    void detach();
+
+    qint64 unusedBytes() const;
+    int bufferCount() const;
+
+    static qint64 byteCount(const QtWaylandClient::QWaylandServerBuffer *buffer);
+
+private:
+    struct CachedBuffer
+    {
+        QtWaylandClient::QWaylandServerBuffer *buffer = nullptr;
+        int refCount = 0;
+        quint64 lastUsed = 0;
+    };
+
+    mutable QMutex m_mutex;
+    QObject *m_owner = nullptr;
+    QHash<QString, CachedBuffer> m_buffers;
+    bool m_trimScheduled = false;
+    quint64 m_usageCounter = 0;
+    qint64 m_unusedBytes = 0;
+    qint64 m_cacheLimit = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif // SHAREDTEXTURECACHE_H
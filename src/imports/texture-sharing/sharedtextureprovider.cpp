@@ -55,6 +55,9 @@
 #include <QImageReader>
 
 #include <QTimer>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QPointer>
 
 #include "texturesharingextension.h"
 
@@ -104,18 +107,16 @@ inline void SharedTexture::updateGLTexture() const
 class SharedTextureFactory : public QQuickTextureFactory
 {
 public:
-    SharedTextureFactory(const QtWaylandClient::QWaylandServerBuffer *buffer, const QString &id, SharedTextureRegistry *registry)
-        : m_buffer(buffer), m_id(id), m_registry(registry)
+    SharedTextureFactory(const QtWaylandClient::QWaylandServerBuffer *buffer, const QString &id, const QSharedPointer<SharedTextureCache> &cache)
+        : m_buffer(buffer), m_id(id), m_cache(cache)
     {
     }
 
+    // Runs on the GUI or render thread. The cache keeps released buffers around for a while,
+    // so they can be reused without a server roundtrip.
     ~SharedTextureFactory() override
     {
-        //qDebug() << "====> DESTRUCTOR SharedTextureFactory" << this;
-        if (m_registry)
-            m_registry->abandonBuffer(m_id);
-        delete m_buffer; // TODO: make sure we are not keeping references to this elsewhere
-        //qDebug() << "buffer deleted";
+        m_cache->release(m_id);
     }
 
     QSize textureSize() const override
@@ -136,7 +137,7 @@ public:
 private:
     const QtWaylandClient::QWaylandServerBuffer *m_buffer = nullptr;
     QString m_id;
-    QPointer<SharedTextureRegistry> m_registry;
+    QSharedPointer<SharedTextureCache> m_cache;
 };
 
 
@@ -145,41 +146,61 @@ SharedTextureRegistry::SharedTextureRegistry()
 {
     connect(m_extension, &TextureSharingExtension::bufferReceived, this, &SharedTextureRegistry::receiveBuffer);
     connect(m_extension, &TextureSharingExtension::activeChanged, this, &SharedTextureRegistry::handleExtensionActive);
+
+    qint64 cacheLimit = 16 * 1024 * 1024;
+    bool ok = false;
+    qint64 envCacheLimit = qEnvironmentVariable("QT_SHAREDTEXTURE_CACHE_SIZE").toLongLong(&ok);
+    if (ok && envCacheLimit >= 0)
+        cacheLimit = envCacheLimit;
+    m_cache.reset(new SharedTextureCache(this, cacheLimit));
 }
 
 SharedTextureRegistry::~SharedTextureRegistry()
 {
+    // Buffers that are still referenced are deleted by their texture factories
+    m_cache->detach();
     delete m_extension;
 }
 
-const QtWaylandClient::QWaylandServerBuffer *SharedTextureRegistry::bufferForId(const QString &id) const
+// Abandons the buffers the cache has dropped to fit its limit
+void SharedTextureRegistry::trimCache()
 {
-    return m_buffers.value(id);
+    const QStringList trimmed = m_cache->trim();
+    for (const QString &id : trimmed)
+        m_extension->abandonImage(id);
 }
 
 void SharedTextureRegistry::requestBuffer(const QString &id)
 {
-    if (!m_extension->isActive()) {
-        //qDebug() << "Extension not active, adding" << id << "to queue";
-        m_pendingBuffers << id;
+    if (m_cache->contains(id) || m_requestedBuffers.contains(id) || m_pendingBuffers.contains(id))
         return;
+
+    // Requests made in the same event loop iteration are sent together
+    m_pendingBuffers << id;
+    if (!m_sendScheduled && m_extension->isActive()) {
+        m_sendScheduled = true;
+        QMetaObject::invokeMethod(this, "sendRequests", Qt::QueuedConnection);
     }
-    m_extension->requestImage(id);
 }
 
-void SharedTextureRegistry::abandonBuffer(const QString &id)
+void SharedTextureRegistry::sendRequests()
 {
-    m_buffers.remove(id);
-    m_extension->abandonImage(id);
-}
+    m_sendScheduled = false;
+    if (!m_extension->isActive() || m_pendingBuffers.isEmpty())
+        return;
 
+    //qDebug() << "Requesting" << m_pendingBuffers;
+    m_extension->requestImages(m_pendingBuffers);
+    for (const QString &id : qAsConst(m_pendingBuffers))
+        m_requestedBuffers.insert(id);
+    m_pendingBuffers.clear();
+}
 
 void SharedTextureRegistry::handleExtensionActive()
 {
     //qDebug() << "handleExtensionActive, queue:" << m_pendingBuffers;
     if (m_extension->isActive())
-        while (!m_pendingBuffers.isEmpty())
-            requestBuffer(m_pendingBuffers.takeFirst());
+        sendRequests();
 }
 
 bool SharedTextureRegistry::preinitialize()
@@ -197,55 +218,78 @@ bool SharedTextureRegistry::preinitialize()
 void SharedTextureRegistry::receiveBuffer(QtWaylandClient::QWaylandServerBuffer *buffer, const QString& id)
 {
     //qDebug() << "ReceiveBuffer for id" << id;
-    if (buffer)
-        m_buffers.insert(id, buffer);
+    m_requestedBuffers.remove(id);
+    if (buffer && !m_cache->insert(id, buffer))
+        delete buffer;
     emit replyReceived(id);
+    trimCache();
 }
 
+class SharedTextureFallbackLoader : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    SharedTextureFallbackLoader(const QString &path)
+        : m_path(path)
+    {
+    }
+
+    void run() override
+    {
+        QImageReader reader(m_path);
+        QImage img = reader.read();
+        QString errorString;
+        if (img.isNull()) {
+            qWarning() << "Could not load local image from id/path" << reader.fileName();
+            errorString = QStringLiteral("Shared buffer not found, and fallback local file loading failed: ") + reader.errorString();
+        }
+        emit loaded(img, errorString);
+    }
+
+signals:
+    void loaded(const QImage &image, const QString &errorString);
+
+private:
+    QString m_path;
+};
+
 class SharedTextureImageResponse : public QQuickImageResponse
 {
     Q_OBJECT
 public:
     SharedTextureImageResponse(SharedTextureRegistry *registry, const QString &id)
-        : m_id(id), m_registry(registry)
+        : m_id(id), m_registry(registry), m_cache(registry ? registry->cache() : nullptr)
     {
-        if (!m_registry || m_registry->bufferForId(id)) {
-            // Shortcut: no server roundtrip needed, just let the event loop call the slot
-            QMetaObject::invokeMethod(this, "doResponse", Qt::QueuedConnection, Q_ARG(QString, id));
-
+        if (!m_registry) {
+            loadFallback();
+        } else if ((m_buffer = m_cache->acquire(id))) {
+            // Shortcut: no server roundtrip needed, just let the event loop emit finished
+            QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
         } else {
-            // TBD: timeout?
             connect(registry, &SharedTextureRegistry::replyReceived, this, &SharedTextureImageResponse::doResponse);
+            m_timer.setSingleShot(true);
+            connect(&m_timer, &QTimer::timeout, this, &SharedTextureImageResponse::handleTimeout);
+            m_timer.start(requestTimeout());
             registry->requestBuffer(id);
         }
     }
 
-    QQuickTextureFactory *textureFactory() const override
+    ~SharedTextureImageResponse() override
     {
-        if (m_registry) {
-            const QtWaylandClient::QWaylandServerBuffer *buffer = m_registry->bufferForId(m_id);
-            if (buffer) {
-                //qDebug() << "Creating shared buffer texture for" << m_id;
-                return new SharedTextureFactory(buffer, m_id, m_registry);
-            }
-            //qDebug() << "Shared buffer NOT found for" << m_id;
-        }
+        if (m_buffer)
+            m_cache->release(m_id);
+    }
 
-        // No shared buffer, do fallback
-        QString fbPath = fallbackPath();
-        if (fbPath.isEmpty()) {
-            m_errorString = QStringLiteral("Shared buffer not found, and no fallback path set.");
-            return nullptr;
+    QQuickTextureFactory *textureFactory() const override
+    {
+        if (m_buffer) {
+            //qDebug() << "Creating shared buffer texture for" << m_id;
+            return new SharedTextureFactory(m_cache->acquire(m_id), m_id, m_cache);
         }
 
-        QImageReader reader(fbPath + m_id);
-        QImage img = reader.read();
-        if (img.isNull()) {
-            qWarning() << "Could not load local image from id/path" << reader.fileName();
-            m_errorString = QStringLiteral("Shared buffer not found, and fallback local file loading failed: ") + reader.errorString();
+        if (m_image.isNull())
             return nullptr;
-        }
-        return QQuickTextureFactory::textureFactoryForImage(img);
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
     }
 
     QString errorString() const override
@@ -269,6 +313,18 @@ public:
         return fbPath;
     }
 
+    // How long to wait for the compositor before falling back to the local file
+    static int requestTimeout()
+    {
+        static int timeout = -1;
+        if (timeout < 0) {
+            bool ok = false;
+            timeout = qEnvironmentVariableIntValue("QT_SHAREDTEXTURE_REQUEST_TIMEOUT", &ok);
+            if (!ok || timeout < 0)
+                timeout = 5000;
+        }
+        return timeout;
+    }
 
 public slots:
     void doResponse(const QString &key) {
@@ -276,16 +332,59 @@ public slots:
             return; // not our buffer
 
         // No need to be called again
-        if (m_registry)
-            disconnect(m_registry, &SharedTextureRegistry::replyReceived, this, &SharedTextureImageResponse::doResponse);
+        stopWaiting();
+
+        m_buffer = m_cache->acquire(m_id);
+        if (m_buffer)
+            emit finished();
+        else
+            loadFallback();
+    }
+
+    void handleTimeout()
+    {
+        qWarning() << "Timed out waiting for shared buffer" << m_id;
+        stopWaiting();
+        loadFallback();
+    }
 
+    void handleFallbackLoaded(const QImage &image, const QString &errorString)
+    {
+        m_image = image;
+        m_errorString = errorString;
         emit finished();
     }
 
 private:
+    void stopWaiting()
+    {
+        m_timer.stop();
+        if (m_registry)
+            disconnect(m_registry, &SharedTextureRegistry::replyReceived, this, &SharedTextureImageResponse::doResponse);
+    }
+
+    // Decodes the local file on the thread pool rather than in textureFactory()
+    void loadFallback()
+    {
+        QString fbPath = fallbackPath();
+        if (fbPath.isEmpty()) {
+            m_errorString = QStringLiteral("Shared buffer not found, and no fallback path set.");
+            QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+            return;
+        }
+
+        auto *loader = new SharedTextureFallbackLoader(fbPath + m_id);
+        connect(loader, &SharedTextureFallbackLoader::loaded, this, &SharedTextureImageResponse::handleFallbackLoaded);
+        QThreadPool::globalInstance()->start(loader);
+    }
+
     QString m_id;
-    SharedTextureRegistry *m_registry = nullptr;
-    mutable QString m_errorString;
+    QPointer<SharedTextureRegistry> m_registry;
+    QSharedPointer<SharedTextureCache> m_cache;
+    QtWaylandClient::QWaylandServerBuffer *m_buffer = nullptr;
+    QImage m_image;
+    QTimer m_timer;
+    QString m_errorString;
 };
 
 
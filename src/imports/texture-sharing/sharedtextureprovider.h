@@ -44,10 +44,13 @@
 #include <QQuickImageProvider>
 #include <QtQuick/QSGTexture>
 #include <QScopedPointer>
-#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
 
 #include <QtWaylandClient/private/qwaylandserverbufferintegration_p.h>
 
+#include "sharedtexturecache.h"
+
 QT_BEGIN_NAMESPACE
 
 class TextureSharingExtension;
@@ -59,9 +62,8 @@ public:
     SharedTextureRegistry();
     ~SharedTextureRegistry() override;
 
-    const QtWaylandClient::QWaylandServerBuffer *bufferForId(const QString &id) const;
+    QSharedPointer<SharedTextureCache> cache() const { return m_cache; }
     void requestBuffer(const QString &id);
-    void abandonBuffer(const QString &id);
 
     static bool preinitialize();
 
@@ -73,11 +75,15 @@ signals:
 
 private slots:
     void handleExtensionActive();
+    void sendRequests();
+    void trimCache();
 
 private:
     TextureSharingExtension *m_extension = nullptr;
-    QHash<QString, QtWaylandClient::QWaylandServerBuffer *> m_buffers;
-    QStringList m_pendingBuffers;
+    QSharedPointer<SharedTextureCache> m_cache;
+    QStringList m_pendingBuffers;   // not sent to the compositor yet
+    QSet<QString> m_requestedBuffers; // sent, waiting for a reply
+    bool m_sendScheduled = false;
 };
 
 class SharedTextureProvider : public QQuickAsyncImageProvider
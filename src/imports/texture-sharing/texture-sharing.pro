@@ -4,11 +4,13 @@ TARGETPATH = QtWayland/Client/TextureSharing
 IMPORT_VERSION = 1.$$QT_MINOR_VERSION
 
 HEADERS += \
+    sharedtexturecache.h \
     sharedtextureprovider.h \
     texturesharingextension.h
 
 SOURCES += \
     plugin.cpp \
+    sharedtexturecache.cpp \
     sharedtextureprovider.cpp \
     texturesharingextension.cpp
 
@@ -52,7 +52,7 @@
 QT_BEGIN_NAMESPACE
 
 TextureSharingExtension::TextureSharingExtension()
-    : QWaylandClientExtensionTemplate(/* Supported protocol version */ 1 )
+    : QWaylandClientExtensionTemplate(/* Supported protocol version */ 2 )
 {
         auto *wayland_integration = static_cast<QtWaylandClient::QWaylandIntegration *>(QGuiApplicationPrivate::platformIntegration());
         m_server_buffer_integration = wayland_integration->serverBufferIntegration();
@@ -78,6 +78,31 @@ void TextureSharingExtension::requestImage(const QString &key)
     request_image(key);
 }
 
+// Sends the keys in as few requests as the compositor and the message size limit allow
+void TextureSharingExtension::requestImages(const QStringList &keys)
+{
+    if (version() < 2) {
+        for (const QString &key : keys)
+            request_image(key);
+        return;
+    }
+
+    // Stay well below the 4096 byte limit of a Wayland message
+    const int maxBatchSize = 3072;
+    QByteArray batch;
+    for (const QString &key : keys) {
+        const QByteArray utf8Key = key.toUtf8();
+        if (!batch.isEmpty() && batch.size() + utf8Key.size() + 1 > maxBatchSize) {
+            request_images(batch);
+            batch.clear();
+        }
+        batch += utf8Key;
+        batch += '\0';
+    }
+    if (!batch.isEmpty())
+        request_images(batch);
+}
+
 void TextureSharingExtension::abandonImage(const QString &key)
 {
     abandon_image(key);
@@ -61,6 +61,7 @@ public:
 
 public slots:
     void requestImage(const QString &key);
+    void requestImages(const QStringList &keys);
     void abandonImage(const QString &key);
 
 signals:
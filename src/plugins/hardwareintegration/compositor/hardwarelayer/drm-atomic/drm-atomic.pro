@@ -0,0 +1,14 @@
+QT = waylandcompositor waylandcompositor-private core-private gui-private quick
+
+OTHER_FILES += drm-atomic.json
+
+SOURCES += \
+    main.cpp
+
+TARGET = qt-wayland-compositor-drm-atomic
+
+include(../../../../../hardwareintegration/compositor/hardwarelayer/drm-atomic/drm-atomic.pri)
+
+PLUGIN_TYPE = wayland-hardware-layer-integration
+PLUGIN_CLASS_NAME = DrmAtomicHardwareLayerIntegrationPlugin
+load(qt_plugin)
@@ -3,3 +3,5 @@ QT_FOR_CONFIG += waylandcompositor-private
 
 qtConfig(wayland-layer-integration-vsp2): \
     SUBDIRS += vsp2
+qtConfig(wayland-layer-integration-drm-atomic): \
+    SUBDIRS += drm-atomic
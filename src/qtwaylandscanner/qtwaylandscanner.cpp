@@ -73,6 +73,7 @@ private:
         QByteArray interface;
         QByteArray summary;
         bool allowNull;
+        bool rawString;
     };
 
     struct WaylandEvent {
@@ -101,15 +102,19 @@ private:
     Scanner::WaylandEnum readEnum(QXmlStreamReader &xml);
     Scanner::WaylandInterface readInterface(QXmlStreamReader &xml);
     QByteArray waylandToCType(const QByteArray &waylandType, const QByteArray &interface);
-    QByteArray waylandToQtType(const QByteArray &waylandType, const QByteArray &interface, bool cStyleArray);
+    QByteArray waylandToQtType(const QByteArray &waylandType, const QByteArray &interface, bool cStyleArray, bool rawString = false);
     const Scanner::WaylandArgument *newIdArgument(const std::vector<WaylandArgument> &arguments);
 
     void printEvent(const WaylandEvent &e, bool omitNames = false, bool withResource = false);
     void printEventHandlerSignature(const WaylandEvent &e, const char *interfaceName, bool deepIndent = true);
     void printEnums(const std::vector<WaylandEnum> &enums);
+    void printRequestArgument(const WaylandArgument &a, const WaylandEvent &e);
+    QByteArray messageSizeExpression(const WaylandEvent &e, bool qtTypes);
+    void printMessageHookDefinition();
 
     QByteArray stripInterfaceName(const QByteArray &name);
     bool ignoreInterface(const QByteArray &name);
+    bool isRawString(const QByteArray &interfaceName, const WaylandEvent &e, const WaylandArgument &a);
 
     enum Option {
         ClientHeader,
@@ -124,6 +129,8 @@ private:
     QByteArray m_headerPath;
     QByteArray m_prefix;
     QVector <QByteArray> m_includes;
+    QVector <QByteArray> m_rawStringSelectors;
+    bool m_rawStrings = false;
     QXmlStreamReader *m_xml = nullptr;
 };
 
@@ -150,6 +157,8 @@ bool Scanner::parseArguments(int argc, char **argv)
         // --header-path=<path> (14 characters)
         // --prefix=<prefix> (9 characters)
         // --add-include=<include> (14 characters)
+        // --raw-strings
+        // --raw-strings=<interface>[.<message>[.<argument>]] (14 characters)
         for (int pos = 3; pos < argc; pos++) {
             const QByteArray &option = args[pos];
             if (option.startsWith("--header-path=")) {
@@ -160,6 +169,12 @@ bool Scanner::parseArguments(int argc, char **argv)
                 auto include = option.mid(14);
                 if (!include.isEmpty())
                     m_includes << include;
+            } else if (option == "--raw-strings") {
+                m_rawStrings = true;
+            } else if (option.startsWith("--raw-strings=")) {
+                auto selector = option.mid(14);
+                if (!selector.isEmpty())
+                    m_rawStringSelectors << selector;
             } else {
                 return false;
             }
@@ -171,7 +186,7 @@ bool Scanner::parseArguments(int argc, char **argv)
 
 void Scanner::printUsage()
 {
-    fprintf(stderr, "Usage: %s [client-header|server-header|client-code|server-code] specfile [--header-path=<path>] [--prefix=<prefix>] [--add-include=<include>]\n", m_scannerName.constData());
+    fprintf(stderr, "Usage: %s [client-header|server-header|client-code|server-code] specfile [--header-path=<path>] [--prefix=<prefix>] [--add-include=<include>] [--raw-strings[=<interface>[.<message>[.<argument>]]]]\n", m_scannerName.constData());
 }
 
 bool Scanner::isServerSide()
@@ -230,6 +245,7 @@ Scanner::WaylandEvent Scanner::readEvent(QXmlStreamReader &xml, bool request)
                 .interface = byteArrayValue(xml, "interface"),
                 .summary   = byteArrayValue(xml, "summary"),
                 .allowNull = boolValue(xml, "allowNull"),
+                .rawString = false,
             };
             event.arguments.push_back(std::move(argument));
         }
@@ -283,6 +299,15 @@ Scanner::WaylandInterface Scanner::readInterface(QXmlStreamReader &xml)
             xml.skipCurrentElement();
     }
 
+    for (WaylandEvent &e : interface.events) {
+        for (WaylandArgument &a : e.arguments)
+            a.rawString = isRawString(interface.name, e, a);
+    }
+    for (WaylandEvent &e : interface.requests) {
+        for (WaylandArgument &a : e.arguments)
+            a.rawString = isRawString(interface.name, e, a);
+    }
+
     return interface;
 }
 
@@ -310,10 +335,10 @@ QByteArray Scanner::waylandToCType(const QByteArray &waylandType, const QByteArr
     return waylandType;
 }
 
-QByteArray Scanner::waylandToQtType(const QByteArray &waylandType, const QByteArray &interface, bool cStyleArray)
+QByteArray Scanner::waylandToQtType(const QByteArray &waylandType, const QByteArray &interface, bool cStyleArray, bool rawString)
 {
     if (waylandType == "string")
-        return "const QString &";
+        return rawString ? "const char *" : "const QString &";
     else if (waylandType == "array")
         return cStyleArray ? "wl_array *" : "const QByteArray &";
     else
@@ -365,7 +390,7 @@ void Scanner::printEvent(const WaylandEvent &e, bool omitNames, bool withResourc
             }
         }
 
-        QByteArray qtType = waylandToQtType(a.type, a.interface, e.request == isServerSide());
+        QByteArray qtType = waylandToQtType(a.type, a.interface, e.request == isServerSide(), a.rawString);
         printf("%s%s%s", qtType.constData(), qtType.endsWith("&") || qtType.endsWith("*") ? "" : " ", omitNames ? "" : a.name.constData());
     }
     printf(")");
@@ -410,6 +435,93 @@ void Scanner::printEnums(const std::vector<WaylandEnum> &enums)
     }
 }
 
+void Scanner::printRequestArgument(const WaylandArgument &a, const WaylandEvent &e)
+{
+    QByteArray cType = waylandToCType(a.type, a.interface);
+    QByteArray qtType = waylandToQtType(a.type, a.interface, e.request, a.rawString);
+    if (a.type == "string" && !a.rawString)
+        printf("            %s.toUtf8().constData()", a.name.constData());
+    else if (a.type == "array")
+        printf("            &%s_data", a.name.constData());
+    else if (cType == qtType)
+        printf("            %s", a.name.constData());
+}
+
+// Returns an expression for the size of the message on the wire. It is only
+// evaluated when a message hook is compiled in, so it may be expensive.
+QByteArray Scanner::messageSizeExpression(const WaylandEvent &e, bool qtTypes)
+{
+    int fixedSize = 8; // object id, opcode and message size
+    QByteArray variableSize;
+    for (const WaylandArgument &a : e.arguments) {
+        const QByteArray &name = a.name;
+        if (a.type == "fd") {
+            // passed as ancillary data
+        } else if (a.type == "string") {
+            if (qtTypes && !a.rawString)
+                variableSize += " + ((uint32_t(" + name + ".toUtf8().size()) + 4) & ~3u)";
+            else
+                variableSize += " + (" + name + " ? (uint32_t(qstrlen(" + name + ")) + 4) & ~3u : 0u)";
+            fixedSize += 4;
+        } else if (a.type == "array") {
+            if (qtTypes)
+                variableSize += " + ((uint32_t(" + name + ".size()) + 3) & ~3u)";
+            else
+                variableSize += " + ((uint32_t(" + name + "->size) + 3) & ~3u)";
+            fixedSize += 4;
+        } else if (a.type == "new_id" && a.interface.isEmpty() && qtTypes && !isServerSide()) {
+            // interface name, version and id
+            variableSize += " + ((uint32_t(qstrlen(interface->name)) + 4) & ~3u)";
+            fixedSize += 12;
+        } else {
+            fixedSize += 4;
+        }
+    }
+    return QByteArray::number(fixedSize) + variableSize;
+}
+
+// The message hook is called for every message that passes through the generated
+// code. By default it compiles to nothing, unless QT_WAYLAND_PROTOCOL_STATISTICS is
+// defined, in which case it feeds the protocol statistics of the module. Tracing
+// backends can define the hook themselves. The handled hook is called when the handler
+// of an incoming message returns, so that they can also measure how long it took.
+void Scanner::printMessageHookDefinition()
+{
+    if (isServerSide()) {
+        printf("#ifndef QT_WAYLAND_SERVER_MESSAGE_HANDLED_HOOK\n");
+        printf("#define QT_WAYLAND_SERVER_MESSAGE_HANDLED_HOOK(interface, opcode) do { } while (false)\n");
+        printf("#endif\n");
+        printf("#ifndef QT_WAYLAND_SERVER_MESSAGE_HOOK\n");
+        printf("#if defined(QT_WAYLAND_PROTOCOL_STATISTICS)\n");
+        printf("#include <QtWaylandCompositor/private/qwlprotocolstatistics_p.h>\n");
+        printf("#define QT_WAYLAND_SERVER_MESSAGE_HOOK(interface, opcode, request, resource, size) \\\n");
+        printf("    do { \\\n");
+        printf("        if (Q_UNLIKELY(QtWayland::ProtocolStatistics::isEnabled())) \\\n");
+        printf("            QtWayland::ProtocolStatistics::record(interface, opcode, request, resource, size); \\\n");
+        printf("    } while (false)\n");
+        printf("#else\n");
+        printf("#define QT_WAYLAND_SERVER_MESSAGE_HOOK(interface, opcode, request, resource, size) do { } while (false)\n");
+        printf("#endif\n");
+        printf("#endif\n");
+    } else {
+        printf("#ifndef QT_WAYLAND_CLIENT_MESSAGE_HANDLED_HOOK\n");
+        printf("#define QT_WAYLAND_CLIENT_MESSAGE_HANDLED_HOOK(interface, opcode) do { } while (false)\n");
+        printf("#endif\n");
+        printf("#ifndef QT_WAYLAND_CLIENT_MESSAGE_HOOK\n");
+        printf("#if defined(QT_WAYLAND_PROTOCOL_STATISTICS)\n");
+        printf("#include <QtWaylandClient/private/qwaylandprotocolstatistics_p.h>\n");
+        printf("#define QT_WAYLAND_CLIENT_MESSAGE_HOOK(interface, opcode, request, proxy, size) \\\n");
+        printf("    do { \\\n");
+        printf("        if (Q_UNLIKELY(QtWaylandClient::QWaylandProtocolStatistics::isEnabled())) \\\n");
+        printf("            QtWaylandClient::QWaylandProtocolStatistics::record(interface, opcode, request, size); \\\n");
+        printf("    } while (false)\n");
+        printf("#else\n");
+        printf("#define QT_WAYLAND_CLIENT_MESSAGE_HOOK(interface, opcode, request, proxy, size) do { } while (false)\n");
+        printf("#endif\n");
+        printf("#endif\n");
+    }
+}
+
 QByteArray Scanner::stripInterfaceName(const QByteArray &name)
 {
     if (!m_prefix.isEmpty() && name.startsWith(m_prefix))
@@ -426,6 +538,24 @@ bool Scanner::ignoreInterface(const QByteArray &name)
            || (isServerSide() && name == "wl_registry");
 }
 
+// Strings selected with --raw-strings are passed through as the NUL-terminated
+// UTF-8 buffer libwayland hands us (or expects), without a QString in between.
+bool Scanner::isRawString(const QByteArray &interfaceName, const WaylandEvent &e, const WaylandArgument &a)
+{
+    if (a.type != "string")
+        return false;
+    if (m_rawStrings)
+        return true;
+
+    const QByteArray message = interfaceName + '.' + e.name;
+    const QByteArray argument = message + '.' + a.name;
+    for (const QByteArray &selector : qAsConst(m_rawStringSelectors)) {
+        if (selector == interfaceName || selector == message || selector == argument)
+            return true;
+    }
+    return false;
+}
+
 bool Scanner::process()
 {
     QFile file(m_protocolFilePath);
@@ -484,6 +614,7 @@ bool Scanner::process()
         else
             printf("#include <%s/wayland-%s-server-protocol.h>\n", m_headerPath.constData(), QByteArray(m_protocolName).replace('_', '-').constData());
         printf("#include <QByteArray>\n");
+        printf("#include <QMultiHash>\n");
         printf("#include <QMultiMap>\n");
         printf("#include <QString>\n");
 
@@ -495,6 +626,9 @@ bool Scanner::process()
         printf("    (WAYLAND_VERSION_MAJOR == (major) && WAYLAND_VERSION_MINOR == (minor) && WAYLAND_VERSION_MICRO >= (micro)))\n");
         printf("#endif\n");
 
+        printf("\n");
+        printMessageHookDefinition();
+
         printf("\n");
         printf("QT_BEGIN_NAMESPACE\n");
         printf("QT_WARNING_PUSH\n");
@@ -566,8 +700,11 @@ bool Scanner::process()
             printf("        Resource *resource() { return m_resource; }\n");
             printf("        const Resource *resource() const { return m_resource; }\n");
             printf("\n");
-            printf("        QMultiMap<struct ::wl_client*, Resource*> resourceMap() { return m_resource_map; }\n");
-            printf("        const QMultiMap<struct ::wl_client*, Resource*> resourceMap() const { return m_resource_map; }\n");
+            printf("        const QMultiHash<struct ::wl_client*, Resource*> &resourceHash() const { return m_resource_map; }\n");
+            printf("        Resource *clientResource(struct ::wl_client *client) const { return m_resource_map.value(client, nullptr); }\n");
+            printf("#if QT_DEPRECATED_SINCE(5, 15)\n");
+            printf("        QT_DEPRECATED_X(\"Use resourceHash() or clientResource()\") QMultiMap<struct ::wl_client*, Resource*> resourceMap() const;\n");
+            printf("#endif\n");
             printf("\n");
             printf("        bool isGlobal() const { return m_global != nullptr; }\n");
             printf("        bool isResource() const { return m_resource != nullptr; }\n");
@@ -634,7 +771,7 @@ bool Scanner::process()
             }
 
             printf("\n");
-            printf("        QMultiMap<struct ::wl_client*, Resource*> m_resource_map;\n");
+            printf("        QMultiHash<struct ::wl_client*, Resource*> m_resource_map;\n");
             printf("        Resource *m_resource;\n");
             printf("        struct ::wl_global *m_global;\n");
             printf("        uint32_t m_globalVersion;\n");
@@ -731,6 +868,17 @@ bool Scanner::process()
             printf("    }\n");
             printf("\n");
 
+            printf("#if QT_DEPRECATED_SINCE(5, 15)\n");
+            printf("    QMultiMap<struct ::wl_client*, %s::Resource*> %s::resourceMap() const\n", interfaceName, interfaceName);
+            printf("    {\n");
+            printf("        QMultiMap<struct ::wl_client*, Resource*> map;\n");
+            printf("        for (auto it = m_resource_map.cbegin(), end = m_resource_map.cend(); it != end; ++it)\n");
+            printf("            map.insert(it.key(), it.value());\n");
+            printf("        return map;\n");
+            printf("    }\n");
+            printf("#endif\n");
+            printf("\n");
+
             printf("    void %s::init(struct ::wl_client *client, int id, int version)\n", interfaceName);
             printf("    {\n");
             printf("        m_resource = bind(client, id, version);\n");
@@ -891,10 +1039,14 @@ bool Scanner::process()
                     printf("\n");
                     printf("    {\n");
                     printf("        Q_UNUSED(client);\n");
+                    printf("        QT_WAYLAND_SERVER_MESSAGE_HOOK(&::%s_interface, %d, true, resource, %s);\n",
+                           interfaceName, int(&e - interface.requests.data()), messageSizeExpression(e, false).constData());
                     printf("        Resource *r = Resource::fromResource(resource);\n");
                     printf("        if (Q_UNLIKELY(!r->%s_object)) {\n", interfaceNameStripped);
                     if (e.type == "destructor")
                         printf("            wl_resource_destroy(resource);\n");
+                    printf("            QT_WAYLAND_SERVER_MESSAGE_HANDLED_HOOK(&::%s_interface, %d);\n",
+                           interfaceName, int(&e - interface.requests.data()));
                     printf("            return;\n");
                     printf("        }\n");
                     printf("        static_cast<%s *>(r->%s_object)->%s_%s(\n", interfaceName, interfaceNameStripped, interfaceNameStripped, e.name.constData());
@@ -902,7 +1054,7 @@ bool Scanner::process()
                     for (const WaylandArgument &a : e.arguments) {
                         printf(",\n");
                         QByteArray cType = waylandToCType(a.type, a.interface);
-                        QByteArray qtType = waylandToQtType(a.type, a.interface, e.request);
+                        QByteArray qtType = waylandToQtType(a.type, a.interface, e.request, a.rawString);
                         const char *argumentName = a.name.constData();
                         if (cType == qtType)
                             printf("            %s", argumentName);
@@ -910,6 +1062,9 @@ bool Scanner::process()
                             printf("            QString::fromUtf8(%s)", argumentName);
                     }
                     printf(");\n");
+                    // The resource may be gone by now
+                    printf("        QT_WAYLAND_SERVER_MESSAGE_HANDLED_HOOK(&::%s_interface, %d);\n",
+                           interfaceName, int(&e - interface.requests.data()));
                     printf("    }\n");
                 }
             }
@@ -953,14 +1108,16 @@ bool Scanner::process()
                     printf("\n");
                 }
 
+                printf("        QT_WAYLAND_SERVER_MESSAGE_HOOK(&::%s_interface, %d, false, resource, %s);\n",
+                       interfaceName, int(&e - interface.events.data()), messageSizeExpression(e, true).constData());
                 printf("        %s_send_%s(\n", interfaceName, e.name.constData());
                 printf("            resource");
 
                 for (const WaylandArgument &a : e.arguments) {
                     printf(",\n");
                     QByteArray cType = waylandToCType(a.type, a.interface);
-                    QByteArray qtType = waylandToQtType(a.type, a.interface, e.request);
-                    if (a.type == "string")
+                    QByteArray qtType = waylandToQtType(a.type, a.interface, e.request, a.rawString);
+                    if (a.type == "string" && !a.rawString)
                         printf("            %s.toUtf8().constData()", a.name.constData());
                     else if (a.type == "array")
                         printf("            &%s_data", a.name.constData());
@@ -990,6 +1147,16 @@ bool Scanner::process()
             printf("#include <%s/wayland-%s-client-protocol.h>\n", m_headerPath.constData(), QByteArray(m_protocolName).replace('_', '-').constData());
         printf("#include <QByteArray>\n");
         printf("#include <QString>\n");
+
+        printf("\n");
+        printf("#ifndef WAYLAND_VERSION_CHECK\n");
+        printf("#define WAYLAND_VERSION_CHECK(major, minor, micro) \\\n");
+        printf("    ((WAYLAND_VERSION_MAJOR > (major)) || \\\n");
+        printf("    (WAYLAND_VERSION_MAJOR == (major) && WAYLAND_VERSION_MINOR > (minor)) || \\\n");
+        printf("    (WAYLAND_VERSION_MAJOR == (major) && WAYLAND_VERSION_MINOR == (minor) && WAYLAND_VERSION_MICRO >= (micro)))\n");
+        printf("#endif\n");
+        printf("\n");
+        printMessageHookDefinition();
         printf("\n");
         printf("struct wl_registry;\n");
         printf("\n");
@@ -1119,7 +1286,10 @@ bool Scanner::process()
         printf("static inline void *wlRegistryBind(struct ::wl_registry *registry, uint32_t name, const struct ::wl_interface *interface, uint32_t version)\n");
         printf("{\n");
         printf("    const uint32_t bindOpCode = 0;\n");
-        printf("#if (WAYLAND_VERSION_MAJOR == 1 && WAYLAND_VERSION_MINOR > 10) || WAYLAND_VERSION_MAJOR > 1\n");
+        printf("#if WAYLAND_VERSION_CHECK(1, 20, 0)\n");
+        printf("    return (void *) wl_proxy_marshal_flags((struct wl_proxy *) registry,\n");
+        printf("        bindOpCode, interface, version, 0, name, interface->name, version, nullptr);\n");
+        printf("#elif (WAYLAND_VERSION_MAJOR == 1 && WAYLAND_VERSION_MINOR > 10) || WAYLAND_VERSION_MAJOR > 1\n");
         printf("    return (void *) wl_proxy_marshal_constructor_versioned((struct wl_proxy *) registry,\n");
         printf("        bindOpCode, interface, version, name, interface->name, version, nullptr);\n");
         printf("#else\n");
@@ -1234,6 +1404,44 @@ bool Scanner::process()
                     printf("        %s.alloc = 0;\n", arrayName);
                     printf("\n");
                 }
+                // With libwayland 1.20 we marshal through wl_proxy_marshal_flags() directly,
+                // which creates the new proxy, or destroys this one, under a single lock of
+                // the display mutex, no matter which wayland-scanner generated the C header.
+                QByteArray opcode = (interface.name + '_' + e.name).toUpper();
+                printf("        QT_WAYLAND_CLIENT_MESSAGE_HOOK(&::%s_interface, %s, true, m_%s, %s);\n",
+                       interfaceName, opcode.constData(), interfaceName, messageSizeExpression(e, true).constData());
+                printf("#if WAYLAND_VERSION_CHECK(1, 20, 0)\n");
+                printf("        %s", new_id ? "return " : "");
+                if (new_id && !new_id->interface.isEmpty())
+                    printf("reinterpret_cast<struct ::%s *>(", new_id->interface.constData());
+                printf("::wl_proxy_marshal_flags(\n");
+                printf("            reinterpret_cast<struct ::wl_proxy *>(m_%s),\n", interfaceName);
+                printf("            %s,\n", opcode.constData());
+                if (!new_id) {
+                    printf("            nullptr,\n");
+                    printf("            ::wl_proxy_get_version(reinterpret_cast<struct ::wl_proxy *>(m_%s)),\n", interfaceName);
+                } else if (new_id->interface.isEmpty()) {
+                    printf("            interface,\n");
+                    printf("            version,\n");
+                } else {
+                    printf("            &::%s_interface,\n", new_id->interface.constData());
+                    printf("            ::wl_proxy_get_version(reinterpret_cast<struct ::wl_proxy *>(m_%s)),\n", interfaceName);
+                }
+                printf("            %s", e.type == "destructor" ? "WL_MARSHAL_FLAG_DESTROY" : "0");
+                for (const WaylandArgument &a : e.arguments) {
+                    printf(",\n");
+                    if (a.type == "new_id") {
+                        if (a.interface.isEmpty()) {
+                            printf("            interface->name,\n");
+                            printf("            version,\n");
+                        }
+                        printf("            nullptr");
+                    } else {
+                        printRequestArgument(a, e);
+                    }
+                }
+                printf(")%s;\n", new_id && !new_id->interface.isEmpty() ? ")" : "");
+                printf("#else\n");
                 int actualArgumentCount = new_id ? int(e.arguments.size()) - 1 : int(e.arguments.size());
                 printf("        %s%s_%s(\n", new_id ? "return " : "", interfaceName, e.name.constData());
                 printf("            m_%s%s", interfaceName, actualArgumentCount > 0 ? "," : "");
@@ -1250,17 +1458,11 @@ bool Scanner::process()
                         printf("            interface,\n");
                         printf("            version");
                     } else {
-                        QByteArray cType = waylandToCType(a.type, a.interface);
-                        QByteArray qtType = waylandToQtType(a.type, a.interface, e.request);
-                        if (a.type == "string")
-                            printf("            %s.toUtf8().constData()", a.name.constData());
-                        else if (a.type == "array")
-                            printf("            &%s_data", a.name.constData());
-                        else if (cType == qtType)
-                            printf("            %s", a.name.constData());
+                        printRequestArgument(a, e);
                     }
                 }
                 printf(");\n");
+                printf("#endif\n");
                 if (e.type == "destructor")
                     printf("        m_%s = nullptr;\n", interfaceName);
                 printf("    }\n");
@@ -1280,6 +1482,8 @@ bool Scanner::process()
                     printf("\n");
                     printf("    {\n");
                     printf("        Q_UNUSED(object);\n");
+                    printf("        QT_WAYLAND_CLIENT_MESSAGE_HOOK(&::%s_interface, %d, false, object, %s);\n",
+                           interfaceName, int(&e - interface.events.data()), messageSizeExpression(e, false).constData());
                     printf("        static_cast<%s *>(data)->%s_%s(", interfaceName, interfaceNameStripped, e.name.constData());
                     bool needsComma = false;
                     for (const WaylandArgument &a : e.arguments) {
@@ -1288,12 +1492,14 @@ bool Scanner::process()
                         needsComma = true;
                         printf("\n");
                         const char *argumentName = a.name.constData();
-                        if (a.type == "string")
+                        if (a.type == "string" && !a.rawString)
                             printf("            QString::fromUtf8(%s)", argumentName);
                         else
                             printf("            %s", argumentName);
                     }
                     printf(");\n");
+                    printf("        QT_WAYLAND_CLIENT_MESSAGE_HANDLED_HOOK(&::%s_interface, %d);\n",
+                           interfaceName, int(&e - interface.events.data()));
 
                     printf("    }\n");
                     printf("\n");
@@ -0,0 +1,83 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the tools applications of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "tracemerger.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+
+#include <cstdio>
+
+QT_USE_NAMESPACE
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("qtwaylandtracemerge"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral(
+            "Merges the trace files written by Qt Wayland clients (QT_WAYLAND_CLIENT_TRACE) and "
+            "compositors (QT_WAYLAND_COMPOSITOR_TRACE), and links client commits and frame "
+            "callbacks to the compositor events handling them."));
+    parser.addHelpOption();
+    QCommandLineOption outputOption({ QStringLiteral("o"), QStringLiteral("output") },
+                                    QStringLiteral("Write the merged trace to <file> instead of the standard output."),
+                                    QStringLiteral("file"));
+    parser.addOption(outputOption);
+    parser.addPositionalArgument(QStringLiteral("traces"), QStringLiteral("The trace files to merge."),
+                                 QStringLiteral("traces..."));
+    parser.process(app);
+
+    const QStringList inputs = parser.positionalArguments();
+    if (inputs.isEmpty())
+        parser.showHelp(1);
+
+    TraceMerger merger;
+    for (const QString &input : inputs) {
+        if (!merger.addFile(input))
+            return 1;
+    }
+    merger.linkEvents();
+    if (!merger.write(parser.value(outputOption)))
+        return 1;
+
+    fprintf(stderr, "Linked %d commits and %d frame callbacks\n", merger.commitLinks, merger.frameCallbackLinks);
+    return 0;
+}
@@ -0,0 +1,10 @@
+option(host_build)
+QT = core
+
+HEADERS += tracemerger.h
+
+SOURCES += \
+    qtwaylandtracemerge.cpp \
+    tracemerger.cpp
+
+load(qt_tool)
@@ -0,0 +1,242 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the tools applications of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "tracemerger.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QVector>
+
+#include <algorithm>
+#include <cstdio>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+struct Key
+{
+    qint64 pid;
+    qint64 surface;
+    qint64 frameCallback;
+};
+
+bool operator==(const Key &a, const Key &b)
+{
+    return a.pid == b.pid && a.surface == b.surface && a.frameCallback == b.frameCallback;
+}
+
+uint qHash(const Key &key, uint seed = 0)
+{
+    return QT_PREPEND_NAMESPACE(qHash)(key.pid, seed) ^ QT_PREPEND_NAMESPACE(qHash)(key.surface << 32 | key.frameCallback, seed);
+}
+
+struct Endpoint
+{
+    double ts;
+    int index;
+};
+
+const Endpoint *lastBefore(const QVector<Endpoint> &endpoints, double ts)
+{
+    auto it = std::upper_bound(endpoints.cbegin(), endpoints.cend(), ts, [](double ts, const Endpoint &endpoint) {
+        return ts < endpoint.ts;
+    });
+    return it == endpoints.cbegin() ? nullptr : &*(it - 1);
+}
+
+const Endpoint *firstAfter(const QVector<Endpoint> &endpoints, double ts)
+{
+    auto it = std::lower_bound(endpoints.cbegin(), endpoints.cend(), ts, [](const Endpoint &endpoint, double ts) {
+        return endpoint.ts < ts;
+    });
+    return it == endpoints.cend() ? nullptr : &*it;
+}
+
+}
+
+bool TraceMerger::addFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "Could not open %s: %s\n", qPrintable(fileName), qPrintable(file.errorString()));
+        return false;
+    }
+
+    QByteArray data = file.readAll().trimmed();
+    // The closing bracket of the array format is optional, and traces cut short end with a comma
+    if (data.startsWith('[') && !data.endsWith(']')) {
+        if (data.endsWith(','))
+            data.chop(1);
+        data += ']';
+    }
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(data, &error);
+    if (error.error != QJsonParseError::NoError) {
+        fprintf(stderr, "Could not parse %s: %s at offset %d\n", qPrintable(fileName),
+                qPrintable(error.errorString()), error.offset);
+        return false;
+    }
+
+    const QJsonArray events = document.isArray() ? document.array()
+                                                 : document.object().value(QLatin1String("traceEvents")).toArray();
+    for (const QJsonValue &event : events)
+        m_events.append(event);
+    return true;
+}
+
+void TraceMerger::linkEvents()
+{
+    // Client side events, by client pid, surface and frame callback
+    QHash<Key, QVector<Endpoint>> clientCommits;
+    QHash<Key, QVector<Endpoint>> clientFrameCallbacks;
+    for (int i = 0; i < m_events.size(); ++i) {
+        const QJsonObject event = m_events.at(i).toObject();
+        const QString name = event.value(QLatin1String("name")).toString();
+        const QJsonObject args = event.value(QLatin1String("args")).toObject();
+        if (args.contains(QLatin1String("client")))
+            continue; // Compositor side
+        const qint64 frameCallback = args.value(QLatin1String("frameCallback")).toVariant().toLongLong();
+        if (!frameCallback)
+            continue;
+
+        const double ts = event.value(QLatin1String("ts")).toDouble();
+        const qint64 pid = event.value(QLatin1String("pid")).toVariant().toLongLong();
+        if (name == QLatin1String("commit") || name == QLatin1String("swapBuffers")) {
+            const qint64 surface = args.value(QLatin1String("surface")).toVariant().toLongLong();
+            clientCommits[{ pid, surface, frameCallback }].append({ ts, i });
+        } else if (name == QLatin1String("frameCallback")) {
+            clientFrameCallbacks[{ pid, 0, frameCallback }].append({ ts, i });
+        }
+    }
+
+    const auto byTime = [](const Endpoint &a, const Endpoint &b) { return a.ts < b.ts; };
+    for (auto it = clientCommits.begin(); it != clientCommits.end(); ++it)
+        std::sort(it->begin(), it->end(), byTime);
+    for (auto it = clientFrameCallbacks.begin(); it != clientFrameCallbacks.end(); ++it)
+        std::sort(it->begin(), it->end(), byTime);
+
+    for (int i = 0; i < m_events.size(); ++i) {
+        QJsonObject event = m_events.at(i).toObject();
+        QJsonObject args = event.value(QLatin1String("args")).toObject();
+        if (!args.contains(QLatin1String("client")))
+            continue;
+        const qint64 frameCallback = args.value(QLatin1String("frameCallback")).toVariant().toLongLong();
+        if (!frameCallback)
+            continue;
+
+        const QString name = event.value(QLatin1String("name")).toString();
+        const double ts = event.value(QLatin1String("ts")).toDouble();
+        const qint64 client = args.value(QLatin1String("client")).toVariant().toLongLong();
+        if (name == QLatin1String("surface_commit")) {
+            // The latest commit with the same frame callback the client made before
+            const qint64 surface = args.value(QLatin1String("surface")).toVariant().toLongLong();
+            const Endpoint *commit = lastBefore(clientCommits.value({ client, surface, frameCallback }), ts);
+            if (!commit)
+                continue;
+            const QJsonObject clientEvent = m_events.at(commit->index).toObject();
+            addFlow("commit", clientEvent, event);
+            ++commitLinks;
+
+            args.insert(QLatin1String("clientSeq"), clientEvent.value(QLatin1String("args")).toObject().value(QLatin1String("seq")));
+            event.insert(QLatin1String("args"), args);
+            m_events.replace(i, event);
+        } else if (name == QLatin1String("frameCallback")) {
+            // The first time the client handled the frame callback afterwards
+            const Endpoint *done = firstAfter(clientFrameCallbacks.value({ client, 0, frameCallback }), ts);
+            if (!done)
+                continue;
+            addFlow("frameCallback", event, m_events.at(done->index).toObject());
+            ++frameCallbackLinks;
+        }
+    }
+}
+
+void TraceMerger::addFlow(const char *name, const QJsonObject &from, const QJsonObject &to)
+{
+    const int id = m_nextFlowId++;
+
+    QJsonObject start;
+    start.insert(QLatin1String("name"), QLatin1String(name));
+    start.insert(QLatin1String("cat"), QLatin1String("wayland"));
+    start.insert(QLatin1String("ph"), QLatin1String("s"));
+    start.insert(QLatin1String("id"), id);
+    start.insert(QLatin1String("ts"), from.value(QLatin1String("ts")));
+    start.insert(QLatin1String("pid"), from.value(QLatin1String("pid")));
+    start.insert(QLatin1String("tid"), from.value(QLatin1String("tid")));
+    m_flows.append(start);
+
+    QJsonObject finish = start;
+    finish.insert(QLatin1String("ph"), QLatin1String("f"));
+    finish.insert(QLatin1String("bp"), QLatin1String("e"));
+    finish.insert(QLatin1String("ts"), to.value(QLatin1String("ts")));
+    finish.insert(QLatin1String("pid"), to.value(QLatin1String("pid")));
+    finish.insert(QLatin1String("tid"), to.value(QLatin1String("tid")));
+    m_flows.append(finish);
+}
+
+QJsonObject TraceMerger::mergedTrace() const
+{
+    QJsonArray events = m_events;
+    for (const QJsonValue &flow : m_flows)
+        events.append(flow);
+
+    QJsonObject trace;
+    trace.insert(QLatin1String("traceEvents"), events);
+    trace.insert(QLatin1String("displayTimeUnit"), QLatin1String("ms"));
+    return trace;
+}
+
+bool TraceMerger::write(const QString &fileName) const
+{
+    const QByteArray data = QJsonDocument(mergedTrace()).toJson(QJsonDocument::Compact);
+
+    QFile file(fileName);
+    const bool opened = fileName.isEmpty() ? file.open(stdout, QIODevice::WriteOnly)
+                                           : file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!opened || file.write(data) != data.size()) {
+        fprintf(stderr, "Could not write %s: %s\n", qPrintable(fileName), qPrintable(file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+QT_END_NAMESPACE
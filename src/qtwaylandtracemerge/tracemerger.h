@@ -0,0 +1,76 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the tools applications of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef TRACEMERGER_H
+#define TRACEMERGER_H
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+QT_BEGIN_NAMESPACE
+
+// Merges the Chrome trace files written by Qt Wayland clients (QT_WAYLAND_CLIENT_TRACE)
+// and compositors (QT_WAYLAND_COMPOSITOR_TRACE) into one, and adds flow events from each
+// client commit to the compositor handling it, and from each frame callback the
+// compositor sends to the client receiving it. Both sides identify the surface and the
+// frame callback by the ids of the client's wl_surface and wl_callback objects, and the
+// compositor adds the pid of the client.
+class TraceMerger
+{
+public:
+    bool addFile(const QString &fileName);
+    void linkEvents();
+    QJsonObject mergedTrace() const;
+    bool write(const QString &fileName) const;
+
+    int commitLinks = 0;
+    int frameCallbackLinks = 0;
+
+private:
+    void addFlow(const char *name, const QJsonObject &from, const QJsonObject &to);
+
+    QJsonArray m_events;
+    QJsonArray m_flows;
+    int m_nextFlowId = 1;
+};
+
+QT_END_NAMESPACE
+
+#endif // TRACEMERGER_H
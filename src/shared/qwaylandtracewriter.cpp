@@ -0,0 +1,149 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwaylandtracewriter_p.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+QT_BEGIN_NAMESPACE
+
+// Trace timestamps are in microseconds, with nanosecond precision
+static QByteArray formatMicroseconds(qint64 nsecs)
+{
+    return QByteArray::number(nsecs / 1000) + '.' + QByteArray::number(nsecs % 1000).rightJustified(3, '0');
+}
+
+static qint64 currentThreadId()
+{
+#ifdef SYS_gettid
+    return qint64(::syscall(SYS_gettid));
+#else
+    return qint64(quintptr(QThread::currentThreadId()));
+#endif
+}
+
+QWaylandTraceWriter::~QWaylandTraceWriter()
+{
+    close();
+}
+
+bool QWaylandTraceWriter::open(const QString &fileName, const QByteArray &processName)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_file)
+        return true;
+
+    m_pid = ::getpid();
+    QString name = fileName;
+    name.replace(QLatin1String("%p"), QString::number(m_pid));
+    m_file = ::fopen(QFile::encodeName(name).constData(), "w");
+    if (!m_file)
+        return false;
+
+    ::fputs("[", m_file);
+    m_empty = true;
+
+    QByteArray escapedName = processName;
+    escapedName.replace('\\', "\\\\").replace('"', "\\\"");
+    writeLocked("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + QByteArray::number(m_pid)
+                + ",\"tid\":0,\"args\":{\"name\":\"" + escapedName + "\"}}");
+    return true;
+}
+
+void QWaylandTraceWriter::close()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_file)
+        return;
+
+    ::fputs("\n]\n", m_file);
+    ::fclose(m_file);
+    m_file = nullptr;
+}
+
+qint64 QWaylandTraceWriter::timestamp()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void QWaylandTraceWriter::writeEvent(const char *name, char phase, qint64 timestamp, qint64 duration, const QByteArray &args)
+{
+    QByteArray event;
+    event.reserve(160 + args.size());
+    event += "{\"name\":\"";
+    event += name;
+    event += "\",\"ph\":\"";
+    event += phase;
+    event += "\",\"ts\":";
+    event += formatMicroseconds(timestamp);
+    if (phase == 'X') {
+        event += ",\"dur\":";
+        event += formatMicroseconds(duration);
+    }
+    event += ",\"pid\":";
+    event += QByteArray::number(m_pid);
+    event += ",\"tid\":";
+    event += QByteArray::number(currentThreadId());
+    if (!args.isEmpty()) {
+        event += ",\"args\":{";
+        event += args;
+        event += '}';
+    }
+    event += '}';
+
+    QMutexLocker locker(&m_mutex);
+    if (m_file)
+        writeLocked(event);
+}
+
+void QWaylandTraceWriter::writeLocked(const QByteArray &event)
+{
+    ::fputs(m_empty ? "\n" : ",\n", m_file);
+    ::fwrite(event.constData(), 1, size_t(event.size()), m_file);
+    m_empty = false;
+}
+
+QT_END_NAMESPACE
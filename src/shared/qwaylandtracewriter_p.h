@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWAYLANDTRACEWRITER_P_H
+#define QWAYLANDTRACEWRITER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+
+#include <cstdio>
+#include <initializer_list>
+
+QT_BEGIN_NAMESPACE
+
+// Writes trace events in the JSON array format read by chrome://tracing and Perfetto.
+// Timestamps come from CLOCK_MONOTONIC, which all processes share, so the traces
+// written by clients and by the compositor line up. Events may be written from any
+// thread. The closing bracket is optional in this format, so a trace cut short by a
+// crash can still be loaded.
+class QWaylandTraceWriter
+{
+public:
+    ~QWaylandTraceWriter();
+
+    // "%p" in fileName is replaced by the process id
+    bool open(const QString &fileName, const QByteArray &processName);
+    void close();
+    bool isOpen() const { return m_file; }
+
+    // Nanoseconds
+    static qint64 timestamp();
+
+    // args is the contents of a JSON object, see formatArgs()
+    void writeEvent(const char *name, char phase, qint64 timestamp, qint64 duration, const QByteArray &args);
+
+    template <typename Arg>
+    static QByteArray formatArgs(std::initializer_list<Arg> args)
+    {
+        QByteArray result;
+        for (const Arg &arg : args) {
+            if (!result.isEmpty())
+                result += ',';
+            result += '"';
+            result += arg.name;
+            result += "\":";
+            result += QByteArray::number(arg.value);
+        }
+        return result;
+    }
+
+private:
+    void writeLocked(const QByteArray &event);
+
+    QMutex m_mutex;
+    FILE *m_file = nullptr;
+    qint64 m_pid = 0;
+    bool m_empty = true;
+};
+
+QT_END_NAMESPACE
+
+#endif // QWAYLANDTRACEWRITER_P_H
@@ -8,6 +8,10 @@ qtConfig(wayland-client)|qtConfig(wayland-server) {
     sub_qtwaylandscanner.target = sub-qtwaylandscanner
     SUBDIRS += sub_qtwaylandscanner
 
+    sub_qtwaylandtracemerge.subdir = qtwaylandtracemerge
+    sub_qtwaylandtracemerge.target = sub-qtwaylandtracemerge
+    SUBDIRS += sub_qtwaylandtracemerge
+
     qtConfig(wayland-client) {
         sub_client.subdir = client
         sub_client.depends = sub-qtwaylandscanner
@@ -9,3 +9,6 @@ qtHaveModule(waylandclient):qtHaveModule(waylandcompositor): \
 
 qtHaveModule(waylandcompositor): \
     SUBDIRS += compositor
+
+qtHaveModule(waylandclient)|qtHaveModule(waylandcompositor): \
+    SUBDIRS += tracemerge
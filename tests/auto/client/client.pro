@@ -19,3 +19,4 @@ SUBDIRS += \
     xdgshellv6
 
 qtConfig(im): SUBDIRS += inputcontext
+qtConfig(opengl): SUBDIRS += sharedtexturecache
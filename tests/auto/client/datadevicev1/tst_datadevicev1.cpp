@@ -66,14 +66,14 @@ private slots:
 void tst_datadevicev1::initTestCase()
 {
     QCOMPOSITOR_TRY_VERIFY(pointer());
-    QCOMPOSITOR_TRY_VERIFY(!pointer()->resourceMap().empty());
-    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceMap().first()->version(), 5);
+    QCOMPOSITOR_TRY_VERIFY(!pointer()->resourceHash().empty());
+    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceHash().values().first()->version(), 5);
 
     QCOMPOSITOR_TRY_VERIFY(keyboard());
 
     QCOMPOSITOR_TRY_VERIFY(dataDevice());
-    QCOMPOSITOR_TRY_VERIFY(dataDevice()->resourceMap().contains(client()));
-    QCOMPOSITOR_TRY_COMPARE(dataDevice()->resourceMap().value(client())->version(), dataDeviceVersion);
+    QCOMPOSITOR_TRY_VERIFY(dataDevice()->resourceHash().contains(client()));
+    QCOMPOSITOR_TRY_COMPARE(dataDevice()->clientResource(client())->version(), dataDeviceVersion);
 }
 
 void tst_datadevicev1::pasteAscii()
@@ -59,7 +59,7 @@ private slots:
 void tst_output::primaryScreen()
 {
     // Verify that the client has bound to the output global
-    QCOMPOSITOR_TRY_COMPARE(output()->resourceMap().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(output()->resourceHash().size(), 1);
     QTRY_VERIFY(QGuiApplication::primaryScreen());
     QScreen *screen = QGuiApplication::primaryScreen();
     QCOMPARE(screen->manufacturer(), "Make");
@@ -83,7 +83,7 @@ void tst_output::secondaryHiDpiScreen()
     });
 
     // Verify that the client has bound to the output global
-    QCOMPOSITOR_TRY_VERIFY(output(1) && output(1)->resourceMap().size() == 1);
+    QCOMPOSITOR_TRY_VERIFY(output(1) && output(1)->resourceHash().size() == 1);
 
     QTRY_COMPARE(QGuiApplication::screens().size(), 2);
     QScreen *screen = QGuiApplication::screens()[1];
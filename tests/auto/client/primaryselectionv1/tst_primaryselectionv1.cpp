@@ -133,7 +133,7 @@ public:
     void sendSelection(PrimarySelectionOfferV1 *offer)
     {
         auto *client = offer->resource()->client();
-        for (auto *resource : resourceMap().values(client))
+        for (auto *resource : resourceHash().values(client))
             zwp_primary_selection_device_v1::send_selection(resource->handle, offer->resource()->handle);
         m_sentSelectionOffers << offer;
     }
@@ -221,7 +221,7 @@ PrimarySelectionOfferV1 *PrimarySelectionDeviceV1::sendDataOffer(wl_client *clie
 {
     Q_ASSERT(client);
     auto *offer = new PrimarySelectionOfferV1(this, client, m_manager->m_version);
-    for (auto *resource : resourceMap().values(client))
+    for (auto *resource : resourceHash().values(client))
         zwp_primary_selection_device_v1::send_data_offer(resource->handle, offer->resource()->handle);
     for (const auto &mimeType : mimeTypes)
         offer->sendOffer(mimeType);
@@ -268,23 +268,23 @@ private slots:
 void tst_primaryselectionv1::initTestCase()
 {
     QCOMPOSITOR_TRY_VERIFY(pointer());
-    QCOMPOSITOR_TRY_VERIFY(!pointer()->resourceMap().empty());
-    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceMap().first()->version(), 5);
+    QCOMPOSITOR_TRY_VERIFY(!pointer()->resourceHash().empty());
+    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceHash().values().first()->version(), 5);
 
     QCOMPOSITOR_TRY_VERIFY(keyboard());
 }
 
 void tst_primaryselectionv1::bindsToManager()
 {
-    QCOMPOSITOR_TRY_COMPARE(get<PrimarySelectionDeviceManagerV1>()->resourceMap().size(), 1);
-    QCOMPOSITOR_TRY_COMPARE(get<PrimarySelectionDeviceManagerV1>()->resourceMap().first()->version(), primarySelectionVersion);
+    QCOMPOSITOR_TRY_COMPARE(get<PrimarySelectionDeviceManagerV1>()->resourceHash().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(get<PrimarySelectionDeviceManagerV1>()->resourceHash().values().first()->version(), primarySelectionVersion);
 }
 
 void tst_primaryselectionv1::createsPrimaryDevice()
 {
     QCOMPOSITOR_TRY_VERIFY(primarySelectionDevice());
-    QCOMPOSITOR_TRY_VERIFY(primarySelectionDevice()->resourceMap().contains(client()));
-    QCOMPOSITOR_TRY_COMPARE(primarySelectionDevice()->resourceMap().value(client())->version(), primarySelectionVersion);
+    QCOMPOSITOR_TRY_VERIFY(primarySelectionDevice()->resourceHash().contains(client()));
+    QCOMPOSITOR_TRY_COMPARE(primarySelectionDevice()->clientResource(client())->version(), primarySelectionVersion);
     QTRY_VERIFY(QGuiApplication::clipboard()->supportsSelection());
 }
 
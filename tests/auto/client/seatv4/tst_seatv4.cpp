@@ -93,8 +93,8 @@ void tst_seatv4::cleanup()
 
 void tst_seatv4::bindsToSeat()
 {
-    QCOMPOSITOR_COMPARE(get<Seat>()->resourceMap().size(), 1);
-    QCOMPOSITOR_COMPARE(get<Seat>()->resourceMap().first()->version(), 4);
+    QCOMPOSITOR_COMPARE(get<Seat>()->resourceHash().size(), 1);
+    QCOMPOSITOR_COMPARE(get<Seat>()->resourceHash().values().first()->version(), 4);
 }
 
 void tst_seatv4::keyboardKeyPress()
@@ -124,8 +124,8 @@ void tst_seatv4::keyboardKeyPress()
 
 void tst_seatv4::createsPointer()
 {
-    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceMap().size(), 1);
-    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceMap().first()->version(), 4);
+    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceHash().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceHash().values().first()->version(), 4);
 }
 
 void tst_seatv4::setsCursorOnEnter()
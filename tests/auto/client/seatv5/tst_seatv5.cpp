@@ -77,14 +77,14 @@ private slots:
 
 void tst_seatv5::bindsToSeat()
 {
-    QCOMPOSITOR_COMPARE(get<Seat>()->resourceMap().size(), 1);
-    QCOMPOSITOR_COMPARE(get<Seat>()->resourceMap().first()->version(), 5);
+    QCOMPOSITOR_COMPARE(get<Seat>()->resourceHash().size(), 1);
+    QCOMPOSITOR_COMPARE(get<Seat>()->resourceHash().values().first()->version(), 5);
 }
 
 void tst_seatv5::createsPointer()
 {
-    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceMap().size(), 1);
-    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceMap().first()->version(), 5);
+    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceHash().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(pointer()->resourceHash().values().first()->version(), 5);
 }
 
 void tst_seatv5::setsCursorOnEnter()
@@ -399,8 +399,8 @@ void tst_seatv5::continuousScroll()
 
 void tst_seatv5::createsTouch()
 {
-    QCOMPOSITOR_TRY_COMPARE(touch()->resourceMap().size(), 1);
-    QCOMPOSITOR_TRY_COMPARE(touch()->resourceMap().first()->version(), 5);
+    QCOMPOSITOR_TRY_COMPARE(touch()->resourceHash().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(touch()->resourceHash().values().first()->version(), 5);
 }
 
 class TouchWindow : public QRasterWindow {
@@ -42,7 +42,7 @@ void Surface::sendFrameCallbacks()
 void Surface::sendEnter(Output *output)
 {
     m_outputs.append(output);
-    const auto outputResources = output->resourceMap().values(resource()->client());
+    const auto outputResources = output->resourceHash().values(resource()->client());
     for (auto outputResource: outputResources)
         wl_surface::send_enter(resource()->handle, outputResource->handle);
 }
@@ -50,7 +50,7 @@ void Surface::sendEnter(Output *output)
 void Surface::sendLeave(Output *output)
 {
     m_outputs.removeOne(output);
-    const auto outputResources = output->resourceMap().values(resource()->client());
+    const auto outputResources = output->resourceHash().values(resource()->client());
     for (auto outputResource: outputResources)
         wl_surface::send_leave(resource()->handle, outputResource->handle);
 }
@@ -128,7 +128,7 @@ QString WlCompositor::dirtyMessage()
 
 void Output::sendGeometry()
 {
-    const auto resources = resourceMap().values();
+    const auto resources = resourceHash().values();
     for (auto r : resources)
         sendGeometry(r);
 }
@@ -146,7 +146,7 @@ void Output::sendScale(int factor)
 {
     Q_ASSERT(m_version >= WL_OUTPUT_SCALE_SINCE_VERSION);
     m_data.scale = factor;
-    const auto resources = resourceMap().values();
+    const auto resources = resourceHash().values();
     for (auto r : resources)
         sendScale(r);
 }
@@ -161,7 +161,7 @@ void Output::sendScale(Resource *resource)
 void Output::sendDone(wl_client *client)
 {
     Q_ASSERT(m_version >= WL_OUTPUT_DONE_SINCE_VERSION);
-    auto resources = resourceMap().values(client);
+    auto resources = resourceHash().values(client);
     for (auto *r : resources)
         wl_output::send_done(r->handle);
 }
@@ -170,7 +170,7 @@ void Output::sendDone()
 {
     Q_ASSERT(m_version >= WL_OUTPUT_DONE_SINCE_VERSION);
     // TODO: check resource version as well?
-    const auto resources = resourceMap().values();
+    const auto resources = resourceHash().values();
     for (auto r : resources)
         wl_output::send_done(r->handle);
 }
@@ -234,7 +234,7 @@ void Seat::setCapabilities(uint capabilities) {
         m_keyboard = nullptr;
     }
 
-    for (auto *resource : resourceMap())
+    for (auto *resource : resourceHash())
         wl_seat::send_capabilities(resource->handle, capabilities);
 }
 
@@ -298,7 +298,7 @@ uint Pointer::sendEnter(Surface *surface, const QPointF &position)
     m_cursorRole = nullptr; // According to the protocol, the pointer image is undefined after enter
 
     wl_client *client = surface->resource()->client();
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         wl_pointer::send_enter(r->handle, serial, surface->resource()->handle, x ,y);
     return serial;
@@ -309,7 +309,7 @@ uint Pointer::sendLeave(Surface *surface)
     uint serial = m_seat->m_compositor->nextSerial();
 
     wl_client *client = surface->resource()->client();
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         wl_pointer::send_leave(r->handle, serial, surface->resource()->handle);
     return serial;
@@ -321,7 +321,7 @@ void Pointer::sendMotion(wl_client *client, const QPointF &position)
     wl_fixed_t x = wl_fixed_from_double(position.x());
     wl_fixed_t y = wl_fixed_from_double(position.y());
     auto time = m_seat->m_compositor->currentTimeMilliseconds();
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         send_motion(r->handle, time, x, y);
 }
@@ -332,7 +332,7 @@ uint Pointer::sendButton(wl_client *client, uint button, uint state)
     Q_ASSERT(state == button_state_pressed || state == button_state_released);
     auto time = m_seat->m_compositor->currentTimeMilliseconds();
     uint serial = m_seat->m_compositor->nextSerial();
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         send_button(r->handle, serial, time, button, state);
     return serial;
@@ -343,7 +343,7 @@ void Pointer::sendAxis(wl_client *client, axis axis, qreal value)
 {
     auto time = m_seat->m_compositor->currentTimeMilliseconds();
     wl_fixed_t val = wl_fixed_from_double(value);
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         send_axis(r->handle, time, axis, val);
 }
@@ -351,7 +351,7 @@ void Pointer::sendAxis(wl_client *client, axis axis, qreal value)
 void Pointer::sendAxisDiscrete(wl_client *client, QtWaylandServer::wl_pointer::axis axis, int discrete)
 {
     // TODO: assert v5 or newer
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         send_axis_discrete(r->handle, axis, discrete);
 }
@@ -359,7 +359,7 @@ void Pointer::sendAxisDiscrete(wl_client *client, QtWaylandServer::wl_pointer::a
 void Pointer::sendAxisSource(wl_client *client, QtWaylandServer::wl_pointer::axis_source source)
 {
     // TODO: assert v5 or newer
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         send_axis_source(r->handle, source);
 }
@@ -368,7 +368,7 @@ void Pointer::sendAxisStop(wl_client *client, QtWaylandServer::wl_pointer::axis
 {
     // TODO: assert v5 or newer
     auto time = m_seat->m_compositor->currentTimeMilliseconds();
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         send_axis_stop(r->handle, time, axis);
 }
@@ -376,7 +376,7 @@ void Pointer::sendAxisStop(wl_client *client, QtWaylandServer::wl_pointer::axis
 void Pointer::sendFrame(wl_client *client)
 {
     //TODO: assert version 5 or newer?
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         send_frame(r->handle);
 }
@@ -413,7 +413,7 @@ uint Touch::sendDown(Surface *surface, const QPointF &position, int id)
     auto time = m_seat->m_compositor->currentTimeMilliseconds();
     wl_client *client = surface->resource()->client();
 
-    const auto touchResources = resourceMap().values(client);
+    const auto touchResources = resourceHash().values(client);
     for (auto *r : touchResources)
         wl_touch::send_down(r->handle, serial, time, surface->resource()->handle, id, x, y);
 
@@ -425,7 +425,7 @@ uint Touch::sendUp(wl_client *client, int id)
     uint serial = m_seat->m_compositor->nextSerial();
     auto time = m_seat->m_compositor->currentTimeMilliseconds();
 
-    const auto touchResources = resourceMap().values(client);
+    const auto touchResources = resourceHash().values(client);
     for (auto *r : touchResources)
         wl_touch::send_up(r->handle, serial, time, id);
 
@@ -439,14 +439,14 @@ void Touch::sendMotion(wl_client *client, const QPointF &position, int id)
 
     auto time = m_seat->m_compositor->currentTimeMilliseconds();
 
-    const auto touchResources = resourceMap().values(client);
+    const auto touchResources = resourceHash().values(client);
     for (auto *r : touchResources)
         wl_touch::send_motion(r->handle, time, id, x, y);
 }
 
 void Touch::sendFrame(wl_client *client)
 {
-    const auto touchResources = resourceMap().values(client);
+    const auto touchResources = resourceHash().values(client);
     for (auto *r : touchResources)
         send_frame(r->handle);
 }
@@ -455,7 +455,7 @@ uint Keyboard::sendEnter(Surface *surface)
 {
     auto serial = m_seat->m_compositor->nextSerial();
     wl_client *client = surface->resource()->client();
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         send_enter(r->handle, serial, surface->resource()->handle, QByteArray());
     m_enteredSurface = surface;
@@ -466,7 +466,7 @@ uint Keyboard::sendLeave(Surface *surface)
 {
     auto serial = m_seat->m_compositor->nextSerial();
     wl_client *client = surface->resource()->client();
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         send_leave(r->handle, serial, surface->resource()->handle);
     m_enteredSurface = nullptr;
@@ -478,7 +478,7 @@ uint Keyboard::sendKey(wl_client *client, uint key, uint state)
     Q_ASSERT(state == key_state_pressed || state == key_state_released);
     auto time = m_seat->m_compositor->currentTimeMilliseconds();
     uint serial = m_seat->m_compositor->nextSerial();
-    const auto pointerResources = resourceMap().values(client);
+    const auto pointerResources = resourceHash().values(client);
     for (auto *r : pointerResources)
         send_key(r->handle, serial, time, key, state);
     return serial;
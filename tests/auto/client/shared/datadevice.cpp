@@ -63,7 +63,7 @@ void DataDeviceManager::data_device_manager_get_data_device(Resource *resource,
 DataDevice::~DataDevice()
 {
     // If the client(s) hasn't deleted the wayland object, just ignore subsequent events
-    for (auto *r : resourceMap())
+    for (auto *r : resourceHash())
         wl_resource_set_implementation(r->handle, nullptr, nullptr, nullptr);
 }
 
@@ -71,7 +71,7 @@ DataOffer *DataDevice::sendDataOffer(wl_client *client, const QStringList &mimeT
 {
     Q_ASSERT(client);
     auto *offer = new DataOffer(this, client, m_manager->m_version);
-    for (auto *resource : resourceMap().values(client))
+    for (auto *resource : resourceHash().values(client))
         wl_data_device::send_data_offer(resource->handle, offer->resource()->handle);
     for (const auto &mimeType : mimeTypes)
         offer->send_offer(mimeType);
@@ -81,7 +81,7 @@ DataOffer *DataDevice::sendDataOffer(wl_client *client, const QStringList &mimeT
 void DataDevice::sendSelection(DataOffer *offer)
 {
     auto *client = offer->resource()->client();
-    for (auto *resource : resourceMap().values(client))
+    for (auto *resource : resourceHash().values(client))
         wl_data_device::send_selection(resource->handle, offer->resource()->handle);
     m_sentSelectionOffers << offer;
 }
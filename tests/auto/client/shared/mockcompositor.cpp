@@ -71,9 +71,9 @@ uint DefaultCompositor::sendXdgShellPing()
     warnIfNotLockedByThread(Q_FUNC_INFO);
     uint serial = nextSerial();
     auto *base = get<XdgWmBase>();
-    const auto resourceMap = base->resourceMap();
-    Q_ASSERT(resourceMap.size() == 1); // binding more than once shouldn't be needed
-    base->send_ping(resourceMap.first()->handle, serial);
+    const auto &resourceHash = base->resourceHash();
+    Q_ASSERT(resourceHash.size() == 1); // binding more than once shouldn't be needed
+    base->send_ping((*resourceHash.cbegin())->handle, serial);
     return serial;
 }
 
@@ -35,7 +35,7 @@ int XdgOutputV1::s_nextId = 1;
 void XdgOutputV1::sendLogicalSize(const QSize &size)
 {
     m_logicalGeometry.setSize(size);
-    for (auto *resource : resourceMap())
+    for (auto *resource : resourceHash())
         zxdg_output_v1::send_logical_size(resource->handle, size.width(), size.height());
 }
 
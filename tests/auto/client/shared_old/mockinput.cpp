@@ -247,7 +247,7 @@ void Keyboard::setFocus(Surface *surface)
         send_leave(m_focusResource->handle, serial, m_focus->resource()->handle);
     }
 
-    Resource *resource = surface ? resourceMap().value(surface->resource()->client()) : 0;
+    Resource *resource = surface ? clientResource(surface->resource()->client()) : 0;
 
     if (resource && (m_focus != surface || m_focusResource != resource)) {
         uint32_t serial = m_compositor->nextSerial();
@@ -299,7 +299,7 @@ void Pointer::setFocus(Surface *surface, const QPoint &pos)
         send_leave(m_focusResource->handle, serial, m_focus->resource()->handle);
     }
 
-    Resource *resource = surface ? resourceMap().value(surface->resource()->client()) : 0;
+    Resource *resource = surface ? clientResource(surface->resource()->client()) : 0;
 
     if (resource && (m_focus != surface || resource != m_focusResource)) {
         uint32_t serial = m_compositor->nextSerial();
@@ -352,7 +352,7 @@ void Touch::sendDown(Surface *surface, const QPoint &position, int id)
     uint32_t serial = m_compositor->nextSerial();
     uint32_t time = m_compositor->time();
     Q_ASSERT(surface);
-    Resource *resource = resourceMap().value(surface->resource()->client());
+    Resource *resource = clientResource(surface->resource()->client());
     Q_ASSERT(resource);
     auto x = wl_fixed_from_int(position.x());
     auto y = wl_fixed_from_int(position.y());
@@ -361,13 +361,13 @@ void Touch::sendDown(Surface *surface, const QPoint &position, int id)
 
 void Touch::sendUp(Surface *surface, int id)
 {
-    Resource *resource = resourceMap().value(surface->resource()->client());
+    Resource *resource = clientResource(surface->resource()->client());
     wl_touch_send_up(resource->handle, m_compositor->nextSerial(), m_compositor->time(), id);
 }
 
 void Touch::sendMotion(Surface *surface, const QPoint &position, int id)
 {
-    Resource *resource = resourceMap().value(surface->resource()->client());
+    Resource *resource = clientResource(surface->resource()->client());
     uint32_t time = m_compositor->time();
     auto x = wl_fixed_from_int(position.x());
     auto y = wl_fixed_from_int(position.y());
@@ -376,7 +376,7 @@ void Touch::sendMotion(Surface *surface, const QPoint &position, int id)
 
 void Touch::sendFrame(Surface *surface)
 {
-    Resource *resource = resourceMap().value(surface->resource()->client());
+    Resource *resource = clientResource(surface->resource()->client());
     wl_touch_send_frame(resource->handle);
 }
 
@@ -395,7 +395,7 @@ DataDevice::DataDevice(Compositor *compositor)
 void DataDevice::sendDataOffer(wl_client *client)
 {
     m_dataOffer = new QtWaylandServer::wl_data_offer(client, 0, 1);
-    Resource *resource = resourceMap().value(client);
+    Resource *resource = clientResource(client);
     send_data_offer(resource->handle, m_dataOffer->resource()->handle);
 }
 
@@ -403,26 +403,26 @@ void DataDevice::sendEnter(Surface *surface, const QPoint& position)
 {
     uint serial = m_compositor->nextSerial();
     m_focus = surface;
-    Resource *resource = resourceMap().value(surface->resource()->client());
+    Resource *resource = clientResource(surface->resource()->client());
     send_enter(resource->handle, serial, surface->resource()->handle, position.x(), position.y(), m_dataOffer->resource()->handle);
 }
 
 void DataDevice::sendMotion(const QPoint &position)
 {
     uint32_t time = m_compositor->time();
-    Resource *resource = resourceMap().value(m_focus->resource()->client());
+    Resource *resource = clientResource(m_focus->resource()->client());
     send_motion(resource->handle, time, position.x(), position.y());
 }
 
 void DataDevice::sendDrop(Surface *surface)
 {
-    Resource *resource = resourceMap().value(surface->resource()->client());
+    Resource *resource = clientResource(surface->resource()->client());
     send_drop(resource->handle);
 }
 
 void DataDevice::sendLeave(Surface *surface)
 {
-    Resource *resource = resourceMap().value(surface->resource()->client());
+    Resource *resource = clientResource(surface->resource()->client());
     send_leave(resource->handle);
 }
 
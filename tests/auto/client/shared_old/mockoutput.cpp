@@ -54,7 +54,7 @@ Output::Output(wl_display *display, const QSize &resolution, const QPoint &posit
 void Output::setCurrentMode(const QSize &size)
 {
     m_size = size;
-    for (Resource *resource : resourceMap()) {
+    for (Resource *resource : resourceHash()) {
         sendCurrentMode(resource);
         send_done(resource->handle);
     }
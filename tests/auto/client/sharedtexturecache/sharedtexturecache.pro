@@ -0,0 +1,15 @@
+CONFIG += testcase
+TARGET = tst_sharedtexturecache
+
+QT += testlib waylandclient-private
+
+# The client side cache of the texture sharing QML import
+TEXTURE_SHARING = $$PWD/../../../../src/imports/texture-sharing
+INCLUDEPATH += $$TEXTURE_SHARING
+
+HEADERS += \
+    $$TEXTURE_SHARING/sharedtexturecache.h
+
+SOURCES += \
+    $$TEXTURE_SHARING/sharedtexturecache.cpp \
+    tst_sharedtexturecache.cpp
@@ -0,0 +1,213 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "sharedtexturecache.h"
+
+#include <QtWaylandClient/private/qwaylandserverbufferintegration_p.h>
+
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+
+using namespace QtWaylandClient;
+
+class FakeServerBuffer : public QWaylandServerBuffer
+{
+public:
+    // A width x 1 buffer is width * 4 bytes
+    FakeServerBuffer(int width, QSet<FakeServerBuffer *> *live)
+        : m_live(live)
+    {
+        m_size = QSize(width, 1);
+        m_live->insert(this);
+    }
+    ~FakeServerBuffer() override { m_live->remove(this); }
+
+    QOpenGLTexture *toOpenGlTexture() override { return nullptr; }
+
+private:
+    QSet<FakeServerBuffer *> *m_live = nullptr;
+};
+
+// Stands in for SharedTextureRegistry, which abandons what the cache trims
+class CacheOwner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CacheOwner(qint64 cacheLimit)
+        : cache(new SharedTextureCache(this, cacheLimit))
+    {
+    }
+
+    ~CacheOwner() override { cache->detach(); }
+
+    QSharedPointer<SharedTextureCache> cache;
+    QStringList abandoned;
+    QThread *trimThread = nullptr;
+
+public slots:
+    void trimCache()
+    {
+        trimThread = QThread::currentThread();
+        abandoned << cache->trim();
+    }
+};
+
+class tst_SharedTextureCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup() { QVERIFY(m_live.isEmpty()); }
+    void referenceCounting();
+    void trimEvictsLeastRecentlyUsed();
+    void releaseFromOtherThread();
+    void releaseAfterOwnerIsGone();
+
+private:
+    FakeServerBuffer *createBuffer(int width) { return new FakeServerBuffer(width, &m_live); }
+    QSet<FakeServerBuffer *> m_live;
+};
+
+void tst_SharedTextureCache::referenceCounting()
+{
+    CacheOwner owner(1024);
+    SharedTextureCache *cache = owner.cache.data();
+
+    QVERIFY(!cache->acquire("a"));
+    FakeServerBuffer *a = createBuffer(16);
+    QVERIFY(cache->insert("a", a));
+    QVERIFY(!cache->insert("a", a));
+    QVERIFY(cache->contains("a"));
+    QCOMPARE(cache->unusedBytes(), qint64(64));
+
+    // A response and its texture factory each hold a reference
+    QCOMPARE(cache->acquire("a"), a);
+    QCOMPARE(cache->acquire("a"), a);
+    QCOMPARE(cache->unusedBytes(), qint64(0));
+
+    cache->release("a");
+    QCOMPARE(cache->unusedBytes(), qint64(0));
+    cache->release("a");
+    QCOMPARE(cache->unusedBytes(), qint64(64));
+
+    // Released, but kept for the next request while within the limit
+    cache->release("a");
+    QCOMPARE(cache->unusedBytes(), qint64(64));
+    QTest::qWait(10);
+    QVERIFY(owner.abandoned.isEmpty());
+    QCOMPARE(cache->acquire("a"), a);
+    cache->release("a");
+}
+
+void tst_SharedTextureCache::trimEvictsLeastRecentlyUsed()
+{
+    // Room for two unused 64 byte buffers
+    CacheOwner owner(128);
+    SharedTextureCache *cache = owner.cache.data();
+
+    for (const char *id : { "a", "b", "c" }) {
+        QVERIFY(cache->insert(id, createBuffer(16)));
+        cache->acquire(id);
+    }
+    cache->release("b");
+    cache->release("a");
+    QCOMPARE(cache->unusedBytes(), qint64(128));
+
+    // Over the limit, so the least recently released one goes
+    cache->release("c");
+    QTRY_COMPARE(owner.abandoned, QStringList { "b" });
+    QCOMPARE(owner.trimThread, QThread::currentThread());
+    QCOMPARE(cache->bufferCount(), 2);
+    QCOMPARE(cache->unusedBytes(), qint64(128));
+    QCOMPARE(m_live.size(), 2);
+
+    // Referenced buffers are never trimmed
+    cache->acquire("a");
+    cache->acquire("c");
+    QVERIFY(cache->insert("d", createBuffer(64)));
+    QCOMPARE(owner.cache->trim(), QStringList { "d" });
+    QCOMPARE(cache->unusedBytes(), qint64(0));
+    cache->release("a");
+    cache->release("c");
+}
+
+void tst_SharedTextureCache::releaseFromOtherThread()
+{
+    CacheOwner owner(0);
+    SharedTextureCache *cache = owner.cache.data();
+
+    const int count = 100;
+    QStringList ids;
+    for (int i = 0; i < count; ++i) {
+        const QString id = QString::number(i);
+        QVERIFY(cache->insert(id, createBuffer(1)));
+        cache->acquire(id);
+        ids << id;
+    }
+
+    // Texture factories drop their references on the render thread, while the
+    // registry keeps using the cache on its own thread
+    QScopedPointer<QThread> renderThread(QThread::create([&] {
+        for (const QString &id : qAsConst(ids))
+            cache->release(id);
+    }));
+    renderThread->start();
+    for (int i = 0; i < count; ++i)
+        QVERIFY(!cache->contains(QStringLiteral("other/%1").arg(i)));
+    QVERIFY(renderThread->wait());
+
+    // Trimming happens on the owner's thread
+    QTRY_COMPARE(owner.abandoned.size(), count);
+    QCOMPARE(owner.trimThread, QThread::currentThread());
+    QCOMPARE(cache->bufferCount(), 0);
+    QCOMPARE(cache->unusedBytes(), qint64(0));
+}
+
+void tst_SharedTextureCache::releaseAfterOwnerIsGone()
+{
+    QSharedPointer<SharedTextureCache> cache;
+    FakeServerBuffer *used = createBuffer(16);
+    {
+        CacheOwner owner(1024);
+        cache = owner.cache;
+        QVERIFY(cache->insert("used", used));
+        QVERIFY(cache->insert("unused", createBuffer(16)));
+        cache->acquire("used");
+    }
+
+    // Unreferenced buffers go with the owner, the others with their last reference
+    QCOMPARE(m_live.size(), 1);
+    QVERIFY(m_live.contains(used));
+    cache->release("used");
+    QVERIFY(m_live.isEmpty());
+    QCOMPARE(cache->bufferCount(), 0);
+}
+
+QTEST_GUILESS_MAIN(tst_SharedTextureCache)
+#include "tst_sharedtexturecache.moc"
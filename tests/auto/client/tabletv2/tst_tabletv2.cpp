@@ -71,11 +71,11 @@ public:
 
     wl_resource *toolResource() // for convenience
     {
-        Q_ASSERT(resourceMap().size() == 1);
+        Q_ASSERT(resourceHash().size() == 1);
         // Strictly speaking, there may be more than one resource for the tool, for intsance if
         // if there are multiple clients, or a client has called get_tablet_seat multiple times.
         // For now we'll pretend there can only be one resource.
-        return resourceMap().first()->handle;
+        return resourceHash().values().first()->handle;
     }
 
     void send_removed() = delete;
@@ -87,7 +87,7 @@ public:
     void sendMotion(QPointF position)
     {
         Q_ASSERT(m_proximitySurface);
-        for (auto *resource : resourceMap())
+        for (auto *resource : resourceHash())
             send_motion(resource->handle, wl_fixed_from_double(position.x()), wl_fixed_from_double(position.y()));
     }
     uint sendDown();
@@ -136,7 +136,7 @@ public:
     {
         auto *tablet = new TabletV2(this);
         m_tablets.append(tablet);
-        for (auto *resource : resourceMap())
+        for (auto *resource : resourceHash())
             sendTabletAdded(resource, tablet);
         return tablet;
     }
@@ -155,7 +155,7 @@ public:
     {
         auto *tool = new TabletToolV2(this, toolType, hardwareSerial);
         m_tools.append(tool);
-        for (auto *resource : resourceMap())
+        for (auto *resource : resourceHash())
             sendToolAdded(resource, tool);
         return tool;
     }
@@ -178,7 +178,7 @@ public:
     {
         auto *pad = new TabletPadV2(this);
         m_pads.append(pad);
-        for (auto *resource : resourceMap())
+        for (auto *resource : resourceHash())
             sendPadAdded(resource, pad);
         return pad;
     }
@@ -280,7 +280,7 @@ protected:
 
 void TabletV2::sendRemoved()
 {
-    for (auto *resource : resourceMap())
+    for (auto *resource : resourceHash())
         zwp_tablet_v2_send_removed(resource->handle);
     bool removed = m_tabletSeat->m_tablets.removeOne(this);
     QVERIFY(removed);
@@ -299,7 +299,7 @@ void TabletV2::zwp_tablet_v2_destroy(QtWaylandServer::zwp_tablet_v2::Resource *r
 
 void TabletToolV2::sendRemoved()
 {
-    for (auto *resource : resourceMap())
+    for (auto *resource : resourceHash())
         zwp_tablet_tool_v2_send_removed(resource->handle);
     bool removed = m_tabletSeat->m_tools.removeOne(this);
     QVERIFY(removed);
@@ -312,7 +312,7 @@ uint TabletToolV2::sendProximityIn(TabletV2 *tablet, Surface *surface)
     m_proximitySurface = surface;
     uint serial = m_tabletSeat->m_seat->m_compositor->nextSerial();
     auto *client = surface->resource()->client();
-    auto tabletResource = tablet->resourceMap().value(client)->handle;
+    auto tabletResource = tablet->clientResource(client)->handle;
     send_proximity_in(toolResource(), serial, tabletResource, surface->resource()->handle);
     return serial;
 }
@@ -335,7 +335,7 @@ void TabletToolV2::sendPressure(uint pressure)
 {
     Q_ASSERT(m_proximitySurface);
     auto *client = m_proximitySurface->resource()->client();
-    auto toolResource = resourceMap().value(client)->handle;
+    auto toolResource = clientResource(client)->handle;
     send_pressure(toolResource, pressure);
 }
 
@@ -350,7 +350,7 @@ uint TabletToolV2::sendButton(uint button, bool pressed)
 uint TabletToolV2::sendFrame()
 {
     uint time = m_tabletSeat->m_seat->m_compositor->currentTimeMilliseconds();
-    for (auto *resource : resourceMap())
+    for (auto *resource : resourceHash())
         send_frame(resource->handle, time);
     return time;
 }
@@ -366,7 +366,7 @@ void TabletToolV2::zwp_tablet_tool_v2_destroy(QtWaylandServer::zwp_tablet_tool_v
 
 void TabletPadV2::sendRemoved()
 {
-    for (auto *resource : resourceMap())
+    for (auto *resource : resourceHash())
         zwp_tablet_pad_v2_send_removed(resource->handle);
     bool removed = m_tabletSeat->m_pads.removeOne(this);
     QVERIFY(removed);
@@ -495,15 +495,15 @@ void tst_tabletv2::cleanup()
 
 void tst_tabletv2::bindsToManager()
 {
-    QCOMPOSITOR_TRY_COMPARE(get<TabletManagerV2>()->resourceMap().size(), 1);
-    QCOMPOSITOR_TRY_COMPARE(get<TabletManagerV2>()->resourceMap().first()->version(), tabletVersion);
+    QCOMPOSITOR_TRY_COMPARE(get<TabletManagerV2>()->resourceHash().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(get<TabletManagerV2>()->resourceHash().values().first()->version(), tabletVersion);
 }
 
 void tst_tabletv2::createsTabletSeat()
 {
     QCOMPOSITOR_TRY_VERIFY(tabletSeat());
-    QCOMPOSITOR_TRY_VERIFY(tabletSeat()->resourceMap().contains(client()));
-    QCOMPOSITOR_TRY_COMPARE(tabletSeat()->resourceMap().value(client())->version(), tabletVersion);
+    QCOMPOSITOR_TRY_VERIFY(tabletSeat()->resourceHash().contains(client()));
+    QCOMPOSITOR_TRY_COMPARE(tabletSeat()->clientResource(client())->version(), tabletVersion);
     //TODO: Maybe also assert some capability reported though qt APIs?
 }
 
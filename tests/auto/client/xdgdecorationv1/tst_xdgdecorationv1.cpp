@@ -167,8 +167,8 @@ void tst_xdgdecorationv1::clientSidePreferredByCompositor()
 {
     QRasterWindow window;
     window.show();
-    QCOMPOSITOR_TRY_COMPARE(get<XdgDecorationManagerV1>()->resourceMap().size(), 1);
-    QCOMPOSITOR_TRY_COMPARE(get<XdgDecorationManagerV1>()->resourceMap().first()->version(), xdgDecorationVersion);
+    QCOMPOSITOR_TRY_COMPARE(get<XdgDecorationManagerV1>()->resourceHash().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(get<XdgDecorationManagerV1>()->resourceHash().values().first()->version(), xdgDecorationVersion);
     QCOMPOSITOR_TRY_VERIFY(toplevelDecoration()); // The client creates a toplevel object
 
     // Check that we don't assume decorations before the server has configured them
@@ -189,7 +189,7 @@ void tst_xdgdecorationv1::initialFramelessWindowHint()
     QRasterWindow window;
     window.setFlag(Qt::FramelessWindowHint, true);
     window.show();
-    QCOMPOSITOR_TRY_COMPARE(get<XdgDecorationManagerV1>()->resourceMap().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(get<XdgDecorationManagerV1>()->resourceHash().size(), 1);
     QCOMPOSITOR_TRY_VERIFY(xdgToplevel());
     exec([=]{
         xdgToplevel()->sendCompleteConfigure();
@@ -205,7 +205,7 @@ void tst_xdgdecorationv1::delayedFramelessWindowHint()
 {
     QRasterWindow window;
     window.show();
-    QCOMPOSITOR_TRY_COMPARE(get<XdgDecorationManagerV1>()->resourceMap().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(get<XdgDecorationManagerV1>()->resourceHash().size(), 1);
     QCOMPOSITOR_TRY_VERIFY(xdgToplevel());
     exec([=]{
         xdgToplevel()->sendCompleteConfigure();
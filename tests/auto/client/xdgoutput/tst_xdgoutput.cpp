@@ -67,9 +67,9 @@ void tst_xdgoutput::cleanup()
 void tst_xdgoutput::primaryScreen()
 {
     // Verify that the client has bound to the global
-    QCOMPOSITOR_TRY_COMPARE(get<XdgOutputManagerV1>()->resourceMap().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(get<XdgOutputManagerV1>()->resourceHash().size(), 1);
     exec([=] {
-        auto *resource = xdgOutput()->resourceMap().value(client());
+        auto *resource = xdgOutput()->clientResource(client());
         QCOMPARE(resource->version(), 3);
         QCOMPARE(xdgOutput()->m_logicalGeometry.size(), QSize(1920, 1080));
     });
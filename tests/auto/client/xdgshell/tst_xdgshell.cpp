@@ -483,13 +483,13 @@ void tst_xdgshell::pongs()
     window.show();
 
     // Verify that the client has bound to the global
-    QCOMPOSITOR_TRY_COMPARE(get<XdgWmBase>()->resourceMap().size(), 1);
+    QCOMPOSITOR_TRY_COMPARE(get<XdgWmBase>()->resourceHash().size(), 1);
 
     QSignalSpy pongSpy(exec([=] { return get<XdgWmBase>(); }), &XdgWmBase::pong);
     const uint serial = exec([=] { return nextSerial(); });
     exec([=] {
         auto *base = get<XdgWmBase>();
-        wl_resource *resource = base->resourceMap().first()->handle;
+        wl_resource *resource = base->resourceHash().values().first()->handle;
         base->send_ping(resource, serial);
     });
     QTRY_COMPARE(pongSpy.count(), 1);
@@ -0,0 +1,15 @@
+CONFIG += testcase link_pkgconfig
+CONFIG += wayland-scanner
+TARGET = tst_allocations
+
+QT += testlib
+
+# The mock client and test compositor of the compositor autotest. This is a binary of its
+# own, since allocationcounter.h replaces the allocator of the whole process.
+include(../compositor/compositor.pri)
+
+HEADERS += \
+    ../compositor/allocationcounter.h
+
+SOURCES += \
+    tst_allocations.cpp
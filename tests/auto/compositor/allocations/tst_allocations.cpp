@@ -0,0 +1,133 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "allocationcounter.h"
+#include "mockclient.h"
+#include "testcompositor.h"
+
+#include <QtWaylandCompositor/QWaylandOutput>
+#include <QtWaylandCompositor/QWaylandSurface>
+#include <QtWaylandCompositor/QWaylandView>
+
+#include <QtTest/QtTest>
+
+class tst_Allocations : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void commitWithoutNewAllocations();
+
+private:
+    QTemporaryDir m_tmpRuntimeDir;
+};
+
+void tst_Allocations::init()
+{
+    // We need to set a test specific runtime dir so we don't conflict with other tests'
+    // compositors by accident.
+    qputenv("XDG_RUNTIME_DIR", m_tmpRuntimeDir.path().toLocal8Bit());
+}
+
+static void frameCallbackFunc(void *data, wl_callback *callback, uint32_t)
+{
+    ++*static_cast<int *>(data);
+    wl_callback_destroy(callback);
+}
+
+static void registerFrameCallback(wl_surface *surface, int *counter)
+{
+    static const wl_callback_listener frameCallbackListener = {
+        frameCallbackFunc
+    };
+
+    wl_callback_add_listener(wl_surface_frame(surface), &frameCallbackListener, counter);
+}
+
+void tst_Allocations::commitWithoutNewAllocations()
+{
+    TestCompositor compositor;
+    compositor.create();
+    QWaylandOutput *output = compositor.defaultOutput();
+
+    MockClient client;
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.at(0);
+
+    QWaylandView view;
+    view.setSurface(waylandSurface);
+    view.setOutput(output);
+
+    const QSize size(32, 32);
+    ShmBuffer front(size, client.shm);
+    ShmBuffer back(size, client.shm);
+
+    // A double buffered client that damages the same areas every frame. Once the first frames
+    // have been committed, none of the following ones should need operator new, which the
+    // surface state, the damage regions and the frame callbacks used to allocate with.
+    // libwayland mallocs a closure for every message it dispatches or sends, so the
+    // allocations counted at the malloc level don't drop to zero.
+    const int warmup = 8;
+    const int frames = 100;
+    int frameCounter = 0;
+    quint64 newAllocations = 0;
+    for (int i = 0; i < warmup + frames; ++i) {
+        if (i == warmup)
+            newAllocations = AllocationCounter::newAllocations();
+
+        ShmBuffer &buffer = i % 2 ? back : front;
+        wl_surface_attach(surface, buffer.handle, 0, 0);
+        registerFrameCallback(surface, &frameCounter);
+        wl_surface_damage(surface, 0, 0, 16, 16);
+        wl_surface_damage(surface, 16, 16, 16, 16);
+        wl_surface_commit(surface);
+        wl_display_flush(client.display);
+
+        AllocationCounter::setCounting(true);
+        compositor.processWaylandEvents();
+        output->frameStarted();
+        output->sendFrameCallbacks();
+        AllocationCounter::setCounting(false);
+
+        QTRY_COMPARE(frameCounter, i + 1);
+    }
+
+    QCOMPARE(AllocationCounter::newAllocations() - newAllocations, quint64(0));
+    QVERIFY(waylandSurface->hasContent());
+    QVERIFY(view.advance());
+    QCOMPARE(view.currentDamage(), QRegion(0, 0, 16, 16) + QRect(16, 16, 16, 16));
+
+    wl_surface_destroy(surface);
+}
+
+QTEST_MAIN(tst_Allocations)
+#include "tst_allocations.moc"
@@ -1,3 +1,12 @@
 TEMPLATE=subdirs
+QT_FOR_CONFIG += gui waylandcompositor waylandcompositor-private
 
-SUBDIRS += compositor
+SUBDIRS += \
+    compositor \
+    allocations
+
+qtConfig(wayland-dmabuf-client-buffer): \
+    SUBDIRS += linuxdmabuf
+
+qtConfig(wayland-compositor-quick):qtConfig(opengl): \
+    SUBDIRS += texturesharing
@@ -0,0 +1,128 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+// Counts the heap allocations of the whole process while counting is enabled.
+//
+// This replaces the global operator new and, with glibc, malloc, calloc and realloc, so include
+// it in exactly one source file of a test binary, and keep tests using it in their own binary.
+
+#include <QtCore/QAtomicInteger>
+
+#include <cstdlib>
+#include <new>
+
+namespace AllocationCounter {
+
+static QBasicAtomicInt counting = Q_BASIC_ATOMIC_INITIALIZER(0);
+static QBasicAtomicInteger<quint64> newCount = Q_BASIC_ATOMIC_INITIALIZER(0);
+static QBasicAtomicInteger<quint64> mallocCount = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+inline void setCounting(bool enabled)
+{
+    counting.storeRelaxed(enabled ? 1 : 0);
+}
+
+// Whether mallocAllocations() counts anything on this platform
+inline bool countsMalloc()
+{
+#if defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Allocations made with operator new
+inline quint64 newAllocations()
+{
+    return newCount.loadRelaxed();
+}
+
+// Allocations made with malloc, calloc and realloc, including those of operator new,
+// the Qt containers and libwayland
+inline quint64 mallocAllocations()
+{
+    return mallocCount.loadRelaxed();
+}
+
+} // namespace AllocationCounter
+
+void *operator new(std::size_t size)
+{
+    if (AllocationCounter::counting.loadRelaxed())
+        AllocationCounter::newCount.fetchAndAddRelaxed(1);
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#if defined(__GLIBC__)
+// Forwards to the glibc allocator, which free() still belongs to
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) noexcept
+{
+    if (AllocationCounter::counting.loadRelaxed())
+        AllocationCounter::mallocCount.fetchAndAddRelaxed(1);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    if (AllocationCounter::counting.loadRelaxed())
+        AllocationCounter::mallocCount.fetchAndAddRelaxed(1);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept
+{
+    if (AllocationCounter::counting.loadRelaxed())
+        AllocationCounter::mallocCount.fetchAndAddRelaxed(1);
+    return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+#endif // ALLOCATIONCOUNTER_H
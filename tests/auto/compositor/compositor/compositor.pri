@@ -0,0 +1,41 @@
+# The mock client and test compositor, shared with the compositor benchmarks
+
+QT += core-private gui-private waylandcompositor waylandcompositor-private
+
+QMAKE_USE += wayland-client wayland-server
+
+qtConfig(xkbcommon): \
+    QMAKE_USE += xkbcommon
+
+INCLUDEPATH += $$PWD
+
+WAYLANDCLIENTSOURCES += \
+            $$PWD/../../../../src/3rdparty/protocol/ivi-application.xml \
+            $$PWD/../../../../src/3rdparty/protocol/wayland.xml \
+            $$PWD/../../../../src/3rdparty/protocol/xdg-shell.xml \
+            $$PWD/../../../../src/3rdparty/protocol/viewporter.xml \
+            $$PWD/../../../../src/3rdparty/protocol/idle-inhibit-unstable-v1.xml \
+            $$PWD/../../../../src/3rdparty/protocol/xdg-output-unstable-v1.xml \
+            $$PWD/../../../../src/3rdparty/protocol/wlr-screencopy-unstable-v1.xml
+
+SOURCES += \
+    $$PWD/testcompositor.cpp \
+    $$PWD/testkeyboardgrabber.cpp \
+    $$PWD/mockclient.cpp \
+    $$PWD/mockseat.cpp \
+    $$PWD/testseat.cpp \
+    $$PWD/mockkeyboard.cpp \
+    $$PWD/mockpointer.cpp \
+    $$PWD/mockxdgoutputv1.cpp \
+    $$PWD/mockscreencopyv1.cpp
+
+HEADERS += \
+    $$PWD/testcompositor.h \
+    $$PWD/testkeyboardgrabber.h \
+    $$PWD/mockclient.h \
+    $$PWD/mockseat.h \
+    $$PWD/testseat.h \
+    $$PWD/mockkeyboard.h \
+    $$PWD/mockpointer.h \
+    $$PWD/mockxdgoutputv1.h \
+    $$PWD/mockscreencopyv1.h
@@ -165,6 +165,7 @@ void MockClient::handleGlobalRemove(void *data, wl_registry *wl_registry, uint32
 
 void MockClient::handleGlobal(uint32_t id, const QByteArray &interface)
 {
+    globals.insert(interface, id);
     if (interface == "wl_compositor") {
         compositor = static_cast<wl_compositor *>(wl_registry_bind(registry, id, &wl_compositor_interface, 3));
     } else if (interface == "wl_output") {
@@ -188,6 +189,8 @@ void MockClient::handleGlobal(uint32_t id, const QByteArray &interface)
         idleInhibitManager = static_cast<zwp_idle_inhibit_manager_v1 *>(wl_registry_bind(registry, id, &zwp_idle_inhibit_manager_v1_interface, 1));
     } else if (interface == "zxdg_output_manager_v1") {
         xdgOutputManager = new QtWayland::zxdg_output_manager_v1(registry, id, 2);
+    } else if (interface == "zwlr_screencopy_manager_v1") {
+        screencopyManager = new QtWayland::zwlr_screencopy_manager_v1(registry, id, 3);
     }
 }
 
@@ -247,10 +250,35 @@ MockXdgOutputV1 *MockClient::createXdgOutput(wl_output *output)
     return xdgOutput;
 }
 
-ShmBuffer::ShmBuffer(const QSize &size, wl_shm *shm)
+MockScreencopyFrameV1 *MockClient::createScreencopyFrame(wl_output *output, const QRect &region)
+{
+    flushDisplay();
+    if (region.isValid()) {
+        return new MockScreencopyFrameV1(screencopyManager->capture_output_region(
+                0, output, region.x(), region.y(), region.width(), region.height()));
+    }
+    return new MockScreencopyFrameV1(screencopyManager->capture_output(0, output));
+}
+
+ShmBuffer::ShmBuffer(const QSize &size, wl_shm *shm, wl_shm_format format, int poolSize)
 {
     int stride = size.width() * 4;
-    int alloc = stride * size.height();
+    int rows = size.height();
+    switch (format) {
+    case WL_SHM_FORMAT_NV12:
+    case WL_SHM_FORMAT_YUV420:
+        stride = size.width();
+        rows = size.height() * 3 / 2;
+        break;
+    case WL_SHM_FORMAT_YUYV:
+        stride = size.width() * 2;
+        break;
+    default:
+        break;
+    }
+    if (poolSize > 0)
+        rows = poolSize / stride;
+    int alloc = poolSize > 0 ? poolSize : stride * rows;
 
     char filename[] = "/tmp/wayland-shm-XXXXXX";
 
@@ -275,10 +303,15 @@ ShmBuffer::ShmBuffer(const QSize &size, wl_shm *shm)
         return;
     }
 
-    image = QImage(static_cast<uchar *>(data), size.width(), size.height(), stride, QImage::Format_ARGB32_Premultiplied);
+    if (format == WL_SHM_FORMAT_ARGB8888)
+        image = QImage(static_cast<uchar *>(data), size.width(), size.height(), stride, QImage::Format_ARGB32_Premultiplied);
+    else if (format == WL_SHM_FORMAT_XRGB8888)
+        image = QImage(static_cast<uchar *>(data), size.width(), size.height(), stride, QImage::Format_RGB32);
+    else
+        image = QImage(static_cast<uchar *>(data), stride, rows, stride, QImage::Format_Grayscale8);
     shm_pool = wl_shm_create_pool(shm,fd,alloc);
     handle = wl_shm_pool_create_buffer(shm_pool,0, size.width(), size.height(),
-                                   stride, WL_SHM_FORMAT_ARGB8888);
+                                   stride, format);
     close(fd);
 }
 
@@ -36,17 +36,21 @@
 #include <QImage>
 #include <QRect>
 #include <QList>
+#include <QtCore/QHash>
 #include <QtCore/QMap>
 #include <QWaylandOutputMode>
 
 #include "mockxdgoutputv1.h"
+#include "mockscreencopyv1.h"
 
 class MockSeat;
 
 class ShmBuffer
 {
 public:
-    ShmBuffer(const QSize &size, wl_shm *shm);
+    // For YUV formats, image is a Format_Grayscale8 view of all planes, one after the other.
+    // A poolSize of 0 makes the pool just large enough for the buffer.
+    ShmBuffer(const QSize &size, wl_shm *shm, wl_shm_format format = WL_SHM_FORMAT_ARGB8888, int poolSize = 0);
     ~ShmBuffer();
 
     struct wl_buffer *handle = nullptr;
@@ -69,6 +73,7 @@ public:
     ivi_surface *createIviSurface(wl_surface *surface, uint iviId);
     zwp_idle_inhibitor_v1 *createIdleInhibitor(wl_surface *surface);
     MockXdgOutputV1 *createXdgOutput(wl_output *output);
+    MockScreencopyFrameV1 *createScreencopyFrame(wl_output *output, const QRect &region = QRect());
 
     wl_display *display = nullptr;
     wl_compositor *compositor = nullptr;
@@ -82,8 +87,10 @@ public:
     ivi_application *iviApplication = nullptr;
     zwp_idle_inhibit_manager_v1 *idleInhibitManager = nullptr;
     QtWayland::zxdg_output_manager_v1 *xdgOutputManager = nullptr;
+    QtWayland::zwlr_screencopy_manager_v1 *screencopyManager = nullptr;
 
     QList<MockSeat *> m_seats;
+    QHash<QByteArray, uint> globals; // The last global announced for each interface
 
     QRect geometry;
     QSize resolution;
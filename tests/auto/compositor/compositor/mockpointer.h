@@ -42,6 +42,7 @@ public:
 
     wl_pointer *m_pointer = nullptr;
     wl_surface *m_enteredSurface = nullptr;
+    uint m_motionCount = 0;
 };
 
 #endif // MOCKPOINTER_H
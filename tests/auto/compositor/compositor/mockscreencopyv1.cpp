@@ -0,0 +1,75 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "mockscreencopyv1.h"
+
+MockScreencopyFrameV1::MockScreencopyFrameV1(struct ::zwlr_screencopy_frame_v1 *object)
+    : QtWayland::zwlr_screencopy_frame_v1(object)
+{
+}
+
+MockScreencopyFrameV1::~MockScreencopyFrameV1()
+{
+    destroy();
+}
+
+void MockScreencopyFrameV1::zwlr_screencopy_frame_v1_buffer(uint32_t format, uint32_t width, uint32_t height, uint32_t stride)
+{
+    this->format = format;
+    bufferSize = QSize(int(width), int(height));
+    this->stride = stride;
+}
+
+void MockScreencopyFrameV1::zwlr_screencopy_frame_v1_buffer_done()
+{
+    bufferDone = true;
+}
+
+void MockScreencopyFrameV1::zwlr_screencopy_frame_v1_flags(uint32_t flags)
+{
+    this->flags = flags;
+}
+
+void MockScreencopyFrameV1::zwlr_screencopy_frame_v1_damage(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    damage += QRect(int(x), int(y), int(width), int(height));
+}
+
+void MockScreencopyFrameV1::zwlr_screencopy_frame_v1_ready(uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec)
+{
+    Q_UNUSED(tv_sec_hi);
+    Q_UNUSED(tv_sec_lo);
+    Q_UNUSED(tv_nsec);
+    ready = true;
+}
+
+void MockScreencopyFrameV1::zwlr_screencopy_frame_v1_failed()
+{
+    failed = true;
+}
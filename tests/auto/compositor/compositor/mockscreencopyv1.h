@@ -0,0 +1,62 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef MOCKSCREENCOPYV1_H
+#define MOCKSCREENCOPYV1_H
+
+#include <QRegion>
+#include <QSize>
+
+#include "qwayland-wlr-screencopy-unstable-v1.h"
+
+class MockScreencopyFrameV1 : public QtWayland::zwlr_screencopy_frame_v1
+{
+public:
+    explicit MockScreencopyFrameV1(struct ::zwlr_screencopy_frame_v1 *object);
+    ~MockScreencopyFrameV1();
+
+    uint format = 0;
+    QSize bufferSize;
+    uint stride = 0;
+    bool bufferDone = false;
+    uint flags = 0;
+    QRegion damage;
+    bool ready = false;
+    bool failed = false;
+
+protected:
+    void zwlr_screencopy_frame_v1_buffer(uint32_t format, uint32_t width, uint32_t height, uint32_t stride) override;
+    void zwlr_screencopy_frame_v1_buffer_done() override;
+    void zwlr_screencopy_frame_v1_flags(uint32_t flags) override;
+    void zwlr_screencopy_frame_v1_damage(uint32_t x, uint32_t y, uint32_t width, uint32_t height) override;
+    void zwlr_screencopy_frame_v1_ready(uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec) override;
+    void zwlr_screencopy_frame_v1_failed() override;
+};
+
+#endif // MOCKSCREENCOPYV1_H
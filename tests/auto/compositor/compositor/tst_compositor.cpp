@@ -38,6 +38,7 @@
 #include "qwaylandbufferref.h"
 #include "qwaylandseat.h"
 
+#include <QtGui/QPainter>
 #include <QtGui/QScreen>
 #include <QtWaylandCompositor/QWaylandXdgShell>
 #include <QtWaylandCompositor/private/qwaylandxdgshellv6_p.h>
@@ -50,10 +51,24 @@
 #include <QtWaylandCompositor/QWaylandViewporter>
 #include <QtWaylandCompositor/QWaylandIdleInhibitManagerV1>
 #include <QtWaylandCompositor/QWaylandXdgOutputManagerV1>
+#include <QtWaylandCompositor/QWaylandSoftwareOutput>
+#include <QtWaylandCompositor/QWaylandFrameStatistics>
+#include <QtWaylandCompositor/QWaylandSurfaceGrabber>
+#include <QtWaylandCompositor/QWaylandScreencopyManagerV1>
 #include <qwayland-xdg-shell.h>
 #include <qwayland-ivi-application.h>
 #include <QtWaylandCompositor/private/qwaylandoutput_p.h>
+#include <QtWaylandCompositor/private/qwlhardwarelayerplanner_p.h>
 #include <QtWaylandCompositor/private/qwaylandsurface_p.h>
+#include <QtWaylandCompositor/private/qwaylandview_p.h>
+#if QT_CONFIG(wayland_compositor_quick)
+#include <QtQuick/QQuickWindow>
+#include <QtWaylandCompositor/QWaylandQuickItem>
+#include <QtWaylandCompositor/QWaylandQuickOutput>
+#if QT_CONFIG(opengl)
+#include <QtWaylandCompositor/private/qwaylandquickhardwarelayer_p.h>
+#endif
+#endif
 
 #include <QtTest/QtTest>
 
@@ -77,6 +92,9 @@ private slots:
     void defaultInputRegionHiDpi();
     void singleClient();
     void multipleClients();
+    void clientResourceUsage();
+    void clientMemoryLimits();
+    void protocolStatistics();
     void geometry();
     void availableGeometry();
     void modes();
@@ -85,7 +103,17 @@ private slots:
     void mapSurface();
     void mapSurfaceHiDpi();
     void frameCallback();
+    void frameCallbackBeforeMapping();
     void pixelFormats();
+    void yuvPixelFormats_data();
+    void yuvPixelFormats();
+    void yuvUndersizedPool();
+    void softwareOutput();
+    void softwareOutputFullscreenBypass();
+    void quickOutputFullscreenBypass();
+    void frameStatistics();
+    void frameCallbackPolicy();
+    void surfaceGrabber();
     void outputs();
     void customSurface();
 
@@ -122,6 +150,14 @@ private slots:
 
     void xdgOutput();
 
+    void screencopy();
+
+    void hardwareLayerPlannerPrefersLargestLayers();
+    void hardwareLayerPlannerChecksPlaneCapabilities();
+    void hardwareLayerPlannerKeepsStackingOrder();
+    void hardwareLayerPlannerSkipsOccludedLayers();
+    void hardwareLayerPlannerFallsBackWhenTestFails();
+
 private:
     QTemporaryDir m_tmpRuntimeDir;
 };
@@ -163,6 +199,34 @@ void tst_WaylandCompositor::singleClient()
     QTRY_COMPARE(compositor.surfaces.size(), 0);
 }
 
+void tst_WaylandCompositor::protocolStatistics()
+{
+#if !QT_CONFIG(wayland_server_protocol_statistics)
+    QSKIP("Qt Wayland Compositor was configured without -feature-wayland-server-protocol-statistics");
+#endif
+    TestCompositor compositor;
+    compositor.create();
+    compositor.resetProtocolStatistics();
+    compositor.setProtocolStatisticsEnabled(true);
+    QVERIFY(compositor.protocolStatisticsEnabled());
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+
+    const QString statistics = compositor.protocolStatistics();
+    QVERIFY(statistics.contains(QLatin1String("wl_compositor.create_surface (request): 1 messages, 12 bytes")));
+    QVERIFY(statistics.contains(QLatin1String("client pid")));
+
+    compositor.setProtocolStatisticsEnabled(false);
+    wl_surface_destroy(surface);
+    QTRY_COMPARE(compositor.surfaces.size(), 0);
+    QVERIFY(!compositor.protocolStatistics().contains(QLatin1String("wl_surface.destroy")));
+
+    compositor.resetProtocolStatistics();
+    QVERIFY(compositor.protocolStatistics().isEmpty());
+}
+
 void tst_WaylandCompositor::multipleClients()
 {
     TestCompositor compositor;
@@ -366,6 +430,108 @@ void tst_WaylandCompositor::keyboardGrab()
     QTRY_COMPARE(grabKeyPressSpy.count(), 2);
 }
 
+static void frameCallbackFunc(void *data, wl_callback *callback, uint32_t)
+{
+    ++*static_cast<int *>(data);
+    wl_callback_destroy(callback);
+}
+
+static void registerFrameCallback(wl_surface *surface, int *counter)
+{
+    static const wl_callback_listener frameCallbackListener = {
+        frameCallbackFunc
+    };
+
+    wl_callback_add_listener(wl_surface_frame(surface), &frameCallbackListener, counter);
+}
+
+void tst_WaylandCompositor::clientResourceUsage()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    QWaylandClient *waylandClient = waylandSurface->client();
+    QCOMPARE(waylandClient->surfaceCount(), 1);
+    QCOMPARE(waylandClient->sharedMemorySize(), qint64(0));
+
+    QSignalSpy usageSpy(waylandClient, &QWaylandClient::resourceUsageChanged);
+    waylandClient->setResourceUsageInterval(10);
+
+    {
+        const QSize size(32, 16);
+        ShmBuffer buffer(size, client.shm);
+        int frameCounter = 0;
+        wl_surface_attach(surface, buffer.handle, 0, 0);
+        registerFrameCallback(surface, &frameCounter);
+        wl_surface_commit(surface);
+        QTRY_VERIFY(waylandSurface->hasContent());
+
+        QCOMPARE(waylandClient->sharedMemorySize(), qint64(32 * 16 * 4));
+        QCOMPARE(waylandClient->memoryUsage(), qint64(32 * 16 * 4));
+        QCOMPARE(waylandClient->pendingFrameCallbackCount(), 1);
+        QVERIFY(waylandClient->requestCount() > 0);
+        QTRY_VERIFY(usageSpy.count() > 0);
+
+        waylandSurface->frameStarted();
+        waylandSurface->sendFrameCallbacks();
+        QCOMPARE(waylandClient->pendingFrameCallbackCount(), 0);
+        QTRY_COMPARE(frameCounter, 1);
+
+        wl_surface_attach(surface, nullptr, 0, 0);
+        wl_surface_commit(surface);
+        QTRY_VERIFY(!waylandSurface->hasContent());
+    }
+
+    // The buffer is given back once the client destroyed it
+    QTRY_COMPARE(waylandClient->sharedMemorySize(), qint64(0));
+
+    wl_surface_destroy(surface);
+    QTRY_COMPARE(waylandClient->surfaceCount(), 0);
+}
+
+void tst_WaylandCompositor::clientMemoryLimits()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QPointer<QWaylandClient> waylandClient = compositor.surfaces.at(0)->client();
+
+    QSignalSpy softSpy(waylandClient, &QWaylandClient::memorySoftLimitExceeded);
+    QSignalSpy hardSpy(waylandClient, &QWaylandClient::memoryHardLimitExceeded);
+    waylandClient->setMemorySoftLimit(6000);
+    waylandClient->setMemoryHardLimit(12000);
+
+    const QSize size(32, 32);
+    ShmBuffer first(size, client.shm);
+    wl_surface_attach(surface, first.handle, 0, 0);
+    wl_surface_commit(surface);
+    QTRY_COMPARE(waylandClient->sharedMemorySize(), qint64(4096));
+
+    ShmBuffer second(size, client.shm);
+    wl_surface_attach(surface, second.handle, 0, 0);
+    wl_surface_commit(surface);
+    QTRY_COMPARE(softSpy.count(), 1);
+    QCOMPARE(hardSpy.count(), 0);
+
+    // Going above the hard limit closes the client
+    ShmBuffer third(size, client.shm);
+    ShmBuffer fourth(size, client.shm);
+    wl_surface_attach(surface, third.handle, 0, 0);
+    wl_surface_attach(surface, fourth.handle, 0, 0);
+    wl_surface_commit(surface);
+    QTRY_VERIFY(!waylandClient);
+    QCOMPARE(hardSpy.count(), 1);
+    QCOMPARE(softSpy.count(), 1);
+    QTRY_VERIFY(client.error);
+}
+
 void tst_WaylandCompositor::geometry()
 {
     TestCompositor compositor;
@@ -586,21 +752,6 @@ void tst_WaylandCompositor::mapSurfaceHiDpi()
     wl_surface_destroy(surface);
 }
 
-static void frameCallbackFunc(void *data, wl_callback *callback, uint32_t)
-{
-    ++*static_cast<int *>(data);
-    wl_callback_destroy(callback);
-}
-
-static void registerFrameCallback(wl_surface *surface, int *counter)
-{
-    static const wl_callback_listener frameCallbackListener = {
-        frameCallbackFunc
-    };
-
-    wl_callback_add_listener(wl_surface_frame(surface), &frameCallbackListener, counter);
-}
-
 class BufferView : public QWaylandView
 {
 public:
@@ -662,6 +813,57 @@ void tst_WaylandCompositor::frameCallback()
     wl_surface_destroy(surface);
 }
 
+void tst_WaylandCompositor::frameCallbackBeforeMapping()
+{
+    TestCompositor compositor;
+    compositor.create();
+    QWaylandOutput *output = compositor.defaultOutput();
+
+    MockClient client;
+
+    wl_surface *idleSurface = client.createSurface();
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 2);
+
+    QSize size(16, 16);
+    ShmBuffer buffer(size, client.shm);
+    for (wl_surface *s : { idleSurface, surface }) {
+        wl_surface_attach(s, buffer.handle, 0, 0);
+        wl_surface_damage(s, 0, 0, size.width(), size.height());
+    }
+    wl_surface_commit(idleSurface);
+
+    int frameCounter = 0;
+    registerFrameCallback(surface, &frameCounter);
+    wl_surface_commit(surface);
+    QTRY_VERIFY(compositor.surfaces.at(1)->hasContent());
+
+    QWaylandView idleView;
+    idleView.setSurface(compositor.surfaces.at(0));
+    idleView.setOutput(output);
+
+    // The callback committed before the surface got a view on the output is sent with the next frame
+    QWaylandView view;
+    view.setSurface(compositor.surfaces.at(1));
+    view.setOutput(output);
+    output->frameStarted();
+    output->sendFrameCallbacks();
+    QTRY_COMPARE(frameCounter, 1);
+
+    // Removing surfaces from the output leaves the others alone
+    idleView.setOutput(nullptr);
+    QSignalSpy redrawSpy(compositor.surfaces.at(1), SIGNAL(redraw()));
+    registerFrameCallback(surface, &frameCounter);
+    wl_surface_commit(surface);
+    QTRY_COMPARE(redrawSpy.count(), 1);
+    output->frameStarted();
+    output->sendFrameCallbacks();
+    QTRY_COMPARE(frameCounter, 2);
+
+    wl_surface_destroy(surface);
+    wl_surface_destroy(idleSurface);
+}
+
 void tst_WaylandCompositor::pixelFormats()
 {
     TestCompositor compositor;
@@ -691,6 +893,594 @@ void tst_WaylandCompositor::pixelFormats()
     wl_surface_destroy(surface);
 }
 
+void tst_WaylandCompositor::yuvPixelFormats_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("bufferFormat");
+
+    QTest::newRow("NV12") << int(WL_SHM_FORMAT_NV12) << int(QWaylandBufferRef::BufferFormatEgl_Y_XUXV);
+    QTest::newRow("YUV420") << int(WL_SHM_FORMAT_YUV420) << int(QWaylandBufferRef::BufferFormatEgl_Y_U_V);
+    QTest::newRow("YUYV") << int(WL_SHM_FORMAT_YUYV) << int(QWaylandBufferRef::BufferFormatEgl_Y_XUXV);
+}
+
+void tst_WaylandCompositor::yuvPixelFormats()
+{
+    QFETCH(int, format);
+    QFETCH(int, bufferFormat);
+
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    BufferView* view = new BufferView;
+    view->setSurface(waylandSurface);
+    view->setOutput(compositor.defaultOutput());
+
+    // Red, in BT.601 limited range
+    const uchar y = 81;
+    const uchar u = 90;
+    const uchar v = 240;
+
+    QSize size(16, 8);
+    ShmBuffer buffer(size, client.shm, wl_shm_format(format));
+    uchar *bits = buffer.image.bits();
+    const int lumaBytes = size.width() * size.height();
+    switch (format) {
+    case WL_SHM_FORMAT_NV12:
+        std::fill_n(bits, lumaBytes, y);
+        for (int i = lumaBytes; i < buffer.image.sizeInBytes(); i += 2) {
+            bits[i] = u;
+            bits[i + 1] = v;
+        }
+        break;
+    case WL_SHM_FORMAT_YUV420:
+        std::fill_n(bits, lumaBytes, y);
+        std::fill_n(bits + lumaBytes, lumaBytes / 4, u);
+        std::fill_n(bits + lumaBytes + lumaBytes / 4, lumaBytes / 4, v);
+        break;
+    case WL_SHM_FORMAT_YUYV:
+        for (int i = 0; i < buffer.image.sizeInBytes(); i += 4) {
+            bits[i] = y;
+            bits[i + 1] = u;
+            bits[i + 2] = y;
+            bits[i + 3] = v;
+        }
+        break;
+    }
+
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, size.width(), size.height());
+    wl_surface_commit(surface);
+
+    QTRY_COMPARE(waylandSurface->hasContent(), true);
+    QCOMPARE(waylandSurface->bufferSize(), size);
+
+    // Planes are uploaded as separate textures, but the image is converted for software rendering
+    QCOMPARE(int(view->bufferRef.bufferFormatEgl()), bufferFormat);
+    const QImage image = view->image();
+    QCOMPARE(image.size(), size);
+    QCOMPARE(image.pixel(0, 0), QColor(Qt::red).rgb());
+    QCOMPARE(image.pixel(15, 7), QColor(Qt::red).rgb());
+
+    wl_surface_destroy(surface);
+}
+
+void tst_WaylandCompositor::yuvUndersizedPool()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    BufferView* view = new BufferView;
+    view->setSurface(waylandSurface);
+    view->setOutput(compositor.defaultOutput());
+
+    // libwayland accepts the buffer, since stride * height fits, but the chroma plane doesn't
+    QSize size(16, 8);
+    ShmBuffer buffer(size, client.shm, WL_SHM_FORMAT_NV12, size.width() * size.height());
+    std::fill_n(buffer.image.bits(), buffer.image.sizeInBytes(), uchar(81));
+
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, size.width(), size.height());
+    wl_surface_commit(surface);
+
+    QTRY_COMPARE(waylandSurface->hasContent(), true);
+    QCOMPARE(view->bufferRef.bufferFormatEgl(), QWaylandBufferRef::BufferFormatEgl_Null);
+    QVERIFY(view->image().isNull());
+
+    // The client is not disconnected for it either
+    QCOMPARE(compositor.clients().size(), 1);
+
+    wl_surface_destroy(surface);
+}
+
+void tst_WaylandCompositor::softwareOutput()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    // 50x40 in output coordinates
+    QWaylandSoftwareOutput output(&compositor, QSize(100, 80));
+    output.setScaleFactor(2);
+
+    MockClient client;
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    QWaylandView view;
+    view.setSurface(waylandSurface);
+    view.setOutput(&output);
+    output.setViewPosition(&view, QPoint(10, 5));
+
+    QSize size(20, 20);
+    ShmBuffer buffer(size, client.shm);
+    buffer.image.fill(Qt::red);
+    wl_surface_set_buffer_scale(surface, 2);
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, size.width(), size.height());
+    wl_surface_commit(surface);
+
+    const QRgb red = QColor(Qt::red).rgb();
+    const QRgb black = QColor(Qt::black).rgb();
+
+    // The view covers framebuffer pixels (20, 10) to (39, 29)
+    QTRY_COMPARE(output.framebuffer().pixel(25, 15), red);
+    QCOMPARE(output.framebuffer().pixel(39, 29), red);
+    QCOMPARE(output.framebuffer().pixel(15, 15), black);
+    QCOMPARE(output.framebuffer().pixel(40, 15), black);
+
+    // Nothing changed, so there is nothing to redraw
+    QVERIFY(output.renderFrame().isEmpty());
+
+    // Rotated 90 degrees counter-clockwise, the output is 40x50 and the view
+    // ends up on framebuffer pixels (10, 40) to (29, 59)
+    output.setTransform(QWaylandOutput::Transform90);
+    QTRY_COMPARE(output.framebuffer().pixel(15, 50), red);
+    QCOMPARE(output.framebuffer().pixel(25, 15), black);
+    QCOMPARE(output.framebuffer().pixel(15, 35), black);
+
+    wl_surface_destroy(surface);
+}
+
+void tst_WaylandCompositor::softwareOutputFullscreenBypass()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    QSize outputSize(64, 48);
+    QWaylandSoftwareOutput output(&compositor, outputSize);
+
+    MockClient client;
+
+    // A fullscreen surface, which says it is opaque even though its buffer has an alpha channel
+    wl_surface *fullscreen = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandView fullscreenView;
+    fullscreenView.setSurface(compositor.surfaces.at(0));
+    fullscreenView.setOutput(&output);
+
+    ShmBuffer fullscreenBuffer(outputSize, client.shm);
+    fullscreenBuffer.image.fill(QColor(255, 0, 0, 128));
+    wl_region *region = wl_compositor_create_region(client.compositor);
+    wl_region_add(region, 0, 0, outputSize.width(), outputSize.height());
+    wl_surface_set_opaque_region(fullscreen, region);
+    wl_region_destroy(region);
+    wl_surface_attach(fullscreen, fullscreenBuffer.handle, 0, 0);
+    wl_surface_damage(fullscreen, 0, 0, outputSize.width(), outputSize.height());
+    wl_surface_commit(fullscreen);
+
+    // The buffer is copied as is, with the alpha channel ignored
+    const QRgb fullscreenColor = qPremultiply(QColor(255, 0, 0, 128).rgba()) | 0xff000000;
+    QTRY_COMPARE(output.framebuffer().pixel(0, 0), fullscreenColor);
+    QCOMPARE(output.framebuffer().pixel(63, 47), fullscreenColor);
+
+    // Once something is shown on top of it, the output is composited again
+    wl_surface *overlay = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 2);
+    QWaylandView overlayView;
+    overlayView.setSurface(compositor.surfaces.at(1));
+    overlayView.setOutput(&output);
+    output.setViewPosition(&overlayView, QPoint(8, 8));
+
+    QSize overlaySize(16, 16);
+    ShmBuffer overlayBuffer(overlaySize, client.shm);
+    overlayBuffer.image.fill(Qt::blue);
+    wl_surface_attach(overlay, overlayBuffer.handle, 0, 0);
+    wl_surface_damage(overlay, 0, 0, overlaySize.width(), overlaySize.height());
+    wl_surface_commit(overlay);
+
+    const QRgb blue = QColor(Qt::blue).rgb();
+    QTRY_COMPARE(output.framebuffer().pixel(10, 10), blue);
+    QCOMPARE(output.framebuffer().pixel(4, 4), fullscreenColor);
+
+    // The fullscreen surface changing underneath the overlay doesn't draw over it
+    fullscreenBuffer.image.fill(Qt::green);
+    wl_surface_attach(fullscreen, fullscreenBuffer.handle, 0, 0);
+    wl_surface_damage(fullscreen, 0, 0, outputSize.width(), outputSize.height());
+    wl_surface_commit(fullscreen);
+
+    const QRgb green = QColor(Qt::green).rgb();
+    QTRY_COMPARE(output.framebuffer().pixel(4, 4), green);
+    QCOMPARE(output.framebuffer().pixel(10, 10), blue);
+
+    // Without the overlay, the area it covered shows the fullscreen surface again
+    overlayView.setOutput(nullptr);
+    QTRY_COMPARE(output.framebuffer().pixel(10, 10), green);
+    QCOMPARE(output.framebuffer().pixel(63, 47), green);
+
+    wl_surface_destroy(overlay);
+    wl_surface_destroy(fullscreen);
+}
+
+void tst_WaylandCompositor::quickOutputFullscreenBypass()
+{
+#if QT_CONFIG(wayland_compositor_quick)
+    TestCompositor compositor;
+    QQuickWindow window;
+    window.resize(64, 48);
+    if (window.effectiveDevicePixelRatio() != 1)
+        QSKIP("The buffer sizes below assume a device pixel ratio of 1");
+    QWaylandQuickOutput output(&compositor, &window);
+    compositor.create();
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.at(0);
+
+    QWaylandQuickItem item;
+    item.setParentItem(window.contentItem());
+    item.setSurface(waylandSurface);
+
+    // A buffer the size of the window, which says it is opaque even though it has an alpha channel
+    const QSize windowSize = window.size();
+    ShmBuffer buffer(windowSize, client.shm);
+    wl_region *region = wl_compositor_create_region(client.compositor);
+    wl_region_add(region, 0, 0, windowSize.width(), windowSize.height());
+    wl_surface_set_opaque_region(surface, region);
+    wl_region_destroy(region);
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, windowSize.width(), windowSize.height());
+    wl_surface_commit(surface);
+    QTRY_VERIFY(waylandSurface->hasContent());
+    QCOMPARE(item.size(), QSizeF(windowSize));
+
+    // The bypass is opt-in
+    QVERIFY(!output.fullscreenBypass());
+    emit window.afterAnimating();
+    QCOMPARE(output.bypassItem(), nullptr);
+    QVERIFY(window.clearBeforeRendering());
+
+    QSignalSpy bypassItemSpy(&output, &QWaylandQuickOutput::bypassItemChanged);
+    output.setFullscreenBypass(true);
+    emit window.afterAnimating();
+    QCOMPARE(output.bypassItem(), &item);
+    QCOMPARE(bypassItemSpy.count(), 1);
+    QVERIFY(!window.clearBeforeRendering());
+#if QT_CONFIG(opengl)
+    // Without a hardware layer integration the item is still drawn by the scene graph
+    if (!QWaylandQuickHardwareLayer::isAvailable())
+        QVERIFY(!item.findChild<QWaylandQuickHardwareLayer *>());
+#endif
+
+    // Nothing changed, so the bypass item stays the same
+    emit window.afterAnimating();
+    QCOMPARE(bypassItemSpy.count(), 1);
+
+    // An item drawing on top of the surface brings back compositing
+    QQuickItem overlay;
+    overlay.setFlag(QQuickItem::ItemHasContents);
+    overlay.setParentItem(window.contentItem());
+    overlay.setPosition(QPointF(8, 8));
+    overlay.setSize(QSizeF(16, 16));
+    emit window.afterAnimating();
+    QCOMPARE(output.bypassItem(), nullptr);
+    QVERIFY(window.clearBeforeRendering());
+
+    // Items outside the window or without contents don't get in the way
+    overlay.setPosition(QPointF(windowSize.width(), 0));
+    emit window.afterAnimating();
+    QCOMPARE(output.bypassItem(), &item);
+
+    overlay.setPosition(QPointF(8, 8));
+    overlay.setFlag(QQuickItem::ItemHasContents, false);
+    emit window.afterAnimating();
+    QCOMPARE(output.bypassItem(), &item);
+
+    // A surface that doesn't cover the window exactly is composited
+    item.setX(1);
+    emit window.afterAnimating();
+    QCOMPARE(output.bypassItem(), nullptr);
+    item.setX(0);
+
+    item.setOpacity(0.5);
+    emit window.afterAnimating();
+    QCOMPARE(output.bypassItem(), nullptr);
+    item.setOpacity(1);
+
+    emit window.afterAnimating();
+    QCOMPARE(output.bypassItem(), &item);
+
+    // Turning the bypass off restores compositing right away
+    output.setFullscreenBypass(false);
+    QCOMPARE(output.bypassItem(), nullptr);
+    QVERIFY(window.clearBeforeRendering());
+
+    wl_surface_destroy(surface);
+#else
+    QSKIP("Built without QtQuick support");
+#endif
+}
+
+void tst_WaylandCompositor::frameStatistics()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    QWaylandSoftwareOutput output(&compositor, QSize(64, 48));
+    QWaylandFrameStatistics *statistics = output.frameStatistics();
+    QVERIFY(statistics);
+    QCOMPARE(output.frameStatistics(), statistics);
+    QCOMPARE(statistics->output(), &output);
+    QCOMPARE(statistics->frameCount(), 0);
+    statistics->setHistorySize(8);
+
+    MockClient client;
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandView view;
+    view.setSurface(compositor.surfaces.at(0));
+    view.setOutput(&output);
+
+    int frameCallbacks = 0;
+    QSize size(16, 16);
+    ShmBuffer buffer(size, client.shm);
+    registerFrameCallback(surface, &frameCallbacks);
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, size.width(), size.height());
+    wl_surface_commit(surface);
+
+    // The commit is rendered and its frame callback sent, but the frame is only
+    // measured once the next one starts
+    QTRY_COMPARE(frameCallbacks, 1);
+    const int frameCount = statistics->frameCount();
+    output.renderFrame();
+    QCOMPARE(statistics->frameCount(), frameCount + 1);
+
+    QWaylandFrameStatistics::Frame frame = statistics->lastFrame();
+    QVERIFY(frame.startTime > 0);
+    QCOMPARE(frame.surfacesUpdated, 1);
+    QCOMPARE(statistics->surfacesUpdated(), 1);
+    QVERIFY(frame.eventDispatchTime >= 0);
+    QVERIFY(frame.renderTime >= 0);
+    QVERIFY(frame.commitToDisplayTime > 0);
+    QVERIFY(frame.frameCallbackLatency > 0);
+
+    // Nothing was committed for the second frame
+    output.renderFrame();
+    QCOMPARE(statistics->frameCount(), frameCount + 2);
+    frame = statistics->lastFrame();
+    QCOMPARE(frame.surfacesUpdated, 0);
+    QCOMPARE(frame.commitToDisplayTime, qreal(0));
+    QCOMPARE(frame.frameCallbackLatency, qreal(0));
+
+    QVector<QWaylandFrameStatistics::Frame> history = statistics->history();
+    QCOMPARE(history.size(), frameCount + 2);
+    QCOMPARE(history.at(history.size() - 2).surfacesUpdated, 1);
+    QCOMPARE(history.last().surfacesUpdated, 0);
+
+    // Shrinking the history keeps the most recent frames
+    statistics->setHistorySize(1);
+    history = statistics->history();
+    QCOMPARE(history.size(), 1);
+    QCOMPARE(history.first().surfacesUpdated, 0);
+    output.renderFrame();
+    QCOMPARE(statistics->history().size(), 1);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath(QStringLiteral("frames.csv"));
+    QVERIFY(statistics->writeHistory(fileName));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+    const QList<QByteArray> lines = file.readAll().trimmed().split('\n');
+    QCOMPARE(lines.size(), 2);
+    QVERIFY(lines.first().startsWith("startTime,"));
+    QCOMPARE(lines.last().split(',').size(), 7);
+
+    statistics->reset();
+    QCOMPARE(statistics->frameCount(), 0);
+    QVERIFY(statistics->history().isEmpty());
+
+    wl_surface_destroy(surface);
+}
+
+void tst_WaylandCompositor::frameCallbackPolicy()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    QWaylandSoftwareOutput slowOutput(&compositor, QSize(64, 48), 30000);
+    QWaylandSoftwareOutput fastOutput(&compositor, QSize(64, 48), 120000);
+    slowOutput.setAutomaticFrameCallback(false);
+    fastOutput.setAutomaticFrameCallback(false);
+
+    MockClient client;
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    QWaylandClient *waylandClient = waylandSurface->client();
+    QCOMPARE(waylandSurface->frameCallbackPolicy(), QWaylandSurface::PrimaryViewFrameCallbacks);
+
+    QWaylandView slowView;
+    slowView.setSurface(waylandSurface);
+    slowView.setOutput(&slowOutput);
+    QWaylandView fastView;
+    fastView.setSurface(waylandSurface);
+    fastView.setOutput(&fastOutput);
+    QCOMPARE(waylandSurface->primaryView(), &slowView);
+
+    QSize size(16, 16);
+    ShmBuffer buffer(size, client.shm);
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, size.width(), size.height());
+    wl_surface_commit(surface);
+    QTRY_VERIFY(waylandSurface->hasContent());
+
+    int frameCallbacks = 0;
+    auto commitFrame = [&]() {
+        registerFrameCallback(surface, &frameCallbacks);
+        wl_surface_commit(surface);
+        QTRY_COMPARE(waylandClient->pendingFrameCallbackCount(), 1);
+    };
+    auto sendFrame = [](QWaylandOutput &output) {
+        output.frameStarted();
+        output.sendFrameCallbacks();
+    };
+
+    // By default the output of the primary view paces the client
+    commitFrame();
+    sendFrame(fastOutput);
+    QCOMPARE(waylandClient->pendingFrameCallbackCount(), 1);
+    sendFrame(slowOutput);
+    QCOMPARE(waylandClient->pendingFrameCallbackCount(), 0);
+    QTRY_COMPARE(frameCallbacks, 1);
+
+    QSignalSpy policySpy(waylandSurface, &QWaylandSurface::frameCallbackPolicyChanged);
+    waylandSurface->setFrameCallbackPolicy(QWaylandSurface::FastestOutputFrameCallbacks);
+    QCOMPARE(policySpy.count(), 1);
+    commitFrame();
+    sendFrame(slowOutput);
+    QCOMPARE(waylandClient->pendingFrameCallbackCount(), 1);
+    sendFrame(fastOutput);
+    QCOMPARE(waylandClient->pendingFrameCallbackCount(), 0);
+    QTRY_COMPARE(frameCallbacks, 2);
+
+    // Hidden views don't pace the client
+    QWaylandViewPrivate::get(&fastView)->visible = false;
+    commitFrame();
+    sendFrame(fastOutput);
+    QCOMPARE(waylandClient->pendingFrameCallbackCount(), 1);
+    sendFrame(slowOutput);
+    QCOMPARE(waylandClient->pendingFrameCallbackCount(), 0);
+    QTRY_COMPARE(frameCallbacks, 3);
+    QWaylandViewPrivate::get(&fastView)->visible = true;
+
+    QSignalSpy outputSpy(waylandSurface, &QWaylandSurface::frameCallbackOutputChanged);
+    waylandSurface->setFrameCallbackPolicy(QWaylandSurface::ChosenOutputFrameCallbacks);
+    waylandSurface->setFrameCallbackOutput(&slowOutput);
+    QCOMPARE(outputSpy.count(), 1);
+    QCOMPARE(waylandSurface->frameCallbackOutput(), &slowOutput);
+    commitFrame();
+    sendFrame(fastOutput);
+    QCOMPARE(waylandClient->pendingFrameCallbackCount(), 1);
+    sendFrame(slowOutput);
+    QCOMPARE(waylandClient->pendingFrameCallbackCount(), 0);
+    QTRY_COMPARE(frameCallbacks, 4);
+
+    // The fastest output takes over while the chosen one doesn't show the surface
+    slowView.setOutput(nullptr);
+    commitFrame();
+    sendFrame(fastOutput);
+    QCOMPARE(waylandClient->pendingFrameCallbackCount(), 0);
+    QTRY_COMPARE(frameCallbacks, 5);
+
+    wl_surface_destroy(surface);
+}
+
+void tst_WaylandCompositor::surfaceGrabber()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.at(0);
+
+    QWaylandSurfaceGrabber grabber(waylandSurface);
+    QSignalSpy successSpy(&grabber, &QWaylandSurfaceGrabber::success);
+    QSignalSpy failedSpy(&grabber, &QWaylandSurfaceGrabber::failed);
+
+    const QRgb red = QColor(Qt::red).rgb();
+    const QRgb green = QColor(Qt::green).rgb();
+    const QRgb blue = QColor(Qt::blue).rgb();
+
+    QSize size(32, 32);
+    ShmBuffer buffer(size, client.shm);
+    buffer.image.fill(Qt::blue);
+    QPainter(&buffer.image).fillRect(QRect(8, 8, 8, 8), Qt::red);
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, size.width(), size.height());
+    wl_surface_commit(surface);
+    QTRY_VERIFY(waylandSurface->hasContent());
+
+    grabber.grab();
+    QCOMPARE(successSpy.count(), 1);
+    QImage image = successSpy.takeFirst().first().value<QImage>();
+    QCOMPARE(image.size(), size);
+    QCOMPARE(image.pixel(10, 10), red);
+    QCOMPARE(grabber.grabbedRect(), QRect(QPoint(), size));
+
+    grabber.setSourceRect(QRect(8, 8, 8, 8));
+    grabber.grab();
+    QCOMPARE(successSpy.count(), 1);
+    image = successSpy.takeFirst().first().value<QImage>();
+    QCOMPARE(image.size(), QSize(8, 8));
+    QCOMPARE(image.pixel(0, 0), red);
+    QCOMPARE(image.pixel(7, 7), red);
+
+    grabber.setSourceRect(QRect(100, 100, 8, 8));
+    grabber.grab();
+    QCOMPARE(failedSpy.count(), 1);
+    QCOMPARE(failedSpy.takeFirst().first().value<QWaylandSurfaceGrabber::Error>(), QWaylandSurfaceGrabber::InvalidSourceRect);
+    grabber.setSourceRect(QRect());
+
+    // Partial grabs keep the target image up to date as a whole
+    QImage target(size, QImage::Format_ARGB32_Premultiplied);
+    target.fill(Qt::black);
+    grabber.setTargetImage(&target);
+
+    grabber.grabDamage(); // The first one grabs everything
+    QCOMPARE(successSpy.count(), 1);
+    successSpy.clear();
+    QCOMPARE(target.pixel(0, 0), blue);
+    QCOMPARE(target.pixel(10, 10), red);
+
+    QSignalSpy damagedSpy(waylandSurface, &QWaylandSurface::damaged);
+    QPainter(&buffer.image).fillRect(QRect(0, 0, 4, 4), Qt::green);
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, 4, 4);
+    wl_surface_commit(surface);
+    QTRY_COMPARE(damagedSpy.count(), 1);
+
+    grabber.grabDamage();
+    QCOMPARE(successSpy.count(), 1);
+    QCOMPARE(grabber.grabbedRect(), QRect(0, 0, 4, 4));
+    QCOMPARE(target.pixel(1, 1), green);
+    QCOMPARE(target.pixel(10, 10), red);
+
+    // Nothing was damaged since
+    successSpy.clear();
+    grabber.grabDamage();
+    QCOMPARE(successSpy.count(), 0);
+    QCOMPARE(failedSpy.count(), 0);
+
+    wl_surface_destroy(surface);
+}
+
 void tst_WaylandCompositor::outputs()
 {
     TestCompositor compositor;
@@ -1871,5 +2661,288 @@ void tst_WaylandCompositor::xdgOutput()
     QTRY_COMPARE(xdgOutput->logicalSize, QSize(1000, 1000));
 }
 
+class ScreencopyCompositor : public TestCompositor
+{
+    Q_OBJECT
+public:
+    ScreencopyCompositor() : screencopyManager(this) {}
+    QWaylandScreencopyManagerV1 screencopyManager;
+};
+
+void tst_WaylandCompositor::screencopy()
+{
+    ScreencopyCompositor compositor;
+    compositor.create();
+
+    QWaylandSoftwareOutput output(&compositor, QSize(64, 48));
+
+    MockClient client;
+    QTRY_VERIFY(client.screencopyManager);
+    QTRY_COMPARE(client.m_outputs.size(), 2);
+    wl_output *wlOutput = client.m_outputs.last(); // The software output was announced last
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandView view;
+    view.setSurface(compositor.surfaces.at(0));
+    view.setOutput(&output);
+    output.setViewPosition(&view, QPoint(8, 8));
+
+    const QRgb red = QColor(Qt::red).rgb();
+    const QRgb green = QColor(Qt::green).rgb();
+    const QRgb blue = QColor(Qt::blue).rgb();
+    const QRgb black = QColor(Qt::black).rgb();
+
+    QSize surfaceSize(16, 16);
+    ShmBuffer redBuffer(surfaceSize, client.shm);
+    redBuffer.image.fill(Qt::red);
+    wl_surface_attach(surface, redBuffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, surfaceSize.width(), surfaceSize.height());
+    wl_surface_commit(surface);
+    QTRY_COMPARE(output.framebuffer().pixel(10, 10), red);
+
+    // A plain copy of the whole output is served right away
+    MockScreencopyFrameV1 *frame = client.createScreencopyFrame(wlOutput);
+    QTRY_VERIFY(frame->bufferDone);
+    QCOMPARE(frame->format, uint(WL_SHM_FORMAT_XRGB8888));
+    QCOMPARE(frame->bufferSize, QSize(64, 48));
+    QCOMPARE(frame->stride, 64u * 4);
+
+    ShmBuffer buffer(frame->bufferSize, client.shm, WL_SHM_FORMAT_XRGB8888);
+    buffer.image.fill(Qt::blue);
+    frame->copy(buffer.handle);
+    QTRY_VERIFY(frame->ready);
+    QCOMPARE(frame->flags, 0u);
+    QCOMPARE(buffer.image.pixel(10, 10), red);
+    QCOMPARE(buffer.image.pixel(0, 0), black);
+    delete frame;
+
+    // Nothing changed since, so a damage based copy waits
+    buffer.image.setPixel(0, 0, blue);
+    frame = client.createScreencopyFrame(wlOutput);
+    QTRY_VERIFY(frame->bufferDone);
+    frame->copy_with_damage(buffer.handle);
+    QTRY_VERIFY(compositor.screencopyManager.hasPendingCaptures(&output));
+    QVERIFY(!frame->ready);
+
+    ShmBuffer greenBuffer(surfaceSize, client.shm);
+    greenBuffer.image.fill(Qt::green);
+    wl_surface_attach(surface, greenBuffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, surfaceSize.width(), surfaceSize.height());
+    wl_surface_commit(surface);
+
+    // The client may have drawn into the reused buffer, so all of it is copied again.
+    // The damage events only report what changed.
+    QTRY_VERIFY(frame->ready);
+    QCOMPARE(frame->damage.boundingRect(), QRect(QPoint(8, 8), surfaceSize));
+    QCOMPARE(buffer.image.pixel(10, 10), green);
+    QCOMPARE(buffer.image.pixel(0, 0), black);
+    QVERIFY(!compositor.screencopyManager.hasPendingCaptures(&output));
+    delete frame;
+
+    // Regions are in output coordinates
+    frame = client.createScreencopyFrame(wlOutput, QRect(4, 4, 8, 8));
+    QTRY_VERIFY(frame->bufferDone);
+    QCOMPARE(frame->bufferSize, QSize(8, 8));
+    ShmBuffer regionBuffer(frame->bufferSize, client.shm, WL_SHM_FORMAT_XRGB8888);
+    frame->copy(regionBuffer.handle);
+    QTRY_VERIFY(frame->ready);
+    QCOMPARE(regionBuffer.image.pixel(0, 0), black);
+    QCOMPARE(regionBuffer.image.pixel(7, 7), green);
+    delete frame;
+
+    // Buffers in another format than the advertised one are a protocol error
+    {
+        MockClient argbClient;
+        QTRY_VERIFY(argbClient.screencopyManager);
+        QTRY_COMPARE(argbClient.m_outputs.size(), 2);
+        MockScreencopyFrameV1 *argbFrame = argbClient.createScreencopyFrame(argbClient.m_outputs.last());
+        QTRY_VERIFY(argbFrame->bufferDone);
+        ShmBuffer argbBuffer(argbFrame->bufferSize, argbClient.shm, WL_SHM_FORMAT_ARGB8888);
+        argbFrame->copy(argbBuffer.handle);
+        QTRY_COMPARE(argbClient.error, EPROTO);
+        QCOMPARE(argbClient.protocolError.code, uint(ZWLR_SCREENCOPY_FRAME_V1_ERROR_INVALID_BUFFER));
+        delete argbFrame;
+    }
+
+    // As are buffers of the wrong size
+    frame = client.createScreencopyFrame(wlOutput);
+    QTRY_VERIFY(frame->bufferDone);
+    frame->copy(regionBuffer.handle);
+    QTRY_COMPARE(client.error, EPROTO);
+    QCOMPARE(client.protocolError.code, uint(ZWLR_SCREENCOPY_FRAME_V1_ERROR_INVALID_BUFFER));
+}
+
+static const uint32_t drmFormatXrgb8888 = 0x34325258; // DRM_FORMAT_XRGB8888
+static const uint32_t drmFormatArgb8888 = 0x34325241; // DRM_FORMAT_ARGB8888
+
+static QtWayland::HardwarePlane overlayPlane(uint id, int zpos)
+{
+    QtWayland::HardwarePlane plane;
+    plane.id = id;
+    plane.zpos = zpos;
+    plane.formats.insert(drmFormatXrgb8888, QVector<uint64_t>());
+    return plane;
+}
+
+static QtWayland::HardwareLayerCandidate planeCandidate(const QRect &destination, int stackingLevel)
+{
+    QtWayland::HardwareLayerCandidate candidate;
+    candidate.drmFormat = drmFormatXrgb8888;
+    candidate.bufferSize = destination.size();
+    candidate.destination = destination;
+    candidate.opaque = true;
+    candidate.stackingLevel = stackingLevel;
+    return candidate;
+}
+
+static uint planeFor(const QVector<QtWayland::HardwarePlaneAssignment> &assignments, const QRect &destination)
+{
+    for (const auto &assignment : assignments) {
+        if (assignment.candidate.destination == destination)
+            return assignment.plane.id;
+    }
+    return 0;
+}
+
+void tst_WaylandCompositor::hardwareLayerPlannerPrefersLargestLayers()
+{
+    QtWayland::SimulatedHardwarePlaneBackend backend;
+    backend.setPlanes({ overlayPlane(31, 2), overlayPlane(32, 3) });
+    QtWayland::HardwareLayerPlanner planner(&backend);
+
+    const QRect small(0, 0, 100, 100);
+    const QRect large(200, 0, 300, 300);
+    const QRect medium(600, 0, 200, 200);
+    auto assignments = planner.plan({ planeCandidate(small, 0), planeCandidate(large, 1), planeCandidate(medium, 2) });
+
+    QCOMPARE(assignments.size(), 2);
+    QCOMPARE(planeFor(assignments, large), 31u);
+    QCOMPARE(planeFor(assignments, medium), 32u);
+    QCOMPARE(planeFor(assignments, small), 0u);
+    QVERIFY(backend.commit(assignments));
+    QCOMPARE(backend.committed().size(), 2);
+
+    // Negative stacking levels need planes beneath the scene graph
+    auto underlay = planeCandidate(large, -1);
+    QVERIFY(planner.plan({ underlay }).isEmpty());
+    auto plane = overlayPlane(30, 0);
+    plane.underlay = true;
+    backend.setPlanes({ plane, overlayPlane(31, 2) });
+    assignments = planner.plan({ underlay, planeCandidate(medium, 0) });
+    QCOMPARE(planeFor(assignments, large), 30u);
+    QCOMPARE(planeFor(assignments, medium), 31u);
+}
+
+void tst_WaylandCompositor::hardwareLayerPlannerChecksPlaneCapabilities()
+{
+    QtWayland::SimulatedHardwarePlaneBackend backend;
+    backend.setPlanes({ overlayPlane(31, 2) });
+    QtWayland::HardwareLayerPlanner planner(&backend);
+    planner.setOutputRect(QRect(0, 0, 1024, 768));
+
+    const QRect destination(0, 0, 400, 300);
+    QCOMPARE(planner.plan({ planeCandidate(destination, 0) }).size(), 1);
+
+    auto candidate = planeCandidate(destination, 0);
+    candidate.drmFormat = drmFormatArgb8888;
+    QVERIFY(planner.plan({ candidate }).isEmpty());
+
+    // Shared memory buffers can't be scanned out
+    candidate = planeCandidate(destination, 0);
+    candidate.drmFormat = 0;
+    QVERIFY(planner.plan({ candidate }).isEmpty());
+
+    candidate = planeCandidate(destination, 0);
+    candidate.bufferSize = QSize(200, 150);
+    QVERIFY(planner.plan({ candidate }).isEmpty());
+
+    candidate = planeCandidate(destination, 0);
+    candidate.transformed = true;
+    QVERIFY(planner.plan({ candidate }).isEmpty());
+
+    candidate = planeCandidate(QRect(900, 0, 400, 300), 0);
+    QVERIFY(planner.plan({ candidate }).isEmpty());
+
+    candidate = planeCandidate(destination, 0);
+    candidate.opacity = 0.5;
+    QVERIFY(planner.plan({ candidate }).isEmpty());
+
+    auto plane = overlayPlane(31, 2);
+    plane.supportsAlpha = true;
+    plane.minScale = 0.5;
+    plane.maxScale = 2;
+    backend.setPlanes({ plane });
+    QCOMPARE(planner.plan({ candidate }).size(), 1);
+    candidate.opacity = 1;
+    candidate.bufferSize = QSize(200, 150);
+    QCOMPARE(planner.plan({ candidate }).size(), 1);
+    candidate.bufferSize = QSize(100, 75);
+    QVERIFY(planner.plan({ candidate }).isEmpty());
+}
+
+void tst_WaylandCompositor::hardwareLayerPlannerKeepsStackingOrder()
+{
+    QtWayland::SimulatedHardwarePlaneBackend backend;
+    QtWayland::HardwareLayerPlanner planner(&backend);
+
+    // The bottom layer is the largest, but only the top plane supports its format
+    auto plane = overlayPlane(32, 3);
+    plane.formats.insert(drmFormatArgb8888, QVector<uint64_t>());
+    backend.setPlanes({ overlayPlane(31, 2), plane });
+    auto bottom = planeCandidate(QRect(0, 0, 400, 400), 0);
+    bottom.drmFormat = drmFormatArgb8888;
+    auto top = planeCandidate(QRect(500, 0, 100, 100), 1);
+    auto assignments = planner.plan({ top, bottom });
+    QCOMPARE(assignments.size(), 1);
+    QCOMPARE(planeFor(assignments, bottom.destination), 32u);
+
+    // A layer left to the GPU is drawn beneath all planes, so what it overlaps must be too
+    backend.setPlanes({ overlayPlane(31, 2), overlayPlane(32, 3) });
+    auto covering = planeCandidate(QRect(200, 200, 100, 100), 1);
+    covering.drmFormat = drmFormatArgb8888;
+    assignments = planner.plan({ planeCandidate(QRect(0, 0, 400, 400), 0), covering,
+                                 planeCandidate(QRect(500, 0, 100, 100), 2) });
+    QCOMPARE(assignments.size(), 1);
+    QCOMPARE(planeFor(assignments, QRect(500, 0, 100, 100)), 31u);
+}
+
+void tst_WaylandCompositor::hardwareLayerPlannerSkipsOccludedLayers()
+{
+    QtWayland::SimulatedHardwarePlaneBackend backend;
+    backend.setPlanes({ overlayPlane(31, 2) });
+    QtWayland::HardwareLayerPlanner planner(&backend);
+
+    // Most of the bottom layer is hidden by the opaque layer on top
+    const QRect bottom(0, 0, 300, 300);
+    const QRect top(0, 0, 300, 250);
+    auto assignments = planner.plan({ planeCandidate(bottom, 0), planeCandidate(top, 1) });
+    QCOMPARE(assignments.size(), 1);
+    QCOMPARE(planeFor(assignments, top), 31u);
+
+    QCOMPARE(QtWayland::HardwareLayerPlanner::score(planeCandidate(bottom, 0), QRegion(top)), qint64(300 * 50));
+    QCOMPARE(QtWayland::HardwareLayerPlanner::score(planeCandidate(top, 0), QRegion(bottom)), qint64(0));
+}
+
+void tst_WaylandCompositor::hardwareLayerPlannerFallsBackWhenTestFails()
+{
+    QtWayland::SimulatedHardwarePlaneBackend backend;
+    backend.setPlanes({ overlayPlane(31, 2), overlayPlane(32, 3) });
+    backend.setMaxActivePlanes(1);
+    QtWayland::HardwareLayerPlanner planner(&backend);
+
+    const QRect small(0, 0, 100, 100);
+    const QRect large(200, 0, 300, 300);
+    auto assignments = planner.plan({ planeCandidate(small, 0), planeCandidate(large, 1) });
+    QCOMPARE(assignments.size(), 1);
+    QVERIFY(planeFor(assignments, large));
+    QCOMPARE(backend.testCount(), 2);
+
+    backend.setMaxActivePlanes(0);
+    QVERIFY(planner.plan({ planeCandidate(small, 0), planeCandidate(large, 1) }).isEmpty());
+    QVERIFY(backend.commit(QVector<QtWayland::HardwarePlaneAssignment>()));
+    QVERIFY(backend.committed().isEmpty());
+}
+
 #include <tst_compositor.moc>
 QTEST_MAIN(tst_WaylandCompositor);
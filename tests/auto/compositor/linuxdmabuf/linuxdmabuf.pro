@@ -0,0 +1,14 @@
+CONFIG += testcase link_pkgconfig
+CONFIG += wayland-scanner
+TARGET = tst_linuxdmabuf
+
+QT += testlib
+
+# The mock client and test compositor of the compositor autotest
+include(../compositor/compositor.pri)
+
+# LinuxDmabuf and its import cache are built into the test
+include(../../../../src/hardwareintegration/compositor/linux-dmabuf-unstable-v1/linux-dmabuf-unstable-v1.pri)
+
+SOURCES += \
+    tst_linuxdmabuf.cpp
@@ -0,0 +1,526 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "linuxdmabuf.h"
+#include "linuxdmabufimportcache.h"
+#include "mockclient.h"
+#include "testcompositor.h"
+
+#include <QtWaylandCompositor/QWaylandSurface>
+#include <QtTest/QtTest>
+
+#include <drm_fourcc.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+// Stands in for the EGL imports, numbering them in the order they are made
+class FakeImports
+{
+public:
+    LinuxDmabufImportCache::ImportFunction importFunction(bool succeed = true)
+    {
+        return [this, succeed](LinuxDmabufImport *import) {
+            ++imported;
+            import->images[0] = reinterpret_cast<EGLImageKHR>(quintptr(imported));
+            return succeed;
+        };
+    }
+
+    LinuxDmabufImportCache::ReleaseFunction releaseFunction()
+    {
+        return [this](const LinuxDmabufImport &import) {
+            released.append(int(reinterpret_cast<quintptr>(import.images[0])));
+        };
+    }
+
+    static int number(const LinuxDmabufImport *import)
+    {
+        return int(reinterpret_cast<quintptr>(import->images[0]));
+    }
+
+    int imported = 0;
+    QVector<int> released;
+};
+
+static LinuxDmabufImportKey importKey(ino_t inode)
+{
+    LinuxDmabufPlaneKey plane;
+    plane.device = 1;
+    plane.inode = inode;
+    plane.stride = 256;
+
+    LinuxDmabufImportKey key;
+    key.drmFormat = 0x34325241; // DRM_FORMAT_ARGB8888
+    key.size = QSize(64, 64);
+    key.planes.append(plane);
+    return key;
+}
+
+static wl_client *fakeClient(quintptr id)
+{
+    return reinterpret_cast<wl_client *>(id);
+}
+
+// Records the events a client gets on a proxy, without needing client side protocol code
+class EventRecorder
+{
+public:
+    void listen(void *proxy)
+    {
+        wl_proxy_add_dispatcher(static_cast<wl_proxy *>(proxy), dispatch, this, nullptr);
+    }
+
+    QByteArrayList events;
+    QVector<QVector<uint16_t>> trancheFormats;
+
+private:
+    static int dispatch(const void *implementation, void *target, uint32_t opcode, const wl_message *message, wl_argument *args)
+    {
+        Q_UNUSED(target);
+        Q_UNUSED(opcode);
+        auto *recorder = static_cast<EventRecorder *>(const_cast<void *>(implementation));
+        const QByteArray name(message->name);
+        recorder->events.append(name);
+        if (name == "format_table") {
+            close(args[0].h);
+        } else if (name == "tranche_formats") {
+            const auto *indices = static_cast<const uint16_t *>(args[0].a->data);
+            recorder->trancheFormats.append(QVector<uint16_t>(indices, indices + args[0].a->size / sizeof(uint16_t)));
+        }
+        return 0;
+    }
+};
+
+static const QByteArrayList feedbackEvents = {
+    "format_table", "main_device",
+    "tranche_target_device", "tranche_flags", "tranche_formats", "tranche_done",
+    "done"
+};
+
+// Waits until the compositor has handled everything the client sent so far, and the client
+// got the events sent in reply
+static bool syncClient(MockClient *client)
+{
+    bool done = false;
+    static const wl_callback_listener listener = {
+        [](void *data, wl_callback *callback, uint32_t) {
+            *static_cast<bool *>(data) = true;
+            wl_callback_destroy(callback);
+        }
+    };
+    wl_callback_add_listener(wl_display_sync(client->display), &listener, &done);
+    QTest::qWaitFor([&done]() { return done; });
+    return done;
+}
+
+// NV12 sorts first, then ARGB8888 and XRGB8888, so the table is:
+// 0: NV12 linear, 1: ARGB8888 linear, 2: ARGB8888 X-tiled, 3: XRGB8888 implicit
+static QHash<uint32_t, QVector<uint64_t>> syntheticModifiers()
+{
+    QHash<uint32_t, QVector<uint64_t>> modifiers;
+    modifiers.insert(DRM_FORMAT_ARGB8888, { DRM_FORMAT_MOD_LINEAR, I915_FORMAT_MOD_X_TILED });
+    modifiers.insert(DRM_FORMAT_XRGB8888, {});
+    modifiers.insert(DRM_FORMAT_NV12, { DRM_FORMAT_MOD_LINEAR });
+    return modifiers;
+}
+
+static const dev_t syntheticDevice = makedev(226, 128);
+
+// Request opcodes, which only the client side protocol code names
+enum {
+    DmabufGetDefaultFeedback = 2,
+    DmabufGetSurfaceFeedback = 3,
+    FeedbackDestroy = 0
+};
+
+class tst_LinuxDmabuf : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void formatTable();
+    void formatsOnlyForOldClients();
+    void feedbackOnlySentOnChange();
+    void surfaceFeedbackOutlivesSurface();
+    void importCacheSharesImports();
+    void importCacheKeepsRecentlyUnusedImports();
+    void importCacheInvalidatesClient();
+    void importCacheInvalidatesAll();
+    void importCacheFailedImport();
+    void importCacheEmptyKey();
+
+private:
+    QTemporaryDir m_tmpRuntimeDir;
+};
+
+void tst_LinuxDmabuf::init()
+{
+    // The mock client connects to wayland-qt-test-0 in the test's own runtime dir
+    qputenv("XDG_RUNTIME_DIR", m_tmpRuntimeDir.path().toLocal8Bit());
+}
+
+void tst_LinuxDmabuf::formatTable()
+{
+    TestCompositor compositor;
+    compositor.create();
+    LinuxDmabuf linuxDmabuf(compositor.display(), nullptr, syntheticModifiers(), syntheticDevice);
+
+    struct Entry {
+        uint32_t format;
+        uint32_t padding;
+        uint64_t modifier;
+    };
+    const QVector<Entry> expected = {
+        { DRM_FORMAT_NV12, 0, DRM_FORMAT_MOD_LINEAR },
+        { DRM_FORMAT_ARGB8888, 0, DRM_FORMAT_MOD_LINEAR },
+        { DRM_FORMAT_ARGB8888, 0, I915_FORMAT_MOD_X_TILED },
+        { DRM_FORMAT_XRGB8888, 0, DRM_FORMAT_MOD_INVALID },
+    };
+    QVERIFY(linuxDmabuf.formatTableFd() != -1);
+    QCOMPARE(linuxDmabuf.formatTableSize(), uint32_t(expected.size() * sizeof(Entry)));
+    QCOMPARE(linuxDmabuf.mainDevice(), syntheticDevice);
+
+    QVector<Entry> table(expected.size());
+    QCOMPARE(pread(linuxDmabuf.formatTableFd(), table.data(), linuxDmabuf.formatTableSize(), 0),
+             ssize_t(linuxDmabuf.formatTableSize()));
+    for (int i = 0; i < expected.size(); ++i) {
+        QCOMPARE(table.at(i).format, expected.at(i).format);
+        QCOMPARE(table.at(i).modifier, expected.at(i).modifier);
+    }
+
+    // The table is sealed, so clients can map it without fearing it changes
+    QCOMPARE(pwrite(linuxDmabuf.formatTableFd(), table.constData(), sizeof(Entry), 0), ssize_t(-1));
+
+    auto indices = [&linuxDmabuf](const QHash<uint32_t, QVector<uint64_t>> &modifiers) {
+        LinuxDmabufTranche tranche;
+        tranche.modifiers = modifiers;
+        const QByteArray encoded = linuxDmabuf.formatIndices(tranche);
+        const auto *data = reinterpret_cast<const uint16_t *>(encoded.constData());
+        return QVector<uint16_t>(data, data + encoded.size() / int(sizeof(uint16_t)));
+    };
+    QCOMPARE(indices(syntheticModifiers()), QVector<uint16_t>({ 0, 1, 2, 3 }));
+    QCOMPARE(indices({ { DRM_FORMAT_ARGB8888, { I915_FORMAT_MOD_X_TILED } } }), QVector<uint16_t>({ 2 }));
+    QCOMPARE(indices({ { DRM_FORMAT_XRGB8888, {} }, { DRM_FORMAT_NV12, { DRM_FORMAT_MOD_LINEAR } } }),
+             QVector<uint16_t>({ 0, 3 }));
+    // Pairs that are not in the table are left out
+    QCOMPARE(indices({ { DRM_FORMAT_ARGB8888, { I915_FORMAT_MOD_Y_TILED } } }), QVector<uint16_t>());
+    QCOMPARE(indices({ { DRM_FORMAT_RGB565, {} } }), QVector<uint16_t>());
+}
+
+void tst_LinuxDmabuf::formatsOnlyForOldClients()
+{
+    TestCompositor compositor;
+    compositor.create();
+    LinuxDmabuf linuxDmabuf(compositor.display(), nullptr, syntheticModifiers(), syntheticDevice);
+
+    MockClient client;
+    QTRY_VERIFY(client.globals.contains("zwp_linux_dmabuf_v1"));
+    const uint id = client.globals.value("zwp_linux_dmabuf_v1");
+
+    EventRecorder v3;
+    v3.listen(wl_registry_bind(client.registry, id, &zwp_linux_dmabuf_v1_interface, 3));
+    EventRecorder v4;
+    v4.listen(wl_registry_bind(client.registry, id, &zwp_linux_dmabuf_v1_interface, 4));
+    QVERIFY(syncClient(&client));
+
+    // One modifier event for each pair in the table
+    QCOMPARE(v3.events, QByteArrayList({ "modifier", "modifier", "modifier", "modifier" }));
+    // Version 4 clients ask for feedback instead
+    QVERIFY(v4.events.isEmpty());
+}
+
+void tst_LinuxDmabuf::feedbackOnlySentOnChange()
+{
+    TestCompositor compositor;
+    compositor.create();
+    LinuxDmabuf linuxDmabuf(compositor.display(), nullptr, syntheticModifiers(), syntheticDevice);
+
+    MockClient client;
+    QTRY_VERIFY(client.globals.contains("zwp_linux_dmabuf_v1"));
+    auto *dmabuf = static_cast<wl_proxy *>(wl_registry_bind(client.registry, client.globals.value("zwp_linux_dmabuf_v1"),
+                                                           &zwp_linux_dmabuf_v1_interface, 4));
+
+    EventRecorder feedback;
+    feedback.listen(wl_proxy_marshal_constructor(dmabuf, DmabufGetDefaultFeedback,
+                                                 &zwp_linux_dmabuf_feedback_v1_interface, nullptr));
+    QVERIFY(syncClient(&client));
+
+    // Everything in a single tranche by default
+    QCOMPARE(feedback.events, feedbackEvents);
+    QCOMPARE(feedback.trancheFormats, QVector<QVector<uint16_t>>({ { 0, 1, 2, 3 } }));
+
+    // The same tranches, spelled out, don't change anything
+    LinuxDmabufTranche everything;
+    everything.modifiers = syntheticModifiers();
+    linuxDmabuf.setDefaultFeedback({ everything });
+    QVERIFY(syncClient(&client));
+    QCOMPARE(feedback.events.size(), feedbackEvents.size());
+
+    // Preferring scanout capable buffers does
+    LinuxDmabufTranche scanout;
+    scanout.scanout = true;
+    scanout.modifiers.insert(DRM_FORMAT_XRGB8888, {});
+    linuxDmabuf.setDefaultFeedback({ scanout, everything });
+    QVERIFY(syncClient(&client));
+    const QByteArrayList resent = feedback.events.mid(feedbackEvents.size());
+    QCOMPARE(resent.count("tranche_done"), 2);
+    QCOMPARE(resent.last(), QByteArray("done"));
+    QCOMPARE(feedback.trancheFormats.mid(1), QVector<QVector<uint16_t>>({ { 3 }, { 0, 1, 2, 3 } }));
+
+    // Tranches with nothing in the table are left out
+    const int eventCount = feedback.events.size();
+    LinuxDmabufTranche unknown;
+    unknown.modifiers.insert(DRM_FORMAT_RGB565, {});
+    linuxDmabuf.setDefaultFeedback({ unknown, scanout, everything });
+    QVERIFY(syncClient(&client));
+    QCOMPARE(feedback.events.size(), eventCount);
+}
+
+void tst_LinuxDmabuf::surfaceFeedbackOutlivesSurface()
+{
+    TestCompositor compositor;
+    compositor.create();
+    LinuxDmabuf linuxDmabuf(compositor.display(), nullptr, syntheticModifiers(), syntheticDevice);
+
+    MockClient client;
+    QTRY_VERIFY(client.globals.contains("zwp_linux_dmabuf_v1"));
+    auto *dmabuf = static_cast<wl_proxy *>(wl_registry_bind(client.registry, client.globals.value("zwp_linux_dmabuf_v1"),
+                                                           &zwp_linux_dmabuf_v1_interface, 4));
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QPointer<QWaylandSurface> waylandSurface = compositor.surfaces.at(0);
+
+    EventRecorder feedback;
+    auto *feedbackProxy = wl_proxy_marshal_constructor(dmabuf, DmabufGetSurfaceFeedback,
+                                                       &zwp_linux_dmabuf_feedback_v1_interface, nullptr, surface);
+    feedback.listen(feedbackProxy);
+    QVERIFY(syncClient(&client));
+    QCOMPARE(feedback.events, feedbackEvents);
+
+    LinuxDmabufTranche scanout;
+    scanout.scanout = true;
+    scanout.modifiers.insert(DRM_FORMAT_XRGB8888, {});
+    linuxDmabuf.setSurfaceFeedback(waylandSurface, { scanout });
+    QVERIFY(syncClient(&client));
+    QCOMPARE(feedback.events.size(), feedbackEvents.size() * 2);
+    QCOMPARE(feedback.trancheFormats.last(), QVector<uint16_t>({ 3 }));
+
+    // Back to following the default feedback
+    linuxDmabuf.setSurfaceFeedback(waylandSurface, {});
+    QVERIFY(syncClient(&client));
+    QCOMPARE(feedback.events.size(), feedbackEvents.size() * 3);
+    QCOMPARE(feedback.trancheFormats.last(), QVector<uint16_t>({ 0, 1, 2, 3 }));
+
+    // Once the surface is gone, the feedback object stays quiet
+    wl_surface_destroy(surface);
+    QTRY_VERIFY(!waylandSurface);
+    LinuxDmabufTranche linear;
+    linear.modifiers.insert(DRM_FORMAT_ARGB8888, { DRM_FORMAT_MOD_LINEAR });
+    linuxDmabuf.setDefaultFeedback({ linear });
+    QVERIFY(syncClient(&client));
+    QCOMPARE(feedback.events.size(), feedbackEvents.size() * 3);
+
+    // And can still be destroyed
+    wl_proxy_marshal(feedbackProxy, FeedbackDestroy);
+    wl_proxy_destroy(feedbackProxy);
+    QVERIFY(syncClient(&client));
+    QCOMPARE(client.error, 0);
+}
+
+void tst_LinuxDmabuf::importCacheSharesImports()
+{
+    FakeImports fake;
+    LinuxDmabufImportCache cache(fake.releaseFunction());
+
+    // Two wl_buffers for the same dmabuf share the import
+    LinuxDmabufImport *first = cache.acquire(importKey(1), fakeClient(1), fake.importFunction());
+    LinuxDmabufImport *second = cache.acquire(importKey(1), fakeClient(1), fake.importFunction());
+    QVERIFY(first);
+    QCOMPARE(second, first);
+    QCOMPARE(fake.imported, 1);
+    QCOMPARE(cache.count(), 1);
+
+    // It outlives them, and is found again by a new wl_buffer
+    cache.release(first);
+    cache.release(second);
+    QCOMPARE(cache.unusedCount(), 1);
+    QVERIFY(fake.released.isEmpty());
+
+    LinuxDmabufImport *third = cache.acquire(importKey(1), fakeClient(1), fake.importFunction());
+    QCOMPARE(third, first);
+    QCOMPARE(fake.imported, 1);
+    QCOMPARE(cache.unusedCount(), 0);
+
+    // Other memory gets its own import
+    LinuxDmabufImport *other = cache.acquire(importKey(2), fakeClient(1), fake.importFunction());
+    QVERIFY(other != first);
+    QCOMPARE(fake.imported, 2);
+
+    cache.release(third);
+    cache.release(other);
+    QCOMPARE(cache.count(), 2);
+}
+
+void tst_LinuxDmabuf::importCacheKeepsRecentlyUnusedImports()
+{
+    FakeImports fake;
+    LinuxDmabufImportCache cache(fake.releaseFunction(), 2);
+    QCOMPARE(cache.maxUnusedImports(), 2);
+
+    LinuxDmabufImport *imports[3];
+    for (int i = 0; i < 3; ++i)
+        imports[i] = cache.acquire(importKey(ino_t(i + 1)), fakeClient(1), fake.importFunction());
+
+    // Used imports are never dropped
+    cache.setMaxUnusedImports(0);
+    QVERIFY(fake.released.isEmpty());
+    cache.setMaxUnusedImports(2);
+
+    // The least recently released one goes first
+    cache.release(imports[1]);
+    cache.release(imports[0]);
+    cache.release(imports[2]);
+    QCOMPARE(cache.unusedCount(), 2);
+    QCOMPARE(fake.released, QVector<int>({ 2 }));
+
+    // Using an import again makes it the most recent one
+    LinuxDmabufImport *reused = cache.acquire(importKey(1), fakeClient(1), fake.importFunction());
+    QCOMPARE(FakeImports::number(reused), 1);
+    cache.release(reused);
+    cache.setMaxUnusedImports(1);
+    QCOMPARE(fake.released, QVector<int>({ 2, 3 }));
+    QCOMPARE(cache.count(), 1);
+
+    cache.setMaxUnusedImports(0);
+    QCOMPARE(fake.released, QVector<int>({ 2, 3, 1 }));
+    QCOMPARE(cache.count(), 0);
+    QCOMPARE(cache.unusedCount(), 0);
+}
+
+void tst_LinuxDmabuf::importCacheInvalidatesClient()
+{
+    FakeImports fake;
+    LinuxDmabufImportCache cache(fake.releaseFunction());
+
+    LinuxDmabufImport *used = cache.acquire(importKey(1), fakeClient(1), fake.importFunction());
+    LinuxDmabufImport *unused = cache.acquire(importKey(2), fakeClient(1), fake.importFunction());
+    LinuxDmabufImport *otherClient = cache.acquire(importKey(3), fakeClient(2), fake.importFunction());
+    cache.release(unused);
+    cache.release(otherClient);
+
+    // Unused imports of the client go right away, the used one stays until released
+    cache.invalidate(fakeClient(1));
+    QCOMPARE(fake.released, QVector<int>({ 2 }));
+    QCOMPARE(cache.count(), 2);
+    QCOMPARE(cache.unusedCount(), 1);
+
+    // But it is no longer shared
+    LinuxDmabufImport *fresh = cache.acquire(importKey(1), fakeClient(1), fake.importFunction());
+    QVERIFY(fresh != used);
+    QCOMPARE(FakeImports::number(fresh), 4);
+
+    cache.release(used);
+    QCOMPARE(fake.released, QVector<int>({ 2, 1 }));
+    QCOMPARE(cache.unusedCount(), 1);
+
+    // The other client is not affected
+    LinuxDmabufImport *kept = cache.acquire(importKey(3), fakeClient(2), fake.importFunction());
+    QCOMPARE(kept, otherClient);
+    cache.release(kept);
+    cache.release(fresh);
+    QCOMPARE(cache.unusedCount(), 2);
+}
+
+void tst_LinuxDmabuf::importCacheInvalidatesAll()
+{
+    FakeImports fake;
+    {
+        LinuxDmabufImportCache cache(fake.releaseFunction());
+        LinuxDmabufImport *used = cache.acquire(importKey(1), fakeClient(1), fake.importFunction());
+        cache.release(cache.acquire(importKey(2), fakeClient(2), fake.importFunction()));
+
+        cache.invalidate();
+        QCOMPARE(fake.released, QVector<int>({ 2 }));
+        QCOMPARE(cache.count(), 1);
+        QCOMPARE(cache.unusedCount(), 0);
+
+        cache.release(used);
+        QCOMPARE(fake.released, QVector<int>({ 2, 1 }));
+        QCOMPARE(cache.count(), 0);
+
+        cache.acquire(importKey(3), fakeClient(1), fake.importFunction());
+    }
+
+    // Whatever is left goes with the cache
+    QCOMPARE(fake.released, QVector<int>({ 2, 1, 3 }));
+}
+
+void tst_LinuxDmabuf::importCacheFailedImport()
+{
+    FakeImports fake;
+    LinuxDmabufImportCache cache(fake.releaseFunction());
+
+    // What a failed import made is released, and nothing is cached
+    QVERIFY(!cache.acquire(importKey(1), fakeClient(1), fake.importFunction(false)));
+    QCOMPARE(fake.released, QVector<int>({ 1 }));
+    QCOMPARE(cache.count(), 0);
+    QCOMPARE(cache.unusedCount(), 0);
+
+    // So the next attempt imports again
+    LinuxDmabufImport *import = cache.acquire(importKey(1), fakeClient(1), fake.importFunction());
+    QVERIFY(import);
+    QCOMPARE(FakeImports::number(import), 2);
+    cache.release(import);
+    QCOMPARE(cache.unusedCount(), 1);
+}
+
+void tst_LinuxDmabuf::importCacheEmptyKey()
+{
+    FakeImports fake;
+    LinuxDmabufImportCache cache(fake.releaseFunction());
+
+    // Without planes there is nothing to tell the imports apart, so they aren't shared
+    const LinuxDmabufImportKey key;
+    LinuxDmabufImport *first = cache.acquire(key, fakeClient(1), fake.importFunction());
+    LinuxDmabufImport *second = cache.acquire(key, fakeClient(1), fake.importFunction());
+    QVERIFY(first != second);
+    QCOMPARE(fake.imported, 2);
+
+    // Nor kept once unused
+    cache.release(first);
+    QCOMPARE(fake.released, QVector<int>({ 1 }));
+    cache.release(second);
+    QCOMPARE(fake.released, QVector<int>({ 1, 2 }));
+    QCOMPARE(cache.count(), 0);
+    QCOMPARE(cache.unusedCount(), 0);
+}
+
+#include <tst_linuxdmabuf.moc>
+QTEST_MAIN(tst_LinuxDmabuf);
@@ -0,0 +1,15 @@
+CONFIG += testcase link_pkgconfig
+CONFIG += wayland-scanner
+TARGET = tst_texturesharing
+
+QT += testlib quick
+
+# The mock client and test compositor of the compositor autotest
+include(../compositor/compositor.pri)
+
+WAYLANDCLIENTSOURCES += \
+    ../../../../src/extensions/server-buffer-extension.xml \
+    ../../../../src/extensions/qt-texture-sharing-unstable-v1.xml
+
+SOURCES += \
+    tst_texturesharing.cpp
@@ -0,0 +1,650 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "mockclient.h"
+#include "testcompositor.h"
+#include "wayland-qt-texture-sharing-unstable-v1-client-protocol.h"
+
+#include <QtWaylandCompositor/private/qwaylandcompositor_p.h>
+#include <QtWaylandCompositor/private/qwlserverbufferintegration_p.h>
+#include <QtWaylandCompositor/private/qwltexturesharingextension_p.h>
+#include <QtCore/QDir>
+#include <QtGui/QImage>
+#include <QtTest/QtTest>
+
+class FakeServerBufferIntegration;
+
+class FakeServerBuffer : public QtWayland::ServerBuffer
+{
+public:
+    FakeServerBuffer(FakeServerBufferIntegration *integration, const QSize &size, qint64 byteCount);
+    ~FakeServerBuffer() override;
+
+    // The extension warns and sends nothing, as the client has no object for the buffer
+    struct ::wl_resource *resourceForClient(struct ::wl_client *) override
+    {
+        ++provided;
+        return nullptr;
+    }
+    bool bufferInUse() override { return inUse; }
+    QOpenGLTexture *toOpenGlTexture() override { return nullptr; }
+
+    FakeServerBufferIntegration *integration = nullptr;
+    qint64 byteCount = 0;
+    int provided = 0;
+    bool inUse = false;
+};
+
+class FakeServerBufferIntegration : public QtWayland::ServerBufferIntegration
+{
+public:
+    bool supportsFormat(QtWayland::ServerBuffer::Format) const override { return true; }
+
+    QtWayland::ServerBuffer *createServerBufferFromImage(const QImage &image, QtWayland::ServerBuffer::Format) override
+    {
+        return new FakeServerBuffer(this, image.size(), image.sizeInBytes());
+    }
+
+    QtWayland::ServerBuffer *createServerBufferFromData(const QByteArray &data, const QSize &size, uint) override
+    {
+        return new FakeServerBuffer(this, size, data.size());
+    }
+
+    // The live buffer of byteCount bytes, if any
+    FakeServerBuffer *buffer(qint64 byteCount) const
+    {
+        for (FakeServerBuffer *buffer : buffers) {
+            if (buffer->byteCount == byteCount)
+                return buffer;
+        }
+        return nullptr;
+    }
+
+    QVector<FakeServerBuffer *> buffers;
+    int created = 0;
+};
+
+FakeServerBuffer::FakeServerBuffer(FakeServerBufferIntegration *integration, const QSize &size, qint64 byteCount)
+    : QtWayland::ServerBuffer(size, QtWayland::ServerBuffer::RGBA32)
+    , integration(integration)
+    , byteCount(byteCount)
+{
+    integration->buffers.append(this);
+    ++integration->created;
+}
+
+FakeServerBuffer::~FakeServerBuffer()
+{
+    integration->buffers.removeOne(this);
+}
+
+// QWaylandCompositorPrivate only lets subclasses replace the server buffer integration
+struct CompositorPrivateAccess : QWaylandCompositorPrivate
+{
+    using QWaylandCompositorPrivate::server_buffer_integration;
+};
+
+static FakeServerBufferIntegration *installFakeIntegration(QWaylandCompositor *compositor)
+{
+    auto *integration = new FakeServerBufferIntegration;
+    auto member = &CompositorPrivateAccess::server_buffer_integration;
+    (QWaylandCompositorPrivate::get(compositor)->*member).reset(integration);
+    return integration;
+}
+
+class TestTextureSharingExtension : public QWaylandTextureSharingExtension
+{
+public:
+    using QWaylandTextureSharingExtension::QWaylandTextureSharingExtension;
+    using QWaylandTextureSharingExtension::cleanupBuffers;
+
+protected:
+    // "kb/<n>" is <n> KiB of texture data, which is made right away instead of decoded
+    bool customPixelData(const QString &key, QByteArray *data, QSize *size, uint *glInternalFormat) override
+    {
+        if (!key.startsWith(QLatin1String("kb/")))
+            return false;
+        const int kb = key.mid(3).toInt();
+        *data = QByteArray(kb * 1024, '\0');
+        *size = QSize(32, 32 * kb);
+        *glInternalFormat = GL_RGBA;
+        return true;
+    }
+};
+
+class TextureSharingClient
+{
+public:
+    explicit TextureSharingClient(MockClient *client)
+    {
+        sharing = static_cast<zqt_texture_sharing_v1 *>(
+                wl_registry_bind(client->registry, client->globals.value("zqt_texture_sharing_v1"),
+                                 &zqt_texture_sharing_v1_interface, 2));
+        zqt_texture_sharing_v1_add_listener(sharing, &listener, this);
+    }
+
+    ~TextureSharingClient()
+    {
+        zqt_texture_sharing_v1_destroy(sharing);
+    }
+
+    void requestImage(const char *key) { zqt_texture_sharing_v1_request_image(sharing, key); }
+    void abandonImage(const char *key) { zqt_texture_sharing_v1_abandon_image(sharing, key); }
+
+    // keys holds NUL-terminated keys, as sent by the texture sharing import
+    void requestImages(const QByteArray &keys)
+    {
+        wl_array array;
+        wl_array_init(&array);
+        memcpy(wl_array_add(&array, size_t(keys.size())), keys.constData(), size_t(keys.size()));
+        zqt_texture_sharing_v1_request_images(sharing, &array);
+        wl_array_release(&array);
+    }
+
+    zqt_texture_sharing_v1 *sharing = nullptr;
+    QStringList failedImages;
+
+private:
+    static const zqt_texture_sharing_v1_listener listener;
+};
+
+const zqt_texture_sharing_v1_listener TextureSharingClient::listener = {
+    [](void *data, zqt_texture_sharing_v1 *, const char *key, const char *) {
+        static_cast<TextureSharingClient *>(data)->failedImages.append(QString::fromUtf8(key));
+    },
+    [](void *, zqt_texture_sharing_v1 *, qt_server_buffer *, const char *) {
+    }
+};
+
+static void expectProvided(int count = 1)
+{
+    for (int i = 0; i < count; ++i)
+        QTest::ignoreMessage(QtWarningMsg, "QWaylandTextureSharingExtension: no buffer resource for client");
+}
+
+class tst_TextureSharing : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void prefetchedImagesAreKeptUntilRequested();
+    void cacheBudgetEvictsLeastRecentlyUsed();
+    void pinnedAndLocallyUsedImagesAreKept();
+    void pendingRequestsShareOneDecode();
+    void batchedRequestImages();
+    void cacheRoundTrip();
+    void cacheRejectsInvalidFiles();
+    void cachePruneKeepsRecentlyUsed();
+    void cacheDirectoryLimit();
+
+private:
+    QTemporaryDir m_tmpRuntimeDir;
+};
+
+void tst_TextureSharing::init()
+{
+    // The mock client connects to wayland-qt-test-0 in the test's own runtime dir
+    qputenv("XDG_RUNTIME_DIR", m_tmpRuntimeDir.path().toLocal8Bit());
+}
+
+void tst_TextureSharing::prefetchedImagesAreKeptUntilRequested()
+{
+    TestCompositor compositor;
+    compositor.create();
+    FakeServerBufferIntegration *integration = installFakeIntegration(&compositor);
+    TestTextureSharingExtension extension(&compositor);
+    QCOMPARE(extension.cacheBudget(), qint64(0));
+    extension.setPrefetchImages({ QStringLiteral("kb/1"), QStringLiteral("kb/2") });
+
+    QTRY_VERIFY(extension.isInitialized());
+    QCOMPARE(integration->created, 2);
+    QCOMPARE(extension.cacheSize(), qint64(3 * 1024));
+
+    // Nobody uses them, but they aren't evicted before they are requested
+    QTest::qWait(200);
+    extension.cleanupBuffers();
+    QCOMPARE(extension.cacheSize(), qint64(3 * 1024));
+
+    extension.prefetch({ QStringLiteral("kb/4") });
+    extension.cleanupBuffers();
+    QCOMPARE(extension.cacheSize(), qint64(7 * 1024));
+
+    MockClient client;
+    QTRY_VERIFY(client.globals.contains("zqt_texture_sharing_v1"));
+    TextureSharingClient sharing(&client);
+
+    // Requesting one hands out the prefetched buffer, which is cached like any other from then on
+    expectProvided();
+    sharing.requestImage("kb/1");
+    QTRY_COMPARE(integration->buffer(1024)->provided, 1);
+    QCOMPARE(integration->created, 3);
+    extension.cleanupBuffers();
+    QCOMPARE(extension.cacheSize(), qint64(6 * 1024));
+    QVERIFY(!integration->buffer(1024));
+
+    // As are the ones no longer listed
+    extension.setPrefetchImages({});
+    QTRY_COMPARE(extension.cacheSize(), qint64(4 * 1024));
+    QVERIFY(integration->buffer(4096));
+}
+
+void tst_TextureSharing::cacheBudgetEvictsLeastRecentlyUsed()
+{
+    TestCompositor compositor;
+    compositor.create();
+    FakeServerBufferIntegration *integration = installFakeIntegration(&compositor);
+    TestTextureSharingExtension extension(&compositor);
+    extension.setCacheBudget(64 * 1024);
+    QTRY_VERIFY(extension.isInitialized());
+
+    MockClient client;
+    QTRY_VERIFY(client.globals.contains("zqt_texture_sharing_v1"));
+    TextureSharingClient sharing(&client);
+
+    expectProvided(3);
+    sharing.requestImage("kb/1");
+    sharing.requestImage("kb/2");
+    sharing.requestImage("kb/4");
+    QTRY_COMPARE(integration->created, 3);
+    QCOMPARE(extension.cacheSize(), qint64(7 * 1024));
+
+    // Requesting kb/1 again leaves kb/2 the least recently used
+    expectProvided();
+    sharing.requestImage("kb/1");
+    QTRY_COMPARE(integration->buffer(1024)->provided, 2);
+    QCOMPARE(integration->created, 3);
+
+    extension.setCacheBudget(5 * 1024);
+    QTRY_COMPARE(extension.cacheSize(), qint64(5 * 1024));
+    QVERIFY(!integration->buffer(2048));
+    QVERIFY(integration->buffer(1024));
+    QVERIFY(integration->buffer(4096));
+
+    // Buffers a client still uses are kept whatever the budget
+    integration->buffer(4096)->inUse = true;
+    extension.setCacheBudget(0);
+    QTRY_COMPARE(extension.cacheSize(), qint64(4 * 1024));
+    QVERIFY(!integration->buffer(1024));
+
+    // Until the client abandons them
+    integration->buffer(4096)->inUse = false;
+    sharing.abandonImage("kb/4");
+    QTRY_COMPARE(extension.cacheSize(), qint64(0));
+    QVERIFY(integration->buffers.isEmpty());
+
+    // Evicted images are made again when requested
+    expectProvided();
+    sharing.requestImage("kb/2");
+    QTRY_COMPARE(integration->created, 4);
+}
+
+void tst_TextureSharing::pinnedAndLocallyUsedImagesAreKept()
+{
+    TestCompositor compositor;
+    compositor.create();
+    FakeServerBufferIntegration *integration = installFakeIntegration(&compositor);
+    TestTextureSharingExtension extension(&compositor);
+    extension.setPinnedImages({ QStringLiteral("kb/2") });
+    QTRY_VERIFY(extension.isInitialized());
+
+    MockClient client;
+    QTRY_VERIFY(client.globals.contains("zqt_texture_sharing_v1"));
+    TextureSharingClient sharing(&client);
+
+    expectProvided(2);
+    sharing.requestImage("kb/1");
+    sharing.requestImage("kb/2");
+    QTRY_COMPARE(integration->created, 2);
+
+    // The compositor's own requests are answered right away for images made synchronously
+    QStringList results;
+    connect(&extension, &QWaylandTextureSharingExtension::bufferResult, this,
+            [&results](const QString &key, QtWayland::ServerBuffer *buffer) {
+        if (buffer)
+            results.append(key);
+    });
+    extension.requestBuffer(QStringLiteral("kb/4"));
+    QCOMPARE(results, QStringList { QStringLiteral("kb/4") });
+
+    extension.cleanupBuffers();
+    QCOMPARE(extension.cacheSize(), qint64(6 * 1024));
+    QVERIFY(!integration->buffer(1024));
+
+    extension.setPinnedImages({});
+    QTRY_COMPARE(extension.cacheSize(), qint64(4 * 1024));
+    QVERIFY(integration->buffer(4096));
+}
+
+void tst_TextureSharing::pendingRequestsShareOneDecode()
+{
+    QTemporaryDir imageDir;
+    QVERIFY(imageDir.isValid());
+    QImage red(8, 8, QImage::Format_RGBA8888_Premultiplied);
+    red.fill(Qt::red);
+    QVERIFY(red.save(imageDir.filePath(QStringLiteral("red.png"))));
+    QImage blue(16, 16, QImage::Format_RGBA8888_Premultiplied);
+    blue.fill(Qt::blue);
+    QVERIFY(blue.save(imageDir.filePath(QStringLiteral("blue.png"))));
+    QImage green(4, 4, QImage::Format_RGBA8888_Premultiplied);
+    green.fill(Qt::green);
+    QVERIFY(green.save(imageDir.filePath(QStringLiteral("green.png"))));
+
+    TestCompositor compositor;
+    compositor.create();
+    FakeServerBufferIntegration *integration = installFakeIntegration(&compositor);
+    TestTextureSharingExtension extension(&compositor);
+    extension.setImageSearchPath(imageDir.path());
+    extension.setCacheBudget(1024 * 1024);
+    QTRY_VERIFY(extension.isInitialized());
+
+    QVector<QPair<QString, QtWayland::ServerBuffer *>> results;
+    connect(&extension, &QWaylandTextureSharingExtension::bufferResult, this,
+            [&results](const QString &key, QtWayland::ServerBuffer *buffer) {
+        results.append(qMakePair(key, buffer));
+    });
+
+    // Local requests made while the image is decoded get one result
+    extension.requestBuffer(QStringLiteral("red"));
+    extension.requestBuffer(QStringLiteral("red"));
+    QVERIFY(results.isEmpty());
+    QTRY_COMPARE(results.size(), 1);
+    QCOMPARE(results.first().first, QStringLiteral("red"));
+    QVERIFY(results.first().second);
+    QCOMPARE(integration->created, 1);
+
+    // Requests of a client arriving together wait for the same decode
+    MockClient client;
+    QTRY_VERIFY(client.globals.contains("zqt_texture_sharing_v1"));
+    TextureSharingClient sharing(&client);
+    expectProvided(2);
+    sharing.requestImage("blue");
+    sharing.requestImage("blue");
+    QTRY_VERIFY(integration->buffer(16 * 16 * 4) && integration->buffer(16 * 16 * 4)->provided == 2);
+    QCOMPARE(integration->created, 2);
+
+    // Once decoded, the image is shared right away
+    extension.requestBuffer(QStringLiteral("red"));
+    QCOMPARE(results.size(), 2);
+    QCOMPARE(results.last().second, results.first().second);
+
+    // Every request for an image that doesn't exist fails
+    sharing.requestImage("missing");
+    sharing.requestImage("missing");
+    QTRY_COMPARE(sharing.failedImages, QStringList({ QStringLiteral("missing"), QStringLiteral("missing") }));
+    extension.requestBuffer(QStringLiteral("missing"));
+    QTRY_COMPARE(results.size(), 3);
+    QCOMPARE(results.last().first, QStringLiteral("missing"));
+    QCOMPARE(results.last().second, nullptr);
+    QCOMPARE(integration->created, 2);
+
+    // A client disconnecting while its image is decoded is forgotten, and the buffer cached as usual
+    {
+        MockClient leaving;
+        QTRY_VERIFY(leaving.globals.contains("zqt_texture_sharing_v1"));
+        TextureSharingClient leavingSharing(&leaving);
+        leavingSharing.requestImage("green");
+        wl_display_flush(leaving.display);
+    }
+    QTRY_COMPARE(integration->created, 3);
+    QCOMPARE(extension.cacheSize(), qint64((8 * 8 + 16 * 16 + 4 * 4) * 4));
+
+    // Only the image the compositor uses itself is left without a budget
+    extension.setCacheBudget(0);
+    QTRY_COMPARE(extension.cacheSize(), qint64(8 * 8 * 4));
+    QCOMPARE(integration->buffers.size(), 1);
+}
+
+// contents with the header field at offset replaced by value
+template <typename T>
+static QByteArray withField(const QByteArray &contents, int offset, T value)
+{
+    QByteArray result = contents;
+    memcpy(result.data() + offset, &value, sizeof(value));
+    return result;
+}
+
+static bool setModificationTime(const QString &fileName, const QDateTime &time)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) && file.setFileTime(time, QFileDevice::FileModificationTime);
+}
+
+void tst_TextureSharing::batchedRequestImages()
+{
+    TestCompositor compositor;
+    compositor.create();
+    FakeServerBufferIntegration *integration = installFakeIntegration(&compositor);
+    TestTextureSharingExtension extension(&compositor);
+    extension.setCacheBudget(1024 * 1024);
+    QTRY_VERIFY(extension.isInitialized());
+
+    MockClient client;
+    QTRY_VERIFY(client.globals.contains("zqt_texture_sharing_v1"));
+    TextureSharingClient sharing(&client);
+
+    // Each key of one request_images is handled like a request_image, empty ones are skipped
+    expectProvided(4);
+    sharing.requestImages(QByteArray("kb/1\0kb/2\0\0kb/4\0kb/1\0", 21));
+    QTRY_VERIFY(integration->buffer(1024) && integration->buffer(1024)->provided == 2);
+    QTRY_VERIFY(integration->buffer(2048) && integration->buffer(2048)->provided == 1);
+    QTRY_VERIFY(integration->buffer(4096) && integration->buffer(4096)->provided == 1);
+    QCOMPARE(integration->created, 3);
+    QVERIFY(sharing.failedImages.isEmpty());
+}
+
+void tst_TextureSharing::cacheRoundTrip()
+{
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+
+    SharedTextureData image;
+    image.image = QImage(5, 3, QImage::Format_RGBA8888_Premultiplied);
+    for (int y = 0; y < image.image.height(); ++y) {
+        for (int x = 0; x < image.image.width(); ++x)
+            image.image.setPixel(x, y, qRgba(x * 50, y * 100, 255, 255));
+    }
+    const QString imagePath = cacheDir.filePath(QStringLiteral("image.qwltex"));
+    QVERIFY(SharedTextureCache::write(imagePath, image));
+
+    // The pixels are mapped from the file, aligned after the header
+    SharedTextureData readImage;
+    QVERIFY(SharedTextureCache::read(imagePath, &readImage));
+    QCOMPARE(readImage.image, image.image);
+    QCOMPARE(readImage.image.format(), QImage::Format_RGBA8888_Premultiplied);
+    QVERIFY(readImage.pixelData.isEmpty());
+    QVERIFY(readImage.mappedFile);
+    QCOMPARE(readImage.fileOffset, qint64(64));
+
+    SharedTextureData compressed;
+    compressed.pixelData = QByteArray("0123456789abcdef").repeated(4);
+    compressed.size = QSize(8, 8);
+    compressed.glInternalFormat = 0x83f0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    const QString compressedPath = cacheDir.filePath(QStringLiteral("compressed.qwltex"));
+    QVERIFY(SharedTextureCache::write(compressedPath, compressed));
+
+    SharedTextureData readCompressed;
+    QVERIFY(SharedTextureCache::read(compressedPath, &readCompressed));
+    QCOMPARE(readCompressed.pixelData, compressed.pixelData);
+    QCOMPARE(readCompressed.size, compressed.size);
+    QCOMPARE(readCompressed.glInternalFormat, compressed.glInternalFormat);
+    QVERIFY(readCompressed.image.isNull());
+
+    // Images that failed to decode aren't cached
+    const QString emptyPath = cacheDir.filePath(QStringLiteral("empty.qwltex"));
+    QVERIFY(!SharedTextureCache::write(emptyPath, SharedTextureData()));
+    QVERIFY(!QFile::exists(emptyPath));
+}
+
+void tst_TextureSharing::cacheRejectsInvalidFiles()
+{
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+
+    SharedTextureData image;
+    image.image = QImage(4, 4, QImage::Format_RGBA8888_Premultiplied);
+    image.image.fill(Qt::red);
+    const QString validPath = cacheDir.filePath(QStringLiteral("valid.qwltex"));
+    QVERIFY(SharedTextureCache::write(validPath, image));
+    QFile validFile(validPath);
+    QVERIFY(validFile.open(QIODevice::ReadOnly));
+    const QByteArray valid = validFile.readAll();
+    QCOMPARE(valid.size(), 64 + 4 * 4 * 4);
+
+    // Offsets into the header
+    const int versionOffset = 8;
+    const int heightOffset = 20;
+    const int dataLengthOffset = 40;
+
+    const QVector<QPair<QByteArray, QByteArray>> invalidFiles = {
+        { "truncated header", valid.left(20) },
+        { "empty", QByteArray() },
+        { "wrong magic", QByteArray("XWLTEXC").append('\0') + valid.mid(8) },
+        { "other version", withField(valid, versionOffset, quint32(2)) },
+        { "truncated pixels", valid.left(valid.size() - 1) },
+        { "data beyond the file", withField(valid, dataLengthOffset, quint64(1) << 40) },
+    };
+    for (const auto &invalid : invalidFiles) {
+        const QString path = cacheDir.filePath(QString::fromLatin1(invalid.first) + QLatin1String(".qwltex"));
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(invalid.second);
+        file.close();
+
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression(QStringLiteral("ignoring invalid cache file")));
+        SharedTextureData data;
+        QVERIFY2(!SharedTextureCache::read(path, &data), invalid.first.constData());
+        QVERIFY(data.image.isNull());
+        QVERIFY(!data.mappedFile);
+    }
+
+    // A header that doesn't describe its pixels is rejected as well
+    const QString inconsistentPath = cacheDir.filePath(QStringLiteral("inconsistent.qwltex"));
+    QFile inconsistent(inconsistentPath);
+    QVERIFY(inconsistent.open(QIODevice::WriteOnly));
+    inconsistent.write(withField(valid, heightOffset, quint32(3)));
+    inconsistent.close();
+    SharedTextureData data;
+    QVERIFY(!SharedTextureCache::read(inconsistentPath, &data));
+    QVERIFY(!SharedTextureCache::read(cacheDir.filePath(QStringLiteral("missing.qwltex")), &data));
+
+    // The valid file is still read
+    QVERIFY(SharedTextureCache::read(validPath, &data));
+    QCOMPARE(data.image, image.image);
+}
+
+void tst_TextureSharing::cachePruneKeepsRecentlyUsed()
+{
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+
+    SharedTextureData data;
+    data.pixelData = QByteArray(1000, 'x');
+    data.size = QSize(1, 1);
+    const qint64 fileSize = 64 + 1000;
+
+    // Files 0 to 3, from the oldest to the newest
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    for (int i = 0; i < 4; ++i) {
+        const QString path = cacheDir.filePath(QStringLiteral("%1.qwltex").arg(i));
+        QVERIFY(SharedTextureCache::write(path, data));
+        QVERIFY(setModificationTime(path, now.addSecs(-100 + 10 * i)));
+    }
+
+    // Other files in the directory are left alone
+    const QString otherPath = cacheDir.filePath(QStringLiteral("other.txt"));
+    QFile other(otherPath);
+    QVERIFY(other.open(QIODevice::WriteOnly));
+    other.write(QByteArray(10000, 'x'));
+    other.close();
+    QVERIFY(setModificationTime(otherPath, now.addSecs(-1000)));
+
+    // Reading 0 makes it the most recently used
+    SharedTextureData read;
+    QVERIFY(SharedTextureCache::read(cacheDir.filePath(QStringLiteral("0.qwltex")), &read));
+
+    const QDir dir(cacheDir.path());
+    SharedTextureCache::prune(cacheDir.path(), 4 * fileSize);
+    QCOMPARE(dir.entryList(QDir::Files, QDir::Name).size(), 5);
+
+    SharedTextureCache::prune(cacheDir.path(), 2 * fileSize);
+    QCOMPARE(dir.entryList(QDir::Files, QDir::Name),
+             QStringList({ QStringLiteral("0.qwltex"), QStringLiteral("3.qwltex"), QStringLiteral("other.txt") }));
+
+    SharedTextureCache::prune(cacheDir.path(), 0);
+    QCOMPARE(dir.entryList(QDir::Files, QDir::Name), QStringList { QStringLiteral("other.txt") });
+}
+
+void tst_TextureSharing::cacheDirectoryLimit()
+{
+    QTemporaryDir imageDir;
+    QVERIFY(imageDir.isValid());
+    QImage red(8, 8, QImage::Format_RGBA8888_Premultiplied);
+    red.fill(Qt::red);
+    QVERIFY(red.save(imageDir.filePath(QStringLiteral("red.png"))));
+    QImage blue(16, 16, QImage::Format_RGBA8888_Premultiplied);
+    blue.fill(Qt::blue);
+    QVERIFY(blue.save(imageDir.filePath(QStringLiteral("blue.png"))));
+
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+    const QDir dir(cacheDir.path());
+    const QStringList cacheFilter { QStringLiteral("*.qwltex") };
+
+    TestCompositor compositor;
+    compositor.create();
+    installFakeIntegration(&compositor);
+    TestTextureSharingExtension extension(&compositor);
+    extension.setImageSearchPath(imageDir.path());
+    extension.setCacheDirectory(cacheDir.path());
+    QCOMPARE(extension.cacheDirectoryLimit(), qint64(256 * 1024 * 1024));
+    QTRY_VERIFY(extension.isInitialized());
+
+    int results = 0;
+    connect(&extension, &QWaylandTextureSharingExtension::bufferResult, this, [&results] { ++results; });
+
+    // The decoded pixels are written to the cache directory
+    extension.requestBuffer(QStringLiteral("red"));
+    QTRY_COMPARE(results, 1);
+    const QFileInfoList redFiles = dir.entryInfoList(cacheFilter, QDir::Files);
+    QCOMPARE(redFiles.size(), 1);
+    QCOMPARE(redFiles.first().size(), qint64(64 + 8 * 8 * 4));
+    QVERIFY(setModificationTime(redFiles.first().filePath(), QDateTime::currentDateTimeUtc().addSecs(-3600)));
+
+    // Writing another file drops the least recently used ones that no longer fit
+    const qint64 blueFileSize = 64 + 16 * 16 * 4;
+    extension.setCacheDirectoryLimit(blueFileSize);
+    extension.requestBuffer(QStringLiteral("blue"));
+    QTRY_COMPARE(results, 2);
+    const QFileInfoList blueFiles = dir.entryInfoList(cacheFilter, QDir::Files);
+    QCOMPARE(blueFiles.size(), 1);
+    QCOMPARE(blueFiles.first().size(), blueFileSize);
+}
+
+#include <tst_texturesharing.moc>
+QTEST_MAIN(tst_TextureSharing);
@@ -0,0 +1,18 @@
+CONFIG += testcase
+TARGET = tst_tracemerge
+
+QT = core testlib
+
+# The trace writer of the client and compositor libraries, and the merge logic of qtwaylandtracemerge
+INCLUDEPATH += \
+    ../../../src/shared \
+    ../../../src/qtwaylandtracemerge
+
+HEADERS += \
+    ../../../src/shared/qwaylandtracewriter_p.h \
+    ../../../src/qtwaylandtracemerge/tracemerger.h
+
+SOURCES += \
+    tst_tracemerge.cpp \
+    ../../../src/shared/qwaylandtracewriter.cpp \
+    ../../../src/qtwaylandtracemerge/tracemerger.cpp
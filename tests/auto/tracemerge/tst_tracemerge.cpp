@@ -0,0 +1,277 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwaylandtracewriter_p.h"
+#include "tracemerger.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+#include <unistd.h>
+
+struct TraceArg
+{
+    const char *name;
+    qint64 value;
+};
+
+static QJsonDocument readTrace(const QString &fileName, QJsonParseError *error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QJsonDocument();
+    return QJsonDocument::fromJson(file.readAll(), error);
+}
+
+static QJsonObject findEvent(const QJsonArray &events, const QString &name, const QString &phase,
+                             const QString &arg = QString(), qint64 value = 0)
+{
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QLatin1String("name")).toString() != name
+                || event.value(QLatin1String("ph")).toString() != phase)
+            continue;
+        if (!arg.isEmpty() && event.value(QLatin1String("args")).toObject().value(arg).toVariant().toLongLong() != value)
+            continue;
+        return event;
+    }
+    return QJsonObject();
+}
+
+class tst_TraceMerge : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void writerProducesValidJson();
+    void mergeTruncatedTrace();
+    void mergeLinksCommitsAndFrameCallbacks();
+
+private:
+    void writeTraces(const QString &clientFileName, const QString &compositorFileName);
+
+    QTemporaryDir m_dir;
+    qint64 m_clientCommitTs = 0;
+    qint64 m_compositorCommitTs = 0;
+    qint64 m_compositorFrameCallbackTs = 0;
+    qint64 m_clientFrameCallbackTs = 0;
+};
+
+// The events of one frame of a client, and of the compositor handling it, as written by
+// QWaylandWindow and QWaylandSurface
+void tst_TraceMerge::writeTraces(const QString &clientFileName, const QString &compositorFileName)
+{
+    const qint64 pid = ::getpid();
+    const qint64 surface = 3;
+    const qint64 frameCallback = 7;
+    const qint64 start = QWaylandTraceWriter::timestamp();
+
+    QWaylandTraceWriter client;
+    QVERIFY(client.open(clientFileName, "client"));
+    QWaylandTraceWriter compositor;
+    QVERIFY(compositor.open(compositorFileName, "compositor"));
+
+    m_clientCommitTs = start + 1000;
+    client.writeEvent("commit", 'X', m_clientCommitTs, 500, QWaylandTraceWriter::formatArgs<TraceArg>({
+        { "surface", surface }, { "seq", 1 }, { "frameCallback", frameCallback }
+    }));
+    // A later commit without a frame callback, which can't be linked
+    client.writeEvent("commit", 'X', start + 1500, 500, QWaylandTraceWriter::formatArgs<TraceArg>({
+        { "surface", surface }, { "seq", 2 }, { "frameCallback", 0 }
+    }));
+
+    m_compositorCommitTs = start + 2000;
+    compositor.writeEvent("surface_commit", 'X', m_compositorCommitTs, 250, QWaylandTraceWriter::formatArgs<TraceArg>({
+        { "client", pid }, { "surface", surface }, { "seq", 1 }, { "frameCallback", frameCallback }, { "newBuffer", 1 }
+    }));
+    // The same frame callback id on another surface doesn't belong to the client commit
+    compositor.writeEvent("surface_commit", 'X', start + 2500, 250, QWaylandTraceWriter::formatArgs<TraceArg>({
+        { "client", pid }, { "surface", surface + 1 }, { "seq", 1 }, { "frameCallback", frameCallback }, { "newBuffer", 1 }
+    }));
+    compositor.writeEvent("render", 'B', start + 3000, 0, QByteArray());
+    compositor.writeEvent("render", 'E', start + 4000, 0, QByteArray());
+
+    m_compositorFrameCallbackTs = start + 5000;
+    compositor.writeEvent("frameCallback", 'X', m_compositorFrameCallbackTs, 100, QWaylandTraceWriter::formatArgs<TraceArg>({
+        { "client", pid }, { "frameCallback", frameCallback }
+    }));
+
+    m_clientFrameCallbackTs = start + 6000;
+    client.writeEvent("frameCallback", 'X', m_clientFrameCallbackTs, 100, QWaylandTraceWriter::formatArgs<TraceArg>({
+        { "surface", surface }, { "frameCallback", frameCallback }
+    }));
+}
+
+void tst_TraceMerge::writerProducesValidJson()
+{
+    QVERIFY(m_dir.isValid());
+    const QString clientFileName = m_dir.filePath(QStringLiteral("valid-client-%p.json"));
+    const QString compositorFileName = m_dir.filePath(QStringLiteral("valid-compositor.json"));
+    writeTraces(clientFileName, compositorFileName);
+    if (QTest::currentTestFailed())
+        return;
+
+    // "%p" is replaced by the pid
+    const QString pid = QString::number(::getpid());
+    const QString clientTrace = m_dir.filePath(QStringLiteral("valid-client-%1.json").arg(pid));
+    QVERIFY(QFile::exists(clientTrace));
+
+    for (const QString &fileName : { clientTrace, compositorFileName }) {
+        QJsonParseError error;
+        const QJsonDocument document = readTrace(fileName, &error);
+        QCOMPARE(error.error, QJsonParseError::NoError);
+        QVERIFY(document.isArray());
+
+        const QJsonArray events = document.array();
+        const QJsonObject processName = events.first().toObject();
+        QCOMPARE(processName.value(QLatin1String("ph")).toString(), QStringLiteral("M"));
+        QCOMPARE(processName.value(QLatin1String("pid")).toVariant().toLongLong(), qint64(::getpid()));
+
+        for (const QJsonValue &value : events) {
+            const QJsonObject event = value.toObject();
+            QVERIFY(event.contains(QLatin1String("name")));
+            QVERIFY(event.contains(QLatin1String("pid")));
+            QVERIFY(event.contains(QLatin1String("tid")));
+        }
+    }
+
+    QJsonParseError error;
+    const QJsonArray clientEvents = readTrace(clientTrace, &error).array();
+    QCOMPARE(clientEvents.first().toObject().value(QLatin1String("args")).toObject().value(QLatin1String("name")).toString(),
+             QStringLiteral("client"));
+
+    // Timestamps are in microseconds, and complete events have a duration
+    const QJsonObject commit = findEvent(clientEvents, QStringLiteral("commit"), QStringLiteral("X"), QStringLiteral("seq"), 1);
+    QVERIFY(!commit.isEmpty());
+    QCOMPARE(commit.value(QLatin1String("ts")).toDouble(), m_clientCommitTs / 1000.);
+    QCOMPARE(commit.value(QLatin1String("dur")).toDouble(), 0.5);
+    QCOMPARE(commit.value(QLatin1String("args")).toObject().value(QLatin1String("surface")).toInt(), 3);
+}
+
+void tst_TraceMerge::mergeTruncatedTrace()
+{
+    QVERIFY(m_dir.isValid());
+    const QString clientFileName = m_dir.filePath(QStringLiteral("truncated-client.json"));
+    const QString compositorFileName = m_dir.filePath(QStringLiteral("truncated-compositor.json"));
+    writeTraces(clientFileName, compositorFileName);
+    if (QTest::currentTestFailed())
+        return;
+
+    // A trace cut short by a crash has neither the closing bracket nor the last event
+    QFile file(compositorFileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray data = file.readAll();
+    file.close();
+    data.truncate(data.lastIndexOf("\n{"));
+    QVERIFY(data.endsWith(','));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(data);
+    file.close();
+
+    TraceMerger merger;
+    QVERIFY(merger.addFile(clientFileName));
+    QVERIFY(merger.addFile(compositorFileName));
+    merger.linkEvents();
+
+    // The compositor's frame callback event was lost, but the commit is still linked
+    QCOMPARE(merger.commitLinks, 1);
+    QCOMPARE(merger.frameCallbackLinks, 0);
+
+    // Garbage is rejected
+    const QString garbageFileName = m_dir.filePath(QStringLiteral("garbage.json"));
+    QFile garbage(garbageFileName);
+    QVERIFY(garbage.open(QIODevice::WriteOnly));
+    garbage.write("[{\"name\":");
+    garbage.close();
+    QVERIFY(!TraceMerger().addFile(garbageFileName));
+}
+
+void tst_TraceMerge::mergeLinksCommitsAndFrameCallbacks()
+{
+    QVERIFY(m_dir.isValid());
+    const QString clientFileName = m_dir.filePath(QStringLiteral("client.json"));
+    const QString compositorFileName = m_dir.filePath(QStringLiteral("compositor.json"));
+    writeTraces(clientFileName, compositorFileName);
+    if (QTest::currentTestFailed())
+        return;
+
+    TraceMerger merger;
+    QVERIFY(merger.addFile(clientFileName));
+    QVERIFY(merger.addFile(compositorFileName));
+    merger.linkEvents();
+    QCOMPARE(merger.commitLinks, 1);
+    QCOMPARE(merger.frameCallbackLinks, 1);
+
+    // The merged trace is valid JSON in the object format
+    const QString mergedFileName = m_dir.filePath(QStringLiteral("merged.json"));
+    QVERIFY(merger.write(mergedFileName));
+    QJsonParseError error;
+    const QJsonDocument document = readTrace(mergedFileName, &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QVERIFY(document.isObject());
+    QCOMPARE(document.object(), merger.mergedTrace());
+    const QJsonArray events = document.object().value(QLatin1String("traceEvents")).toArray();
+
+    // The compositor commit of the client's surface knows the client's commit sequence number
+    const QJsonObject surfaceCommit = findEvent(events, QStringLiteral("surface_commit"), QStringLiteral("X"),
+                                                QStringLiteral("surface"), 3);
+    QVERIFY(!surfaceCommit.isEmpty());
+    QCOMPARE(surfaceCommit.value(QLatin1String("args")).toObject().value(QLatin1String("clientSeq")).toInt(), 1);
+    const QJsonObject otherSurfaceCommit = findEvent(events, QStringLiteral("surface_commit"), QStringLiteral("X"),
+                                                     QStringLiteral("surface"), 4);
+    QVERIFY(!otherSurfaceCommit.isEmpty());
+    QVERIFY(!otherSurfaceCommit.value(QLatin1String("args")).toObject().contains(QLatin1String("clientSeq")));
+
+    // A flow from the client commit to the compositor commit
+    const QJsonObject commitStart = findEvent(events, QStringLiteral("commit"), QStringLiteral("s"));
+    const QJsonObject commitFinish = findEvent(events, QStringLiteral("commit"), QStringLiteral("f"));
+    QVERIFY(!commitStart.isEmpty());
+    QVERIFY(!commitFinish.isEmpty());
+    QCOMPARE(commitStart.value(QLatin1String("id")), commitFinish.value(QLatin1String("id")));
+    QCOMPARE(commitStart.value(QLatin1String("ts")).toDouble(), m_clientCommitTs / 1000.);
+    QCOMPARE(commitFinish.value(QLatin1String("ts")).toDouble(), m_compositorCommitTs / 1000.);
+    QCOMPARE(commitFinish.value(QLatin1String("bp")).toString(), QStringLiteral("e"));
+
+    // And one from the frame callback the compositor sent to the client handling it
+    const QJsonObject frameStart = findEvent(events, QStringLiteral("frameCallback"), QStringLiteral("s"));
+    const QJsonObject frameFinish = findEvent(events, QStringLiteral("frameCallback"), QStringLiteral("f"));
+    QVERIFY(!frameStart.isEmpty());
+    QVERIFY(!frameFinish.isEmpty());
+    QCOMPARE(frameStart.value(QLatin1String("id")), frameFinish.value(QLatin1String("id")));
+    QVERIFY(frameStart.value(QLatin1String("id")) != commitStart.value(QLatin1String("id")));
+    QCOMPARE(frameStart.value(QLatin1String("ts")).toDouble(), m_compositorFrameCallbackTs / 1000.);
+    QCOMPARE(frameFinish.value(QLatin1String("ts")).toDouble(), m_clientFrameCallbackTs / 1000.);
+}
+
+QTEST_GUILESS_MAIN(tst_TraceMerge)
+
+#include "tst_tracemerge.moc"
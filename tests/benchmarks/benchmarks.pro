@@ -0,0 +1,14 @@
+TEMPLATE=subdirs
+QT_FOR_CONFIG += waylandclient-private
+
+# Run with "make benchmark". Pass e.g. TESTARGS="-o results.xml,xml" (or -csv, -teamcity)
+# to get results CI can track instead of the plain text log.
+
+qtHaveModule(waylandclient): \
+    SUBDIRS += client
+
+qtHaveModule(waylandcompositor): \
+    SUBDIRS += compositor
+
+qtHaveModule(waylandclient):qtHaveModule(waylandcompositor): \
+    SUBDIRS += scanner
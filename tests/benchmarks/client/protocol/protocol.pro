@@ -0,0 +1,8 @@
+include (../../../auto/client/shared/shared.pri)
+
+CONFIG += benchmark
+QT += gui-private
+INCLUDEPATH += ../../../auto/client/shared
+
+TARGET = tst_bench_clientprotocol
+SOURCES += tst_bench_clientprotocol.cpp
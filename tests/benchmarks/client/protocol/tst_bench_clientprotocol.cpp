@@ -0,0 +1,304 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "mockcompositor.h"
+
+#include <QtGui/QClipboard>
+#include <QtGui/QPainter>
+#include <QtGui/QRasterWindow>
+#include <QtGui/private/qguiapplication_p.h>
+#include <QtCore/QMimeData>
+#include <QtCore/QThread>
+#include <QtWaylandClient/private/qwaylanddisplay_p.h>
+#include <QtWaylandClient/private/qwaylandintegration_p.h>
+
+#include <algorithm>
+
+using namespace MockCompositor;
+
+// As defined in linux/input-event-codes.h
+#ifndef KEY_A
+#define KEY_A 30
+#endif
+
+// QTRY_* polls in 50 ms steps, which would swamp everything we try to measure here,
+// so spin the client event loop until the condition holds instead.
+template<typename Predicate>
+static bool spinUntil(Predicate predicate, int timeout = 5000)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!predicate()) {
+        if (timer.hasExpired(timeout))
+            return false;
+        QCoreApplication::processEvents();
+        QThread::yieldCurrentThread();
+    }
+    return true;
+}
+
+#define SPIN_VERIFY(expr) QVERIFY(spinUntil([&] { return (expr); }))
+#define QCOMPOSITOR_SPIN_VERIFY(expr) SPIN_VERIFY(exec([&] { return (expr); }))
+
+// The wl_seat globals the client currently knows about
+static int clientSeatCount()
+{
+    auto *waylandIntegration = static_cast<QtWaylandClient::QWaylandIntegration *>(QGuiApplicationPrivate::platformIntegration());
+    const auto globals = waylandIntegration->display()->globals();
+    return int(std::count_if(globals.begin(), globals.end(), [](const QtWaylandClient::QWaylandDisplay::RegistryGlobal &global) {
+        return global.interface == QLatin1String("wl_seat");
+    }));
+}
+
+class BenchmarkCompositor : public DefaultCompositor {
+public:
+    explicit BenchmarkCompositor()
+    {
+        exec([this] {
+            m_config.autoConfigure = true;
+            add<DataDeviceManager>(1);
+        });
+    }
+    DataDevice *dataDevice() { return get<DataDeviceManager>()->deviceFor(get<Seat>()); }
+};
+
+class BenchmarkWindow : public QRasterWindow
+{
+public:
+    explicit BenchmarkWindow(const QSize &size = QSize(256, 256)) { resize(size); }
+
+    void paintEvent(QPaintEvent *) override
+    {
+        QPainter painter(this);
+        painter.fillRect(rect(), (++m_frames & 1) ? Qt::red : Qt::blue);
+        if (m_animating)
+            update();
+    }
+    void mouseMoveEvent(QMouseEvent *) override { ++m_mouseMoves; }
+    void keyPressEvent(QKeyEvent *) override { ++m_keyPresses; }
+
+    bool m_animating = false;
+    int m_frames = 0;
+    int m_mouseMoves = 0;
+    int m_keyPresses = 0;
+};
+
+class tst_bench_clientprotocol : public QObject, private BenchmarkCompositor
+{
+    Q_OBJECT
+private slots:
+    void cleanup() { QTRY_VERIFY2(isClean(), qPrintable(dirtyMessage())); }
+    void surfaceLifecycle();
+    void frameRoundTrip();
+    void shmBufferChurn_data();
+    void shmBufferChurn();
+    void pointerMotion_data();
+    void pointerMotion();
+    void clipboardTransfer_data();
+    void clipboardTransfer();
+    // Leaves a seat behind per iteration, as the client never releases them, so keep it last
+    void seatStartup();
+
+private:
+    Surface *showAndWaitForBuffer(QWindow *window);
+    uint m_motions = 0;
+};
+
+Surface *tst_bench_clientprotocol::showAndWaitForBuffer(QWindow *window)
+{
+    window->show();
+    if (!spinUntil([&] { return exec([&] { return xdgSurface() && xdgSurface()->m_surface->m_committed.buffer; }); }))
+        return nullptr;
+    return exec([&] { return xdgSurface()->m_surface; });
+}
+
+void tst_bench_clientprotocol::surfaceLifecycle()
+{
+    // Create, configure, commit the first buffer and destroy a toplevel
+    QBENCHMARK {
+        BenchmarkWindow window(QSize(64, 64));
+        QVERIFY(showAndWaitForBuffer(&window));
+        window.destroy();
+        QCOMPOSITOR_SPIN_VERIFY(!surface());
+    }
+}
+
+void tst_bench_clientprotocol::frameRoundTrip()
+{
+    // Time from wl_callback.done to the next attach+damage+commit from the client
+    BenchmarkWindow window;
+    window.m_animating = true;
+    Surface *s = showAndWaitForBuffer(&window);
+    QVERIFY(s);
+
+    QBENCHMARK {
+        QCOMPOSITOR_SPIN_VERIFY(!s->m_waitingFrameCallbacks.empty());
+        const int commits = exec([&] {
+            s->sendFrameCallbacks();
+            return s->m_commits.size();
+        });
+        QCOMPOSITOR_SPIN_VERIFY(s->m_commits.size() > commits && s->m_committed.buffer);
+    }
+}
+
+void tst_bench_clientprotocol::shmBufferChurn_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::newRow("64x64") << QSize(64, 64);
+    QTest::newRow("512x512") << QSize(512, 512);
+    QTest::newRow("1920x1080") << QSize(1920, 1080);
+}
+
+void tst_bench_clientprotocol::shmBufferChurn()
+{
+    // Every resize makes the backing store throw away its buffers and allocate a new pool
+    QFETCH(QSize, size);
+    BenchmarkWindow window(size);
+    Surface *s = showAndWaitForBuffer(&window);
+    QVERIFY(s);
+
+    const QSize sizes[] = { size, size + QSize(1, 1) };
+    int i = 0;
+    QBENCHMARK {
+        const QSize target = sizes[++i & 1];
+        window.resize(target);
+        SPIN_VERIFY(exec([&] {
+            s->sendFrameCallbacks();
+            return s->m_committed.buffer && s->m_committed.buffer->size() == target;
+        }));
+    }
+}
+
+void tst_bench_clientprotocol::pointerMotion_data()
+{
+    QTest::addColumn<int>("events");
+    QTest::newRow("1") << 1;
+    QTest::newRow("16") << 16;
+    QTest::newRow("256") << 256;
+}
+
+void tst_bench_clientprotocol::pointerMotion()
+{
+    // Motion+frame pairs, from the compositor sending them to the QMouseEvents being delivered
+    QFETCH(int, events);
+    BenchmarkWindow window;
+    QVERIFY(showAndWaitForBuffer(&window));
+
+    exec([&] {
+        pointer()->sendEnter(xdgSurface()->m_surface, {1, 1});
+        pointer()->sendFrame(client());
+    });
+
+    QBENCHMARK {
+        const int expected = window.m_mouseMoves + events;
+        exec([&] {
+            for (int i = 0; i < events; ++i, ++m_motions) {
+                // Consecutive positions always differ, so none of them are dropped as duplicates
+                pointer()->sendMotion(client(), QPointF(8 + m_motions % 240, 8 + (m_motions / 240) % 240));
+                pointer()->sendFrame(client());
+            }
+        });
+        SPIN_VERIFY(window.m_mouseMoves >= expected);
+    }
+
+    exec([&] {
+        pointer()->sendLeave(xdgSurface()->m_surface);
+        pointer()->sendFrame(client());
+    });
+}
+
+void tst_bench_clientprotocol::clipboardTransfer_data()
+{
+    QTest::addColumn<int>("bytes");
+    QTest::newRow("4KiB") << 4 * 1024;
+    QTest::newRow("256KiB") << 256 * 1024;
+    QTest::newRow("4MiB") << 4 * 1024 * 1024;
+}
+
+void tst_bench_clientprotocol::clipboardTransfer()
+{
+    // A fresh selection per iteration, since the client caches the data of the current offer
+    QFETCH(int, bytes);
+    const QByteArray payload(bytes, 'q');
+    const QString mimeType = QStringLiteral("application/octet-stream");
+
+    BenchmarkWindow window;
+    QVERIFY(showAndWaitForBuffer(&window));
+    exec([&] { keyboard()->sendEnter(xdgSurface()->m_surface); }); // Selections need keyboard focus
+
+    int changes = 0;
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    auto connection = connect(clipboard, &QClipboard::dataChanged, this, [&] { ++changes; });
+
+    QBENCHMARK {
+        const int expected = changes + 1;
+        exec([&] {
+            auto *offer = dataDevice()->sendDataOffer(client(), {mimeType});
+            connect(offer, &DataOffer::receive, [&](QString, int fd) {
+                QFile file;
+                file.open(fd, QIODevice::WriteOnly, QFile::FileHandleFlag::AutoCloseHandle);
+                file.write(payload);
+                file.close();
+            });
+            dataDevice()->sendSelection(offer);
+        });
+        SPIN_VERIFY(changes >= expected);
+        QCOMPARE(clipboard->mimeData()->data(mimeType).size(), bytes);
+    }
+
+    disconnect(connection);
+    exec([&] { keyboard()->sendLeave(xdgSurface()->m_surface); });
+}
+
+void tst_bench_clientprotocol::seatStartup()
+{
+    // Binding a new seat and its devices, up to the first key press, which is when the client
+    // compiles its keymap. Each iteration removes its seat again, so they don't pile up.
+    BenchmarkWindow window;
+    QVERIFY(showAndWaitForBuffer(&window));
+    const int seatCount = clientSeatCount();
+
+    QBENCHMARK {
+        const int expected = window.m_keyPresses + 1;
+        auto *seat = exec([&] { return add<Seat>(Seat::capability_pointer | Seat::capability_keyboard); });
+        QCOMPOSITOR_SPIN_VERIFY(seat->m_keyboard && seat->m_keyboard->resourceHash().contains(client()));
+        exec([&] {
+            seat->m_keyboard->sendEnter(xdgSurface()->m_surface);
+            seat->m_keyboard->sendKey(client(), KEY_A, Keyboard::key_state_pressed);
+            seat->m_keyboard->sendKey(client(), KEY_A, Keyboard::key_state_released);
+        });
+        SPIN_VERIFY(window.m_keyPresses >= expected);
+
+        exec([&] { remove(seat); });
+        SPIN_VERIFY(clientSeatCount() == seatCount);
+    }
+}
+
+QCOMPOSITOR_TEST_MAIN(tst_bench_clientprotocol)
+#include "tst_bench_clientprotocol.moc"
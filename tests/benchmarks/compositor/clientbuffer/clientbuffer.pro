@@ -0,0 +1,14 @@
+CONFIG += testcase benchmark link_pkgconfig
+CONFIG += wayland-scanner
+TARGET = tst_bench_clientbuffer
+
+QT += testlib
+
+# Reuse the mock client and test compositor of the compositor autotest
+include(../../../auto/compositor/compositor/compositor.pri)
+
+HEADERS += \
+    ../../../auto/compositor/compositor/allocationcounter.h
+
+SOURCES += \
+    tst_bench_clientbuffer.cpp
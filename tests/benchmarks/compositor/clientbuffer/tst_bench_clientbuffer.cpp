@@ -0,0 +1,139 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "allocationcounter.h"
+#include "mockclient.h"
+#include "testcompositor.h"
+
+#include <QtTest/QtTest>
+
+class tst_bench_clientbuffer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void allocationsPerBuffer();
+    void bufferPerFrame();
+
+private:
+    void dispatch(QWaylandCompositor *compositor, MockClient *client, bool count);
+
+    QTemporaryDir m_tmpRuntimeDir;
+};
+
+void tst_bench_clientbuffer::init()
+{
+    // We need to set a test specific runtime dir so we don't conflict with other tests'
+    // compositors by accident.
+    qputenv("XDG_RUNTIME_DIR", m_tmpRuntimeDir.path().toLocal8Bit());
+}
+
+// Lets the compositor handle what the client sent so far, then lets the client read the
+// replies, so the socket buffers never fill up however many iterations we run.
+void tst_bench_clientbuffer::dispatch(QWaylandCompositor *compositor, MockClient *client, bool count)
+{
+    wl_display_flush(client->display);
+    AllocationCounter::setCounting(count);
+    compositor->processWaylandEvents();
+    AllocationCounter::setCounting(false);
+    QCoreApplication::processEvents();
+}
+
+void tst_bench_clientbuffer::allocationsPerBuffer()
+{
+    // A client that allocates a new wl_buffer for every frame, like many video players do.
+    // Reports the heap allocations the compositor makes for each of them, counted at the
+    // malloc level where possible, so libwayland's and the Qt containers' are included.
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.first();
+
+    const QSize size(64, 64);
+    const int warmup = 64;
+    const int iterations = 1000;
+    QScopedPointer<ShmBuffer> previous;
+    const auto allocationCount = AllocationCounter::countsMalloc()
+            ? AllocationCounter::mallocAllocations : AllocationCounter::newAllocations;
+    quint64 allocations = 0;
+
+    for (int i = 0; i < warmup + iterations; ++i) {
+        if (i == warmup)
+            allocations = allocationCount();
+
+        auto *buffer = new ShmBuffer(size, client.shm);
+        wl_surface_attach(surface, buffer->handle, 0, 0);
+        wl_surface_damage(surface, 0, 0, size.width(), size.height());
+        wl_surface_commit(surface);
+        dispatch(&compositor, &client, true);
+
+        previous.reset(buffer); // Destroys the buffer of the frame before
+        dispatch(&compositor, &client, true);
+    }
+    allocations = allocationCount() - allocations;
+    QVERIFY(waylandSurface->hasContent());
+
+    QTest::setBenchmarkResult(qreal(allocations) / iterations, QTest::Events);
+
+    wl_surface_destroy(surface);
+}
+
+void tst_bench_clientbuffer::bufferPerFrame()
+{
+    // The same as above, timed
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+
+    const QSize size(64, 64);
+    QScopedPointer<ShmBuffer> previous;
+
+    QBENCHMARK {
+        auto *buffer = new ShmBuffer(size, client.shm);
+        wl_surface_attach(surface, buffer->handle, 0, 0);
+        wl_surface_damage(surface, 0, 0, size.width(), size.height());
+        wl_surface_commit(surface);
+        dispatch(&compositor, &client, false);
+
+        previous.reset(buffer);
+        dispatch(&compositor, &client, false);
+    }
+
+    wl_surface_destroy(surface);
+}
+
+QTEST_MAIN(tst_bench_clientbuffer);
+#include "tst_bench_clientbuffer.moc"
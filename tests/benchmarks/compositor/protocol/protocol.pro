@@ -0,0 +1,11 @@
+CONFIG += testcase benchmark link_pkgconfig
+CONFIG += wayland-scanner
+TARGET = tst_bench_compositorprotocol
+
+QT += testlib
+
+# Reuse the mock client and test compositor of the compositor autotest
+include(../../../auto/compositor/compositor/compositor.pri)
+
+SOURCES += \
+    tst_bench_compositorprotocol.cpp
@@ -0,0 +1,313 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "mockclient.h"
+#include "mockseat.h"
+#include "mockpointer.h"
+#include "testcompositor.h"
+
+#include "qwaylandview.h"
+#include "qwaylandseat.h"
+
+#include <QtTest/QtTest>
+
+// QTRY_* polls in 50 ms steps, which would swamp everything we try to measure here,
+// so spin the event loop until the condition holds instead.
+template<typename Predicate>
+static bool spinUntil(Predicate predicate, int timeout = 5000)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!predicate()) {
+        if (timer.hasExpired(timeout))
+            return false;
+        QCoreApplication::processEvents();
+    }
+    return true;
+}
+
+#define SPIN_VERIFY(expr) QVERIFY(spinUntil([&] { return (expr); }))
+
+static void frameCallbackFunc(void *data, wl_callback *callback, uint32_t)
+{
+    ++*static_cast<int *>(data);
+    wl_callback_destroy(callback);
+}
+
+static void registerFrameCallback(wl_surface *surface, int *counter)
+{
+    static const wl_callback_listener frameCallbackListener = {
+        frameCallbackFunc
+    };
+
+    wl_callback_add_listener(wl_surface_frame(surface), &frameCallbackListener, counter);
+}
+
+class tst_bench_compositorprotocol : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void surfaceLifecycle();
+    void frameRoundTrip();
+    void frameWithIdleSurfaces_data();
+    void frameWithIdleSurfaces();
+    void shmBufferChurn_data();
+    void shmBufferChurn();
+    void pointerMotion_data();
+    void pointerMotion();
+    void clientStartup();
+
+private:
+    QTemporaryDir m_tmpRuntimeDir;
+};
+
+void tst_bench_compositorprotocol::init()
+{
+    // We need to set a test specific runtime dir so we don't conflict with other tests'
+    // compositors by accident.
+    qputenv("XDG_RUNTIME_DIR", m_tmpRuntimeDir.path().toLocal8Bit());
+}
+
+void tst_bench_compositorprotocol::surfaceLifecycle()
+{
+    // create_surface, attach+damage+commit of a first buffer, and destroy
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    const QSize size(64, 64);
+    ShmBuffer buffer(size, client.shm);
+
+    QBENCHMARK {
+        wl_surface *surface = client.createSurface();
+        wl_surface_attach(surface, buffer.handle, 0, 0);
+        wl_surface_damage(surface, 0, 0, size.width(), size.height());
+        wl_surface_commit(surface);
+        SPIN_VERIFY(compositor.surfaces.size() == 1 && compositor.surfaces.first()->hasContent());
+
+        wl_surface_destroy(surface);
+        SPIN_VERIFY(compositor.surfaces.isEmpty());
+    }
+}
+
+void tst_bench_compositorprotocol::frameRoundTrip()
+{
+    // From the client's commit to the wl_callback.done of the frame the compositor drew for it
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    SPIN_VERIFY(compositor.surfaces.size() == 1);
+
+    QWaylandSurface *waylandSurface = compositor.surfaces.first();
+    QWaylandView view;
+    view.setSurface(waylandSurface);
+    view.setOutput(compositor.defaultOutput());
+
+    int damaged = 0;
+    connect(waylandSurface, &QWaylandSurface::damaged, this, [&] { ++damaged; });
+
+    // A new buffer has to be attached every frame, else there is no damage to wait for
+    const QSize size(256, 256);
+    ShmBuffer buffers[] = { { size, client.shm }, { size, client.shm } };
+    int frames = 0;
+
+    QBENCHMARK {
+        const int expected = frames + 1;
+        wl_surface_attach(surface, buffers[frames & 1].handle, 0, 0);
+        registerFrameCallback(surface, &frames);
+        wl_surface_damage(surface, 0, 0, size.width(), size.height());
+        wl_surface_commit(surface);
+        SPIN_VERIFY(damaged == expected);
+
+        compositor.defaultOutput()->frameStarted();
+        compositor.defaultOutput()->sendFrameCallbacks();
+        SPIN_VERIFY(frames == expected);
+    }
+
+    wl_surface_destroy(surface);
+}
+
+void tst_bench_compositorprotocol::frameWithIdleSurfaces_data()
+{
+    QTest::addColumn<int>("idleSurfaces");
+    QTest::newRow("0") << 0;
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+}
+
+void tst_bench_compositorprotocol::frameWithIdleSurfaces()
+{
+    // One surface asking for frame callbacks among many mapped surfaces that do not;
+    // the cost of a frame should not depend on the idle ones.
+    QFETCH(int, idleSurfaces);
+    TestCompositor compositor;
+    compositor.create();
+    QWaylandOutput *output = compositor.defaultOutput();
+
+    MockClient client;
+    const QSize size(32, 32);
+    ShmBuffer buffer(size, client.shm);
+
+    QVector<wl_surface *> surfaces;
+    for (int i = 0; i <= idleSurfaces; ++i) {
+        wl_surface *surface = client.createSurface();
+        wl_surface_attach(surface, buffer.handle, 0, 0);
+        wl_surface_damage(surface, 0, 0, size.width(), size.height());
+        wl_surface_commit(surface);
+        surfaces.append(surface);
+    }
+    SPIN_VERIFY(compositor.surfaces.size() == idleSurfaces + 1
+                && compositor.surfaces.last()->hasContent());
+
+    QVector<QWaylandView *> views;
+    for (QWaylandSurface *waylandSurface : qAsConst(compositor.surfaces)) {
+        auto *view = new QWaylandView;
+        view->setSurface(waylandSurface);
+        view->setOutput(output);
+        views.append(view);
+    }
+    output->sendFrameCallbacks(); // Sends wl_surface.enter for all of them
+
+    wl_surface *activeSurface = surfaces.last();
+    int commits = 0;
+    connect(compositor.surfaces.last(), &QWaylandSurface::redraw, this, [&] { ++commits; });
+    int frames = 0;
+
+    QBENCHMARK {
+        const int expected = frames + 1;
+        registerFrameCallback(activeSurface, &frames);
+        wl_surface_commit(activeSurface);
+        SPIN_VERIFY(commits == expected);
+
+        output->frameStarted();
+        output->sendFrameCallbacks();
+        SPIN_VERIFY(frames == expected);
+    }
+
+    qDeleteAll(views);
+    for (wl_surface *surface : qAsConst(surfaces))
+        wl_surface_destroy(surface);
+}
+
+void tst_bench_compositorprotocol::shmBufferChurn_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::newRow("64x64") << QSize(64, 64);
+    QTest::newRow("512x512") << QSize(512, 512);
+    QTest::newRow("1920x1080") << QSize(1920, 1080);
+}
+
+void tst_bench_compositorprotocol::shmBufferChurn()
+{
+    // A fresh wl_shm_pool and wl_buffer per frame, as naive clients do
+    QFETCH(QSize, size);
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    SPIN_VERIFY(compositor.surfaces.size() == 1);
+
+    QWaylandSurface *waylandSurface = compositor.surfaces.first();
+    QWaylandView view;
+    view.setSurface(waylandSurface);
+    view.setOutput(compositor.defaultOutput());
+
+    int damaged = 0;
+    connect(waylandSurface, &QWaylandSurface::damaged, this, [&] { ++damaged; });
+
+    QBENCHMARK {
+        const int expected = damaged + 1;
+        ShmBuffer buffer(size, client.shm);
+        wl_surface_attach(surface, buffer.handle, 0, 0);
+        wl_surface_damage(surface, 0, 0, size.width(), size.height());
+        wl_surface_commit(surface);
+        SPIN_VERIFY(damaged == expected);
+    }
+
+    wl_surface_destroy(surface);
+}
+
+void tst_bench_compositorprotocol::pointerMotion_data()
+{
+    QTest::addColumn<int>("events");
+    QTest::newRow("1") << 1;
+    QTest::newRow("16") << 16;
+    QTest::newRow("256") << 256;
+}
+
+void tst_bench_compositorprotocol::pointerMotion()
+{
+    // QWaylandSeat::sendMouseMoveEvent() up to the client having read the wl_pointer.motion
+    QFETCH(int, events);
+    TestCompositor compositor(true);
+    compositor.create();
+
+    MockClient client;
+    client.createSurface();
+    SPIN_VERIFY(compositor.surfaces.size() == 1);
+    SPIN_VERIFY(client.m_seats.size() == 1);
+    MockPointer *mockPointer = client.m_seats.first()->pointer();
+
+    QWaylandView view;
+    view.setSurface(compositor.surfaces.first());
+    QWaylandSeat *seat = compositor.defaultSeat();
+    seat->setMouseFocus(&view);
+
+    uint motions = 0;
+    QBENCHMARK {
+        const uint expected = mockPointer->m_motionCount + events;
+        for (int i = 0; i < events; ++i, ++motions) {
+            // Consecutive positions always differ, so none of them are dropped as duplicates
+            const QPointF position(motions % 240, (motions / 240) % 240);
+            seat->sendMouseMoveEvent(&view, position, position);
+        }
+        compositor.flushClients();
+        SPIN_VERIFY(mockPointer->m_motionCount >= expected);
+    }
+}
+
+void tst_bench_compositorprotocol::clientStartup()
+{
+    // Connecting and binding every global, including the seat and its keymap
+    TestCompositor compositor(true);
+    compositor.create();
+
+    QBENCHMARK {
+        MockClient client;
+        SPIN_VERIFY(client.m_seats.size() == 1);
+    }
+}
+
+QTEST_MAIN(tst_bench_compositorprotocol);
+#include "tst_bench_compositorprotocol.moc"
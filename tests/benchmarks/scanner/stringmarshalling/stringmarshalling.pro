@@ -0,0 +1,42 @@
+CONFIG += benchmark link_pkgconfig
+CONFIG += wayland-scanner
+TARGET = tst_bench_stringmarshalling
+
+QT = core testlib
+QT_FOR_CONFIG += waylandclient-private waylandcompositor-private
+
+QMAKE_USE += wayland-client wayland-server
+
+# The client side is generated the usual way
+WAYLANDCLIENTSOURCES += string-bench.xml
+
+# The server side is generated by hand, so the raw interface can be
+# selected with --raw-strings
+WAYLANDSERVERSOURCES_RAW += string-bench.xml
+
+qtPrepareTool(QMAKE_QTWAYLANDSCANNER, qtwaylandscanner)
+
+wayland_raw_server_header.name = wayland ${QMAKE_FILE_BASE}
+wayland_raw_server_header.input = WAYLANDSERVERSOURCES_RAW
+wayland_raw_server_header.variable_out = HEADERS
+wayland_raw_server_header.output = wayland-${QMAKE_FILE_BASE}-server-protocol$${first(QMAKE_EXT_H)}
+wayland_raw_server_header.commands = $$QMAKE_WAYLAND_SCANNER server-header < ${QMAKE_FILE_IN} > ${QMAKE_FILE_OUT}
+QMAKE_EXTRA_COMPILERS += wayland_raw_server_header
+
+qtwayland_raw_server_header.name = qtwayland ${QMAKE_FILE_BASE}
+qtwayland_raw_server_header.input = WAYLANDSERVERSOURCES_RAW
+qtwayland_raw_server_header.variable_out = HEADERS
+qtwayland_raw_server_header.depends += $$QMAKE_QTWAYLANDSCANNER_EXE wayland-${QMAKE_FILE_BASE}-server-protocol$${first(QMAKE_EXT_H)}
+qtwayland_raw_server_header.output = qwayland-server-${QMAKE_FILE_BASE}$${first(QMAKE_EXT_H)}
+qtwayland_raw_server_header.commands = $$QMAKE_QTWAYLANDSCANNER server-header ${QMAKE_FILE_IN} --raw-strings=qt_string_bench_raw > ${QMAKE_FILE_OUT}
+QMAKE_EXTRA_COMPILERS += qtwayland_raw_server_header
+
+qtwayland_raw_server_code.name = qtwayland ${QMAKE_FILE_BASE}
+qtwayland_raw_server_code.input = WAYLANDSERVERSOURCES_RAW
+qtwayland_raw_server_code.variable_out = SOURCES
+qtwayland_raw_server_code.depends += $$QMAKE_QTWAYLANDSCANNER_EXE qwayland-server-${QMAKE_FILE_BASE}$${first(QMAKE_EXT_H)}
+qtwayland_raw_server_code.output = qwayland-server-${QMAKE_FILE_BASE}.cpp
+qtwayland_raw_server_code.commands = $$QMAKE_QTWAYLANDSCANNER server-code ${QMAKE_FILE_IN} --raw-strings=qt_string_bench_raw > ${QMAKE_FILE_OUT}
+QMAKE_EXTRA_COMPILERS += qtwayland_raw_server_code
+
+SOURCES += tst_bench_stringmarshalling.cpp
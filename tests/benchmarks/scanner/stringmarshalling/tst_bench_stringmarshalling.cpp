@@ -0,0 +1,207 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "wayland-string-bench-client-protocol.h"
+#include "qwayland-server-string-bench.h"
+
+#include <QtTest/QtTest>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+class CopyStringBench : public QtWaylandServer::qt_string_bench_copy
+{
+public:
+    using QtWaylandServer::qt_string_bench_copy::qt_string_bench_copy;
+    int received = 0;
+
+protected:
+    void string_bench_copy_set_text(Resource *resource, const QString &text) override
+    {
+        Q_UNUSED(resource);
+        received += text.size();
+    }
+};
+
+class RawStringBench : public QtWaylandServer::qt_string_bench_raw
+{
+public:
+    using QtWaylandServer::qt_string_bench_raw::qt_string_bench_raw;
+    int received = 0;
+
+protected:
+    void string_bench_raw_set_text(Resource *resource, const char *text) override
+    {
+        Q_UNUSED(resource);
+        received += int(qstrlen(text));
+    }
+};
+
+class tst_bench_stringmarshalling : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void setText_data();
+    void setText();
+
+private:
+    void dispatchServer();
+    void dispatchClient();
+
+    static void handleGlobal(void *data, struct ::wl_registry *registry, uint32_t id,
+                             const char *interface, uint32_t version);
+    static void handleGlobalRemove(void *data, struct ::wl_registry *registry, uint32_t id);
+    static const struct wl_registry_listener s_registryListener;
+
+    struct ::wl_display *m_serverDisplay = nullptr;
+    struct ::wl_display *m_clientDisplay = nullptr;
+    struct ::wl_registry *m_registry = nullptr;
+    struct ::qt_string_bench_copy *m_copy = nullptr;
+    struct ::qt_string_bench_raw *m_raw = nullptr;
+    CopyStringBench *m_copyGlobal = nullptr;
+    RawStringBench *m_rawGlobal = nullptr;
+};
+
+const struct wl_registry_listener tst_bench_stringmarshalling::s_registryListener = {
+    tst_bench_stringmarshalling::handleGlobal,
+    tst_bench_stringmarshalling::handleGlobalRemove
+};
+
+void tst_bench_stringmarshalling::handleGlobal(void *data, struct ::wl_registry *registry, uint32_t id,
+                                               const char *interface, uint32_t version)
+{
+    Q_UNUSED(version);
+    auto *that = static_cast<tst_bench_stringmarshalling *>(data);
+    if (qstrcmp(interface, qt_string_bench_copy_interface.name) == 0) {
+        that->m_copy = static_cast<struct ::qt_string_bench_copy *>(
+                    wl_registry_bind(registry, id, &qt_string_bench_copy_interface, 1));
+    } else if (qstrcmp(interface, qt_string_bench_raw_interface.name) == 0) {
+        that->m_raw = static_cast<struct ::qt_string_bench_raw *>(
+                    wl_registry_bind(registry, id, &qt_string_bench_raw_interface, 1));
+    }
+}
+
+void tst_bench_stringmarshalling::handleGlobalRemove(void *data, struct ::wl_registry *registry, uint32_t id)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(registry);
+    Q_UNUSED(id);
+}
+
+// Both ends live in this thread, so the usual blocking roundtrip would deadlock.
+// Instead every step flushes one side and dispatches the other.
+void tst_bench_stringmarshalling::dispatchServer()
+{
+    QVERIFY(wl_display_flush(m_clientDisplay) >= 0);
+    wl_event_loop_dispatch(wl_display_get_event_loop(m_serverDisplay), 0);
+    wl_display_flush_clients(m_serverDisplay);
+}
+
+void tst_bench_stringmarshalling::dispatchClient()
+{
+    QVERIFY(wl_display_dispatch(m_clientDisplay) >= 0);
+}
+
+void tst_bench_stringmarshalling::initTestCase()
+{
+    int fds[2];
+    QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds), 0);
+
+    m_serverDisplay = wl_display_create();
+    QVERIFY(m_serverDisplay);
+    QVERIFY(wl_client_create(m_serverDisplay, fds[0]));
+    m_copyGlobal = new CopyStringBench(m_serverDisplay, 1);
+    m_rawGlobal = new RawStringBench(m_serverDisplay, 1);
+
+    m_clientDisplay = wl_display_connect_to_fd(fds[1]);
+    QVERIFY(m_clientDisplay);
+    m_registry = wl_display_get_registry(m_clientDisplay);
+    wl_registry_add_listener(m_registry, &s_registryListener, this);
+
+    dispatchServer();
+    dispatchClient();
+    QVERIFY(m_copy);
+    QVERIFY(m_raw);
+    dispatchServer();
+}
+
+void tst_bench_stringmarshalling::cleanupTestCase()
+{
+    qt_string_bench_copy_destroy(m_copy);
+    qt_string_bench_raw_destroy(m_raw);
+    wl_registry_destroy(m_registry);
+    wl_display_disconnect(m_clientDisplay);
+
+    delete m_copyGlobal;
+    delete m_rawGlobal;
+    wl_display_destroy_clients(m_serverDisplay);
+    wl_display_destroy(m_serverDisplay);
+}
+
+void tst_bench_stringmarshalling::setText_data()
+{
+    QTest::addColumn<bool>("raw");
+    QTest::addColumn<QByteArray>("text");
+
+    const QByteArray shortText = QByteArrayLiteral("preedit");
+    const QByteArray title = QByteArrayLiteral("Übersicht — Qt Wayland Compositor");
+    const QByteArray key = QByteArray(240, 'k');
+
+    QTest::newRow("copy-short") << false << shortText;
+    QTest::newRow("raw-short") << true << shortText;
+    QTest::newRow("copy-title") << false << title;
+    QTest::newRow("raw-title") << true << title;
+    QTest::newRow("copy-long") << false << key;
+    QTest::newRow("raw-long") << true << key;
+}
+
+void tst_bench_stringmarshalling::setText()
+{
+    QFETCH(bool, raw);
+    QFETCH(QByteArray, text);
+
+    // Keep each batch well below the connection buffer size
+    const int batchSize = 4096 / (text.size() + 16);
+
+    QBENCHMARK {
+        for (int i = 0; i < batchSize; ++i) {
+            if (raw)
+                qt_string_bench_raw_set_text(m_raw, text.constData());
+            else
+                qt_string_bench_copy_set_text(m_copy, text.constData());
+        }
+        dispatchServer();
+    }
+
+    QVERIFY(m_copyGlobal->received > 0 || m_rawGlobal->received > 0);
+}
+
+QTEST_GUILESS_MAIN(tst_bench_stringmarshalling)
+#include "tst_bench_stringmarshalling.moc"